@@ -24,6 +24,9 @@
  */
 
 #include "QxAutoMLInf.h"
+#include "QxDataCollect.h"
+#include "QxPredictProfile.h"
+#include "QxStack.h"
 
 rtos::Thread sample_thread;
 
@@ -113,16 +116,33 @@ void QxAutoMLInf::sensorInit(void)
     }
 }
 
+#ifdef QX_EXECUTOR
+QxAutoMLInf::QxAutoMLInf(void* lsm6dsm, void* lis2mdl)
+{
+    /* Nothing to do */
+}
+
+/* Timer work of the executor given to InitEngine() */
+void QxAutoMLInf::FillDataWork(void *self)
+{
+    ((QxAutoMLInf *)self)->FillDataFrame();
+}
+#else
+/* In .bss instead of the heap, and painted before the thread starts so QxOS_MemoryReport() shows its use */
+MBED_ALIGN(8) static unsigned char sensor_read_stack[QX_SENSOR_READ_STACK];
+
 QxAutoMLInf::QxAutoMLInf(void* lsm6dsm, void* lis2mdl):
-    _thread_sensor_read(osPriorityISR, 4096, NULL, "sensor_read_thread")
+    _thread_sensor_read(osPriorityISR, sizeof(sensor_read_stack), sensor_read_stack, "sensor_read_thread")
 {
     /* Nothing to do */
 }
+#endif
 
 /*
-    This funtion initialize all requeirements for classification
+    This funtion initialize all requeirements for classification. With QX_EXECUTOR
+    the sensor data is read by a timer of executor instead of a thread.
 */
-void QxAutoMLInf::InitEngine()
+void QxAutoMLInf::InitEngine(tQxExecutor *executor)
 {
     Serial.println("Ready to initialize MLEngine!!");
 
@@ -165,9 +185,18 @@ void QxAutoMLInf::InitEngine()
             to init any sensors that are used by current static classify engine libarary. */
         sensorInit();
 
+#ifdef QX_EXECUTOR
+        /* The sensor data feeding is a 10ms timer, it runs before any other work of the executor */
+        QxOS_WorkInit(&mSensorTimer.work, FillDataWork, this, QxPriorityRealtime);
+        QxOS_ExecutorTimerStart(executor, &mSensorTimer, 0, 10);
+#else
+        (void)executor;
+
         /* Here we create a thread and use ticker & event queue methods to trigger periodically
             sensor data feeding, the feeding interval should be 10ms. */
+        QxOS_PaintStack(sensor_read_stack, sizeof(sensor_read_stack));
         _thread_sensor_read.start(mbed::callback(this, &QxAutoMLInf::FillDataLoop));
+#endif
     } else {
         Serial.println("MLEngine init error!!");
     }
@@ -243,6 +272,9 @@ void QxAutoMLInf::FillDataFrame()
         if(mGyroData) {
             CopyDataToSensorData(gyro_data, mGyroData, read_samples*6);
         }
+
+        /* raw samples for the app while it collects data, see inc/QxDataCollect.h */
+        QxDataCollect_Push(accel_data, gyro_data, read_samples);
      }
 
     /* 2. read MAG data */
@@ -267,21 +299,118 @@ void QxAutoMLInf::FillDataFrame()
     }
 }
 
+#ifdef QX_GOLDEN_DUMP
+#define GOLDEN_WINDOW_MAX 1024 //bytes
+
+/* Copy of a sensor window taken before QXO_MLEngine_Work() */
+typedef struct {
+    SensorData *sensor;
+    uint32_t len;
+    uint8_t data[GOLDEN_WINDOW_MAX];
+} GoldenWindow;
+
+static void GoldenSnapshot(GoldenWindow *window, SensorData *sensor)
+{
+    window->sensor = sensor;
+    window->len = (sensor != NULL) ? MIN(sensor->buff_end, GOLDEN_WINDOW_MAX) : 0;
+    if (window->len > 0) {
+        memcpy(window->data, sensor->buff_ptr, window->len);
+    }
+}
+
+static bool GoldenUnchanged(const GoldenWindow *window)
+{
+    return window->len == 0 || memcmp(window->data, window->sensor->buff_ptr, window->len) == 0;
+}
+
+static void GoldenPrintWindow(const char *key, const GoldenWindow *window)
+{
+    char text[16];
+    const int16_t *samples = (const int16_t *)window->data;
+
+    Serial.print("\"");
+    Serial.print(key);
+    Serial.print("\": [");
+    for (uint32_t i = 0; i < window->len / sizeof(int16_t); i++) {
+        sprintf(text, i ? ", %d" : "%d", samples[i]);
+        Serial.print(text);
+    }
+    Serial.print("], ");
+}
+#endif
+
 int QxAutoMLInf::Classify()
 {
     /* Call classification prediction, the input sensor data in 'mPred' is feeding
         in another thread that created by QxAutoMLInf::InitEngine() */
     int cls = 0;
+
+#ifdef QX_GOLDEN_DUMP
+    /* Golden records for host/harness/qxgolden.cpp. The sensor thread keeps filling
+        the frame, so a record is only printed when the windows did not change while
+        QXO_MLEngine_Work() was reading them. */
+    static GoldenWindow accel_window, gyro_window;
+    QxOS_LockMutex(mPred->mFrameMutex);
+    GoldenSnapshot(&accel_window, mAccelData);
+    GoldenSnapshot(&gyro_window, mGyroData);
+    QxOS_UnLockMutex(mPred->mFrameMutex);
+#endif
+
     cls = QXO_MLEngine_Work(mPred, 0);
+
+#ifdef QX_GOLDEN_DUMP
+    QxOS_LockMutex(mPred->mFrameMutex);
+    bool unchanged = GoldenUnchanged(&accel_window) && GoldenUnchanged(&gyro_window);
+    QxOS_UnLockMutex(mPred->mFrameMutex);
+
+    if (unchanged) {
+        char text[24];
+        Serial.print("GOLDEN {");
+        GoldenPrintWindow("accel", &accel_window);
+        GoldenPrintWindow("gyro", &gyro_window);
+        /* what the original predict() got, checked against a generated predict() on the host */
+        const float *features;
+        uint32_t num_features;
+        if (QxPredictProfile_GetFeatures(&features, &num_features) == QxOK) {
+            Serial.print("\"features\": [");
+            for (uint32_t i = 0; i < num_features; i++) {
+                sprintf(text, i ? ", %.9g" : "%.9g", features[i]);
+                Serial.print(text);
+            }
+            Serial.print("], ");
+        }
+        sprintf(text, "\"cls\": %d, \"probs\": [", cls);
+        Serial.print(text);
+        for (int i = 0; i < mNumOfClasses; i++) {
+            sprintf(text, i ? ", %.9g" : "%.9g", mPred->mProbs[i]);
+            Serial.print(text);
+        }
+        Serial.println("]}");
+    }
+#endif
     const uint8_t buffsize = 125;
     char classifylogBuffer[buffsize];
     int offset = 0;
 
-    offset = sprintf(classifylogBuffer, "PRED: %d", cls);
+    /* snprintf() returns what it would have written, so offset stops at the terminating zero of a full buffer */
+    offset = snprintf(classifylogBuffer, buffsize, "PRED: %d", cls);
+    offset = (offset > buffsize - 1) ? buffsize - 1 : offset;
 
     for (int i = 0; i < mNumOfClasses; i++) {
-        offset += sprintf(classifylogBuffer + offset, ", %.2f", mPred->mProbs[i]);
+        offset += snprintf(classifylogBuffer + offset, buffsize - offset, ", %.2f", mPred->mProbs[i]);
+        offset = (offset > buffsize - 1) ? buffsize - 1 : offset;
+    }
+
+#ifdef QX_PROFILE_PREDICT
+    /* predict() cycles, counted by the --wrap=predict wrapper in QxPredictProfile.cpp */
+    tQxPredictProfile profile;
+    if (QxPredictProfile_Get(&profile) == QxOK && profile.count > 0) {
+        offset += snprintf(classifylogBuffer + offset, buffsize - offset, ", cycles: %lu (min %lu, avg %lu, max %lu)",
+                           (unsigned long)profile.last, (unsigned long)profile.min,
+                           (unsigned long)(profile.total / profile.count), (unsigned long)profile.max);
+        offset = (offset > buffsize - 1) ? buffsize - 1 : offset;
     }
+#endif
 
     Serial.println(classifylogBuffer);
 
@@ -293,3 +422,14 @@ int QxAutoMLInf::GetInterval()
     /* Gets engine preferred prediction interval in millionseconds*/
     return QXO_MLEngine_GetPredictionInterval();
 }
+
+/* Probabilities of the last Classify(), one per class */
+const float *QxAutoMLInf::GetProbs()
+{
+    return mPred->mProbs;
+}
+
+int QxAutoMLInf::GetNumOfClasses()
+{
+    return mNumOfClasses;
+}
@@ -29,22 +29,35 @@
 
 
 #include "QxClassifyEngine.h"
+#include "QxExecutor.h"
 #include "QxSensorHal_Nano33BLE.h"
 
+/* Stack of the sensor thread, trim it to the watermark of QxOS_MemoryReport(). Not used with QX_EXECUTOR */
+#ifndef QX_SENSOR_READ_STACK
+#define QX_SENSOR_READ_STACK 4096
+#endif
+
 class QxAutoMLInf
 {
 public:
   QxAutoMLInf(void*, void*);
-  void InitEngine();
+  void InitEngine(tQxExecutor *executor = NULL);
   void sensorInit();
   void SetDataFrame(PredictionFrame *dataframe);
   void FillDataLoop();
   void FillDataFrame();
   int Classify();
   int GetInterval();
+  const float *GetProbs();
+  int GetNumOfClasses();
 
 private:
+#ifdef QX_EXECUTOR
+  static void FillDataWork(void *self);
+  tQxTimer  mSensorTimer;
+#else
   rtos::Thread  _thread_sensor_read;
+#endif
   pPredictionFrame   mPred;
   int mNumOfClasses;
   float mEngineSensitivity[50];
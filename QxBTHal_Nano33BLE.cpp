@@ -1,17 +1,372 @@
 #include "QxBTHal.h"
 #include <stdio.h>
 #include "QxOS.h"
+#include "QxDataCollect.h"
+#include "QxFrame.h"
+#include "QxRing.h"
+#include "QxStack.h"
+#include <atomic>
 #include <ArduinoBLE.h>
+#include "utility/ATT.h"
+#include "utility/HCI.h"
+#include "utility/HCITransport.h"
+#include "utility/L2CAPCoC.h"
+#include "utility/L2CAPSignaling.h"
 
 #define serviceUUID  "00618b72-a321-389d-8849-cd74f9f0f4eb"
 #define characteristicUUID "10618b72-a321-389d-8849-cd74f9f0f4eb"
+#define rxCharacteristicUUID "20618b72-a321-389d-8849-cd74f9f0f4eb"
+#define resultCharacteristicUUID "30618b72-a321-389d-8849-cd74f9f0f4eb"
+#define dcCharacteristicUUID "40618b72-a321-389d-8849-cd74f9f0f4eb"
+
+#ifndef QX_BT_RX_STACK
+#define QX_BT_RX_STACK 2048
+#endif
+#define QX_BT_RX_POLL_MS 100
+#define QX_BT_DC_POLL_MS 5  /* while collecting, a 10 ms sensor read fills about half a packet at an MTU of 247 */
 
 BLEService automlService(serviceUUID); // create service
 
 // create button characteristic and allow remote device to get notifications
 BLEStringCharacteristic buttonCharacteristic(characteristicUUID, BLERead | BLENotify, 125);
 
+// packed classification results, see tQxBTResult in inc/QxBTHal.h
+BLECharacteristic resultCharacteristic(resultCharacteristicUUID, BLERead | BLENotify, sizeof(tQxBTResult));
+
+// raw samples of data collection, see inc/QxDataCollect.h
+BLECharacteristic dcCharacteristic(dcCharacteristicUUID, BLENotify, QX_DC_PACKET_MAX);
+
+// commands of the app, see inc/QxCommand.h
+BLECharacteristic rxCharacteristic(rxCharacteristicUUID, BLEWrite | BLEWriteWithoutResponse, 125);
+
+/* ArduinoBLE is not thread safe, every BLE call after QxBTHal_Initialize() takes it */
+static tQxMutex *bt_lock;
+
+QX_STATIC_THREAD(bt_rx_thread, "ble_rx", QX_BT_RX_STACK);
+
+static tQxBTConnProfile bt_profile = { QX_BT_MAX_MTU, QX_BT_DATA_LENGTH };
+
+/*
+    Streaming keeps the interval short so the controller buffers drain
+    often, and 2M halves the air time of a packet. Low power lets the radio
+    sleep between results. The timeouts stay well above the least allowed,
+    (1 + latency) * max_interval * 2.
+ */
+static const tQxBTLinkParams bt_link_profiles[QxBTLinkProfileNum] = {
+    /* QxBTLinkStreaming   */ { 6, 12, 0, 200, QX_BT_PHY_2M },
+    /* QxBTLinkInteractive */ { 12, 24, 0, 200, QX_BT_PHY_1M },
+    /* QxBTLinkLowPower    */ { 160, 200, 4, 600, QX_BT_PHY_1M },
+};
+
+/* Profile of the connection, QxBTLinkProfileNum until one is set */
+static tQxBTLinkProfile bt_link_profile = QxBTLinkProfileNum;
+
+/* Notifications of QxBTHal_Write() and QxBTHal_WriteResult() on their way to bt_send_packets() */
+#define QX_BT_NOTIFY_MAX 126 /* the 125 bytes of the text characteristic and a terminating zero */
+
+typedef enum {
+    QxBTNotifyText = 0,
+    QxBTNotifyResult,
+} tQxBTNotifyTarget;
+
+typedef struct {
+    uint8_t     target;     /*!< tQxBTNotifyTarget */
+    uint8_t     length;     /*!< Bytes of data */
+    uint8_t     data[QX_BT_NOTIFY_MAX];
+} tQxBTNotify;
+
+static_assert(sizeof(tQxBTResult) <= QX_BT_NOTIFY_MAX, "a result must fit a queued notification");
+
+/* Producers also remove the oldest record for QxBTDropOldest, so every removal is PopAny() */
+static QxRing<tQxBTNotify, QX_BT_TX_QUEUE> bt_tx_queue;
+static std::atomic<uint8_t> bt_tx_policy;
+static std::atomic<uint32_t> bt_tx_queued;
+static std::atomic<uint32_t> bt_tx_removed;  /* sent, discarded or dropped after being queued */
+static std::atomic<uint32_t> bt_tx_sent;
+static std::atomic<uint32_t> bt_tx_dropped;
+static std::atomic<uint32_t> bt_tx_discarded;
+static std::atomic<uint32_t> bt_tx_max_depth;
+
+/*
+    Broadcast of the results in the advertising data. QxBTHal_WriteResult()
+    keeps the latest one in bt_bc_results and wakes the rx thread only when
+    it differs enough from the one advertised, cls << 8 | confidence in
+    bt_bc_published; bt_update_broadcast() then sends the advertising data
+    once, however many results came before.
+ */
+static std::atomic<bool> bt_bc_on;
+static std::atomic<bool> bt_bc_pending;
+static std::atomic<uint16_t> bt_bc_published;
+static QxRing<tQxBTResult, 2> bt_bc_results;    /* every removal is PopAny() */
+
+/* Advertised from here, under bt_lock: the legacy data, and one AD structure of the extended set */
+static tQxBTBroadcast bt_broadcast;
+static uint8_t bt_broadcast_ext[2 + sizeof(tQxBTBroadcastExt)];
+
+/* Set by the connection events, read without bt_lock */
+static std::atomic<bool> bt_connected;
+
+/* Counters of the connection, under bt_lock */
+static uint32_t bt_connected_tick;
+static uint32_t bt_notifications;
+static uint32_t bt_notified_bytes;
+
+/* Runs inside BLE.poll(), the MTU exchange and data length request follow in the same poll */
+static void onConnected(BLEDevice central)
+{
+    bt_connected_tick = QxOS_GetTick();
+    bt_notifications = 0;
+    bt_notified_bytes = 0;
+    bt_link_profile = QxBTLinkProfileNum;
+    bt_connected = true;
+}
+
+static void onDisconnected(BLEDevice central)
+{
+    bt_connected = false;
+}
+
+/* Counts a notification of length bytes when the characteristic sent it, ATT cuts it to MTU - 3 */
+static bool bt_count_notify(BLECharacteristic &characteristic, int sent, int length)
+{
+    if (sent > 0 && characteristic.subscribed()) {
+        int payload = ATT.centralMtu() - 3;
+        bt_notifications++;
+        bt_notified_bytes += (length < payload) ? length : payload;
+        return true;
+    }
+    return false;
+}
+
+/* Runs inside BLE.poll(); value() is the buffer ATT wrote into, parsed in place */
+static void onRxWritten(BLEDevice central, BLECharacteristic characteristic)
+{
+    QxOS_NotifyStreamDataIn(QxStreamDeviceBT, characteristic.value(), (uint16_t)characteristic.valueLength());
+}
+
+/* Runs inside BLE.poll() like onRxWritten(), an SDU of the L2CAP channel is a write as well */
+static void onChannelReceived(const uint8_t *data, uint16_t length)
+{
+    QxOS_NotifyStreamDataIn(QxStreamDeviceBT, data, length);
+}
+
+/*
+    Queues a notification without waiting for bt_lock or the radio. A full
+    queue refuses it, or with QxBTDropOldest makes room by dropping the
+    oldest one; other producers may take the freed slot first, so that is
+    tried a few times before the new notification is dropped instead.
+ */
+static tQxStatus bt_queue_notify(const tQxBTNotify &notify)
+{
+    if (!bt_connected) {
+        return QxErr;
+    }
+
+    bool queued = bt_tx_queue.Push(notify);
+    for (int i = 0; !queued && bt_tx_policy == QxBTDropOldest && i < 4; i++) {
+        tQxBTNotify oldest;
+        if (bt_tx_queue.PopAny(oldest)) {
+            bt_tx_removed++;
+            bt_tx_dropped++;
+        }
+        queued = bt_tx_queue.Push(notify);
+    }
+    if (!queued) {
+        bt_tx_dropped++;
+        return QxBusy;
+    }
+
+    uint32_t depth = ++bt_tx_queued - bt_tx_removed;
+    uint32_t max_depth = bt_tx_max_depth;
+    while (depth > max_depth && !bt_tx_max_depth.compare_exchange_weak(max_depth, depth)) {
+    }
+
+    // bt_send_packets() runs as soon as the rx thread wakes up
+    HCITransport.wakeup();
+    return QxOK;
+}
+
+static uint8_t bt_confidence(const tQxBTResult &result)
+{
+    return (result.cls < result.count) ? result.probs[result.cls] : 0;
+}
+
+/* Lock free, any thread; the rx thread publishes it */
+static void bt_broadcast_result(const tQxBTResult &result)
+{
+    if (!bt_bc_on) {
+        return;
+    }
+
+    // only the latest counts, an older one makes room like with QxBTDropOldest
+    for (int i = 0; i < 4 && !bt_bc_results.Push(result); i++) {
+        tQxBTResult older;
+        bt_bc_results.PopAny(older);
+    }
+
+    uint16_t published = bt_bc_published;
+    int moved = (int)bt_confidence(result) - (int)(published & 0xFF);
+    if (result.cls != (published >> 8) || moved >= QX_BT_BROADCAST_STEP || -moved >= QX_BT_BROADCAST_STEP) {
+        bt_bc_pending = true;
+        HCITransport.wakeup();
+    }
+}
+
+/* Fills the AD structure of the extended set and hands it to the extended and periodic advertising */
+static void bt_fill_broadcast_ext(const tQxBTResult &result)
+{
+    tQxBTBroadcastExt ext;
+    uint8_t count = (result.count < QX_BT_RESULT_CLASSES) ? result.count : QX_BT_RESULT_CLASSES;
+    uint8_t length = (uint8_t)(sizeof(ext) - sizeof(ext.result.probs) + count);
+
+    ext.company = QX_BT_COMPANY_ID;
+    ext.seq = bt_broadcast.seq;
+    ext.uptime_s = QxOS_GetTick() / 1000;
+    ext.dropped = bt_tx_dropped;
+    ext.connected = bt_connected ? 1 : 0;
+    ext.result = result;
+
+    bt_broadcast_ext[0] = 1 + length;
+    bt_broadcast_ext[1] = 0xFF;
+    memcpy(&bt_broadcast_ext[2], &ext, length);
+    BLE.setExtendedAdvertisingData(bt_broadcast_ext, 2 + length);
+    BLE.setPeriodicAdvertisingData(bt_broadcast_ext, 2 + length);
+}
+
+/* Under bt_lock; advertising takes the new data while it is enabled, or keeps it for the next time */
+static void bt_update_broadcast(void)
+{
+    tQxBTResult result;
+    bool fresh = false;
+
+    if (!bt_bc_pending.exchange(false)) {
+        return;
+    }
+    while (bt_bc_results.PopAny(result)) {
+        fresh = true;
+    }
+    if (!fresh) {
+        return;
+    }
+
+    bt_broadcast.seq++;
+    bt_broadcast.cls = result.cls;
+    bt_broadcast.confidence = bt_confidence(result);
+    bt_bc_published = (uint16_t)(bt_broadcast.cls << 8 | bt_broadcast.confidence);
+    if (BLE.extendedAdvertising()) {
+        bt_fill_broadcast_ext(result);
+    }
+    BLE.updateAdvertisingData();
+}
+
+/* Points the advertising data at the broadcast or away from it, under bt_lock or before BLE.begin() */
+static void bt_apply_broadcast(bool enable)
+{
+    tQxBTResult none = { 0, 0, 0xFF, 0 };
+
+    if (enable) {
+        bt_broadcast.company = QX_BT_COMPANY_ID;
+        bt_broadcast.cls = 0xFF;
+        bt_broadcast.confidence = 0;
+        bt_bc_published = 0xFF00;
+        BLE.setManufacturerData((const uint8_t *)&bt_broadcast, sizeof(bt_broadcast));
+        BLE.setPeriodicAdvertisingInterval(QX_BT_PERIODIC_INTERVAL);
+        bt_fill_broadcast_ext(none);
+    } else {
+        BLE.setManufacturerData(NULL, 0);
+        BLE.setExtendedAdvertisingData(NULL, 0);
+        BLE.setPeriodicAdvertisingData(NULL, 0);
+    }
+    // legacy advertising carries the broadcast on while a central is connected
+    BLE.setAdvertiseWhileConnected(enable);
+    bt_bc_pending = false;
+    bt_bc_on = enable;
+}
+
+/*
+    Hands queued notifications, then data collection packets, to the
+    controller while it has ACL buffers, so several go out in one connection
+    event. With all buffers in flight sendAclPkt() would spin on HCI.poll();
+    instead they wait for the next wake-up, which the completion event of a
+    buffer triggers. Without a subscribed central they are discarded. An
+    open L2CAP channel takes the data collection packets instead.
+ */
+static void bt_send_packets(void)
+{
+    const tQxDcPacket *packet;
+    bool connected = BLE.connected();
+    bool channel = connected && L2CAPCoC.connected();
+    bool sending = connected && dcCharacteristic.subscribed();
+    tQxBTNotify notify;
+
+    while ((!connected || HCI.availableAclPkts() > 0) && bt_tx_queue.PopAny(notify)) {
+        bool notified = false;
+        bt_tx_removed++;
+        // without subscription the value is still stored for reads
+        if (connected && notify.target == QxBTNotifyResult) {
+            notified = bt_count_notify(resultCharacteristic, resultCharacteristic.writeValue(notify.data, notify.length),
+                                       notify.length);
+        } else if (connected) {
+            notified = bt_count_notify(buttonCharacteristic, buttonCharacteristic.writeValue((const char *)notify.data),
+                                       notify.length);
+        }
+        if (notified) {
+            bt_tx_sent++;
+        } else {
+            bt_tx_discarded++;
+        }
+    }
+
+    // with the L2CAP channel open, a packet is an SDU; the credits of the central pace them
+    while (channel && (packet = QxDataCollect_Peek()) != NULL && L2CAPCoC.writable()) {
+        QxDataCollect_Sent(L2CAPCoC.write(packet->data, packet->length) > 0);
+        L2CAPCoC.poll();
+    }
+
+    while (!channel && (packet = QxDataCollect_Peek()) != NULL) {
+        if (sending && HCI.availableAclPkts() == 0) {
+            break;
+        }
+        if (sending) {
+            bt_count_notify(dcCharacteristic, dcCharacteristic.writeValue(packet->data, packet->length), packet->length);
+        }
+        QxDataCollect_Sent(sending);
+    }
+}
+
+/*
+    ArduinoBLE handles controller events only inside BLE.poll(), which the
+    sketch stops calling once it is connected. This thread sleeps until the
+    controller delivers data, so a write of the central reaches the command
+    parser within the connection event it arrived in. It also sends the
+    data collection packets.
+ */
+static void bt_rx_loop(const void *userdata)
+{
+    for (;;) {
+        bool collecting = QxDataCollect_Active() || QxDataCollect_Peek() != NULL;
+        HCITransport.wait(collecting ? QX_BT_DC_POLL_MS : QX_BT_RX_POLL_MS);
+        QxOS_LockMutex(bt_lock);
+        BLE.poll();
+        bt_send_packets();
+        bt_update_broadcast();
+        QxOS_UnLockMutex(bt_lock);
+    }
+}
+
 tQxStatus QxBTHal_Initialize() {
+    bt_lock = QxOS_CreateMutex("ble");
+
+    // a central may open the credit based channel, its SDUs reach the command parser like writes
+    L2CAPCoC.listen(QX_BT_COC_PSM);
+    L2CAPCoC.setReceiveHandler(onChannelReceived);
+
+    // negotiated on every connection from BLE.poll()
+    BLE.setMaxMtu(bt_profile.max_mtu);
+    BLE.setDataLength(bt_profile.data_length);
+    BLE.setEventHandler(BLEConnected, onConnected);
+    BLE.setEventHandler(BLEDisconnected, onDisconnected);
+
     // begin initialization
     if (!BLE.begin()) {
         QxOS_DebugPrint("starting BLE failed!");
@@ -25,6 +380,10 @@ tQxStatus QxBTHal_Initialize() {
 
     // add the characteristics to the service
     automlService.addCharacteristic(buttonCharacteristic);
+    automlService.addCharacteristic(resultCharacteristic);
+    automlService.addCharacteristic(dcCharacteristic);
+    rxCharacteristic.setEventHandler(BLEWritten, onRxWritten);
+    automlService.addCharacteristic(rxCharacteristic);
 
     // add the service
     BLE.addService(automlService);
@@ -42,16 +401,246 @@ tQxStatus QxBTHal_Initialize() {
 }
 
 
+void QxBTHal_SetConnProfile(const tQxBTConnProfile *profile)
+{
+    bt_profile = *profile;
+}
+
+tQxStatus QxBTHal_StartReceive(tQxPriority prio)
+{
+    return (QxOS_CreateStaticThread(&bt_rx_thread, bt_rx_loop, prio, NULL) != NULL) ? QxOK : QxErr;
+}
+
 void QxBTHal_Write(char *buf, int length) {
-    if (BLE.connected()) {
-        buttonCharacteristic.writeValue(buf);
-    } else {
+    tQxBTNotify notify;
+    size_t text = strnlen(buf, QX_BT_NOTIFY_MAX - 1);
+
+    notify.target = QxBTNotifyText;
+    notify.length = (uint8_t)text;
+    memcpy(notify.data, buf, text);
+    notify.data[text] = '\0';
+    if (bt_queue_notify(notify) == QxErr) {
         //QxOS_DebugPrint("QxBTHal_Write error, BT not connected.");
     }
 }
 
+tQxStatus QxBTHal_WriteResult(uint8_t cls, const float *probs, int num_classes)
+{
+    static uint16_t seq;
+    tQxBTNotify notify;
+    tQxBTResult result;
+
+    num_classes = (probs == NULL || num_classes < 0) ? 0 : num_classes;
+    num_classes = (num_classes > QX_BT_RESULT_CLASSES) ? QX_BT_RESULT_CLASSES : num_classes;
+
+    result.seq = seq++;
+    result.time_ms = QxOS_GetTick();
+    result.cls = cls;
+    result.count = (uint8_t)num_classes;
+    for (int i = 0; i < num_classes; i++) {
+        float p = probs[i];
+        p = (p < 0.0f) ? 0.0f : ((p > 1.0f) ? 1.0f : p);
+        result.probs[i] = (uint8_t)(p * 255.0f + 0.5f);
+    }
+    bt_broadcast_result(result);
+    if (QxFrame_Active(QxStreamDeviceUSB)) {
+        QxFrame_Send(QxFrameResult, &result, QX_BT_RESULT_HEADER + num_classes);
+    }
+
+    notify.target = QxBTNotifyResult;
+    notify.length = QX_BT_RESULT_HEADER + num_classes;
+    memcpy(notify.data, &result, notify.length);
+    return bt_queue_notify(notify);
+}
+
+void QxBTHal_SetTxPolicy(tQxBTDropPolicy policy)
+{
+    bt_tx_policy = policy;
+}
+
+void QxBTHal_GetTxStats(tQxBTTxStats *stats)
+{
+    stats->queued = bt_tx_queued;
+    stats->sent = bt_tx_sent;
+    stats->dropped = bt_tx_dropped;
+    stats->discarded = bt_tx_discarded;
+    stats->depth = (uint16_t)(stats->queued - bt_tx_removed);
+    stats->max_depth = (uint16_t)bt_tx_max_depth;
+}
+
+uint16_t QxBTHal_GetMtu()
+{
+    QxOS_LockMutex(bt_lock);
+    uint16_t mtu = ATT.centralMtu();
+    QxOS_UnLockMutex(bt_lock);
+    return mtu;
+}
+
+bool QxBTHal_ChannelOpen()
+{
+    QxOS_LockMutex(bt_lock);
+    bool open = L2CAPCoC.connected();
+    QxOS_UnLockMutex(bt_lock);
+    return open;
+}
+
+int QxBTHal_ChannelWrite(const void *data, uint16_t length)
+{
+    QxOS_LockMutex(bt_lock);
+    int taken = L2CAPCoC.write((const uint8_t *)data, length);
+    QxOS_UnLockMutex(bt_lock);
+    if (taken) {
+        // BLE.poll() of the rx thread sends it
+        HCITransport.wakeup();
+    }
+    return taken;
+}
+
+uint16_t QxBTHal_GetStreamPayload()
+{
+    QxOS_LockMutex(bt_lock);
+    uint16_t payload = L2CAPCoC.connected() ? L2CAPCoC.peerMtu() : ATT.centralMtu() - 3;
+    QxOS_UnLockMutex(bt_lock);
+    return payload;
+}
+
+tQxStatus QxBTHal_SetLinkParams(const tQxBTLinkParams *params)
+{
+    tQxStatus status = QxErr;
+    QxOS_LockMutex(bt_lock);
+    uint16_t handle = ATT.centralHandle();
+    if (BLE.connected() && handle != 0xffff) {
+        status = QxOK;
+        // HCI_LE_Set_PHY first: a rejected PHY must not keep the interval from being asked for
+        if (params->phys != 0 && HCI.leSetPhy(handle, params->phys, params->phys) != 0) {
+            status = QxErr;
+        }
+        if (L2CAPSignaling.requestConnectionParameters(handle, params->min_interval, params->max_interval,
+                                                       params->latency, params->timeout) != 0) {
+            status = QxErr;
+        }
+    }
+    QxOS_UnLockMutex(bt_lock);
+    return status;
+}
+
+tQxStatus QxBTHal_SetLinkProfile(tQxBTLinkProfile profile)
+{
+    if (profile >= QxBTLinkProfileNum) {
+        return QxErr;
+    }
+    if (profile == bt_link_profile) {
+        return QxOK;
+    }
+
+    tQxStatus status = QxBTHal_SetLinkParams(&bt_link_profiles[profile]);
+    if (status == QxOK) {
+        bt_link_profile = profile;
+    }
+    return status;
+}
+
+tQxStatus QxBTHal_GetLinkStats(tQxBTLinkStats *stats)
+{
+    tQxStatus status = QxErr;
+    QxOS_LockMutex(bt_lock);
+    if (BLE.connected()) {
+        stats->mtu = ATT.centralMtu();
+        HCI.leDataLength(stats->tx_octets, stats->tx_time_us, stats->rx_octets, stats->rx_time_us);
+        HCI.leConnParams(stats->interval, stats->latency, stats->timeout);
+        HCI.lePhy(stats->tx_phy, stats->rx_phy);
+        stats->connected_ms = QxOS_GetTick() - bt_connected_tick;
+        stats->notifications = bt_notifications;
+        stats->notified_bytes = bt_notified_bytes;
+        status = QxOK;
+    }
+    QxOS_UnLockMutex(bt_lock);
+    return status;
+}
+
+void QxBTHal_LinkReport()
+{
+    static uint32_t last_ms, last_bytes;
+    tQxBTLinkStats stats;
+
+    if (QxBTHal_GetLinkStats(&stats) != QxOK) {
+        QxOS_DebugPrint("ble   not connected");
+        last_ms = last_bytes = 0;
+        return;
+    }
+    /* counters restart with a new connection */
+    if (stats.connected_ms < last_ms || stats.notified_bytes < last_bytes) {
+        last_ms = last_bytes = 0;
+    }
+
+    uint32_t window_ms = stats.connected_ms - last_ms;
+    uint32_t window_bytes = stats.notified_bytes - last_bytes;
+    QxOS_DebugPrint("ble   mtu %u, tx %u octets %u us, rx %u octets %u us", stats.mtu, stats.tx_octets,
+                    stats.tx_time_us, stats.rx_octets, stats.rx_time_us);
+    static const char *phy_names[] = { "-", "1M", "2M", "Coded" };
+    QxOS_DebugPrint("ble   interval %u.%02u ms, latency %u, timeout %u ms, phy tx %s rx %s", stats.interval * 5 / 4,
+                    stats.interval * 125 % 100, stats.latency, stats.timeout * 10, phy_names[stats.tx_phy & 3],
+                    phy_names[stats.rx_phy & 3]);
+    QxOS_DebugPrint("ble   %lu notifications %lu bytes in %lu ms, %lu B/s since the last report",
+                    (unsigned long)stats.notifications, (unsigned long)stats.notified_bytes,
+                    (unsigned long)stats.connected_ms,
+                    window_ms ? (unsigned long)((uint64_t)window_bytes * 1000 / window_ms) : 0UL);
+    last_ms = stats.connected_ms;
+    last_bytes = stats.notified_bytes;
+
+    uint32_t sdu_sent, sdu_received;
+    uint16_t credits;
+    QxOS_LockMutex(bt_lock);
+    bool channel = L2CAPCoC.connected();
+    uint16_t channel_mtu = L2CAPCoC.peerMtu();
+    L2CAPCoC.counters(sdu_sent, sdu_received, credits);
+    QxOS_UnLockMutex(bt_lock);
+    if (channel) {
+        QxOS_DebugPrint("ble   channel psm 0x%x, sdu %u bytes, %lu sent %lu received, %u credits", QX_BT_COC_PSM,
+                        channel_mtu, (unsigned long)sdu_sent, (unsigned long)sdu_received, credits);
+    }
+
+    tQxBTTxStats tx;
+    QxBTHal_GetTxStats(&tx);
+    QxOS_DebugPrint("ble   queue %u of %u, max %u, %lu queued %lu sent %lu dropped %lu discarded", tx.depth,
+                    QX_BT_TX_QUEUE, tx.max_depth, (unsigned long)tx.queued, (unsigned long)tx.sent,
+                    (unsigned long)tx.dropped, (unsigned long)tx.discarded);
+
+    if (bt_bc_on) {
+        QxOS_LockMutex(bt_lock);
+        bool extended = BLE.extendedAdvertising();
+        bool periodic = BLE.periodicAdvertising();
+        uint16_t updates = bt_broadcast.seq;
+        QxOS_UnLockMutex(bt_lock);
+        QxOS_DebugPrint("ble   broadcast %s%s, %u updates", extended ? "extended" : "legacy",
+                        periodic ? " and periodic" : "", updates);
+    }
+}
+
+tQxStatus QxBTHal_SetBroadcast(bool enable)
+{
+    // the first BLE.advertise() of QxBTHal_Initialize() decides on extended advertising
+    if (bt_lock == NULL) {
+        bt_apply_broadcast(enable);
+        return QxOK;
+    }
+
+    QxOS_LockMutex(bt_lock);
+    bt_apply_broadcast(enable);
+    int updated = BLE.updateAdvertisingData();
+    QxOS_UnLockMutex(bt_lock);
+    return updated ? QxOK : QxErr;
+}
+
+void QxBTHal_Disconnect()
+{
+    QxOS_LockMutex(bt_lock);
+    BLE.disconnect();
+    QxOS_UnLockMutex(bt_lock);
+}
+
 extern "C"
 bool QxBTHal_Connected()
 {
-    return BLE.connected();
+    return bt_connected;
 }
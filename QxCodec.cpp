@@ -0,0 +1,279 @@
+/**
+  ******************************************************************************
+  * @file    QxCodec.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Delta, zigzag, varint, bit packing and IMA ADPCM sample codecs.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxCodec.h"
+
+static const int16_t adpcm_steps[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t adpcm_index_shift[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/* Difference modulo 2^16, zigzag mapped; the decoder adds it back modulo 2^16 */
+static inline uint16_t codec_zigzag(int16_t x, int16_t prev)
+{
+    int16_t d = (int16_t)(uint16_t)((uint16_t)x - (uint16_t)prev);
+    return (uint16_t)(((uint32_t)(uint16_t)d << 1) ^ (uint32_t)(int32_t)(d >> 15));
+}
+
+static inline int16_t codec_unzigzag(uint16_t z, int16_t prev)
+{
+    uint16_t d = (uint16_t)((z >> 1) ^ (uint16_t)-(int16_t)(z & 1));
+    return (int16_t)(uint16_t)((uint16_t)prev + d);
+}
+
+void QxCodec_DeltaReset(tQxDeltaState *state)
+{
+    memset(state, 0, sizeof(*state));
+}
+
+uint32_t QxCodec_DeltaVarintEncode(tQxDeltaState *state, const int16_t *samples, uint32_t count,
+                                   uint8_t channels, uint8_t *out)
+{
+    uint8_t *o = out;
+
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint8_t c = 0; c < channels; c++) {
+            int16_t x = *samples++;
+            uint32_t z = codec_zigzag(x, state->prev[c]);
+            state->prev[c] = x;
+            while (z >= 0x80) {
+                *o++ = (uint8_t)(z | 0x80);
+                z >>= 7;
+            }
+            *o++ = (uint8_t)z;
+        }
+    }
+    return (uint32_t)(o - out);
+}
+
+uint32_t QxCodec_DeltaVarintDecode(tQxDeltaState *state, const uint8_t *in, uint32_t len,
+                                   int16_t *samples, uint32_t count, uint8_t channels)
+{
+    uint32_t at = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint8_t c = 0; c < channels; c++) {
+            uint32_t z = 0;
+            uint32_t shift = 0;
+            uint8_t b;
+            do {
+                if (at == len || shift > 14) {
+                    return 0;
+                }
+                b = in[at++];
+                z |= (uint32_t)(b & 0x7F) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            state->prev[c] = codec_unzigzag((uint16_t)z, state->prev[c]);
+            *samples++ = state->prev[c];
+        }
+    }
+    return at;
+}
+
+uint32_t QxCodec_DeltaPackEncode(const int16_t *samples, uint32_t count, uint8_t channels, uint8_t *out)
+{
+    uint8_t width[QX_CODEC_CHANNELS_MAX];
+    uint8_t *o = out;
+
+    /* widths first, a second pass packs; both walk the block in cache order */
+    for (uint8_t c = 0; c < channels; c++) {
+        uint16_t all = 0;
+        for (uint32_t i = 1; i < count; i++) {
+            all |= codec_zigzag(samples[i * channels + c], samples[(i - 1) * channels + c]);
+        }
+        uint8_t w = 0;
+        while (all != 0) {
+            w++;
+            all >>= 1;
+        }
+        width[c] = w;
+        *o++ = (uint8_t)samples[c];
+        *o++ = (uint8_t)((uint16_t)samples[c] >> 8);
+        *o++ = w;
+    }
+
+    uint32_t bits = 0;
+    uint32_t fill = 0;
+    for (uint8_t c = 0; c < channels; c++) {
+        uint8_t w = width[c];
+        if (w == 0) {
+            continue;
+        }
+        for (uint32_t i = 1; i < count; i++) {
+            bits |= (uint32_t)codec_zigzag(samples[i * channels + c], samples[(i - 1) * channels + c]) << fill;
+            fill += w;
+            while (fill >= 8) {
+                *o++ = (uint8_t)bits;
+                bits >>= 8;
+                fill -= 8;
+            }
+        }
+    }
+    if (fill > 0) {
+        *o++ = (uint8_t)bits;
+    }
+    return (uint32_t)(o - out);
+}
+
+uint32_t QxCodec_DeltaPackDecode(const uint8_t *in, uint32_t len, int16_t *samples, uint32_t count, uint8_t channels)
+{
+    uint32_t at = 3 * channels;
+    uint64_t need = 0;
+
+    if (len < at) {
+        return 0;
+    }
+    for (uint8_t c = 0; c < channels; c++) {
+        if (in[3 * c + 2] > 16) {
+            return 0;
+        }
+        need += (uint64_t)in[3 * c + 2] * (count - 1);
+    }
+    if (len < at + (need + 7) / 8) {
+        return 0;
+    }
+
+    uint32_t bits = 0;
+    uint32_t fill = 0;
+    for (uint8_t c = 0; c < channels; c++) {
+        uint8_t w = in[3 * c + 2];
+        uint32_t mask = (1u << w) - 1;
+        int16_t x = (int16_t)(uint16_t)(in[3 * c] | (in[3 * c + 1] << 8));
+        samples[c] = x;
+        for (uint32_t i = 1; i < count; i++) {
+            while (fill < w) {
+                bits |= (uint32_t)in[at++] << fill;
+                fill += 8;
+            }
+            x = codec_unzigzag((uint16_t)(bits & mask), x);
+            bits >>= w;
+            fill -= w;
+            samples[i * channels + c] = x;
+        }
+    }
+    return at;
+}
+
+uint32_t QxCodec_AdpcmEncode(tQxAdpcmState *state, const int16_t *pcm, uint32_t count, uint8_t *out)
+{
+    int32_t predictor = state->predictor;
+    int32_t index = state->index;
+    uint8_t *o = out;
+
+    *o++ = (uint8_t)predictor;
+    *o++ = (uint8_t)((uint16_t)predictor >> 8);
+    *o++ = (uint8_t)index;
+
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t step = adpcm_steps[index];
+        int32_t diff = pcm[i] - predictor;
+        uint8_t code = 0;
+
+        if (diff < 0) {
+            code = 8;
+            diff = -diff;
+        }
+
+        /* the quantized difference as the decoder rebuilds it */
+        int32_t vpdiff = step >> 3;
+        if (diff >= step) {
+            code |= 4;
+            diff -= step;
+            vpdiff += step;
+        }
+        step >>= 1;
+        if (diff >= step) {
+            code |= 2;
+            diff -= step;
+            vpdiff += step;
+        }
+        step >>= 1;
+        if (diff >= step) {
+            code |= 1;
+            vpdiff += step;
+        }
+
+        predictor += (code & 8) ? -vpdiff : vpdiff;
+        predictor = (predictor > 32767) ? 32767 : ((predictor < -32768) ? -32768 : predictor);
+        index += adpcm_index_shift[code & 7];
+        index = (index > 88) ? 88 : ((index < 0) ? 0 : index);
+
+        if (i & 1) {
+            *o++ |= (uint8_t)(code << 4);
+        } else {
+            *o = code;
+        }
+    }
+    if (count & 1) {
+        o++;
+    }
+
+    state->predictor = (int16_t)predictor;
+    state->index = (uint8_t)index;
+    return (uint32_t)(o - out);
+}
+
+uint32_t QxCodec_AdpcmDecode(const uint8_t *in, uint32_t len, int16_t *pcm, uint32_t count)
+{
+    uint32_t need = 3 + (count + 1) / 2;
+
+    if (len < need || in[2] > 88) {
+        return 0;
+    }
+
+    int32_t predictor = (int16_t)(uint16_t)(in[0] | (in[1] << 8));
+    int32_t index = in[2];
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t code = (in[3 + i / 2] >> ((i & 1) * 4)) & 0x0F;
+        int32_t step = adpcm_steps[index];
+        int32_t vpdiff = step >> 3;
+
+        if (code & 4) {
+            vpdiff += step;
+        }
+        if (code & 2) {
+            vpdiff += step >> 1;
+        }
+        if (code & 1) {
+            vpdiff += step >> 2;
+        }
+
+        predictor += (code & 8) ? -vpdiff : vpdiff;
+        predictor = (predictor > 32767) ? 32767 : ((predictor < -32768) ? -32768 : predictor);
+        index += adpcm_index_shift[code & 7];
+        index = (index > 88) ? 88 : ((index < 0) ? 0 : index);
+        pcm[i] = (int16_t)predictor;
+    }
+    return need;
+}
@@ -0,0 +1,270 @@
+/**
+  ******************************************************************************
+  * @file    QxCommand.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Framed command parser for stream input.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxCommand.h"
+#include "QxRing.h"
+
+#include <atomic>
+#include <string.h>
+
+/* cmd of a published slot whose frame was given up, QxCommand_Run() drops it */
+#define CMD_SKIPPED QX_CMD_MAX
+
+/* Frame in progress on one device */
+typedef enum {
+    CMD_IDLE = 0,               /* waiting for cmd */
+    CMD_LENGTH,                 /* cmd received, length not yet */
+    CMD_PAYLOAD,                /* filling the payload of frame, or skipping it when frame is NULL */
+} tCmdState;
+
+typedef struct {
+    tQxCommandFrame *frame;     /* claimed slot being filled, NULL while skipping a dropped frame */
+    uint32_t pos;               /* its queue position */
+    uint8_t state;              /* tCmdState */
+    uint8_t cmd;
+    uint8_t length;             /* payload length of the frame in progress */
+    uint8_t filled;             /* payload bytes received */
+    uint32_t tick;              /* QxOS_GetTick() of the last input */
+} tCmdParser;
+
+/* a queue per device, from QxStreamDeviceUSB on: a frame in progress only holds back the frames of its own device */
+static QxRing<tQxCommandFrame, QX_CMD_QUEUE> cmd_queues[QxStreamDeviceMax - 1];
+static tCmdParser cmd_parsers[QxStreamDeviceMax];
+
+static struct {
+    tQxCommandFunc func;
+    void *userdata;
+} cmd_handlers[QX_CMD_MAX];
+
+static tQxExecutor *cmd_executor;
+static tQxWork cmd_work;
+
+static std::atomic<uint32_t> cmd_frames;
+static std::atomic<uint32_t> cmd_dropped;
+static std::atomic<uint32_t> cmd_errors;
+static std::atomic<uint32_t> cmd_handled;
+static std::atomic<uint32_t> cmd_unhandled;
+
+static void cmd_run_work(void *arg)
+{
+    (void)arg;
+    QxCommand_Run();
+}
+
+static void cmd_publish(tQxStreamDevice device_type, uint32_t pos)
+{
+    cmd_queues[device_type - 1].Publish(pos);
+    if (cmd_executor != NULL) {
+        QxOS_ExecutorPost(cmd_executor, &cmd_work);
+    }
+}
+
+/* Claim the slot of a frame, its payload is copied straight into it */
+static tQxCommandFrame *cmd_claim(tQxStreamDevice device_type, uint8_t cmd, uint8_t length, uint32_t *pos)
+{
+    tQxCommandFrame *frame = cmd_queues[device_type - 1].Claim(*pos);
+    if (frame == NULL) {
+        cmd_dropped.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    frame->cmd = cmd;
+    frame->device = (uint8_t)device_type;
+    frame->length = length;
+    return frame;
+}
+
+/* Give up a frame in progress, its bytes count as skipped; a claimed slot is published as CMD_SKIPPED */
+static void cmd_abandon(tQxStreamDevice device_type, tCmdParser *p)
+{
+    uint32_t bytes = (p->state == CMD_LENGTH) ? 1 : ((p->state == CMD_PAYLOAD) ? 2 + p->filled : 0);
+    if (bytes > 0) {
+        cmd_errors.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    if (p->state == CMD_PAYLOAD && p->frame != NULL) {
+        p->frame->cmd = CMD_SKIPPED;
+        cmd_publish(device_type, p->pos);
+    }
+    p->frame = NULL;
+    p->state = CMD_IDLE;
+}
+
+/*
+    A BT write, a characteristic write or an L2CAP SDU, holds whole frames:
+    each is copied from the write buffer into its slot and published at once,
+    and a slot is only claimed for a frame that the write holds completely.
+ */
+static void cmd_input_frames(tQxStreamDevice device_type, const uint8_t *data, uint16_t length)
+{
+    while (length > 0) {
+        uint8_t cmd = data[0];
+        if (cmd >= QX_CMD_MAX) {
+            cmd_errors.fetch_add(1, std::memory_order_relaxed);
+            data++;
+            length--;
+            continue;
+        }
+        if (length < 2) {
+            cmd_errors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        uint8_t n = data[1];
+        if (n > QX_CMD_PAYLOAD_MAX) {
+            /* a command byte followed by garbage, resume with the byte after it */
+            cmd_errors.fetch_add(2, std::memory_order_relaxed);
+            data += 2;
+            length -= 2;
+            continue;
+        }
+        if (2 + n > length) {
+            /* truncated, nothing claimed for it */
+            cmd_errors.fetch_add(length, std::memory_order_relaxed);
+            return;
+        }
+
+        uint32_t pos;
+        tQxCommandFrame *frame = cmd_claim(device_type, cmd, n, &pos);
+        if (frame != NULL) {
+            memcpy(frame->payload, data + 2, n);
+            cmd_frames.fetch_add(1, std::memory_order_relaxed);
+            cmd_publish(device_type, pos);
+        }
+        data += 2 + n;
+        length -= 2 + n;
+    }
+}
+
+tQxStatus QxCommand_Register(uint8_t cmd, tQxCommandFunc func, void *userdata)
+{
+    if (cmd >= QX_CMD_MAX) {
+        return QxErr;
+    }
+    cmd_handlers[cmd].func = func;
+    cmd_handlers[cmd].userdata = userdata;
+    return QxOK;
+}
+
+tQxStatus QxCommand_Init(tQxExecutor *executor, tQxPriority prio)
+{
+    cmd_executor = executor;
+    QxOS_WorkInit(&cmd_work, cmd_run_work, NULL, prio);
+    return QxOS_RegisterStreamDataInCallback(QxCommand_Input, NULL);
+}
+
+void QxCommand_Input(tQxStreamDevice device_type, const uint8_t *data, uint16_t length, void *userdata)
+{
+    (void)userdata;
+    if (device_type <= QxStreamDeviceNone || device_type >= QxStreamDeviceMax) {
+        return;
+    }
+    if (device_type == QxStreamDeviceBT) {
+        cmd_input_frames(device_type, data, length);
+        return;
+    }
+    tCmdParser *p = &cmd_parsers[device_type];
+
+    /* a pause in a byte stream ends a frame in progress, the next byte starts a new one */
+    uint32_t now = QxOS_GetTick();
+    if (p->state != CMD_IDLE && now - p->tick >= QX_CMD_TIMEOUT) {
+        cmd_abandon(device_type, p);
+    }
+    p->tick = now;
+
+    while (length > 0) {
+        if (p->state == CMD_PAYLOAD) {
+            uint16_t n = p->length - p->filled;
+            n = (length < n) ? length : n;
+            if (p->frame != NULL) {
+                /* the only copy of the payload, from the transport buffer into the queue slot */
+                memcpy(p->frame->payload + p->filled, data, n);
+            }
+            p->filled += (uint8_t)n;
+            data += n;
+            length -= n;
+        } else {
+            uint8_t b = *data++;
+            length--;
+            if (p->state == CMD_IDLE) {
+                if (b >= QX_CMD_MAX) {
+                    cmd_errors.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                p->cmd = b;
+                p->state = CMD_LENGTH;
+                continue;
+            }
+            if (b > QX_CMD_PAYLOAD_MAX) {
+                /* a command byte followed by garbage, resume with the byte after it */
+                cmd_errors.fetch_add(2, std::memory_order_relaxed);
+                p->state = CMD_IDLE;
+                continue;
+            }
+            /* a full queue drops the frame, its payload is skipped */
+            p->frame = cmd_claim(device_type, p->cmd, b, &p->pos);
+            p->length = b;
+            p->filled = 0;
+            p->state = CMD_PAYLOAD;
+        }
+
+        if (p->state == CMD_PAYLOAD && p->filled == p->length) {
+            if (p->frame != NULL) {
+                cmd_frames.fetch_add(1, std::memory_order_relaxed);
+                cmd_publish(device_type, p->pos);
+            }
+            p->frame = NULL;
+            p->state = CMD_IDLE;
+        }
+    }
+}
+
+uint32_t QxCommand_Run(void)
+{
+    uint32_t n = 0;
+    const tQxCommandFrame *frame;
+
+    for (int d = 0; d < QxStreamDeviceMax - 1; d++) {
+        while ((frame = cmd_queues[d].Peek()) != NULL) {
+            if (frame->cmd == CMD_SKIPPED) {
+                /* counted in errors by the parser */
+            } else if (cmd_handlers[frame->cmd].func != NULL) {
+                cmd_handlers[frame->cmd].func(frame, cmd_handlers[frame->cmd].userdata);
+                cmd_handled.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                cmd_unhandled.fetch_add(1, std::memory_order_relaxed);
+            }
+            cmd_queues[d].Drop();
+            n++;
+        }
+    }
+    return n;
+}
+
+void QxCommand_GetStats(tQxCommandStats *stats)
+{
+    stats->frames = cmd_frames.load(std::memory_order_relaxed);
+    stats->handled = cmd_handled.load(std::memory_order_relaxed);
+    stats->unhandled = cmd_unhandled.load(std::memory_order_relaxed);
+    stats->dropped = cmd_dropped.load(std::memory_order_relaxed);
+    stats->errors = cmd_errors.load(std::memory_order_relaxed);
+}
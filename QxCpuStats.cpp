@@ -0,0 +1,210 @@
+/**
+  ******************************************************************************
+  * @file    QxCpuStats.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Sliding window CPU use per thread on top of the backend counters.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxCpuStats.h"
+#include "QxFrame.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CPU_REPORT_LINE 128
+#define CPU_REPORT_MUTEXES 16
+
+typedef struct {
+    uintptr_t id;
+    uint64_t runtime_us;
+    uint32_t switches;
+    BOOL idle;
+} tCpuCount;
+
+typedef struct {
+    uint64_t time_us;
+    int count;
+    tCpuCount threads[QX_CPU_THREADS_MAX];
+} tCpuSnapshot;
+
+/* QX_CPU_WINDOW snapshots, the oldest at cpu_next once the ring is full */
+static tCpuSnapshot cpu_window[QX_CPU_WINDOW];
+static int cpu_next;
+static int cpu_taken;
+
+static void cpu_snapshot(tCpuSnapshot *snap, tQxThreadCpu *threads, int n)
+{
+    snap->time_us = QxOS_GetTimeUs();
+    snap->count = n;
+    for (int i = 0; i < n; i++) {
+        snap->threads[i].id = threads[i].id;
+        snap->threads[i].runtime_us = threads[i].runtime_us;
+        snap->threads[i].switches = threads[i].switches;
+        snap->threads[i].idle = threads[i].idle;
+    }
+}
+
+static const tCpuCount *cpu_find(const tCpuSnapshot *snap, uintptr_t id)
+{
+    for (int i = 0; i < snap->count; i++) {
+        if (snap->threads[i].id == id) {
+            return &snap->threads[i];
+        }
+    }
+    return NULL;
+}
+
+tQxStatus QxOS_CpuStatsSample(void)
+{
+    tQxThreadCpu threads[QX_CPU_THREADS_MAX];
+    int n = QxOS_GetThreadCpu(threads, QX_CPU_THREADS_MAX);
+    if (n <= 0) {
+        return QxNotReady;
+    }
+    cpu_snapshot(&cpu_window[cpu_next], threads, n);
+    cpu_next = (cpu_next + 1) % QX_CPU_WINDOW;
+    cpu_taken += (cpu_taken < QX_CPU_WINDOW) ? 1 : 0;
+    return QxOK;
+}
+
+tQxStatus QxOS_GetCpuStats(tQxCpuStats *stats)
+{
+    if (cpu_taken == 0) {
+        return QxNotReady;
+    }
+    const tCpuSnapshot *base = &cpu_window[(cpu_taken < QX_CPU_WINDOW) ? 0 : cpu_next];
+
+    tQxThreadCpu threads[QX_CPU_THREADS_MAX];
+    int n = QxOS_GetThreadCpu(threads, QX_CPU_THREADS_MAX);
+    uint64_t window = QxOS_GetTimeUs() - base->time_us;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->window_us = (uint32_t)window;
+    uint64_t busy = 0;
+    for (int i = 0; i < n; i++) {
+        /* a thread missing from the snapshot started during the window */
+        const tCpuCount *old = cpu_find(base, threads[i].id);
+        uint32_t runtime = (uint32_t)(threads[i].runtime_us - (old ? old->runtime_us : 0));
+        uint32_t switches = threads[i].switches - (old ? old->switches : 0);
+
+        stats->switches += switches;
+        if (threads[i].idle) {
+            continue;
+        }
+        busy += runtime;
+
+        /* insertion sort, busiest first */
+        int at = stats->count++;
+        while (at > 0 && stats->threads[at - 1].runtime_us < runtime) {
+            stats->threads[at] = stats->threads[at - 1];
+            at--;
+        }
+        tQxThreadLoad *load = &stats->threads[at];
+        load->name = threads[i].name;
+        load->runtime_us = runtime;
+        load->switches = switches;
+        load->permille = (window > 0) ? (uint16_t)((uint64_t)runtime * 1000 / window) : 0;
+    }
+
+    /*
+        Idle is what the threads left of the window, not the runtime of the
+        idle thread: on the device the cycle counter stops while the idle
+        thread sleeps in WFE, so only the threads are counted exactly.
+     */
+    busy = (busy < window) ? busy : window;
+    stats->idle_us = (uint32_t)(window - busy);
+    stats->load_permille = (window > 0) ? (uint16_t)(busy * 1000 / window) : 0;
+    return QxOK;
+}
+
+int QxOS_CpuStatsFormat(const tQxCpuStats *stats, char *text, int size)
+{
+    if (size <= 0) {
+        return 0;
+    }
+    int len = snprintf(text, size, "cpu %u.%u%% sw %lu", stats->load_permille / 10, stats->load_permille % 10,
+                       (unsigned long)stats->switches);
+    if (len >= size) {
+        text[size - 1] = '\0';
+        return size - 1;
+    }
+
+    for (int i = 0; i < stats->count; i++) {
+        const tQxThreadLoad *t = &stats->threads[i];
+        char part[48];
+        int n = snprintf(part, sizeof(part), " | %.15s %u.%u%% %lu", t->name ? t->name : "?", t->permille / 10,
+                         t->permille % 10, (unsigned long)t->switches);
+        if (n >= (int)sizeof(part) || len + n >= size) {
+            break;
+        }
+        memcpy(text + len, part, n + 1);
+        len += n;
+    }
+    return len;
+}
+
+void QxOS_CpuReport(tQxStreamDevice device)
+{
+    tQxCpuStats stats;
+    if (QxOS_CpuStatsSample() != QxOK || QxOS_GetCpuStats(&stats) != QxOK) {
+        QxOS_DebugPrint("cpu   no statistics, build with QX_CPU_STATS");
+        if (device == QxStreamDeviceNone) {
+            QxOS_MutexReport();
+        }
+        return;
+    }
+
+    if (device != QxStreamDeviceNone) {
+        char line[CPU_REPORT_LINE];
+        int len = QxOS_CpuStatsFormat(&stats, line, sizeof(line) - 1);
+        if (QxFrame_Active(device)) {
+            QxFrame_Send(QxFrameStats, line, (uint16_t)len);
+            return;
+        }
+        line[len++] = '\n';
+        QxOS_StreamDataOut(device, line, (uint16_t)len, 100);
+        return;
+    }
+
+    QxOS_DebugPrint("cpu   %u.%u%% busy, %lu switches in %lu ms", stats.load_permille / 10, stats.load_permille % 10,
+                    (unsigned long)stats.switches, (unsigned long)(stats.window_us / 1000));
+    for (int i = 0; i < stats.count; i++) {
+        const tQxThreadLoad *t = &stats.threads[i];
+        QxOS_DebugPrint("cpu   %-20s %3u.%u%% %9lu us %7lu switches", t->name ? t->name : "?", t->permille / 10,
+                        t->permille % 10, (unsigned long)t->runtime_us, (unsigned long)t->switches);
+    }
+    QxOS_DebugPrint("cpu   %-20s %3u.%u%% %9lu us", "idle", (1000 - stats.load_permille) / 10,
+                    (1000 - stats.load_permille) % 10, (unsigned long)stats.idle_us);
+    QxOS_MutexReport();
+}
+
+void QxOS_MutexReport(void)
+{
+    tQxMutexStats mutexes[CPU_REPORT_MUTEXES];
+    int n = QxOS_ListMutexStats(mutexes, CPU_REPORT_MUTEXES);
+
+    for (int i = 0; i < n; i++) {
+        const tQxMutexStats *m = &mutexes[i];
+        QxOS_DebugPrint("mutex %-20s %9lu locks %7lu contended %5lu timeouts, wait max %7lu us, hold max %7lu us",
+                        m->name ? m->name : "?", (unsigned long)m->locks, (unsigned long)m->contended,
+                        (unsigned long)m->timeouts, (unsigned long)m->max_wait_us, (unsigned long)m->max_hold_us);
+    }
+}
@@ -0,0 +1,234 @@
+/**
+  ******************************************************************************
+  * @file    QxDataCollect.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Packs raw IMU samples into notification sized packets for data collection.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxDataCollect.h"
+#include "QxCodec.h"
+#include "QxFrame.h"
+#include "QxRing.h"
+
+#include <atomic>
+#include <string.h>
+
+enum {
+    DC_NONE,
+    DC_START,
+    DC_STOP,
+};
+
+enum {
+    DC_IDLE,
+    DC_DELAY,   /* started, waiting for dc_delay_ms */
+    DC_RUN,
+};
+
+#ifdef QX_DC_CODEC
+#define DC_SAMPLE_MAX   QX_CODEC_VARINT_MAX(1, 6)
+#define DC_COUNT_FLAGS  QX_DC_DELTA_VARINT
+#else
+#define DC_SAMPLE_MAX   QX_DC_SAMPLE_SIZE
+#define DC_COUNT_FLAGS  0
+#endif
+
+static QxRing<tQxDcPacket, QX_DC_QUEUE> dc_queue;
+
+/* Settings of the next start, read by the sensor thread after it takes DC_START */
+static uint32_t dc_req_delay;
+static uint32_t dc_req_duration;
+static uint16_t dc_req_limit;
+static std::atomic<uint8_t> dc_command;
+static std::atomic<bool> dc_active;
+
+/* State of the sensor thread */
+static struct {
+    uint8_t state;
+    uint32_t start;             /* tick of the start */
+    uint32_t delay;
+    uint32_t duration;
+    uint16_t limit;             /* bytes per packet */
+    uint16_t seq;
+    tQxDcPacket *packet;        /* packet being filled, NULL between packets */
+    uint32_t pos;               /* its queue position */
+    bool claimed;               /* false while filling dc_discard */
+    uint8_t count;
+    uint16_t length;
+#ifdef QX_DC_CODEC
+    tQxDeltaState delta;        /* every packet starts against zero */
+#endif
+} dc;
+
+/* Where the samples go while the queue is full */
+static tQxDcPacket dc_discard;
+
+static std::atomic<uint32_t> dc_samples;
+static std::atomic<uint32_t> dc_packets;
+static std::atomic<uint32_t> dc_sent;
+static std::atomic<uint32_t> dc_dropped;
+
+static void dc_begin_packet(void)
+{
+    dc.packet = dc_queue.Claim(dc.pos);
+    dc.claimed = (dc.packet != NULL);
+    if (!dc.claimed) {
+        dc.packet = &dc_discard;
+    }
+    dc.packet->data[0] = DEV_RPL_DC_INST;
+    dc.packet->data[2] = (uint8_t)dc.seq;
+    dc.packet->data[3] = (uint8_t)(dc.seq >> 8);
+    dc.count = 0;
+    dc.length = QX_DC_HEADER;
+#ifdef QX_DC_CODEC
+    QxCodec_DeltaReset(&dc.delta);
+#endif
+}
+
+static void dc_end_packet(void)
+{
+    if (dc.packet == NULL) {
+        return;
+    }
+    dc.packet->data[1] = dc.count | DC_COUNT_FLAGS;
+    dc.packet->length = dc.length;
+    /* a framed USB stream gets every packet, also the ones the radio has no room for */
+    if (QxFrame_Active(QxStreamDeviceUSB)) {
+        QxFrame_Send(QxFrameSensor, dc.packet->data, dc.length);
+    }
+    if (dc.claimed) {
+        dc_queue.Publish(dc.pos);
+        dc_packets.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        dc_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    dc.packet = NULL;
+    dc.seq++;
+}
+
+static void dc_finish(void)
+{
+    /* a claimed slot must be published, even when it holds no sample */
+    dc_end_packet();
+    dc.state = DC_IDLE;
+    dc_active.store(false, std::memory_order_relaxed);
+}
+
+tQxStatus QxDataCollect_Start(const s_qx_bt_ctrl *ctrl, uint16_t payload_max)
+{
+    payload_max = (payload_max > QX_DC_PACKET_MAX) ? QX_DC_PACKET_MAX : payload_max;
+    if (payload_max < QX_DC_HEADER + DC_SAMPLE_MAX) {
+        return QxErr;
+    }
+    dc_req_delay = ctrl->dc_delay_ms;
+    dc_req_duration = ctrl->dc_duration;
+    dc_req_limit = payload_max;
+    dc_active.store(true, std::memory_order_relaxed);
+    dc_command.store(DC_START, std::memory_order_release);
+    return QxOK;
+}
+
+void QxDataCollect_Stop(void)
+{
+    dc_active.store(false, std::memory_order_relaxed);
+    dc_command.store(DC_STOP, std::memory_order_release);
+}
+
+bool QxDataCollect_Active(void)
+{
+    return dc_active.load(std::memory_order_relaxed);
+}
+
+void QxDataCollect_Push(const int16_t *accel, const int16_t *gyro, uint16_t samples)
+{
+    if (dc_command.load(std::memory_order_relaxed) != DC_NONE) {
+        uint8_t command = dc_command.exchange(DC_NONE, std::memory_order_acquire);
+        if (dc.state != DC_IDLE) {
+            dc_finish();
+        }
+        if (command == DC_START) {
+            dc.state = DC_DELAY;
+            dc.start = QxOS_GetTick();
+            dc.delay = dc_req_delay;
+            dc.duration = dc_req_duration;
+            dc.limit = dc_req_limit;
+            dc.seq = 0;
+            dc_active.store(true, std::memory_order_relaxed);
+        }
+    }
+    if (dc.state == DC_IDLE) {
+        return;
+    }
+
+    uint32_t elapsed = QxOS_GetTick() - dc.start;
+    if (dc.state == DC_DELAY) {
+        if (elapsed < dc.delay) {
+            return;
+        }
+        dc.state = DC_RUN;
+    }
+    if (dc.duration != 0 && elapsed - dc.delay >= dc.duration) {
+        dc_finish();
+        return;
+    }
+
+    for (uint16_t i = 0; i < samples; i++) {
+        if (dc.packet == NULL) {
+            dc_begin_packet();
+        }
+        uint8_t *sample = dc.packet->data + dc.length;
+#ifdef QX_DC_CODEC
+        int16_t axes[6] = { accel[3 * i], accel[3 * i + 1], accel[3 * i + 2],
+                            gyro[3 * i], gyro[3 * i + 1], gyro[3 * i + 2] };
+        dc.length += QxCodec_DeltaVarintEncode(&dc.delta, axes, 1, 6, sample);
+#else
+        memcpy(sample, &accel[3 * i], 3 * sizeof(int16_t));
+        memcpy(sample + 3 * sizeof(int16_t), &gyro[3 * i], 3 * sizeof(int16_t));
+        dc.length += QX_DC_SAMPLE_SIZE;
+#endif
+        dc.count++;
+        if (dc.length + DC_SAMPLE_MAX > dc.limit) {
+            dc_end_packet();
+        }
+    }
+    dc_samples.fetch_add(samples, std::memory_order_relaxed);
+}
+
+const tQxDcPacket *QxDataCollect_Peek(void)
+{
+    return dc_queue.Peek();
+}
+
+void QxDataCollect_Sent(bool sent)
+{
+    dc_queue.Drop();
+    if (sent) {
+        dc_sent.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void QxDataCollect_GetStats(tQxDcStats *stats)
+{
+    stats->samples = dc_samples.load(std::memory_order_relaxed);
+    stats->packets = dc_packets.load(std::memory_order_relaxed);
+    stats->sent = dc_sent.load(std::memory_order_relaxed);
+    stats->dropped = dc_dropped.load(std::memory_order_relaxed);
+}
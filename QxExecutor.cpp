@@ -0,0 +1,323 @@
+/**
+  ******************************************************************************
+  * @file    QxExecutor.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Prioritized executor: posted work and timers on one thread.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxExecutor.h"
+
+#include <atomic>
+
+#define EXEC_LEVELS (QxPriorityRealtime - QxPriorityIdle + 1)
+
+struct tQxExecutor {
+    const char *name;
+    tQxSemaphore *wake;
+    tQxMutex *timer_lock;
+    std::atomic<tQxWork *> posted[EXEC_LEVELS];    /*!< LIFO stacks filled by QxOS_ExecutorPost() */
+    tQxWork *head[EXEC_LEVELS];                     /*!< FIFO of ready items, executor thread only */
+    tQxWork *tail[EXEC_LEVELS];
+    tQxTimer *timers;                               /*!< sorted by due_us, under timer_lock */
+    std::atomic<bool> stop;
+    std::atomic<uint32_t> runs;
+    std::atomic<uint32_t> coalesced;
+    std::atomic<uint32_t> overruns;
+    std::atomic<uint32_t> max_latency_us;
+    std::atomic<uint32_t> max_run_us;
+    std::atomic<tQxWorkFunc> max_run_func;
+};
+
+static int exec_level(tQxPriority prio)
+{
+    int level = (int)prio - QxPriorityIdle;
+    return (level < 0 || level >= EXEC_LEVELS) ? QxPriorityNormal - QxPriorityIdle : level;
+}
+
+/* false when the item was still pending, it then runs once for both posts */
+static bool exec_push(tQxExecutor *ex, tQxWork *work, uint32_t posted_us)
+{
+    if (__atomic_exchange_n(&work->pending, 1, __ATOMIC_ACQUIRE)) {
+        ex->coalesced.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    work->posted_us = posted_us;
+
+    std::atomic<tQxWork *> &top = ex->posted[exec_level(work->prio)];
+    tQxWork *next = top.load(std::memory_order_relaxed);
+    do {
+        work->next = next;
+    } while (!top.compare_exchange_weak(next, work, std::memory_order_release, std::memory_order_relaxed));
+    return true;
+}
+
+/* Move the posted stacks to the ready queues, in posting order */
+static void exec_collect(tQxExecutor *ex)
+{
+    for (int level = 0; level < EXEC_LEVELS; level++) {
+        tQxWork *w = ex->posted[level].exchange(NULL, std::memory_order_acquire);
+        tQxWork *fifo = NULL;
+        while (w != NULL) {
+            tQxWork *next = w->next;
+            w->next = fifo;
+            fifo = w;
+            w = next;
+        }
+        if (fifo == NULL) {
+            continue;
+        }
+        if (ex->tail[level] != NULL) {
+            ex->tail[level]->next = fifo;
+        } else {
+            ex->head[level] = fifo;
+        }
+        while (fifo->next != NULL) {
+            fifo = fifo->next;
+        }
+        ex->tail[level] = fifo;
+    }
+}
+
+static tQxWork *exec_next(tQxExecutor *ex)
+{
+    for (int level = EXEC_LEVELS - 1; level >= 0; level--) {
+        tQxWork *w = ex->head[level];
+        if (w != NULL) {
+            ex->head[level] = w->next;
+            if (ex->head[level] == NULL) {
+                ex->tail[level] = NULL;
+            }
+            return w;
+        }
+    }
+    return NULL;
+}
+
+static void exec_max(std::atomic<uint32_t> &max, uint32_t value)
+{
+    if (value > max.load(std::memory_order_relaxed)) {
+        max.store(value, std::memory_order_relaxed);
+    }
+}
+
+static void exec_run(tQxExecutor *ex, tQxWork *w)
+{
+    uint64_t start = QxOS_GetTimeUs();
+    exec_max(ex->max_latency_us, (uint32_t)start - w->posted_us);
+
+    /* cleared first, so the item may post itself again */
+    __atomic_store_n(&w->pending, 0, __ATOMIC_RELEASE);
+    w->func(w->arg);
+
+    uint32_t ran = (uint32_t)(QxOS_GetTimeUs() - start);
+    if (ran > ex->max_run_us.load(std::memory_order_relaxed)) {
+        ex->max_run_us.store(ran, std::memory_order_relaxed);
+        ex->max_run_func.store(w->func, std::memory_order_relaxed);
+    }
+    ex->runs.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* Called with timer_lock held */
+static void exec_insert_timer(tQxExecutor *ex, tQxTimer *timer)
+{
+    tQxTimer **at = &ex->timers;
+    while (*at != NULL && (*at)->due_us <= timer->due_us) {
+        at = &(*at)->next;
+    }
+    timer->next = *at;
+    *at = timer;
+    timer->active = 1;
+}
+
+/* Called with timer_lock held */
+static bool exec_remove_timer(tQxExecutor *ex, tQxTimer *timer)
+{
+    for (tQxTimer **at = &ex->timers; *at != NULL; at = &(*at)->next) {
+        if (*at == timer) {
+            *at = timer->next;
+            timer->next = NULL;
+            timer->active = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Post the work of every expired timer; returns the next expiry */
+static uint64_t exec_fire_timers(tQxExecutor *ex, uint64_t now)
+{
+    QxOS_LockMutex(ex->timer_lock);
+    while (ex->timers != NULL && ex->timers->due_us <= now) {
+        tQxTimer *t = ex->timers;
+        ex->timers = t->next;
+        t->next = NULL;
+        t->active = 0;
+
+        /* the latency of a timer counts from its expiry */
+        exec_push(ex, &t->work, (uint32_t)t->due_us);
+
+        if (t->period_ms > 0) {
+            uint64_t period = QxOS_MsToUs(t->period_ms);
+            t->due_us += period;
+            if (t->due_us <= now) {
+                uint64_t missed = (now - t->due_us) / period + 1;
+                ex->overruns.fetch_add((uint32_t)missed, std::memory_order_relaxed);
+                t->due_us += missed * period;
+            }
+            exec_insert_timer(ex, t);
+        }
+    }
+    uint64_t next = (ex->timers != NULL) ? ex->timers->due_us : UINT64_MAX;
+    QxOS_UnLockMutex(ex->timer_lock);
+    return next;
+}
+
+void QxOS_WorkInit(tQxWork *work, tQxWorkFunc func, void *arg, tQxPriority prio)
+{
+    work->func = func;
+    work->arg = arg;
+    work->prio = prio;
+    work->next = NULL;
+    work->pending = 0;
+    work->posted_us = 0;
+}
+
+tQxExecutor* QxOS_CreateExecutor(const char *name)
+{
+    tQxExecutor *ex = (tQxExecutor *)calloc(1, sizeof(tQxExecutor));
+    if (ex == NULL) {
+        return NULL;
+    }
+    ex->name = name;
+    /* one count is enough: the executor looks at everything each time it wakes */
+    ex->wake = QxOS_CreateSemaphore(name, 1, 0);
+    ex->timer_lock = QxOS_CreateMutex(name);
+    if (ex->wake == NULL || ex->timer_lock == NULL) {
+        free(ex);
+        return NULL;
+    }
+    return ex;
+}
+
+tQxStatus QxOS_ExecutorPost(tQxExecutor *ex, tQxWork *work)
+{
+    if (ex == NULL || work == NULL) {
+        return QxErr;
+    }
+    if (exec_push(ex, work, (uint32_t)QxOS_GetTimeUs())) {
+        QxOS_ReleaseSemaphore(ex->wake);
+    }
+    return QxOK;
+}
+
+tQxStatus QxOS_ExecutorTimerStart(tQxExecutor *ex, tQxTimer *timer, uint32_t delay_ms, uint32_t period_ms)
+{
+    if (ex == NULL || timer == NULL) {
+        return QxErr;
+    }
+    QxOS_LockMutex(ex->timer_lock);
+    exec_remove_timer(ex, timer);
+    timer->period_ms = period_ms;
+    timer->due_us = QxOS_GetTimeUs() + QxOS_MsToUs(delay_ms);
+    exec_insert_timer(ex, timer);
+    QxOS_UnLockMutex(ex->timer_lock);
+
+    /* the executor may sleep until a later expiry */
+    QxOS_ReleaseSemaphore(ex->wake);
+    return QxOK;
+}
+
+tQxStatus QxOS_ExecutorTimerStop(tQxExecutor *ex, tQxTimer *timer)
+{
+    if (ex == NULL || timer == NULL) {
+        return QxErr;
+    }
+    QxOS_LockMutex(ex->timer_lock);
+    bool removed = exec_remove_timer(ex, timer);
+    QxOS_UnLockMutex(ex->timer_lock);
+    return removed ? QxOK : QxNotReady;
+}
+
+tQxStatus QxOS_ExecutorRun(tQxExecutor *ex, uint32_t millisec)
+{
+    if (ex == NULL) {
+        return QxErr;
+    }
+    uint64_t end = (millisec == QX_WAIT_FOREVER) ? UINT64_MAX : QxOS_GetTimeUs() + QxOS_MsToUs(millisec);
+
+    while (!ex->stop.load(std::memory_order_acquire)) {
+        uint64_t now = QxOS_GetTimeUs();
+        uint64_t next = exec_fire_timers(ex, now);
+        exec_collect(ex);
+
+        /* one item at a time, so items posted meanwhile are ordered by priority */
+        tQxWork *w = exec_next(ex);
+        if (w != NULL) {
+            exec_run(ex, w);
+            continue;
+        }
+
+        if (now >= end) {
+            break;
+        }
+        next = (end < next) ? end : next;
+        QxOS_WaitSemaphore(ex->wake, (next == UINT64_MAX) ? QX_WAIT_FOREVER : QxOS_UsToMs(next - now));
+    }
+    ex->stop.store(false, std::memory_order_relaxed);
+    return QxOK;
+}
+
+static void exec_thread(const void *userdata)
+{
+    QxOS_ExecutorRun((tQxExecutor *)userdata, QX_WAIT_FOREVER);
+}
+
+tQxThread* QxOS_ExecutorStart(tQxExecutor *ex, tQxPriority prio, uint32_t stacksz)
+{
+    if (ex == NULL) {
+        return NULL;
+    }
+    return QxOS_CreateThread(ex->name, exec_thread, prio, stacksz, ex);
+}
+
+tQxStatus QxOS_ExecutorStop(tQxExecutor *ex)
+{
+    if (ex == NULL) {
+        return QxErr;
+    }
+    ex->stop.store(true, std::memory_order_release);
+    QxOS_ReleaseSemaphore(ex->wake);
+    return QxOK;
+}
+
+tQxStatus QxOS_ExecutorGetStats(tQxExecutor *ex, tQxExecutorStats *stats)
+{
+    if (ex == NULL || stats == NULL) {
+        return QxErr;
+    }
+    stats->runs = ex->runs.load(std::memory_order_relaxed);
+    stats->coalesced = ex->coalesced.load(std::memory_order_relaxed);
+    stats->overruns = ex->overruns.load(std::memory_order_relaxed);
+    stats->max_latency_us = ex->max_latency_us.load(std::memory_order_relaxed);
+    stats->max_run_us = ex->max_run_us.load(std::memory_order_relaxed);
+    stats->max_run_func = ex->max_run_func.load(std::memory_order_relaxed);
+    return QxOK;
+}
@@ -0,0 +1,213 @@
+/**
+  ******************************************************************************
+  * @file    QxFastMath.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Array-at-a-time fast math for feature and probability code.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxFastMath.h"
+
+#define FM_LOG2E        1.44269504088896341f
+#define FM_ROUND_MAGIC  12582912.0f /* 1.5 * 2^23 */
+#define FM_SQRT_HALF_BITS   0x3f3504f3  /* bit pattern of sqrt(0.5) */
+#define FM_FLT_MIN_BITS     0x00800000  /* bit pattern of FLT_MIN */
+
+static inline uint32_t fm_as_uint(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float fm_as_float(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/*
+    2^x = 2^k * 2^f with k = round(x) and f in [-0.5, 0.5].
+    Adding 1.5 * 2^23 rounds x to an integer held in the low mantissa bits, so
+    neither floorf() nor a float to int conversion is needed and the loops stay
+    free of branches. 2^f is a degree 6 polynomial and 2^k is assembled
+    directly in the float exponent bits.
+ */
+static inline float fm_exp2_kernel(float x)
+{
+    x = (x < -126.0f) ? -126.0f : x;
+    x = (x > 127.0f) ? 127.0f : x;
+
+    float t = x + FM_ROUND_MAGIC;
+    float f = x - (t - FM_ROUND_MAGIC);
+    uint32_t k = fm_as_uint(t) - fm_as_uint(FM_ROUND_MAGIC);
+
+    float p = 1.5403530393e-4f;
+    p = p * f + 1.3333558146e-3f;
+    p = p * f + 9.6181291076e-3f;
+    p = p * f + 5.5504108665e-2f;
+    p = p * f + 2.4022650696e-1f;
+    p = p * f + 6.9314718056e-1f;
+    p = p * f + 1.0f;
+
+    return p * fm_as_float((k + 127) << 23);
+}
+
+/*
+    log2(x) = e + log2(m) with m in [sqrt(0.5), sqrt(2)).
+    log2(m) = 2/ln2 * atanh(s), s = (m - 1) / (m + 1), |s| <= 0.1716.
+ */
+static inline float fm_log2_kernel(float x)
+{
+    /* clamp on the bit pattern, negative values have the sign bit set */
+    int32_t bits = (int32_t)fm_as_uint(x);
+    bits = (bits < FM_FLT_MIN_BITS) ? FM_FLT_MIN_BITS : bits;
+
+    int32_t e = (bits - FM_SQRT_HALF_BITS) >> 23;
+    float m = fm_as_float((uint32_t)bits - ((uint32_t)e << 23));
+
+    float s = (m - 1.0f) / (m + 1.0f);
+    float z = s * s;
+
+    float p = 3.2059889797e-1f;
+    p = p * z + 4.1219858312e-1f;
+    p = p * z + 5.7707801635e-1f;
+    p = p * z + 9.6179669392e-1f;
+    p = p * z + 2.8853900818e+0f;
+
+    return (float)e + s * p;
+}
+
+void fm_exp2f_batch(const float *in, float *out, uint32_t n)
+{
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        float x0 = in[i], x1 = in[i + 1], x2 = in[i + 2], x3 = in[i + 3];
+        out[i] = fm_exp2_kernel(x0);
+        out[i + 1] = fm_exp2_kernel(x1);
+        out[i + 2] = fm_exp2_kernel(x2);
+        out[i + 3] = fm_exp2_kernel(x3);
+    }
+
+    for (; i < n; i++) {
+        out[i] = fm_exp2_kernel(in[i]);
+    }
+}
+
+void fm_log2f_batch(const float *in, float *out, uint32_t n)
+{
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        float x0 = in[i], x1 = in[i + 1], x2 = in[i + 2], x3 = in[i + 3];
+        out[i] = fm_log2_kernel(x0);
+        out[i + 1] = fm_log2_kernel(x1);
+        out[i + 2] = fm_log2_kernel(x2);
+        out[i + 3] = fm_log2_kernel(x3);
+    }
+
+    for (; i < n; i++) {
+        out[i] = fm_log2_kernel(in[i]);
+    }
+}
+
+void fm_softmax_batch(const float *in, float *out, uint32_t n)
+{
+    if (n == 0) {
+        return;
+    }
+
+    float max = in[0];
+    for (uint32_t i = 1; i < n; i++) {
+        max = (in[i] > max) ? in[i] : max;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = (in[i] - max) * FM_LOG2E;
+    }
+    fm_exp2f_batch(out, out, n);
+
+    /* four partial sums, float addition is not reassociated by the compiler */
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        s0 += out[i];
+        s1 += out[i + 1];
+        s2 += out[i + 2];
+        s3 += out[i + 3];
+    }
+
+    for (; i < n; i++) {
+        s0 += out[i];
+    }
+
+    float sum = (s0 + s1) + (s2 + s3);
+
+    /* sum >= 1 because the largest element contributes exp(0) */
+    float inv = 1.0f / sum;
+    for (i = 0; i < n; i++) {
+        out[i] *= inv;
+    }
+}
+
+void fm_log2_power_batch(const float *cplx, float *out, uint32_t nbins, float pwr_floor)
+{
+    uint32_t i = 0;
+
+    for (; i + 4 <= nbins; i += 4) {
+        const float *c = &cplx[2 * i];
+        float p0 = c[0] * c[0] + c[1] * c[1] + pwr_floor;
+        float p1 = c[2] * c[2] + c[3] * c[3] + pwr_floor;
+        float p2 = c[4] * c[4] + c[5] * c[5] + pwr_floor;
+        float p3 = c[6] * c[6] + c[7] * c[7] + pwr_floor;
+        out[i] = fm_log2_kernel(p0);
+        out[i + 1] = fm_log2_kernel(p1);
+        out[i + 2] = fm_log2_kernel(p2);
+        out[i + 3] = fm_log2_kernel(p3);
+    }
+
+    for (; i < nbins; i++) {
+        const float *c = &cplx[2 * i];
+        out[i] = fm_log2_kernel(c[0] * c[0] + c[1] * c[1] + pwr_floor);
+    }
+}
+
+float fm_entropy_batch(const float *p, uint32_t n)
+{
+    /* four partial sums keep the FPU pipeline busy and allow vectorization */
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        s0 += p[i] * fm_log2_kernel(p[i]);
+        s1 += p[i + 1] * fm_log2_kernel(p[i + 1]);
+        s2 += p[i + 2] * fm_log2_kernel(p[i + 2]);
+        s3 += p[i + 3] * fm_log2_kernel(p[i + 3]);
+    }
+
+    for (; i < n; i++) {
+        s0 += p[i] * fm_log2_kernel(p[i]);
+    }
+
+    return -((s0 + s1) + (s2 + s3));
+}
@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file    QxFlatTree.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Flattened tree ensemble predictor.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxFlatTree.h"
+#include "QxFastMath.h"
+
+/*
+    Number of thresholds of the slot that are not greater than x.
+    The comparison is written as !(x < edge) so a NaN feature lands in the
+    last bin and takes the right branch everywhere, like the original predict().
+ */
+static inline uint8_t flat_bin(const float *edges, uint32_t count, float x)
+{
+    uint32_t lo = 0;
+
+    while (count > 0) {
+        uint32_t half = count >> 1;
+        if (!(x < edges[lo + half])) {
+            lo += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+
+    return (uint8_t)lo;
+}
+
+void QxFlatTree_Predict(const tQxFlatForest *forest, const float *features, float *probs)
+{
+    uint8_t bins[QX_FLAT_LEAF];
+
+    for (uint32_t s = 0; s < forest->num_slots; s++) {
+        uint32_t start = forest->edge_start[s];
+        bins[s] = flat_bin(&forest->edges[start], forest->edge_start[s + 1] - start,
+                           features[forest->slot_feature[s]]);
+    }
+
+    uint32_t t = 0;
+    for (uint32_t c = 0; c < forest->num_classes; c++) {
+        /* quantized leaves add up exactly in an integer */
+        int32_t acc = 0;
+
+        for (; t < forest->class_tree_end[c]; t++) {
+            const tQxFlatNode *node = &forest->nodes[forest->tree_root[t]];
+
+            while (node->slot != QX_FLAT_LEAF) {
+                node += node->value + (bins[node->slot] >= node->bin);
+            }
+            acc += node->value;
+        }
+
+        probs[c] = forest->base_score[c] + (float)acc * forest->leaf_scale;
+    }
+
+    fm_softmax_batch(probs, probs, forest->num_classes);
+}
@@ -0,0 +1,161 @@
+/**
+  ******************************************************************************
+  * @file    QxFrame.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    19-Oct-2020
+  * @brief   Framed stream: COBS and CRC-16 frames of several channels on one device.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxFrame.h"
+#include "QxStreamAsync.h"
+
+#include <atomic>
+
+#define FRAME_TIMEOUT   100 //ms, only without QxOS_StreamAsyncStart()
+
+static std::atomic<uint8_t> frame_device(QxStreamDeviceNone);
+static bool frame_async;
+static std::atomic<uint8_t> frame_seq[QxFrameChannelNum];
+static std::atomic<uint32_t> frame_count[QxFrameChannelNum];
+static std::atomic<uint32_t> frame_bytes;
+static std::atomic<uint32_t> frame_dropped;
+
+/* CRC-16/CCITT-FALSE a nibble at a time, 32 bytes of table instead of 512 */
+static uint16_t frame_crc16(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
+    for (uint32_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+/* COBS encoder fed in pieces, so header, payload and crc need no copy into one buffer */
+typedef struct {
+    uint8_t *out;
+    uint32_t pos;       /* next byte of out */
+    uint32_t code_pos;  /* code byte of the current block */
+    uint8_t code;       /* 1 + bytes in the current block */
+} tCobs;
+
+static void cobs_begin(tCobs *c, uint8_t *out)
+{
+    c->out = out;
+    c->code_pos = 0;
+    c->pos = 1;
+    c->code = 1;
+}
+
+static void cobs_put(tCobs *c, const uint8_t *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] != 0) {
+            c->out[c->pos++] = data[i];
+            c->code++;
+        }
+        /* a zero, or a full block of 254 bytes, closes the block */
+        if (data[i] == 0 || c->code == 0xFF) {
+            c->out[c->code_pos] = c->code;
+            c->code_pos = c->pos++;
+            c->code = 1;
+        }
+    }
+}
+
+static uint32_t cobs_end(tCobs *c)
+{
+    c->out[c->code_pos] = c->code;
+    return c->pos;
+}
+
+tQxStatus QxFrame_Init(tQxStreamDevice device)
+{
+    if (device == QxStreamDeviceNone) {
+        return QxErr;
+    }
+    tQxStreamAsyncStats stats;
+    frame_async = (QxOS_StreamAsyncGetStats(device, &stats) == QxOK);
+    frame_device.store(device, std::memory_order_release);
+    return QxOK;
+}
+
+bool QxFrame_Active(tQxStreamDevice device)
+{
+    return device != QxStreamDeviceNone && frame_device.load(std::memory_order_acquire) == device;
+}
+
+uint32_t QxFrame_Pack(uint8_t *out, tQxFrameChannel channel, const void *data, uint16_t length)
+{
+    if ((unsigned)channel >= QxFrameChannelNum || length > QX_FRAME_PAYLOAD_MAX) {
+        return 0;
+    }
+    uint8_t header[2] = { (uint8_t)channel, frame_seq[channel].fetch_add(1, std::memory_order_relaxed) };
+    uint16_t crc = frame_crc16(0xFFFF, header, sizeof(header));
+    crc = frame_crc16(crc, (const uint8_t *)data, length);
+    uint8_t trailer[2] = { (uint8_t)crc, (uint8_t)(crc >> 8) };
+
+    tCobs cobs;
+    out[0] = QX_FRAME_DELIMITER;
+    cobs_begin(&cobs, out + 1);
+    cobs_put(&cobs, header, sizeof(header));
+    cobs_put(&cobs, (const uint8_t *)data, length);
+    cobs_put(&cobs, trailer, sizeof(trailer));
+    uint32_t n = 1 + cobs_end(&cobs);
+    out[n++] = QX_FRAME_DELIMITER;
+    return n;
+}
+
+int QxFrame_Send(tQxFrameChannel channel, const void *data, uint16_t length)
+{
+    uint8_t out[QX_FRAME_ENCODED_MAX(QX_FRAME_PAYLOAD_MAX)];
+    tQxStreamDevice device = (tQxStreamDevice)frame_device.load(std::memory_order_acquire);
+    if (device == QxStreamDeviceNone) {
+        return 0;
+    }
+
+    uint32_t n = QxFrame_Pack(out, channel, data, length);
+    if (n == 0) {
+        frame_dropped.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    int sent = frame_async ? QxOS_StreamDataOutAsync(device, out, (uint16_t)n)
+                           : QxOS_StreamDataOut(device, out, (uint16_t)n, FRAME_TIMEOUT);
+    if (sent != (int)n) {
+        /* the seq was taken, the host sees the gap */
+        frame_dropped.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    frame_count[channel].fetch_add(1, std::memory_order_relaxed);
+    frame_bytes.fetch_add(n, std::memory_order_relaxed);
+    return length;
+}
+
+void QxFrame_GetStats(tQxFrameStats *stats)
+{
+    for (int i = 0; i < QxFrameChannelNum; i++) {
+        stats->frames[i] = frame_count[i].load(std::memory_order_relaxed);
+    }
+    stats->bytes = frame_bytes.load(std::memory_order_relaxed);
+    stats->dropped = frame_dropped.load(std::memory_order_relaxed);
+}
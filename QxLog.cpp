@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file    QxLog.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Deferred binary logging: record ring and stream drain.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxLog.h"
+#include "QxFrame.h"
+#include "QxRing.h"
+
+#define LOG_FLUSH_BYTES     256
+#define LOG_FLUSH_TIMEOUT   100 //ms
+
+typedef struct {
+    uint8_t len;
+    uint8_t data[QX_LOG_RECORD_MAX];
+} tLogRecord;
+
+extern "C" const char QxLog_Base[] = "QxLog";
+
+static QxRing<tLogRecord, QX_LOG_RECORDS> log_ring;
+static std::atomic<uint32_t> log_dropped;
+static tQxStreamDevice log_device = QxStreamDeviceUSB;
+static uint32_t log_period;
+
+BOOL QxLog_Commit(const uint8_t *payload, uint8_t length)
+{
+    tLogRecord record;
+    record.len = length;
+    memcpy(record.data, payload, length);
+
+    if (!log_ring.Push(record)) {
+        log_dropped.fetch_add(1, std::memory_order_relaxed);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static uint32_t log_frame(uint8_t *out, const uint8_t *payload, uint8_t length)
+{
+    uint8_t sum = 0;
+    out[0] = QX_LOG_SYNC;
+    out[1] = length;
+    for (uint8_t i = 0; i < length; i++) {
+        out[2 + i] = payload[i];
+        sum += payload[i];
+    }
+    out[2 + length] = (uint8_t)~sum;
+    return 3 + length;
+}
+
+int QxLog_Flush(void)
+{
+    uint8_t buf[LOG_FLUSH_BYTES];
+    uint32_t used = 0;
+    int sent = 0;
+    bool framed = QxFrame_Active(log_device);
+
+    uint32_t dropped = log_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+        uint8_t payload[6] = { QxLogDropped };
+        uint8_t n = 1;
+        do {
+            payload[n++] = (uint8_t)((dropped & 0x7F) | (dropped > 0x7F ? 0x80 : 0));
+            dropped >>= 7;
+        } while (dropped);
+        if (framed) {
+            sent += QxFrame_Send(QxFrameLog, payload, n);
+        } else {
+            used += log_frame(buf, payload, n);
+        }
+    }
+
+    /* coalesce frames into as few stream writes as possible */
+    tLogRecord record;
+    while (log_ring.Pop(record)) {
+        if (framed) {
+            /* a record per frame of the log channel, QxFrame frames and checks it */
+            sent += QxFrame_Send(QxFrameLog, record.data, record.len);
+            continue;
+        }
+        if (used + 3 + record.len > sizeof(buf)) {
+            sent += QxOS_StreamDataOut(log_device, buf, (uint16_t)used, LOG_FLUSH_TIMEOUT);
+            used = 0;
+        }
+        used += log_frame(buf + used, record.data, record.len);
+    }
+
+    if (used) {
+        sent += QxOS_StreamDataOut(log_device, buf, (uint16_t)used, LOG_FLUSH_TIMEOUT);
+    }
+    return sent;
+}
+
+static void log_drain_loop(const void *userdata)
+{
+    (void)userdata;
+    while (1) {
+        QxLog_Flush();
+        QxOS_Delay(log_period);
+    }
+}
+
+tQxStatus QxLog_Init(tQxStreamDevice device, uint32_t period)
+{
+    log_device = device;
+    if (period == 0) {
+        return QxOK;
+    }
+
+    log_period = period;
+    if (QxOS_CreateThread("qxlog", log_drain_loop, QxPriorityLow, 1024, NULL) == NULL) {
+        return QxErr;
+    }
+    return QxOK;
+}
@@ -0,0 +1,165 @@
+/**
+  ******************************************************************************
+  * @file    QxNNInt8.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Int8 quantized dense and conv1d inference.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxNNInt8.h"
+#include "QxFastMath.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis.h"
+#define NN_USE_SIMD 1
+#endif
+
+/*
+    Two output channels share each load of the input, as in the CMSIS-NN
+    s8 kernels. On the Cortex-M4 four int8 values are loaded as one word,
+    sign extended in pairs with SXTB16 and accumulated with SMLAD, which is
+    four multiply-accumulates per two instructions.
+ */
+static inline void nn_dot2_s8(const int8_t *x, const int8_t *w0, const int8_t *w1, uint32_t n,
+                              int32_t *acc0, int32_t *acc1)
+{
+    int32_t s0 = *acc0, s1 = *acc1;
+    uint32_t i = 0;
+
+#ifdef NN_USE_SIMD
+    for (; i + 4 <= n; i += 4) {
+        uint32_t vx, va, vb;
+        memcpy(&vx, x + i, 4);
+        memcpy(&va, w0 + i, 4);
+        memcpy(&vb, w1 + i, 4);
+
+        uint32_t x_even = __SXTB16(vx), x_odd = __SXTB16(__ROR(vx, 8));
+        s0 = (int32_t)__SMLAD(x_even, __SXTB16(va), (uint32_t)s0);
+        s0 = (int32_t)__SMLAD(x_odd, __SXTB16(__ROR(va, 8)), (uint32_t)s0);
+        s1 = (int32_t)__SMLAD(x_even, __SXTB16(vb), (uint32_t)s1);
+        s1 = (int32_t)__SMLAD(x_odd, __SXTB16(__ROR(vb, 8)), (uint32_t)s1);
+    }
+#endif
+
+    for (; i < n; i++) {
+        s0 += (int32_t)x[i] * w0[i];
+        s1 += (int32_t)x[i] * w1[i];
+    }
+
+    *acc0 = s0;
+    *acc1 = s1;
+}
+
+static inline int32_t nn_dot_s8(const int8_t *x, const int8_t *w, uint32_t n, int32_t acc)
+{
+    uint32_t i = 0;
+
+#ifdef NN_USE_SIMD
+    for (; i + 4 <= n; i += 4) {
+        uint32_t vx, vw;
+        memcpy(&vx, x + i, 4);
+        memcpy(&vw, w + i, 4);
+        acc = (int32_t)__SMLAD(__SXTB16(vx), __SXTB16(vw), (uint32_t)acc);
+        acc = (int32_t)__SMLAD(__SXTB16(__ROR(vx, 8)), __SXTB16(__ROR(vw, 8)), (uint32_t)acc);
+    }
+#endif
+
+    for (; i < n; i++) {
+        acc += (int32_t)x[i] * w[i];
+    }
+
+    return acc;
+}
+
+/* acc * multiplier * 2^shift / 2^31, rounded half up (CMSIS-NN single rounding), saturated to int32 */
+static inline int32_t nn_requantize(int32_t acc, int32_t multiplier, int32_t shift)
+{
+    int64_t product = (int64_t)acc * multiplier;
+    int64_t result = ((product >> (30 - shift)) + 1) >> 1;
+    result = (result < INT32_MIN) ? INT32_MIN : result;
+    result = (result > INT32_MAX) ? INT32_MAX : result;
+    return (int32_t)result;
+}
+
+static inline int8_t nn_output(const tQxNNLayer *layer, uint32_t c, int32_t acc, int32_t act_min)
+{
+    /* the zero point is added after the int32 saturation, keep it from wrapping */
+    int64_t v = (int64_t)nn_requantize(acc, layer->multiplier[c], layer->shift[c]) + layer->out_zero_point;
+    v = (v < act_min) ? act_min : v;
+    v = (v > 127) ? 127 : v;
+    return (int8_t)v;
+}
+
+void QxNNInt8_Layer(const tQxNNLayer *layer, const int8_t *in, int8_t *out)
+{
+    const uint32_t window = (uint32_t)layer->kernel * layer->in_channels;
+    const uint32_t step = (uint32_t)layer->stride * layer->in_channels;
+    const uint32_t channels = layer->out_channels;
+    const int32_t act_min = layer->relu ? layer->out_zero_point : -128;
+
+    for (uint32_t p = 0; p < layer->out_length; p++) {
+        const int8_t *x = in + p * step;
+        int8_t *y = out + p * channels;
+        uint32_t c = 0;
+
+        for (; c + 2 <= channels; c += 2) {
+            int32_t acc0 = layer->bias[c], acc1 = layer->bias[c + 1];
+            const int8_t *w = layer->weights + c * window;
+            nn_dot2_s8(x, w, w + window, window, &acc0, &acc1);
+            y[c] = nn_output(layer, c, acc0, act_min);
+            y[c + 1] = nn_output(layer, c + 1, acc1, act_min);
+        }
+
+        if (c < channels) {
+            int32_t acc = nn_dot_s8(x, layer->weights + c * window, window, layer->bias[c]);
+            y[c] = nn_output(layer, c, acc, act_min);
+        }
+    }
+}
+
+void QxNNInt8_Predict(const tQxNNModel *model, const float *features, float *probs)
+{
+    int8_t *a = model->scratch;
+    int8_t *b = model->scratch + model->scratch_half;
+    const float inv_scale = 1.0f / model->in_scale;
+
+    for (uint32_t i = 0; i < model->num_inputs; i++) {
+        float v = features[i] * inv_scale + (float)model->in_zero_point;
+        /* written so that a NaN feature becomes -128 */
+        v = (v >= -128.0f) ? v : -128.0f;
+        v = (v <= 127.0f) ? v : 127.0f;
+        a[i] = (int8_t)(int32_t)(v + ((v >= 0.0f) ? 0.5f : -0.5f));
+    }
+
+    for (uint32_t l = 0; l < model->num_layers; l++) {
+        QxNNInt8_Layer(&model->layers[l], a, b);
+        int8_t *t = a;
+        a = b;
+        b = t;
+    }
+
+    for (uint32_t i = 0; i < model->num_outputs; i++) {
+        probs[i] = model->out_scale * (float)(a[i] - model->out_zero_point);
+    }
+
+    if (model->softmax) {
+        fm_softmax_batch(probs, probs, model->num_outputs);
+    }
+}
@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file    QxOS_Cpu_Nano33BLE.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Per-thread CPU time and context switches of the RTX kernel.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxCpuStats.h"
+
+#include <mbed.h>
+#include "rtx_os.h"
+
+/*
+    RTX switches threads only on the way out of SVC_Handler, PendSV_Handler
+    and SysTick_Handler (mbed pends SysTick for its OS tick), so between two
+    entries into any of them exactly one thread ran: the one running at the
+    second entry. QX_CPU_STATS=<ms> of automl-build.sh links with
+    --wrap=SVC_Handler --wrap=PendSV_Handler --wrap=SysTick_Handler, so the
+    vector table points at the wrappers below. They call cpu_switch_hook()
+    and continue in the RTX handler with the stack and LR untouched; r0-r3
+    and r12 are reloaded from the exception frame by RTX.
+
+    The three handlers share the lowest priority and do not nest, which keeps
+    the hook free of locks. Interrupt time counts for the interrupted thread.
+
+    The DWT cycle counter stops while the core sleeps, and the idle thread
+    sleeps in WFE, so the cycles of the idle thread are only its awake part.
+    QxOS_GetCpuStats() therefore takes the idle time as the rest of the
+    window, which comes from the us ticker.
+ */
+#ifdef QX_CPU_STATS
+
+typedef struct {
+    osRtxThread_t *thread;
+    const char *name;
+    uint64_t cycles;
+    uint32_t switches;
+} tCpuSlot;
+
+static tCpuSlot cpu_slots[QX_CPU_THREADS_MAX];
+static int cpu_slot_count;
+static osRtxThread_t *cpu_prev;
+static uint32_t cpu_last;
+static bool cpu_started;
+
+static tCpuSlot *cpu_slot(osRtxThread_t *thread)
+{
+    for (int i = 0; i < cpu_slot_count; i++) {
+        if (cpu_slots[i].thread == thread) {
+            return &cpu_slots[i];
+        }
+    }
+    /* the last slot collects every thread that did not get its own */
+    tCpuSlot *slot = &cpu_slots[cpu_slot_count];
+    if (cpu_slot_count < QX_CPU_THREADS_MAX - 1) {
+        slot->thread = thread;
+        slot->name = (thread->name != NULL) ? thread->name : "?";
+        cpu_slot_count++;
+    } else {
+        slot->name = "other";
+    }
+    return slot;
+}
+
+extern "C" void cpu_switch_hook(void)
+{
+    uint32_t now = QxOS_GetCycles();
+    osRtxThread_t *curr = osRtxInfo.thread.run.curr;
+    if (curr == NULL) {
+        return;
+    }
+    if (!cpu_started) {
+        cpu_started = true;
+        cpu_last = now;
+    }
+
+    tCpuSlot *slot = cpu_slot(curr);
+    slot->cycles += now - cpu_last;
+    cpu_last = now;
+    if (curr != cpu_prev) {
+        slot->switches++;
+        cpu_prev = curr;
+    }
+}
+
+#define CPU_WRAP(handler) \
+    extern "C" void __real_##handler(void); \
+    extern "C" __attribute__((naked)) void __wrap_##handler(void) \
+    { \
+        __asm volatile("push {r0, lr}\n" \
+                       "bl cpu_switch_hook\n" \
+                       "pop {r0, lr}\n" \
+                       "b __real_" #handler "\n"); \
+    }
+
+CPU_WRAP(SVC_Handler)
+CPU_WRAP(PendSV_Handler)
+CPU_WRAP(SysTick_Handler)
+
+int QxOS_GetThreadCpu(tQxThreadCpu *threads, int max)
+{
+    uint32_t per_us = QxOS_GetCycleHz() / 1000000u;
+
+    core_util_critical_section_enter();
+    /* the caller is running, charge it up to now */
+    cpu_switch_hook();
+    int used = cpu_slot_count + ((cpu_slots[QX_CPU_THREADS_MAX - 1].name != NULL) ? 1 : 0);
+    int n = (used < max) ? used : max;
+    for (int i = 0; i < n; i++) {
+        threads[i].name = cpu_slots[i].name;
+        threads[i].id = (uintptr_t)cpu_slots[i].thread;
+        threads[i].runtime_us = cpu_slots[i].cycles / per_us;
+        threads[i].switches = cpu_slots[i].switches;
+        threads[i].idle = (cpu_slots[i].thread == osRtxInfo.thread.idle) ? TRUE : FALSE;
+    }
+    core_util_critical_section_exit();
+    return n;
+}
+
+#else
+
+int QxOS_GetThreadCpu(tQxThreadCpu *threads, int max)
+{
+    /* the handlers are only wrapped in QX_CPU_STATS builds */
+    return 0;
+}
+
+#endif /* QX_CPU_STATS */
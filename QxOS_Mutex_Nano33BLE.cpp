@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    QxOS_Mutex_Nano33BLE.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Priority inheriting mutexes with contention statistics.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxOS.h"
+
+#include <mbed.h>
+#include "mbed_rtos_storage.h"
+
+/*
+    These replace the weak mutex functions of the library with RTX mutexes
+    created with osMutexPrioInherit. While a thread waits, the owner runs at
+    the priority of the waiter, so a thread of medium priority can not keep
+    it, and with it the waiter, off the CPU; the inversion is bounded by the
+    hold time, which is measured here together with the waits. Like the
+    rtos::Mutex of the library they are recursive and robust.
+
+    The statistics are written by the owner, only timeouts are counted by
+    threads that do not get the mutex. They are read without a lock, a word
+    does not tear on the Cortex-M4. Times come from the cycle counter, which
+    wraps after 67 s.
+ */
+typedef struct tRtxMutex {
+    tQxMutex mutex;
+    osMutexId_t id;
+    mbed_rtos_storage_mutex_t cb;
+    uint32_t depth;             /* nested locks of the owner */
+    uint32_t locked_at;         /* QxOS_GetCycles() of the outermost lock */
+    tQxMutexStats stats;
+    struct tRtxMutex *next;
+} tRtxMutex;
+
+static tRtxMutex *rtx_mutexes;
+
+static tQxStatus rtx_lock(tRtxMutex *m, uint32_t ticks)
+{
+    if (osMutexAcquire(m->id, 0) != osOK) {
+        uint32_t start = QxOS_GetCycles();
+        if (ticks == 0 || osMutexAcquire(m->id, ticks) != osOK) {
+            core_util_atomic_incr_u32(&m->stats.timeouts, 1);
+            return QxBusy;
+        }
+        uint32_t waited = QxOS_CyclesToUs(QxOS_GetCycles() - start);
+        m->stats.contended++;
+        m->stats.max_wait_us = (waited > m->stats.max_wait_us) ? waited : m->stats.max_wait_us;
+    }
+    if (m->depth++ == 0) {
+        m->stats.locks++;
+        m->locked_at = QxOS_GetCycles();
+        m->mutex.isLocked = TRUE;
+    }
+    return QxOK;
+}
+
+tQxMutex* QxOS_CreateMutex(const char* name)
+{
+    tRtxMutex *m = (tRtxMutex *)calloc(1, sizeof(tRtxMutex));
+    if (m == NULL) {
+        return NULL;
+    }
+
+    osMutexAttr_t attr = { 0 };
+    attr.name = name;
+    attr.attr_bits = osMutexPrioInherit | osMutexRecursive | osMutexRobust;
+    attr.cb_mem = &m->cb;
+    attr.cb_size = sizeof(m->cb);
+    m->id = osMutexNew(&attr);
+    if (m->id == NULL) {
+        free(m);
+        return NULL;
+    }
+    m->mutex.name = (char *)name;
+    m->mutex.isLocked = FALSE;
+    m->stats.name = name;
+
+    core_util_critical_section_enter();
+    m->next = rtx_mutexes;
+    rtx_mutexes = m;
+    core_util_critical_section_exit();
+    return &m->mutex;
+}
+
+tQxStatus QxOS_LockMutex(tQxMutex* mutex)
+{
+    if (mutex == NULL) {
+        return QxErr;
+    }
+    return rtx_lock((tRtxMutex *)mutex, osWaitForever);
+}
+
+tQxStatus QxOS_LockMutex_Wait(tQxMutex* mutex, uint32_t millisec)
+{
+    if (mutex == NULL) {
+        return QxErr;
+    }
+    return rtx_lock((tRtxMutex *)mutex, (millisec == QX_WAIT_FOREVER) ? osWaitForever : millisec);
+}
+
+tQxStatus QxOS_UnLockMutex(tQxMutex* mutex)
+{
+    if (mutex == NULL) {
+        return QxErr;
+    }
+    tRtxMutex *m = (tRtxMutex *)mutex;
+    if (osMutexGetOwner(m->id) != osThreadGetId()) {
+        return QxErr;
+    }
+
+    if (--m->depth == 0) {
+        uint32_t held = QxOS_CyclesToUs(QxOS_GetCycles() - m->locked_at);
+        m->stats.max_hold_us = (held > m->stats.max_hold_us) ? held : m->stats.max_hold_us;
+        m->mutex.isLocked = FALSE;
+    }
+    return (osMutexRelease(m->id) == osOK) ? QxOK : QxErr;
+}
+
+tQxStatus QxOS_GetMutexStats(tQxMutex* mutex, tQxMutexStats* stats)
+{
+    if (mutex == NULL || stats == NULL) {
+        return QxErr;
+    }
+    *stats = ((tRtxMutex *)mutex)->stats;
+    return QxOK;
+}
+
+int QxOS_ListMutexStats(tQxMutexStats* stats, int max)
+{
+    int n = 0;
+    for (tRtxMutex *m = rtx_mutexes; m != NULL && n < max; m = m->next) {
+        stats[n++] = m->stats;
+    }
+    return n;
+}
@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    QxOS_Semaphore_Nano33BLE.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   QxOS counting semaphores on the RTX kernel of mbed.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxOS.h"
+
+#include <mbed.h>
+#include "mbed_rtos_storage.h"
+
+/*
+    mbed builds RTX without a dynamic object pool, so the control block is
+    allocated with the handle, like the threads and mutexes of the library.
+    Release only sets the count and wakes the waiter, so it is safe in
+    interrupt handlers.
+ */
+typedef struct {
+    tQxSemaphore sem;
+    osSemaphoreId_t id;
+    mbed_rtos_storage_semaphore_t cb;
+} tRtxSemaphore;
+
+tQxSemaphore* QxOS_CreateSemaphore(const char* name, uint32_t max_count, uint32_t initial_count)
+{
+    tRtxSemaphore *s = (tRtxSemaphore *)calloc(1, sizeof(tRtxSemaphore));
+    if (s == NULL) {
+        return NULL;
+    }
+
+    osSemaphoreAttr_t attr = { 0 };
+    attr.name = name;
+    attr.cb_mem = &s->cb;
+    attr.cb_size = sizeof(s->cb);
+    s->id = osSemaphoreNew(max_count, initial_count, &attr);
+    if (s->id == NULL) {
+        free(s);
+        return NULL;
+    }
+    s->sem.name = (char *)name;
+    return &s->sem;
+}
+
+tQxStatus QxOS_WaitSemaphore(tQxSemaphore* sem, uint32_t millisec)
+{
+    if (sem == NULL) {
+        return QxErr;
+    }
+    uint32_t ticks = (millisec == QX_WAIT_FOREVER) ? osWaitForever : millisec;
+    return (osSemaphoreAcquire(((tRtxSemaphore *)sem)->id, ticks) == osOK) ? QxOK : QxBusy;
+}
+
+tQxStatus QxOS_ReleaseSemaphore(tQxSemaphore* sem)
+{
+    if (sem == NULL) {
+        return QxErr;
+    }
+    return (osSemaphoreRelease(((tRtxSemaphore *)sem)->id) == osOK) ? QxOK : QxBusy;
+}
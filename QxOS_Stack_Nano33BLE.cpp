@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file    QxOS_Stack_Nano33BLE.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Static threads and stack and heap statistics on mbed RTX.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxStack.h"
+
+#include <mbed.h>
+#include <malloc.h>
+#include "rtx_os.h"
+
+#define STACK_PAINT_MARGIN  64  //bytes kept below the stack pointer of the caller
+#define STACK_THREADS_MAX   16
+
+static_assert(sizeof(((tQxStaticThread *)0)->cb) >= sizeof(osRtxThread_t),
+              "tQxStaticThread.cb is smaller than the RTX thread control block");
+
+static void static_thread_main(void *argument)
+{
+    tQxStaticThread *t = (tQxStaticThread *)argument;
+    t->func(t->userdata);
+}
+
+/* tQxPriority is centered on osPriorityNormal of CMSIS-RTOS v1, RTOS2 spaces the levels by 8 */
+static osPriority_t static_thread_priority(tQxPriority prio)
+{
+    if (prio == QxPriorityIdle) {
+        return osPriorityIdle;
+    }
+    if (prio < QxPriorityIdle || prio > QxPriorityRealtime) {
+        return osPriorityNormal;
+    }
+    return (osPriority_t)(osPriorityNormal + 8 * (int)prio);
+}
+
+tQxThread* QxOS_CreateStaticThread(tQxStaticThread *t, tQxThreadFunc func, tQxPriority prio, void *userdata)
+{
+    t->thread.pData = userdata;
+    t->func = func;
+    t->userdata = userdata;
+    memset(t->cb, 0, sizeof(t->cb));
+    QxOS_PaintStack(t->stack, t->stack_size);
+
+    osThreadAttr_t attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.name = t->thread.name;
+    attr.cb_mem = t->cb;
+    attr.cb_size = sizeof(t->cb);
+    attr.stack_mem = t->stack;
+    attr.stack_size = t->stack_size;
+    attr.priority = static_thread_priority(prio);
+
+    t->handle = osThreadNew(static_thread_main, t, &attr);
+    return (t->handle != NULL) ? &t->thread : NULL;
+}
+
+void QxOS_PaintCurrentStack(void)
+{
+    osRtxThread_t *self = (osRtxThread_t *)osThreadGetId();
+    if (self == NULL || self->stack_mem == NULL) {
+        return;
+    }
+
+    /* word 0 is the RTX overflow magic, everything up to the live frames is unused */
+    uint32_t *word = (uint32_t *)self->stack_mem + 1;
+    uint32_t *limit = (uint32_t *)(__get_PSP() - STACK_PAINT_MARGIN);
+    while (word < limit) {
+        *word++ = QX_STACK_PAINT;
+    }
+}
+
+int QxOS_GetStackStats(tQxStackStats *stats, int max)
+{
+    osThreadId_t ids[STACK_THREADS_MAX];
+    int n = (int)osThreadEnumerate(ids, STACK_THREADS_MAX);
+    n = (n < max) ? n : max;
+
+    for (int i = 0; i < n; i++) {
+        osRtxThread_t *t = (osRtxThread_t *)ids[i];
+        const uint32_t *words = (const uint32_t *)t->stack_mem;
+
+        stats[i].name = (t->name != NULL) ? t->name : "?";
+        stats[i].size = t->stack_size;
+        /* the words above the magic keep the paint unless the stack overflowed */
+        stats[i].painted = words != NULL && t->stack_size > 16 &&
+                           words[1] == QX_STACK_PAINT && words[2] == QX_STACK_PAINT;
+        stats[i].used = stats[i].painted ? QxOS_StackUsed(words, t->stack_size) : 0;
+    }
+    return n;
+}
+
+tQxStatus QxOS_GetHeapStats(tQxHeapStats *stats)
+{
+    struct mallinfo info = mallinfo();
+    stats->arena = (uint32_t)info.arena;
+    stats->in_use = (uint32_t)info.uordblks;
+    stats->free = (uint32_t)info.fordblks;
+    return QxOK;
+}
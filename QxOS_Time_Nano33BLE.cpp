@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    QxOS_Time_Nano33BLE.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Microsecond and cycle time stamps of the Nano 33 BLE.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxOS.h"
+
+#include <mbed.h>
+#include "hal/us_ticker_api.h"
+
+/*
+    The microsecond time comes from the mbed us ticker, TIMER1 of the nRF52840
+    at 1 MHz. Its 32 bit count is extended to 64 bit by the ticker layer,
+    which keeps an interrupt scheduled inside every counter period, so the
+    value stays correct when nobody reads it for a long time.
+
+    Cycles come from the DWT cycle counter of the Cortex-M4, which runs at the
+    core clock and costs a single load to read.
+ */
+uint64_t QxOS_GetTimeUs(void)
+{
+    return ticker_read_us(get_us_ticker_data());
+}
+
+uint32_t QxOS_GetCycles(void)
+{
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+uint32_t QxOS_GetCycleHz(void)
+{
+    return SystemCoreClock;
+}
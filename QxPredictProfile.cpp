@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file    QxPredictProfile.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Cycle counting wrapper of the engine predict().
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxPredictProfile.h"
+#include "QxOS.h"
+
+#if defined(QX_PROFILE_PREDICT) || defined(QX_GOLDEN_DUMP)
+
+#include <mbed.h>
+
+static tQxPredictProfile predict_profile;
+
+#ifdef QX_GOLDEN_DUMP
+#ifndef QX_GOLDEN_FEATURES
+#error "QX_GOLDEN_DUMP needs QX_GOLDEN_FEATURES, the number of features predict() reads"
+#endif
+static float golden_features[QX_GOLDEN_FEATURES];
+static uint32_t golden_count;
+#endif
+
+/* The original predict(), resolved by the linker because of -Wl,--wrap=predict */
+extern "C" void __real_predict(const float *features, float *probs);
+
+extern "C" void __wrap_predict(const float *features, float *probs)
+{
+    uint32_t start = QxOS_GetCycles();
+    __real_predict(features, probs);
+    /* unsigned subtraction is correct across one counter wrap */
+    uint32_t cycles = QxOS_GetCycles() - start;
+
+    tQxPredictProfile *p = &predict_profile;
+    p->min = (p->count == 0 || cycles < p->min) ? cycles : p->min;
+    p->max = (cycles > p->max) ? cycles : p->max;
+    p->last = cycles;
+    p->total += cycles;
+    p->count++;
+
+#ifdef QX_GOLDEN_DUMP
+    /* after the timing, the copy is not part of the predict() cycles */
+    memcpy(golden_features, features, sizeof(golden_features));
+    golden_count = QX_GOLDEN_FEATURES;
+#endif
+}
+
+#endif
+
+#ifdef QX_PROFILE_PREDICT
+
+tQxStatus QxPredictProfile_Get(tQxPredictProfile *profile)
+{
+    /* predict() runs in the classify thread, copy with interrupts off for a consistent view */
+    core_util_critical_section_enter();
+    *profile = predict_profile;
+    core_util_critical_section_exit();
+    return QxOK;
+}
+
+tQxStatus QxPredictProfile_Reset(void)
+{
+    core_util_critical_section_enter();
+    memset(&predict_profile, 0, sizeof(predict_profile));
+    core_util_critical_section_exit();
+    return QxOK;
+}
+
+#else
+
+tQxStatus QxPredictProfile_Get(tQxPredictProfile *profile)
+{
+    memset(profile, 0, sizeof(*profile));
+    return QxNotReady;
+}
+
+tQxStatus QxPredictProfile_Reset(void)
+{
+    return QxNotReady;
+}
+
+#endif
+
+#ifdef QX_GOLDEN_DUMP
+
+tQxStatus QxPredictProfile_GetFeatures(const float **features, uint32_t *count)
+{
+    *features = golden_features;
+    *count = golden_count;
+    return (golden_count > 0) ? QxOK : QxNotReady;
+}
+
+#else
+
+tQxStatus QxPredictProfile_GetFeatures(const float **features, uint32_t *count)
+{
+    *features = NULL;
+    *count = 0;
+    return QxNotReady;
+}
+
+#endif
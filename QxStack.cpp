@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    QxStack.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Stack painting, watermarks and the memory report.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxStack.h"
+
+#define STACK_REPORT_MAX    16
+
+void QxOS_PaintStack(void *stack, uint32_t size)
+{
+    uint32_t *words = (uint32_t *)stack;
+    for (uint32_t i = 0; i < size / 4; i++) {
+        words[i] = QX_STACK_PAINT;
+    }
+}
+
+uint32_t QxOS_StackUsed(const void *stack, uint32_t size)
+{
+    /* stacks grow down; word 0 may hold the RTOS overflow magic instead of paint */
+    const uint32_t *words = (const uint32_t *)stack;
+    uint32_t i = 1;
+    while (i < size / 4 && words[i] == QX_STACK_PAINT) {
+        i++;
+    }
+    return size - i * 4;
+}
+
+void QxOS_MemoryReport(void)
+{
+    tQxStackStats stacks[STACK_REPORT_MAX];
+    int n = QxOS_GetStackStats(stacks, STACK_REPORT_MAX);
+
+    for (int i = 0; i < n; i++) {
+        if (stacks[i].painted) {
+            QxOS_DebugPrint("stack %-20s %5lu of %5lu bytes", stacks[i].name,
+                            (unsigned long)stacks[i].used, (unsigned long)stacks[i].size);
+        } else {
+            QxOS_DebugPrint("stack %-20s     ? of %5lu bytes, not painted", stacks[i].name,
+                            (unsigned long)stacks[i].size);
+        }
+    }
+
+    tQxHeapStats heap;
+    if (QxOS_GetHeapStats(&heap) == QxOK) {
+        QxOS_DebugPrint("heap  %lu bytes in use, %lu free, grown to %lu", (unsigned long)heap.in_use,
+                        (unsigned long)heap.free, (unsigned long)heap.arena);
+    }
+}
@@ -0,0 +1,176 @@
+/**
+  ******************************************************************************
+  * @file    QxStreamAsync.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Asynchronous stream output: per device byte queue and drain thread.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxStreamAsync.h"
+#include "QxRing.h"
+
+#define ASYNC_WRITE_TIMEOUT 100 //ms
+#define ASYNC_STACK_SIZE    1024
+
+typedef struct {
+    QxByteRing ring;
+    tQxStreamDevice device;
+    uint8_t *chunk;
+    uint32_t chunk_size;
+    uint32_t period;
+    std::atomic<uint32_t> done;     /*!< ring position written to the transport */
+    std::atomic<uint32_t> queued;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> written;
+    std::atomic<uint32_t> lost;
+    std::atomic<uint32_t> writes;
+} tStreamAsync;
+
+static std::atomic<tStreamAsync *> async_streams[QxStreamDeviceMax];
+
+static tStreamAsync *async_get(tQxStreamDevice device_type)
+{
+    if (device_type <= QxStreamDeviceNone || device_type >= QxStreamDeviceMax) {
+        return NULL;
+    }
+    return async_streams[device_type].load(std::memory_order_acquire);
+}
+
+static void async_drain_loop(const void *userdata)
+{
+    tStreamAsync *s = (tStreamAsync *)userdata;
+
+    while (1) {
+        /* everything queued so far, up to one transport-sized write */
+        uint32_t n = s->ring.Read(s->chunk, s->chunk_size);
+        if (n == 0) {
+            QxOS_Delay(s->period);
+            continue;
+        }
+
+        uint32_t sent = 0;
+        while (sent < n) {
+            int ret = QxOS_StreamDataOut(s->device, s->chunk + sent, (uint16_t)(n - sent), ASYNC_WRITE_TIMEOUT);
+            if (ret <= 0) {
+                s->lost.fetch_add(n - sent, std::memory_order_relaxed);
+                break;
+            }
+            sent += (uint32_t)ret;
+        }
+        s->written.fetch_add(sent, std::memory_order_relaxed);
+        s->writes.fetch_add(1, std::memory_order_relaxed);
+        s->done.store(s->ring.Tail(), std::memory_order_release);
+    }
+}
+
+tQxStatus QxOS_StreamAsyncStart(tQxStreamDevice device_type, uint32_t buffer_size, uint32_t chunk_size,
+                                uint32_t period, tQxPriority prio)
+{
+    if (device_type <= QxStreamDeviceNone || device_type >= QxStreamDeviceMax ||
+        buffer_size < 8 || (buffer_size & (buffer_size - 1)) != 0 || chunk_size == 0 || chunk_size > 0xFFFF) {
+        return QxErr;
+    }
+    if (async_get(device_type) != NULL) {
+        return QxBusy;
+    }
+
+    tStreamAsync *s = (tStreamAsync *)calloc(1, sizeof(tStreamAsync));
+    uint32_t *words = (uint32_t *)calloc(buffer_size / 4, sizeof(uint32_t));
+    uint8_t *chunk = (uint8_t *)malloc(chunk_size);
+    if (s == NULL || words == NULL || chunk == NULL) {
+        free(s);
+        free(words);
+        free(chunk);
+        return QxErr;
+    }
+
+    s->ring.Init(words, buffer_size);
+    s->device = device_type;
+    s->chunk = chunk;
+    s->chunk_size = chunk_size;
+    s->period = (period == 0) ? 1 : period;
+
+    tStreamAsync *expected = NULL;
+    if (!async_streams[device_type].compare_exchange_strong(expected, s, std::memory_order_acq_rel)) {
+        free(s);
+        free(words);
+        free(chunk);
+        return QxBusy;
+    }
+
+    if (QxOS_CreateThread("stream_async", async_drain_loop, prio, ASYNC_STACK_SIZE, s) == NULL) {
+        /* keep the queue, writes are accepted but only counted until a thread drains it */
+        return QxErr;
+    }
+    return QxOK;
+}
+
+int QxOS_StreamDataOutAsync(tQxStreamDevice device_type, const void *data, uint16_t data_len)
+{
+    tStreamAsync *s = async_get(device_type);
+    if (s == NULL) {
+        return 0;
+    }
+
+    if (!s->ring.Write(data, data_len)) {
+        s->dropped.fetch_add(data_len, std::memory_order_relaxed);
+        return 0;
+    }
+    s->queued.fetch_add(data_len, std::memory_order_relaxed);
+    return data_len;
+}
+
+tQxStatus QxOS_FlushDataOutAsync(tQxStreamDevice device_type, uint32_t timeout)
+{
+    tStreamAsync *s = async_get(device_type);
+    if (s == NULL) {
+        return QxNotReady;
+    }
+
+    uint32_t target = s->ring.Head();
+    uint32_t start = QxOS_GetTick();
+    while ((int32_t)(s->done.load(std::memory_order_acquire) - target) < 0) {
+        uint32_t waited = QxOS_GetTick() - start;
+        if (waited >= timeout) {
+            return QxBusy;
+        }
+        QxOS_Delay(1);
+    }
+
+    uint32_t waited = QxOS_GetTick() - start;
+    QxOS_FlushDataOut(device_type, (waited < timeout) ? timeout - waited : 0);
+    return QxOK;
+}
+
+tQxStatus QxOS_StreamAsyncGetStats(tQxStreamDevice device_type, tQxStreamAsyncStats *stats)
+{
+    tStreamAsync *s = async_get(device_type);
+    if (s == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return QxNotReady;
+    }
+
+    stats->queued = s->queued.load(std::memory_order_relaxed);
+    stats->dropped = s->dropped.load(std::memory_order_relaxed);
+    stats->written = s->written.load(std::memory_order_relaxed);
+    stats->lost = s->lost.load(std::memory_order_relaxed);
+    stats->writes = s->writes.load(std::memory_order_relaxed);
+    return QxOK;
+}
@@ -32,6 +32,10 @@ fi
 
 MBED_PATH="$COMPILE_PATH/mbed-os"
 
+# tools/qxmodel.py reads the class count and base score from predict() of the library,
+# QX_NUM_CLASSES and QX_BASE_SCORE are needed when it cannot
+QX_MODEL_ARGS="${QX_NUM_CLASSES:+--num-classes $QX_NUM_CLASSES} ${QX_BASE_SCORE:+--base-score $QX_BASE_SCORE}"
+
 if [ "$COMMAND" = "--build" ] || [ "$COMMAND" = "-b" ] || [ "$COMMAND" = "--build-with-battery" ] || [ "$COMMAND" = "-bb" ];
 then
 	echo "Building $PROJECT"
@@ -49,13 +53,136 @@ fi
     then
         STATIC_LIB_PATH={compiler.demo_root}/libs/libQxClassifyEngine.a
     fi
+
+    # QX_MODEL_LAYOUT=flat|compiled|nn replaces predict.o of the engine with a generated model
+    MODEL_LAYOUT=${QX_MODEL_LAYOUT:-engine}
+    if [ "$MODEL_LAYOUT" != "engine" ]
+    then
+        SOURCE_LIB=$2
+        if [ "$SOURCE_LIB" = "" ]
+        then
+            SOURCE_LIB=libs/libQxClassifyEngine.a
+        fi
+        mkdir -p output
+        if [ "$MODEL_LAYOUT" = "nn" ]
+        then
+            # QX_NN_MODEL is the JSON network description read by tools/qxnn.py
+            ${PYTHON:-python3} tools/qxnn.py $QX_NN_MODEL --emit qx_model_generated.cpp --replace-predict || exit 1
+        else
+            ${PYTHON:-python3} tools/qxmodel.py $SOURCE_LIB $QX_MODEL_ARGS --emit-$MODEL_LAYOUT qx_model_generated.cpp --replace-predict || exit 1
+        fi
+        cp $SOURCE_LIB output/libQxClassifyEngine-$MODEL_LAYOUT.a
+        ${AR:-arm-none-eabi-ar} d output/libQxClassifyEngine-$MODEL_LAYOUT.a predict.o || exit 1
+        STATIC_LIB_PATH=$COMPILE_PATH/output/libQxClassifyEngine-$MODEL_LAYOUT.a
+    fi
+
+    # QX_PROFILE_PREDICT=1 counts the cycles of every predict() call, see QxPredictProfile.cpp
+    PROFILE_FLAGS=""
+    PROFILE_LDFLAGS=""
+    if [ "$QX_PROFILE_PREDICT" = "1" ]
+    then
+        PROFILE_FLAGS="-DQX_PROFILE_PREDICT"
+        PROFILE_LDFLAGS="-Wl,--wrap=predict"
+    fi
+    # QX_GOLDEN_DUMP=1 prints golden records for tools/qxgolden.py capture, with the features
+    # handed to predict() by the QxPredictProfile.cpp wrapper
+    if [ "$QX_GOLDEN_DUMP" = "1" ]
+    then
+        if [ "$QX_GOLDEN_FEATURES" = "" ]
+        then
+            QX_GOLDEN_FEATURES=$(${PYTHON:-python3} tools/qxmodel.py ${2:-libs/libQxClassifyEngine.a} $QX_MODEL_ARGS --print-num-features) || exit 1
+        fi
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_GOLDEN_DUMP -DQX_GOLDEN_FEATURES=$QX_GOLDEN_FEATURES"
+        PROFILE_LDFLAGS="-Wl,--wrap=predict"
+    fi
+    # QX_LOG_DEFERRED=1 sends QX_DEBUG_PRINT() records unformatted, see inc/QxLog.h
+    if [ "$QX_LOG_DEFERRED" = "1" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_LOG_DEFERRED"
+    fi
+    # QX_BT_BINARY_ONLY=1 stops the "1"/"2" text results that old apps read, the binary result stays, see tools/qxresult.py
+    if [ "$QX_BT_BINARY_ONLY" = "1" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_BT_BINARY_ONLY"
+    fi
+    # QX_BT_BROADCAST=1 adds the latest result to the advertising data, see tQxBTBroadcast
+    if [ "$QX_BT_BROADCAST" = "1" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_BT_BROADCAST"
+    fi
+    # QX_BT_PERIODIC_INTERVAL=<1.25 ms> also sends the broadcast as periodic advertising on BLE 5 controllers
+    if [ -n "$QX_BT_PERIODIC_INTERVAL" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_BT_PERIODIC_INTERVAL=$QX_BT_PERIODIC_INTERVAL"
+    fi
+    # QX_USB_FRAMED=1 multiplexes log, results, statistics and data collection as COBS frames on USB, see inc/QxFrame.h
+    if [ "$QX_USB_FRAMED" = "1" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_USB_FRAMED"
+    fi
+    # QX_DC_CODEC=1 sends data collection samples as delta varints, see inc/QxCodec.h
+    if [ "$QX_DC_CODEC" = "1" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_DC_CODEC"
+    fi
+    # QX_BT_MAX_MTU=<bytes> and QX_BT_DATA_LENGTH=<octets> set the link negotiated on connect, see tQxBTConnProfile
+    if [ -n "$QX_BT_MAX_MTU" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_BT_MAX_MTU=$QX_BT_MAX_MTU"
+    fi
+    if [ -n "$QX_BT_DATA_LENGTH" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_BT_DATA_LENGTH=$QX_BT_DATA_LENGTH"
+    fi
+    # QX_BT_TX_QUEUE=<n> notifications queued for the BLE thread, see tQxBTTxStats
+    if [ -n "$QX_BT_TX_QUEUE" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_BT_TX_QUEUE=$QX_BT_TX_QUEUE"
+    fi
+    # QX_EXECUTOR=1 runs the sensor reads and classification as timers of one executor, see inc/QxExecutor.h
+    if [ "$QX_EXECUTOR" = "1" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_EXECUTOR"
+    fi
+    # QX_MEMORY_REPORT=<ms> prints the stack watermarks and the heap in use, see inc/QxStack.h
+    if [ -n "$QX_MEMORY_REPORT" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_MEMORY_REPORT=$QX_MEMORY_REPORT"
+    fi
+    # QX_CPU_STATS=<ms> prints the CPU share of every thread, the wrapped handlers count switches, see inc/QxCpuStats.h
+    if [ -n "$QX_CPU_STATS" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_CPU_STATS=$QX_CPU_STATS"
+        PROFILE_LDFLAGS="$PROFILE_LDFLAGS -Wl,--wrap=SVC_Handler -Wl,--wrap=PendSV_Handler -Wl,--wrap=SysTick_Handler"
+    fi
+    if [ -n "$QX_CPU_REPORT_DEVICE" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_CPU_REPORT_DEVICE=$QX_CPU_REPORT_DEVICE"
+    fi
+    if [ -n "$QX_SENSOR_READ_STACK" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_SENSOR_READ_STACK=$QX_SENSOR_READ_STACK"
+    fi
+    if [ -n "$QX_COMMAND_STACK" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_COMMAND_STACK=$QX_COMMAND_STACK"
+    fi
+    if [ -n "$QX_BT_RX_STACK" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DQX_BT_RX_STACK=$QX_BT_RX_STACK"
+    fi
+    if [ -n "$BLE_LOOP_STACK_SIZE" ]
+    then
+        PROFILE_FLAGS="$PROFILE_FLAGS -DBLE_LOOP_STACK_SIZE=$BLE_LOOP_STACK_SIZE"
+    fi
 	$WINPTY arduino-cli compile --fqbn  $BOARD --verbose --libraries ./libs $COMPILE_PATH --build-path $COMPILE_PATH/output  \
     --build-properties "compiler.demo_root=$COMPILE_PATH"\
     --build-properties "compiler.mbed='$STATIC_LIB_PATH' '{compiler.demo_root}/libs/libQxSensorHal.a' '{compiler.demo_root}/libs/mbed-core-ARDUINO_NANO33BLE.a' '{compiler.demo_root}/libs/libarm_cortexM4lf_math.a'"\
     --build-properties 'compiler.mbed.cflags={compiler.demo_root}/variants/cflags.txt'\
     --build-properties 'compiler.mbed.cxxflags={compiler.demo_root}/variants/cxxflags.txt'\
     --build-properties 'compiler.mbed.ldflags={compiler.demo_root}/variants/ldflags.txt'\
-    --build-properties 'compiler.mbed.extra_ldflags=-lstdc++ -lsupc++ -lm -lc -lgcc -lnosys -mfloat-abi=hard'\
+    --build-properties "compiler.mbed.extra_ldflags=-lstdc++ -lsupc++ -lm -lc -lgcc -lnosys -mfloat-abi=hard $PROFILE_LDFLAGS"\
+    --build-properties "compiler.cpp.extra_flags=$PROFILE_FLAGS"\
     --build-properties "recipe.c.o.pattern='{compiler.path}{compiler.c.cmd}' {compiler.c.flags} -DARDUINO={runtime.ide.version} -DARDUINO_{build.board} -DARDUINO_ARCH_{build.arch}  {build.extra_flags} {compiler.c.extra_flags} '-I{build.core.path}/api/deprecated' {includes} '-iprefix{build.core.path}' '@{compiler.mbed.includes}' '-I$COMPILE_PATH/inc' -o '{object_file}' '{source_file}'"\
     --build-properties "recipe.cpp.o.pattern='{compiler.path}{compiler.cpp.cmd}' {compiler.cpp.flags} -DARDUINO={runtime.ide.version} -DARDUINO_{build.board} -DARDUINO_ARCH_{build.arch} {includes} {build.extra_flags} {compiler.cpp.extra_flags} '-I{build.core.path}/api/deprecated' '-iprefix{build.core.path}' '@{compiler.mbed.includes}' '-I$COMPILE_PATH/inc' '{source_file}' -o '{object_file}' "\
     --build-properties 'build.float-abi=hard'
@@ -74,6 +201,7 @@ fi
 		exit "Building $PROJECT failed"
 	fi
       rm automl-arduino-nano-33ble-sense.ino
+      rm -f qx_model_generated.cpp
 elif [ "$COMMAND" = "--flash" ] || [ "$COMMAND" = "-f" ];
 then
     INPUT_FILE=$2
@@ -98,7 +226,18 @@ then
 if [ $SYSTEM = "Darwin" ] ; then
     cat $(arduino-cli board list | grep Arduino | cut -d ' ' -f1)
 else
-    $WINPTY python -u tools/debuglog.py -p $(arduino-cli board list | grep Arduino | cut -d ' ' -f1)
+    LOG_ELF=""
+    if [ "$QX_LOG_DEFERRED" = "1" ]
+    then
+        LOG_ELF="--elf $COMPILE_PATH/output/automl-arduino-nano-33ble-sense.ino.elf"
+    fi
+    if [ "$QX_USB_FRAMED" = "1" ]
+    then
+        # records the frames to qxcapture-<date>-<time>.qxcap and prints them with the throughput
+        $WINPTY python -u tools/qxcapture.py --decode $LOG_ELF -p $(arduino-cli board list | grep Arduino | cut -d ' ' -f1)
+    else
+        $WINPTY python -u tools/debuglog.py $LOG_ELF -p $(arduino-cli board list | grep Arduino | cut -d ' ' -f1)
+    fi
 fi
 elif [ "$COMMAND" = "--mbedcore" ] || [ "$COMMAND" = "-m" ];
 then
@@ -119,9 +258,105 @@ fi
     tr  ' ' '\n' < $BUILD_PATH/.link_options.txt | grep '\.o' \
      | grep -v '/main\.o' | xargs arm-none-eabi-ar rcs \
      ./libs/mbed-core-ARDUINO_NANO33BLE.a
+elif [ "$COMMAND" = "--bench" ] || [ "$COMMAND" = "-t" ];
+then
+    # Host benchmarks, built with the native compiler instead of arduino-cli
+    HOST_CXX=${HOST_CXX:-c++}
+    HOST_CXXFLAGS=${HOST_CXXFLAGS:-"-O3 -march=native"}
+    HOST_OUT=output/host
+    mkdir -p $HOST_OUT
+
+    mkdir -p $HOST_OUT/gen
+    ${PYTHON:-python3} tools/qxmodel.py ${2:-libs/libQxClassifyEngine.a} $QX_MODEL_ARGS \
+        --emit-reference $HOST_OUT/gen/model_reference.h --emit-flat $HOST_OUT/gen/model_flat.cpp \
+        --emit-compiled $HOST_OUT/gen/model_compiled.cpp || exit 1
+    ${PYTHON:-python3} tools/qxnn.py $HOST_OUT/gen/model_nn.json --example 881:2 \
+        --emit $HOST_OUT/gen/model_nn.cpp --emit-reference $HOST_OUT/gen/model_nn_reference.h || exit 1
+
+    $HOST_CXX $HOST_CXXFLAGS -Iinc host/bench/fastmath_bench.cpp QxFastMath.cpp -o $HOST_OUT/fastmath_bench || exit 1
+    $HOST_CXX $HOST_CXXFLAGS -Iinc host/bench/codec_bench.cpp QxCodec.cpp -o $HOST_OUT/codec_bench || exit 1
+    $HOST_CXX $HOST_CXXFLAGS -Iinc -c $HOST_OUT/gen/model_compiled.cpp -o $HOST_OUT/model_compiled.o || exit 1
+    $HOST_CXX $HOST_CXXFLAGS -Iinc -I$HOST_OUT/gen host/bench/tree_bench.cpp $HOST_OUT/gen/model_flat.cpp \
+        $HOST_OUT/model_compiled.o QxFlatTree.cpp QxFastMath.cpp -o $HOST_OUT/tree_bench || exit 1
+    $HOST_CXX $HOST_CXXFLAGS -Iinc -I$HOST_OUT/gen host/bench/nn_bench.cpp $HOST_OUT/gen/model_nn.cpp \
+        QxNNInt8.cpp QxFastMath.cpp -o $HOST_OUT/nn_bench || exit 1
+    $HOST_CXX $HOST_CXXFLAGS -Ihost/ble -Ilibs/ArduinoBLE/src/utility host/ble/coc_test.cpp \
+        libs/ArduinoBLE/src/utility/L2CAPCoC.cpp -o $HOST_OUT/coc_test || exit 1
+    $HOST_OUT/fastmath_bench
+    $HOST_OUT/tree_bench
+    size $HOST_OUT/model_compiled.o 2>/dev/null
+    $HOST_OUT/nn_bench || exit 1
+    $HOST_OUT/codec_bench
+    $HOST_OUT/coc_test || exit 1
+elif [ "$COMMAND" = "--golden" ] || [ "$COMMAND" = "-g" ];
+then
+    # Golden vector regression and per-stage timing on the host, see host/harness/qxgolden.cpp
+    HOST_CXX=${HOST_CXX:-c++}
+    HOST_CXXFLAGS=${HOST_CXXFLAGS:-"-O3 -march=native"}
+    HOST_OUT=output/host
+    mkdir -p $HOST_OUT/gen
+
+    GOLDEN=${2:-$HOST_OUT/golden.jsonl}
+    SOURCE_LIB=${3:-libs/libQxClassifyEngine.a}
+    if [ ! -f "$GOLDEN" ]
+    then
+        # records synthesized by tools/qxmodel.py would check the generated predict() against itself
+        echo "$GOLDEN not found: capture golden records of the original predict() from a QX_GOLDEN_DUMP=1 device"
+        echo "with tools/qxgolden.py capture, or record them with a QX_HOST_ENGINE_LIBS build (qxgolden --record)"
+        exit 1
+    fi
+
+    if [ "$QX_HOST_ENGINE_LIBS" != "" ]
+    then
+        # a host build of the engine library and its CMSIS-DSP dependency
+        $HOST_CXX $HOST_CXXFLAGS -DQX_HARNESS_ENGINE -Iinc host/harness/qxgolden.cpp host/posix/QxOS_Posix.cpp \
+            -Wl,--wrap=predict $QX_HOST_ENGINE_LIBS -lm -lpthread -o $HOST_OUT/qxgolden || exit 1
+    else
+        # the ARM engine library cannot run here, check a generated predict() instead
+        HARNESS_LAYOUT=${QX_MODEL_LAYOUT:-compiled}
+        ${PYTHON:-python3} tools/qxmodel.py $SOURCE_LIB $QX_MODEL_ARGS --emit-$HARNESS_LAYOUT $HOST_OUT/gen/harness_model.cpp \
+            --replace-predict || exit 1
+        $HOST_CXX $HOST_CXXFLAGS -Iinc host/harness/qxgolden.cpp $HOST_OUT/gen/harness_model.cpp \
+            QxFlatTree.cpp QxFastMath.cpp -Wl,--wrap=predict -o $HOST_OUT/qxgolden || exit 1
+    fi
+
+    GOLDEN_STATUS=0
+    $HOST_OUT/qxgolden $QX_GOLDEN_ARGS $GOLDEN > $HOST_OUT/golden_result.jsonl || GOLDEN_STATUS=1
+    ${PYTHON:-python3} tools/qxgolden.py gate $HOST_OUT/golden_result.jsonl \
+        ${QX_GOLDEN_BASELINE:+--baseline $QX_GOLDEN_BASELINE} || exit 1
+    exit $GOLDEN_STATUS
+elif [ "$COMMAND" = "--posix" ] || [ "$COMMAND" = "-p" ];
+then
+    # QxOS on Linux, see host/posix/QxOS_Posix.h
+    HOST_CXX=${HOST_CXX:-c++}
+    HOST_CXXFLAGS=${HOST_CXXFLAGS:-"-O2 -g"}
+    HOST_OUT=output/host
+    mkdir -p $HOST_OUT
+
+    # QXOS_VIRTUAL_TIME=1 runs the threads on a deterministic virtual clock, see host/posix/QxOS_VirtualTime.cpp
+    VT_FLAGS=""
+    if [ "$QXOS_VIRTUAL_TIME" = "1" ]
+    then
+        VT_FLAGS="-DQXOS_VIRTUAL_TIME"
+    fi
+    if [ "$QX_LOG_DEFERRED" = "1" ]
+    then
+        VT_FLAGS="$VT_FLAGS -DQX_LOG_DEFERRED"
+    fi
+    if [ "$QX_EXECUTOR" = "1" ]
+    then
+        VT_FLAGS="$VT_FLAGS -DQX_EXECUTOR"
+    fi
+    if [ "$QX_USB_FRAMED" = "1" ]
+    then
+        VT_FLAGS="$VT_FLAGS -DQX_USB_FRAMED"
+    fi
+    $HOST_CXX $HOST_CXXFLAGS $VT_FLAGS -Iinc -Ihost/posix host/posix/qxos_posix_demo.cpp host/posix/QxOS_Posix.cpp \
+        host/posix/QxOS_VirtualTime.cpp QxLog.cpp QxFrame.cpp QxStreamAsync.cpp QxStack.cpp QxExecutor.cpp QxCpuStats.cpp QxCommand.cpp -lm -lpthread -o $HOST_OUT/qxos_posix_demo || exit 1
+    $HOST_OUT/qxos_posix_demo ${2:-2}
 elif [ "$COMMAND" = "--help" ] || [ "$COMMAND" = "-h" ] || [ "$COMMAND" = "" ];
 then
-	echo 'useage: automl-build.sh [-h] [-b <STATIC_LIB_PATH>] [-f] [-m] [-d]
+	echo 'useage: automl-build.sh [-h] [-b <STATIC_LIB_PATH>] [-f] [-m] [-d] [-t] [-g [<GOLDEN>] [<STATIC_LIB_PATH>]] [-p]
      for example:
          automl-build.sh -b   //build arduino sketch demo using default static library filepath
          automl-build.sh -b  ~/nano-xgb-1.0-static.a  //build arduino sketch demo using gived static library filepath
@@ -134,5 +369,38 @@ then
                            connected to USB and has been in bootloader mode. (by double clicking button)
      -d, --debuglog       Print devices debug log from USB
      -m, --mbedcore       Build mBed OS library for Arduino Nano 33BLE
+     -t, --bench          Build and run host benchmarks with the native compiler (HOST_CXX, HOST_CXXFLAGS)
+        <STATIC_LIB_PATH>  the static library whose model is benchmarked, the default filepath is: ./libs/libQxClassifyEngine.a
+     -g, --golden         Check predictions against golden vectors and time each stage on the host
+        <GOLDEN>           golden records of the original predict(), from the device or a host engine build, default: output/host/golden.jsonl
+        <STATIC_LIB_PATH>  the static library whose model is checked, the default filepath is: ./libs/libQxClassifyEngine.a
+     -p, --posix          Build and run the QxOS POSIX backend demo on Linux (HOST_CXX, HOST_CXXFLAGS)
+        <SECONDS>          how long to run, default: 2
+     environment:
+        QX_MODEL_LAYOUT=flat   replace predict() of the static library with the flattened tree layout (needs arm-none-eabi-ar, or AR)
+        QX_MODEL_LAYOUT=compiled  replace predict() of the static library with the trees generated as if/else code
+        QX_MODEL_LAYOUT=nn QX_NN_MODEL=<JSON>  replace predict() of the static library with an int8 network, see tools/qxnn.py
+        QX_NUM_CLASSES=<N> QX_BASE_SCORE=<F>  class count and initial margin of the trees, for libraries whose predict() tools/qxmodel.py cannot read
+        QX_HOST_ENGINE_LIBS=<LIBS>  -g links a host build of the engine library (and CMSIS-DSP) instead of a generated predict()
+        QX_GOLDEN_BASELINE=<RESULT>  -g fails when a stage is more than 10% slower than in this earlier golden_result.jsonl
+        QX_GOLDEN_ARGS=<ARGS>  extra harness arguments, e.g. "--loops 1000 --prob-tol 1e-5"
+        QX_GOLDEN_DUMP=1       print "GOLDEN {...}" records of every classification, for tools/qxgolden.py capture (QX_GOLDEN_FEATURES=<N> features, default from the library)
+        QXOS_STREAM_USB=<SPEC>  -p binds the USB stream device, e.g. file:out.bin, fd:1,0, tcp:host:port or unix:path (also _BT, _SD, _WIFI)
+        QXOS_VIRTUAL_TIME=1    -p runs on a virtual clock: sleeps take no time and runs are reproducible (QXOS_VT_CHARGE=<factor> adds scaled CPU time)
+        QX_PROFILE_PREDICT=1   print the cycles of every predict() call with the classification result
+        QX_LOG_DEFERRED=1      send debug prints as binary records, formatted on the host by -d (tools/debuglog.py --elf), see inc/QxLog.h
+        QX_BT_BINARY_ONLY=1    only send the binary result characteristic (tools/qxresult.py), not the "1"/"2" text results of old apps
+        QX_BT_BROADCAST=1      advertise the latest class and confidence to scanners, decoded by tools/qxresult.py --broadcast
+        QX_BT_PERIODIC_INTERVAL=<N>  with QX_BT_BROADCAST=1, periodic advertising of the full result every N * 1.25 ms (BLE 5)
+        QX_USB_FRAMED=1        send log, results, statistics and data collection as COBS frames on USB, recorded by -d (tools/qxcapture.py), also for -p
+        QX_DC_CODEC=1          send BLE data collection samples as delta varints, decoded by tools/qxcodec.py dc
+        QX_BT_MAX_MTU=<BYTES>, QX_BT_DATA_LENGTH=<OCTETS>  ATT MTU and LL payload negotiated on connect, default 247 and 251 (23 and 27 turn it off)
+        QX_BT_TX_QUEUE=<N>     notifications of results and text queued for the BLE thread, a power of two, default 8
+        QX_EXECUTOR=1          run the sensor reads and classification (and the deferred log) as timers of one executor on the loop thread, also for -p
+        QX_MEMORY_REPORT=<MS>  print the stack high watermarks and the heap in use every MS milliseconds, see inc/QxStack.h
+        QX_CPU_STATS=<MS>      print the CPU share and context switches of every thread every MS milliseconds, over the last 8 reports
+        QX_CPU_REPORT_DEVICE=QxStreamDeviceBT  send the QX_CPU_STATS report as one line to a stream device instead
+        QX_SENSOR_READ_STACK=<BYTES>, BLE_LOOP_STACK_SIZE=<BYTES>  stack sizes of the sensor and BLE threads, trimmed with QX_MEMORY_REPORT
+        QX_COMMAND_STACK=<BYTES>, QX_BT_RX_STACK=<BYTES>  stack sizes of the command handler and BLE receive threads
      '
 fi
@@ -0,0 +1,232 @@
+/**
+  ******************************************************************************
+  * @file    codec_bench.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Compression ratio and encode cost of the sample codecs.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+/*
+    Built and run by "./automl-build.sh --bench".
+    Encodes synthetic 952 Hz accelerometer/gyroscope streams (at rest and
+    moving) in blocks of one data collection packet and a 16 kHz PCM stream
+    in blocks of 256 samples. Reports bytes per sample, the ratio against
+    raw int16, encode time and, on x86, TSC cycles per sample. Every block
+    is decoded again and compared; ADPCM reports its SNR instead.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#endif
+
+#include "QxCodec.h"
+
+#define IMU_RATE        952.0
+#define IMU_CHANNELS    6
+#define IMU_SAMPLES     (952 * 20)
+#define IMU_BLOCK       20      /* samples of a data collection packet at an MTU of 247 */
+#define PCM_RATE        16000.0
+#define PCM_SAMPLES     (16000 * 4)
+#define PCM_BLOCK       256
+#define BENCH_LOOPS     50
+
+static double now_ns()
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t now_cycles()
+{
+#ifdef BENCH_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static double noise(double amplitude)
+{
+    return amplitude * ((double)rand() / RAND_MAX * 2.0 - 1.0);
+}
+
+static int16_t clamp16(double v)
+{
+    return (int16_t)((v > 32767.0) ? 32767.0 : ((v < -32768.0) ? -32768.0 : v));
+}
+
+/* 16 g and 2000 dps full scale as in QxAutoMLInf::sensorInit(): 1 g is 2048 LSB, 1 dps 16.4 LSB */
+static std::vector<int16_t> imu_stream(bool moving)
+{
+    std::vector<int16_t> s(IMU_SAMPLES * IMU_CHANNELS);
+
+    for (int i = 0; i < IMU_SAMPLES; i++) {
+        double t = i / IMU_RATE;
+        double m = moving ? 1.0 : 0.0;
+        int16_t *x = &s[i * IMU_CHANNELS];
+        x[0] = clamp16(m * 1500.0 * sin(2 * M_PI * 2.1 * t) + noise(4));
+        x[1] = clamp16(m * 900.0 * sin(2 * M_PI * 3.3 * t + 1.0) + noise(4));
+        x[2] = clamp16(2048.0 + m * 700.0 * sin(2 * M_PI * 1.7 * t) + noise(4));
+        x[3] = clamp16(m * 3000.0 * sin(2 * M_PI * 1.3 * t) + noise(3));
+        x[4] = clamp16(m * 1800.0 * sin(2 * M_PI * 2.9 * t + 0.5) + noise(3));
+        x[5] = clamp16(m * 1200.0 * sin(2 * M_PI * 0.8 * t) + noise(3));
+    }
+    return s;
+}
+
+static std::vector<int16_t> pcm_stream()
+{
+    std::vector<int16_t> s(PCM_SAMPLES);
+
+    for (int i = 0; i < PCM_SAMPLES; i++) {
+        double t = i / PCM_RATE;
+        s[i] = clamp16(6000.0 * sin(2 * M_PI * 440.0 * t) + 2500.0 * sin(2 * M_PI * 1250.0 * t) + noise(300));
+    }
+    return s;
+}
+
+static void report(const char *name, uint32_t samples, uint32_t channels, uint64_t bytes,
+                   double ns, uint64_t cycles, const char *check)
+{
+    double per = (double)samples * channels * BENCH_LOOPS;
+    printf("codec %-22s %6.2f bytes/sample ratio %5.2f  %6.2f ns/sample", name,
+           (double)bytes / ((double)samples * channels), 2.0 * samples * channels / bytes, ns / per);
+#ifdef BENCH_HAS_TSC
+    printf("  %6.2f cycles/sample", cycles / per);
+#else
+    (void)cycles;
+#endif
+    printf("  %s\n", check);
+}
+
+static void bench_varint(const char *name, const std::vector<int16_t> &s)
+{
+    uint32_t samples = (uint32_t)(s.size() / IMU_CHANNELS);
+    std::vector<uint8_t> out(QX_CODEC_VARINT_MAX(samples, IMU_CHANNELS));
+    std::vector<int16_t> back(s.size());
+    uint64_t bytes = 0;
+
+    double t0 = now_ns();
+    uint64_t c0 = now_cycles();
+    for (int l = 0; l < BENCH_LOOPS; l++) {
+        tQxDeltaState state;
+        bytes = 0;
+        for (uint32_t i = 0; i < samples; i += IMU_BLOCK) {
+            /* every packet on its own, as lost packets must not break the next */
+            QxCodec_DeltaReset(&state);
+            bytes += QxCodec_DeltaVarintEncode(&state, &s[i * IMU_CHANNELS], IMU_BLOCK, IMU_CHANNELS, &out[bytes]);
+        }
+    }
+    uint64_t c1 = now_cycles();
+    double t1 = now_ns();
+
+    tQxDeltaState state;
+    uint32_t at = 0;
+    for (uint32_t i = 0; i < samples; i += IMU_BLOCK) {
+        QxCodec_DeltaReset(&state);
+        at += QxCodec_DeltaVarintDecode(&state, &out[at], (uint32_t)(bytes - at), &back[i * IMU_CHANNELS],
+                                        IMU_BLOCK, IMU_CHANNELS);
+    }
+    report(name, samples, IMU_CHANNELS, bytes, t1 - t0, c1 - c0,
+           (at == bytes && back == s) ? "lossless" : "MISMATCH");
+}
+
+static void bench_pack(const char *name, const std::vector<int16_t> &s)
+{
+    uint32_t samples = (uint32_t)(s.size() / IMU_CHANNELS);
+    std::vector<uint8_t> out(QX_CODEC_PACK_MAX(samples, IMU_CHANNELS));
+    std::vector<int16_t> back(s.size());
+    uint64_t bytes = 0;
+
+    double t0 = now_ns();
+    uint64_t c0 = now_cycles();
+    for (int l = 0; l < BENCH_LOOPS; l++) {
+        bytes = 0;
+        for (uint32_t i = 0; i < samples; i += IMU_BLOCK) {
+            bytes += QxCodec_DeltaPackEncode(&s[i * IMU_CHANNELS], IMU_BLOCK, IMU_CHANNELS, &out[bytes]);
+        }
+    }
+    uint64_t c1 = now_cycles();
+    double t1 = now_ns();
+
+    uint32_t at = 0;
+    bool ok = true;
+    for (uint32_t i = 0; i < samples; i += IMU_BLOCK) {
+        uint32_t n = QxCodec_DeltaPackDecode(&out[at], (uint32_t)(bytes - at), &back[i * IMU_CHANNELS],
+                                             IMU_BLOCK, IMU_CHANNELS);
+        ok = ok && n > 0;
+        at += n;
+    }
+    report(name, samples, IMU_CHANNELS, bytes, t1 - t0, c1 - c0,
+           (ok && at == bytes && back == s) ? "lossless" : "MISMATCH");
+}
+
+static void bench_adpcm(const std::vector<int16_t> &s)
+{
+    uint32_t samples = (uint32_t)s.size();
+    std::vector<uint8_t> out(QX_CODEC_ADPCM_MAX(PCM_BLOCK) * (samples / PCM_BLOCK));
+    std::vector<int16_t> back(s.size());
+    uint64_t bytes = 0;
+
+    double t0 = now_ns();
+    uint64_t c0 = now_cycles();
+    for (int l = 0; l < BENCH_LOOPS; l++) {
+        tQxAdpcmState state = {0, 0};
+        bytes = 0;
+        for (uint32_t i = 0; i < samples; i += PCM_BLOCK) {
+            bytes += QxCodec_AdpcmEncode(&state, &s[i], PCM_BLOCK, &out[bytes]);
+        }
+    }
+    uint64_t c1 = now_cycles();
+    double t1 = now_ns();
+
+    uint32_t at = 0;
+    for (uint32_t i = 0; i < samples; i += PCM_BLOCK) {
+        at += QxCodec_AdpcmDecode(&out[at], (uint32_t)(bytes - at), &back[i], PCM_BLOCK);
+    }
+    double sig = 0.0, err = 0.0;
+    for (uint32_t i = 0; i < samples; i++) {
+        sig += (double)s[i] * s[i];
+        err += ((double)s[i] - back[i]) * ((double)s[i] - back[i]);
+    }
+    char check[32];
+    snprintf(check, sizeof(check), (at == bytes) ? "snr %.1f dB" : "MISMATCH", 10.0 * log10(sig / (err + 1e-9)));
+    report("adpcm pcm", samples, 1, bytes, t1 - t0, c1 - c0, check);
+}
+
+int main(void)
+{
+    srand(1);
+    std::vector<int16_t> rest = imu_stream(false);
+    std::vector<int16_t> moving = imu_stream(true);
+    std::vector<int16_t> pcm = pcm_stream();
+
+    bench_varint("delta varint imu rest", rest);
+    bench_varint("delta varint imu move", moving);
+    bench_pack("delta pack imu rest", rest);
+    bench_pack("delta pack imu move", moving);
+    bench_adpcm(pcm);
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+  ******************************************************************************
+  * @file    fastmath_bench.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Host accuracy and speed report of the batch fast math functions.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+/*
+    Built and run by "./automl-build.sh --bench".
+    Reports the maximum ULP error of fm_exp2f_batch()/fm_log2f_batch() against
+    correctly rounded libm results, and nanoseconds per element of the batch
+    functions against a per-element libm loop.
+ */
+
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "QxFastMath.h"
+
+#define BENCH_LEN   4096
+#define BENCH_LOOPS 2000
+#define SWEEP_CHUNK 4096
+
+static int32_t ordered(float f)
+{
+    int32_t i;
+    memcpy(&i, &f, sizeof(i));
+    return (i < 0) ? (int32_t)(0x80000000u - (uint32_t)i) : i;
+}
+
+static uint32_t ulp_distance(float a, float b)
+{
+    int64_t d = (int64_t)ordered(a) - (int64_t)ordered(b);
+    return (uint32_t)(d < 0 ? -d : d);
+}
+
+typedef void (*batch_fn)(const float *in, float *out, uint32_t n);
+typedef double (*ref_fn)(double x);
+
+/*
+    Walk the bit patterns from lo to hi with the given stride, evaluate in
+    chunks through the batch function and compare with the double reference.
+ */
+static void ulp_sweep(const char *name, batch_fn fn, ref_fn ref, float lo, float hi, uint32_t stride)
+{
+    std::vector<float> in(SWEEP_CHUNK), out(SWEEP_CHUNK);
+    uint32_t max_ulp = 0;
+    float worst = lo;
+    uint64_t count = 0;
+    double sum_ulp = 0.0;
+
+    int32_t b = ordered(lo);
+    int32_t end = ordered(hi);
+
+    while (b <= end) {
+        uint32_t n = 0;
+        for (; n < SWEEP_CHUNK && b <= end; n++, b += stride) {
+            int32_t i = (b < 0) ? (int32_t)(0x80000000u - (uint32_t)b) : b;
+            memcpy(&in[n], &i, sizeof(float));
+        }
+
+        fn(in.data(), out.data(), n);
+
+        for (uint32_t k = 0; k < n; k++) {
+            float expect = (float)ref((double)in[k]);
+            uint32_t u = ulp_distance(out[k], expect);
+            sum_ulp += u;
+            if (u > max_ulp) {
+                max_ulp = u;
+                worst = in[k];
+            }
+        }
+        count += n;
+    }
+
+    printf("ulp   %-16s range [%g, %g] samples %llu max %u mean %.3f worst_x %.9g\n",
+           name, lo, hi, (unsigned long long)count, max_ulp, sum_ulp / count, worst);
+}
+
+static double now_ns()
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void libm_exp2(const float *in, float *out, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = exp2f(in[i]);
+    }
+}
+
+static void libm_log2(const float *in, float *out, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = log2f(in[i]);
+    }
+}
+
+static void libm_softmax(const float *in, float *out, uint32_t n)
+{
+    float max = in[0], sum = 0.0f;
+    for (uint32_t i = 1; i < n; i++) {
+        max = fmaxf(max, in[i]);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = expf(in[i] - max);
+        sum += out[i];
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] /= sum;
+    }
+}
+
+static volatile float sink;
+
+static void time_fn(const char *name, batch_fn fn, const std::vector<float> &in)
+{
+    std::vector<float> out(in.size());
+
+    fn(in.data(), out.data(), (uint32_t)in.size());
+
+    double t0 = now_ns();
+    for (int l = 0; l < BENCH_LOOPS; l++) {
+        fn(in.data(), out.data(), (uint32_t)in.size());
+        sink = out[l % in.size()];
+    }
+    double t1 = now_ns();
+
+    printf("time  %-16s %.3f ns/elem\n", name, (t1 - t0) / ((double)BENCH_LOOPS * in.size()));
+}
+
+int main(void)
+{
+    ulp_sweep("fm_exp2f_batch", fm_exp2f_batch, exp2, -126.0f, 127.0f, 61);
+    ulp_sweep("fm_log2f_batch", fm_log2f_batch, log2, 1.17549435e-38f, 3.4028235e38f, 61);
+
+    std::vector<float> ein(BENCH_LEN), lin(BENCH_LEN), sin_(64);
+    for (uint32_t i = 0; i < BENCH_LEN; i++) {
+        ein[i] = -20.0f + 40.0f * (float)i / BENCH_LEN;
+        lin[i] = 1e-6f + 1e3f * (float)i / BENCH_LEN;
+    }
+    for (uint32_t i = 0; i < sin_.size(); i++) {
+        sin_[i] = sinf((float)i) * 8.0f;
+    }
+
+    time_fn("libm exp2f", libm_exp2, ein);
+    time_fn("fm_exp2f_batch", fm_exp2f_batch, ein);
+    time_fn("libm log2f", libm_log2, lin);
+    time_fn("fm_log2f_batch", fm_log2f_batch, lin);
+    time_fn("libm softmax64", libm_softmax, sin_);
+    time_fn("fm_softmax64", fm_softmax_batch, sin_);
+
+    /* softmax and entropy are compositions, report their absolute error */
+    std::vector<float> a(sin_.size()), b(sin_.size());
+    libm_softmax(sin_.data(), a.data(), (uint32_t)a.size());
+    fm_softmax_batch(sin_.data(), b.data(), (uint32_t)b.size());
+    double max_err = 0.0, h_ref = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        max_err = fmax(max_err, fabs((double)a[i] - b[i]));
+        h_ref -= (a[i] > 0.0f) ? a[i] * log2((double)a[i]) : 0.0;
+    }
+    printf("abs   %-16s max %.3g\n", "fm_softmax_batch", max_err);
+    printf("abs   %-16s max %.3g\n", "fm_entropy_batch",
+           fabs(h_ref - fm_entropy_batch(a.data(), (uint32_t)a.size())));
+
+    return 0;
+}
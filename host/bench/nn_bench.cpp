@@ -0,0 +1,190 @@
+/**
+  ******************************************************************************
+  * @file    nn_bench.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Host latency, footprint and accuracy of the int8 network path.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+/*
+    Built and run by "./automl-build.sh --bench", which writes a random
+    example network with tools/qxnn.py into output/host/gen and quantizes
+    it. The reference predictor below runs the same network in float.
+ */
+
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "QxNNInt8.h"
+#include "model_nn_reference.h"
+
+#define BENCH_SAMPLES 64
+#define BENCH_LOOPS   50
+
+extern "C" const tQxNNModel qx_nn_model;
+
+static void reference_predict(const float *features, float *probs)
+{
+    static float buf[2][1 << 16];
+    const float *in = features;
+    float *out = buf[0];
+
+    for (int l = 0; l < NN_REF_NUM_LAYERS; l++) {
+        const struct ref_layer *layer = &ref_layers[l];
+        int window = layer->kernel * layer->in_channels;
+
+        for (int p = 0; p < layer->out_length; p++) {
+            const float *x = in + p * layer->stride * layer->in_channels;
+            for (int c = 0; c < layer->out_channels; c++) {
+                const float *w = layer->weights + c * window;
+                float acc = layer->bias[c];
+                for (int i = 0; i < window; i++) {
+                    acc += x[i] * w[i];
+                }
+                out[p * layer->out_channels + c] = (layer->relu && acc < 0.0f) ? 0.0f : acc;
+            }
+        }
+        in = out;
+        out = (out == buf[0]) ? buf[1] : buf[0];
+    }
+
+    float max = in[0], sum = 0.0f;
+    for (int c = 0; c < NN_REF_NUM_OUTPUTS; c++) {
+        probs[c] = in[c];
+        max = fmaxf(max, in[c]);
+    }
+    if (NN_REF_SOFTMAX) {
+        for (int c = 0; c < NN_REF_NUM_OUTPUTS; c++) {
+            probs[c] = expf(probs[c] - max);
+            sum += probs[c];
+        }
+        for (int c = 0; c < NN_REF_NUM_OUTPUTS; c++) {
+            probs[c] /= sum;
+        }
+    }
+}
+
+static void int8_predict(const float *features, float *probs)
+{
+    QxNNInt8_Predict(&qx_nn_model, features, probs);
+}
+
+typedef void (*predict_fn)(const float *features, float *probs);
+
+static double time_ns(predict_fn fn, const std::vector<float> &samples)
+{
+    float probs[NN_REF_NUM_OUTPUTS];
+    volatile float sink = 0.0f;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int l = 0; l < BENCH_LOOPS; l++) {
+        for (size_t s = 0; s < BENCH_SAMPLES; s++) {
+            fn(&samples[s * NN_REF_NUM_INPUTS], probs);
+            sink = sink + probs[0];
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() /
+           ((double)BENCH_LOOPS * BENCH_SAMPLES);
+}
+
+static int argmax(const float *p)
+{
+    int best = 0;
+    for (int c = 1; c < NN_REF_NUM_OUTPUTS; c++) {
+        best = (p[c] > p[best]) ? c : best;
+    }
+    return best;
+}
+
+/*
+    Accumulators whose requantized value does not fit an int32: the
+    result saturates to the int8 range instead of wrapping around.
+ */
+static int saturation_mismatch(void)
+{
+    static const int8_t in[1] = { 127 };
+    static const int8_t weights[3] = { 127, -127, 1 };
+    static const int32_t bias[3] = { INT32_MAX - 127 * 127, INT32_MIN + 1 + 127 * 127, 0 };
+    static const int32_t multiplier[3] = { INT32_MAX, INT32_MAX, 1 << 30 };
+    static const int8_t shift[3] = { 30, 30, 0 };
+    static const int8_t expect[3] = { 127, -128, 64 + 5 };
+
+    tQxNNLayer layer = {};
+    layer.type = QX_NN_DENSE;
+    layer.out_zero_point = 5;
+    layer.in_channels = 1;
+    layer.out_channels = 3;
+    layer.in_length = layer.out_length = layer.kernel = layer.stride = 1;
+    layer.weights = weights;
+    layer.bias = bias;
+    layer.multiplier = multiplier;
+    layer.shift = shift;
+
+    int8_t out[3];
+    QxNNInt8_Layer(&layer, in, out);
+    int mismatch = 0;
+    for (int c = 0; c < 3; c++) {
+        mismatch += out[c] != expect[c];
+    }
+    return mismatch;
+}
+
+int main(void)
+{
+    std::vector<float> samples((size_t)BENCH_SAMPLES * NN_REF_NUM_INPUTS);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < samples.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        float u = (float)(seed >> 8) / (float)(1u << 24);
+        samples[i] = NN_REF_INPUT_MIN + u * (NN_REF_INPUT_MAX - NN_REF_INPUT_MIN);
+    }
+
+    float a[NN_REF_NUM_OUTPUTS], b[NN_REF_NUM_OUTPUTS];
+    double max_err = 0.0;
+    int mismatch = 0;
+    for (size_t s = 0; s < BENCH_SAMPLES; s++) {
+        reference_predict(&samples[s * NN_REF_NUM_INPUTS], a);
+        int8_predict(&samples[s * NN_REF_NUM_INPUTS], b);
+        for (int c = 0; c < NN_REF_NUM_OUTPUTS; c++) {
+            max_err = fmax(max_err, fabs((double)a[c] - b[c]));
+        }
+        mismatch += argmax(a) != argmax(b);
+    }
+
+    size_t float_bytes = 0, int8_bytes = 0;
+    for (int l = 0; l < NN_REF_NUM_LAYERS; l++) {
+        const tQxNNLayer *q = &qx_nn_model.layers[l];
+        size_t weights = (size_t)q->out_channels * q->kernel * q->in_channels;
+        float_bytes += (weights + q->out_channels) * sizeof(float);
+        int8_bytes += weights + q->out_channels * (2 * sizeof(int32_t) + sizeof(int8_t));
+    }
+
+    printf("nn    float      %8.1f ns/pred  %6zu bytes\n", time_ns(reference_predict, samples), float_bytes);
+    printf("nn    int8       %8.1f ns/pred  %6zu bytes  max_abs_err %.3g  argmax_mismatch %d/%d\n",
+           time_ns(int8_predict, samples), int8_bytes, max_err, mismatch, BENCH_SAMPLES);
+
+    int saturated = saturation_mismatch();
+    printf("nn    saturate   %s\n", saturated ? "FAILED" : "ok");
+
+    return saturated ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+/**
+  ******************************************************************************
+  * @file    tree_bench.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Host latency and footprint comparison of tree ensemble layouts.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+/*
+    Built and run by "./automl-build.sh --bench", which first extracts the
+    model of the engine library with tools/qxmodel.py into output/host/gen,
+    as the original arrays, the flat layout and straight-line compiled code.
+    The reference predictor below walks the original predict.o arrays the
+    same way the engine does.
+ */
+
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "QxFlatTree.h"
+#include "model_reference.h"
+
+#define BENCH_SAMPLES 256
+#define BENCH_LOOPS   2000
+
+extern "C" const tQxFlatForest qx_flat_model;
+extern "C" void qx_compiled_predict(const float *features, float *probs);
+
+static void reference_predict(const float *features, float *probs)
+{
+    float margin[QX_REF_NUM_CLASSES];
+    uint32_t node_base = 0, leaf_base = 0;
+
+    for (int c = 0; c < QX_REF_NUM_CLASSES; c++) {
+        margin[c] = QX_REF_BASE_SCORE;
+    }
+
+    for (uint32_t t = 0; t < QX_REF_NUM_TREES; t++) {
+        if (ref_ileft[node_base] == 0 && ref_iright[node_base] == 0) {
+            margin[t % QX_REF_NUM_CLASSES] += ref_leaves[leaf_base];
+            node_base += 1;
+            leaf_base += 1;
+            continue;
+        }
+
+        int32_t i = node_base, next;
+        for (;;) {
+            next = (features[ref_ifeat[i]] < ref_thresh[i]) ? ref_ileft[i] : ref_iright[i];
+            if (next <= 0) {
+                break;
+            }
+            i = node_base + next;
+        }
+        margin[t % QX_REF_NUM_CLASSES] += ref_leaves[leaf_base - next];
+        node_base += ref_tree_lens[t];
+        leaf_base += ref_tree_lens[t] + 1;
+    }
+
+    float max = margin[0], sum = 0.0f;
+    for (int c = 1; c < QX_REF_NUM_CLASSES; c++) {
+        max = fmaxf(max, margin[c]);
+    }
+    for (int c = 0; c < QX_REF_NUM_CLASSES; c++) {
+        probs[c] = expf(margin[c] - max);
+        sum += probs[c];
+    }
+    for (int c = 0; c < QX_REF_NUM_CLASSES; c++) {
+        probs[c] /= sum;
+    }
+}
+
+static void flat_predict(const float *features, float *probs)
+{
+    QxFlatTree_Predict(&qx_flat_model, features, probs);
+}
+
+typedef void (*predict_fn)(const float *features, float *probs);
+
+/* Random feature vectors spread around the thresholds the model tests */
+static std::vector<float> make_samples(void)
+{
+    std::vector<float> lo(QX_REF_NUM_FEATURES, 0.0f), hi(QX_REF_NUM_FEATURES, 0.0f);
+    std::vector<bool> seen(QX_REF_NUM_FEATURES, false);
+
+    for (size_t i = 0; i < sizeof(ref_ifeat) / sizeof(ref_ifeat[0]); i++) {
+        uint16_t f = ref_ifeat[i];
+        float t = ref_thresh[i];
+        lo[f] = seen[f] ? fminf(lo[f], t) : t;
+        hi[f] = seen[f] ? fmaxf(hi[f], t) : t;
+        seen[f] = true;
+    }
+
+    std::vector<float> samples((size_t)BENCH_SAMPLES * QX_REF_NUM_FEATURES);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < samples.size(); i++) {
+        size_t f = i % QX_REF_NUM_FEATURES;
+        seed = seed * 1664525u + 1013904223u;
+        float u = (float)(seed >> 8) / (float)(1u << 24);
+        float span = hi[f] - lo[f];
+        float pad = 0.25f * span + 1e-3f * (fabsf(lo[f]) + 1.0f);
+        samples[i] = lo[f] - pad + u * (span + 2.0f * pad);
+    }
+    return samples;
+}
+
+static double time_ns(predict_fn fn, const std::vector<float> &samples)
+{
+    float probs[QX_REF_NUM_CLASSES];
+    volatile float sink = 0.0f;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int l = 0; l < BENCH_LOOPS; l++) {
+        for (size_t s = 0; s < BENCH_SAMPLES; s++) {
+            fn(&samples[s * QX_REF_NUM_FEATURES], probs);
+            sink = sink + probs[0];
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() /
+           ((double)BENCH_LOOPS * BENCH_SAMPLES);
+}
+
+static int argmax(const float *p)
+{
+    int best = 0;
+    for (int c = 1; c < QX_REF_NUM_CLASSES; c++) {
+        best = (p[c] > p[best]) ? c : best;
+    }
+    return best;
+}
+
+/* Compare a layout with the reference and print one report line */
+static void report(const char *name, predict_fn fn, size_t bytes, const std::vector<float> &samples)
+{
+    float a[QX_REF_NUM_CLASSES], b[QX_REF_NUM_CLASSES];
+    double max_err = 0.0;
+    int mismatch = 0;
+
+    for (size_t s = 0; s < BENCH_SAMPLES; s++) {
+        reference_predict(&samples[s * QX_REF_NUM_FEATURES], a);
+        fn(&samples[s * QX_REF_NUM_FEATURES], b);
+        for (int c = 0; c < QX_REF_NUM_CLASSES; c++) {
+            max_err = fmax(max_err, fabs((double)a[c] - b[c]));
+        }
+        mismatch += argmax(a) != argmax(b);
+    }
+
+    /* the compiled layout has no tables, its footprint is the text size of model_compiled.o */
+    char footprint[24];
+    if (bytes > 0) {
+        snprintf(footprint, sizeof(footprint), "%6zu bytes", bytes);
+    } else {
+        snprintf(footprint, sizeof(footprint), "%12s", "code only");
+    }
+
+    printf("tree  %-10s %8.1f ns/pred  %s  max_abs_err %.3g  argmax_mismatch %d/%d\n",
+           name, time_ns(fn, samples), footprint, max_err, mismatch, BENCH_SAMPLES);
+}
+
+int main(void)
+{
+    std::vector<float> samples = make_samples();
+
+    size_t ref_bytes = sizeof(ref_ifeat) + sizeof(ref_thresh) + sizeof(ref_ileft) +
+                       sizeof(ref_iright) + sizeof(ref_leaves) + sizeof(ref_tree_lens);
+
+    const tQxFlatForest *m = &qx_flat_model;
+    size_t flat_bytes = m->num_slots * sizeof(uint16_t) +
+                        (m->num_slots + 1) * sizeof(uint16_t) +
+                        m->edge_start[m->num_slots] * sizeof(float) +
+                        m->num_trees * sizeof(uint16_t) +
+                        m->num_classes * (sizeof(uint16_t) + sizeof(float)) +
+                        m->num_nodes * sizeof(tQxFlatNode);
+
+    report("reference", reference_predict, ref_bytes, samples);
+    report("flat", flat_predict, flat_bytes, samples);
+    report("compiled", qx_compiled_predict, 0, samples);
+
+    return 0;
+}
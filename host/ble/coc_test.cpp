@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+  * @file    coc_test.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    19-Oct-2020
+  * @brief   Host check of the L2CAP CoC connection request handling.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+/*
+    Built and run by "./automl-build.sh --bench". L2CAPCoC.cpp is linked
+    against the HCIClass members below instead of HCI.cpp; sendAclPkt()
+    keeps the last signaling packet, which is checked field by field.
+ */
+
+#include <stdio.h>
+
+#include "HCI.h"
+#include "L2CAPSignaling.h"
+#include "L2CAPCoC.h"
+
+#define COC_PSM                0x0080
+#define COC_HANDLE             0x0001
+#define COC_CONN_REQUEST       0x14
+#define COC_CONN_RESPONSE      0x15
+
+struct __attribute__ ((packed)) tCocResponse {
+    uint8_t code;
+    uint8_t identifier;
+    uint16_t length;
+    uint16_t dcid;
+    uint16_t mtu;
+    uint16_t mps;
+    uint16_t credits;
+    uint16_t result;
+};
+
+static tCocResponse last_response;
+static int responses;
+
+HCIClass::HCIClass()
+{
+}
+
+HCIClass::~HCIClass()
+{
+}
+
+int HCIClass::sendAclPkt(uint16_t /*handle*/, uint16_t cid, uint8_t plen, void* data)
+{
+    if (cid == SIGNALING_CID && plen == sizeof(last_response)) {
+        memcpy(&last_response, data, plen);
+        responses++;
+    }
+    return 0;
+}
+
+int HCIClass::availableAclPkts() const
+{
+    return 0;
+}
+
+uint16_t HCIClass::aclPktLen() const
+{
+    return 251;
+}
+
+HCIClass HCI;
+
+/*
+    Sends one connection request and compares the response, a refusal
+    must carry zeros in all fields but the result.
+ */
+static int request_mismatch(const char *name, uint16_t scid, uint16_t mtu, uint16_t mps, uint16_t result)
+{
+    struct __attribute__ ((packed)) {
+        uint16_t psm;
+        uint16_t scid;
+        uint16_t mtu;
+        uint16_t mps;
+        uint16_t credits;
+    } request = { COC_PSM, scid, mtu, mps, 4 };
+
+    bool accept = (result == 0x0000);
+    tCocResponse expect = { COC_CONN_RESPONSE, 0x21, 10,
+                            (uint16_t)(accept ? 0x0040 : 0),
+                            (uint16_t)(accept ? L2CAP_COC_MTU : 0),
+                            (uint16_t)(accept ? L2CAP_COC_MPS : 0),
+                            (uint16_t)(accept ? L2CAP_COC_CREDITS : 0), result };
+
+    int sent = responses;
+    L2CAPCoC.connectionRequest(COC_HANDLE, 0x21, sizeof(request), (uint8_t*)&request);
+
+    bool ok = (responses == sent + 1) && memcmp(&last_response, &expect, sizeof(expect)) == 0;
+    printf("coc   %-16s result 0x%04x  %s\n", name, last_response.result, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(void)
+{
+    int mismatch = 0;
+
+    L2CAPCoC.listen(COC_PSM);
+    mismatch += request_mismatch("scid 0x0020", 0x0020, 256, 64, 0x0009);
+    mismatch += request_mismatch("scid 0x0080", 0x0080, 256, 64, 0x0009);
+    mismatch += request_mismatch("mtu 22", 0x0041, 22, 64, 0x000B);
+    mismatch += request_mismatch("mps 22", 0x0041, 256, 22, 0x000B);
+    mismatch += request_mismatch("accepted", 0x0041, 256, 64, 0x0000);
+    mismatch += request_mismatch("second channel", 0x0042, 256, 64, 0x0004);
+
+    return mismatch ? 1 : 0;
+}
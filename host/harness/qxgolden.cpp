@@ -0,0 +1,396 @@
+/**
+  ******************************************************************************
+  * @file    qxgolden.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Golden vector regression and per-stage timing harness for the engine.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+/*
+    Built by "./automl-build.sh --golden", in one of two modes chosen at link time:
+
+    engine   QX_HARNESS_ENGINE is defined and a host build of
+             libQxClassifyEngine.a is linked. The recorded accel/gyro window
+             of every record is copied into the PredictionFrame and goes
+             through QXO_MLEngine_Work(), so featurize, predict and the glue
+             are all checked. QxOS comes from host/posix/QxOS_Posix.cpp.
+    predict  A generated predict() (tools/qxmodel.py --replace-predict) is
+             linked instead. The recorded feature vectors go through predict().
+             Records without features are skipped.
+
+    The golden records come from the original predict() of the library: the
+    QX_GOLDEN_DUMP records of the device, or --record of an engine build.
+    A record whose probs do not match the class count of the model fails,
+    and a run that compares no record at all fails too.
+
+    Both modes link with -Wl,--wrap=predict. __wrap_predict() keeps a copy of
+    the feature vector the engine hands to predict() and times the call, so the
+    featurize stage is the Work() time minus the predict() time.
+
+    Records and results are JSON lines, see tools/qxgolden.py.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "QxClassifyEngine.h"
+
+extern "C" void predict(const float *features, float *probs);
+extern "C" void __real_predict(const float *features, float *probs);
+extern "C" void QXO_MLEngine_GetSensitivity(float *pSensitivity, int *pNumOfClasses);
+#ifndef QX_HARNESS_ENGINE
+extern "C" const int qx_predict_num_classes;
+#endif
+
+static std::vector<float> wrap_features;
+static uint32_t wrap_num_features;
+static double wrap_ns;
+
+static double now_ns(void)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+extern "C" void __wrap_predict(const float *features, float *probs)
+{
+    double t0 = now_ns();
+    __real_predict(features, probs);
+    wrap_ns = now_ns() - t0;
+    wrap_features.assign(features, features + wrap_num_features);
+}
+
+/* Values of "key": [n, n, ...] in a JSON line, false when the key is missing */
+static bool json_array(const std::string &line, const char *key, std::vector<double> &out)
+{
+    std::string pattern = std::string("\"") + key + "\"";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = line.find('[', pos + pattern.size());
+    if (pos == std::string::npos) {
+        return false;
+    }
+
+    out.clear();
+    const char *p = line.c_str() + pos + 1;
+    for (;;) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        if (*p == ']' || *p == '\0') {
+            break;
+        }
+        char *end;
+        double v = strtod(p, &end);
+        if (end == p) {
+            /* non finite values are written as null */
+            v = NAN;
+            end = (char *)p + strcspn(p, ",]");
+        }
+        out.push_back(v);
+        p = end;
+    }
+    return true;
+}
+
+static bool json_int(const std::string &line, const char *key, int *out)
+{
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    *out = atoi(line.c_str() + pos + pattern.size());
+    return true;
+}
+
+static void json_write_array(FILE *f, const char *key, const float *v, size_t n)
+{
+    fprintf(f, "\"%s\": [", key);
+    for (size_t i = 0; i < n; i++) {
+        if (isfinite(v[i])) {
+            fprintf(f, "%s%.9g", i ? ", " : "", v[i]);
+        } else {
+            fprintf(f, "%snull", i ? ", " : "");
+        }
+    }
+    fprintf(f, "]");
+}
+
+/* Largest error beyond tolerance scaled by the golden magnitude; NaN must match NaN */
+static double max_error(const float *got, const std::vector<double> &golden, double tol, bool *ok)
+{
+    double worst = 0.0;
+    for (size_t i = 0; i < golden.size(); i++) {
+        if (isnan(golden[i]) || isnan(got[i])) {
+            *ok = *ok && isnan(golden[i]) && isnan(got[i]);
+            continue;
+        }
+        /* golden values are float printed with 9 digits, round them back first */
+        double err = fabs((double)got[i] - (double)(float)golden[i]);
+        worst = std::max(worst, err);
+        *ok = *ok && err <= tol * (1.0 + fabs(golden[i]));
+    }
+    return worst;
+}
+
+static double median(std::vector<double> v)
+{
+    if (v.empty()) {
+        return 0.0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+#ifdef QX_HARNESS_ENGINE
+static pPredictionFrame engine_frame;
+
+static SensorData *engine_sensor(QXOSensorType type)
+{
+    for (int i = 0; i < engine_frame->mEnabledSensorCount; i++) {
+        if (engine_frame->mSensorData[i].sensor_type == type) {
+            return &engine_frame->mSensorData[i];
+        }
+    }
+    return NULL;
+}
+
+static void engine_fill(QXOSensorType type, const std::vector<double> &window)
+{
+    SensorData *sensor = engine_sensor(type);
+    if (sensor == NULL) {
+        return;
+    }
+
+    uint32_t n = std::min<uint32_t>(window.size(), sensor->buff_max / sizeof(int16_t));
+    int16_t *dst = (int16_t *)sensor->buff_ptr;
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] = (int16_t)window[i];
+    }
+    sensor->buff_end = n * sizeof(int16_t);
+}
+#endif
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: qxgolden [--record OUT] [--loops N] [--feat-tol X] [--prob-tol X]\n"
+            "                [--num-features N] GOLDEN.jsonl\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *golden_path = NULL, *record_path = NULL;
+    int loops = 100;
+    double feat_tol = 1e-4, prob_tol = 1e-4;
+    uint32_t num_features = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (arg == "--loops" && i + 1 < argc) {
+            loops = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--feat-tol" && i + 1 < argc) {
+            feat_tol = atof(argv[++i]);
+        } else if (arg == "--prob-tol" && i + 1 < argc) {
+            prob_tol = atof(argv[++i]);
+        } else if (arg == "--num-features" && i + 1 < argc) {
+            num_features = (uint32_t)atoi(argv[++i]);
+        } else if (arg[0] != '-' && golden_path == NULL) {
+            golden_path = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if (golden_path == NULL) {
+        usage();
+    }
+
+    FILE *in = fopen(golden_path, "r");
+    if (in == NULL) {
+        perror(golden_path);
+        return 2;
+    }
+    FILE *rec = NULL;
+    if (record_path != NULL && (rec = fopen(record_path, "w")) == NULL) {
+        perror(record_path);
+        return 2;
+    }
+
+#ifdef QX_HARNESS_ENGINE
+    engine_frame = QXO_MLEngine_Init();
+    if (engine_frame == NULL) {
+        fprintf(stderr, "QXO_MLEngine_Init failed\n");
+        return 2;
+    }
+    const char *mode = "engine";
+    int num_classes = 0;
+    float sensitivity[50];
+    QXO_MLEngine_GetSensitivity(sensitivity, &num_classes);
+    num_classes = std::min<int>(num_classes, sizeof(engine_frame->mProbs) / sizeof(float));
+#else
+    const char *mode = "predict";
+    const int num_classes = qx_predict_num_classes;
+#endif
+    if (num_classes <= 0) {
+        fprintf(stderr, "the model has no classes\n");
+        return 2;
+    }
+
+    std::vector<double> all_featurize, all_predict, all_work;
+    std::vector<double> accel, gyro, features, probs;
+    std::string line;
+    int records = 0, failed = 0, compared = 0, skipped = 0;
+    char buf[1 << 16];
+
+    while (fgets(buf, sizeof(buf), in) != NULL) {
+        line = buf;
+        /* long records are read in pieces */
+        while (!line.empty() && line.back() != '\n' && fgets(buf, sizeof(buf), in) != NULL) {
+            line += buf;
+        }
+        if (line.find('{') == std::string::npos) {
+            continue;
+        }
+
+        bool has_features = json_array(line, "features", features);
+        bool has_probs = json_array(line, "probs", probs);
+        int golden_cls = -1;
+        json_int(line, "cls", &golden_cls);
+
+        /* the engine does not tell the feature count, take it from the golden record */
+        wrap_num_features = num_features ? num_features : (has_features ? (uint32_t)features.size() : 0);
+        if (rec && wrap_num_features == 0) {
+            fprintf(stderr, "record %d: feature count unknown, use --num-features\n", records);
+        }
+
+        std::vector<float> out_probs(num_classes);
+        std::vector<float> in_features;
+        std::vector<double> t_predict, t_work;
+        int cls = -1;
+
+#ifdef QX_HARNESS_ENGINE
+        bool has_window = json_array(line, "accel", accel) | json_array(line, "gyro", gyro);
+        if (!has_window) {
+            fprintf(stderr, "record %d: no accel/gyro window, skipped\n", records + skipped);
+            skipped++;
+            continue;
+        }
+        for (int l = 0; l < loops; l++) {
+            engine_fill(SENSOR_TYPE_ACCEL, accel);
+            engine_fill(SENSOR_TYPE_GYRO, gyro);
+            double t0 = now_ns();
+            cls = QXO_MLEngine_Work(engine_frame, 0);
+            t_work.push_back(now_ns() - t0);
+            t_predict.push_back(wrap_ns);
+        }
+        memcpy(out_probs.data(), engine_frame->mProbs, num_classes * sizeof(float));
+#else
+        (void)accel;
+        (void)gyro;
+        if (!has_features) {
+            fprintf(stderr, "record %d: no features, skipped\n", records + skipped);
+            skipped++;
+            continue;
+        }
+        in_features.assign(features.begin(), features.end());
+        in_features.resize(std::max<size_t>(in_features.size(), wrap_num_features), 0.0f);
+        for (int l = 0; l < loops; l++) {
+            predict(in_features.data(), out_probs.data());
+            t_predict.push_back(wrap_ns);
+        }
+        has_features = false; /* the input itself, nothing to compare */
+#endif
+
+        bool ok = true;
+        double feat_err = 0.0, prob_err = 0.0;
+        if (has_features && !rec) {
+            bool feat_ok = features.size() <= wrap_features.size();
+            if (feat_ok) {
+                feat_err = max_error(wrap_features.data(), features, feat_tol, &feat_ok);
+            }
+            ok = ok && feat_ok;
+        }
+        if (has_probs && !rec) {
+            if (probs.size() == (size_t)num_classes) {
+                prob_err = max_error(out_probs.data(), probs, prob_tol, &ok);
+            } else {
+                fprintf(stderr, "record %d: %zu probs, the model has %d classes\n", records, probs.size(), num_classes);
+                ok = false;
+            }
+        }
+        if (golden_cls >= 0 && cls >= 0 && !rec) {
+            ok = ok && golden_cls == cls;
+        }
+        compared += !rec && (has_features || has_probs || (golden_cls >= 0 && cls >= 0));
+
+        double ns_predict = median(t_predict);
+        printf("{\"record\": %d, \"stage\": \"predict\", \"ns\": %.0f, \"max_abs_err\": %.3g}\n",
+               records, ns_predict, prob_err);
+        all_predict.push_back(ns_predict);
+        if (!t_work.empty()) {
+            double ns_work = median(t_work);
+            printf("{\"record\": %d, \"stage\": \"featurize\", \"ns\": %.0f, \"max_abs_err\": %.3g}\n",
+                   records, ns_work - ns_predict, feat_err);
+            printf("{\"record\": %d, \"stage\": \"work\", \"ns\": %.0f, \"cls\": %d}\n", records, ns_work, cls);
+            all_featurize.push_back(ns_work - ns_predict);
+            all_work.push_back(ns_work);
+        }
+        if (!rec) {
+            printf("{\"record\": %d, \"ok\": %s}\n", records, ok ? "true" : "false");
+        }
+
+        if (rec) {
+            fprintf(rec, "{");
+#ifdef QX_HARNESS_ENGINE
+            std::vector<float> a(accel.begin(), accel.end()), g(gyro.begin(), gyro.end());
+            json_write_array(rec, "accel", a.data(), a.size());
+            fprintf(rec, ", ");
+            json_write_array(rec, "gyro", g.data(), g.size());
+            fprintf(rec, ", \"cls\": %d, ", cls);
+#endif
+            json_write_array(rec, "features", wrap_features.data(), wrap_features.size());
+            fprintf(rec, ", ");
+            json_write_array(rec, "probs", out_probs.data(), num_classes);
+            fprintf(rec, "}\n");
+        }
+
+        failed += !ok;
+        records++;
+    }
+
+    printf("{\"summary\": true, \"mode\": \"%s\", \"records\": %d, \"compared\": %d, \"skipped\": %d, "
+           "\"failed\": %d, \"featurize_ns\": %.0f, \"predict_ns\": %.0f, \"work_ns\": %.0f}\n",
+           mode, records, compared, skipped, failed, median(all_featurize), median(all_predict), median(all_work));
+
+    fclose(in);
+    if (rec) {
+        fclose(rec);
+    }
+    return (failed > 0 || records == 0 || (!rec && compared == 0)) ? 1 : 0;
+}
@@ -0,0 +1,1090 @@
+/**
+  ******************************************************************************
+  * @file    QxOS_Posix.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   POSIX (Linux) backend of the QxOS abstraction layer.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#include "QxOS_Posix.h"
+#include "QxCpuStats.h"
+#include "QxStack.h"
+
+#include <atomic>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <malloc.h>
+#include <netdb.h>
+#include <new>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define POSIX_MAX_CALLBACKS 8
+#define POSIX_READ_CHUNK    512
+#define POSIX_PRINT_MAX     256
+#define POSIX_STATIC_THREADS 16
+
+/* tQxThread is handed out, the rest stays private */
+typedef struct {
+    tQxThread thread;
+    pthread_t tid;
+    tQxThreadFunc func;
+    void *userdata;
+} tPosixThread;
+
+/* a PI futex: 0 when unlocked, else the owner tid, with FUTEX_WAITERS set by the kernel */
+typedef struct tPosixMutex {
+    tQxMutex mutex;
+    std::atomic<int> state;
+    uint64_t locked_us;         /* written and read by the owner */
+    std::atomic<uint32_t> locks;
+    std::atomic<uint32_t> contended;
+    std::atomic<uint32_t> timeouts;
+    std::atomic<uint32_t> max_wait_us;
+    std::atomic<uint32_t> max_hold_us;
+    struct tPosixMutex *next;
+} tPosixMutex;
+
+/* count with a futex; waiters tells a release whether a wake up is needed */
+typedef struct {
+    tQxSemaphore sem;
+    std::atomic<int> count;
+    std::atomic<int> waiters;
+    int max;
+} tPosixSemaphore;
+
+typedef struct {
+    int fd_out;
+    int fd_in;
+    bool owned;
+    pthread_t reader;
+    bool has_reader;
+    pthread_mutex_t write_lock;
+} tPosixStream;
+
+static struct timespec posix_tick_base;
+static pthread_once_t posix_once = PTHREAD_ONCE_INIT;
+
+static tPosixStream posix_streams[QxStreamDeviceMax];
+
+static pthread_mutex_t posix_callback_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    tQxStreamDataInCallback func;
+    void *userdata;
+} posix_callbacks[POSIX_MAX_CALLBACKS];
+static int posix_callback_count;
+
+#ifdef QXOS_VIRTUAL_TIME
+/* bytes of the reader threads, delivered by the token owner in QxOS_Posix_DrainStreams() */
+typedef struct tPosixStreamIn {
+    struct tPosixStreamIn *next;
+    tQxStreamDevice device;
+    uint16_t len;
+    uint8_t data[POSIX_READ_CHUNK];
+} tPosixStreamIn;
+
+static pthread_mutex_t posix_in_lock = PTHREAD_MUTEX_INITIALIZER;
+static tPosixStreamIn *posix_in_head;
+static tPosixStreamIn **posix_in_tail = &posix_in_head;
+#endif
+
+static tQxPosixSensorFunc posix_sensor_read;
+static tQxPosixSensorFunc posix_sensor_write;
+static void *posix_sensor_userdata;
+
+static void posix_init_once(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &posix_tick_base);
+    for (int i = 0; i < QxStreamDeviceMax; i++) {
+        posix_streams[i].fd_out = -1;
+        posix_streams[i].fd_in = -1;
+        pthread_mutex_init(&posix_streams[i].write_lock, NULL);
+    }
+}
+
+static void posix_init(void)
+{
+    pthread_once(&posix_once, posix_init_once);
+}
+
+static void posix_timespec_add_ms(struct timespec *ts, uint32_t ms)
+{
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/* Time left until deadline, false when it has passed */
+static bool posix_remaining(const struct timespec *deadline, struct timespec *left)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    left->tv_sec = deadline->tv_sec - now.tv_sec;
+    left->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+    if (left->tv_nsec < 0) {
+        left->tv_sec--;
+        left->tv_nsec += 1000000000L;
+    }
+    return left->tv_sec >= 0;
+}
+
+#ifndef QXOS_VIRTUAL_TIME
+
+/*
+    Threads
+ */
+static void *posix_thread_main(void *arg)
+{
+    tPosixThread *t = (tPosixThread *)arg;
+    t->func(t->userdata);
+    return NULL;
+}
+
+static int posix_fifo_priority(tQxPriority prio)
+{
+    int lo = sched_get_priority_min(SCHED_FIFO), hi = sched_get_priority_max(SCHED_FIFO);
+    int p = lo + (hi - lo) / 2 + (int)prio * 10;
+    return (p < lo) ? lo : ((p > hi) ? hi : p);
+}
+
+static tQxThread *posix_create_thread(const char *name, tQxThreadFunc func, tQxPriority prio, void *stack,
+                                      uint32_t stacksz, void *userdata)
+{
+    posix_init();
+
+    tPosixThread *t = (tPosixThread *)calloc(1, sizeof(tPosixThread));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->thread.name = (char *)name;
+    t->thread.pData = userdata;
+    t->func = func;
+    t->userdata = userdata;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (stack != NULL) {
+        pthread_attr_setstack(&attr, stack, stacksz);
+    } else if (stacksz > 0) {
+        /* device stacks are sized for the M4, give host code at least the libc minimum */
+        pthread_attr_setstacksize(&attr, (stacksz < PTHREAD_STACK_MIN) ? PTHREAD_STACK_MIN : stacksz);
+    }
+
+    const char *rt = getenv("QXOS_POSIX_RT");
+    if (rt != NULL && rt[0] == '1' && prio != QxPriorityError) {
+        struct sched_param param;
+        param.sched_priority = posix_fifo_priority(prio);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    int err = pthread_create(&t->tid, &attr, posix_thread_main, t);
+    if (err == EPERM) {
+        /* no permission for SCHED_FIFO, fall back to the normal scheduler */
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        err = pthread_create(&t->tid, &attr, posix_thread_main, t);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (err != 0) {
+        free(t);
+        return NULL;
+    }
+    if (name != NULL) {
+        char short_name[16];
+        snprintf(short_name, sizeof(short_name), "%s", name);
+        pthread_setname_np(t->tid, short_name);
+    }
+    return &t->thread;
+}
+
+tQxThread* QxOS_CreateThread(const char* name, tQxThreadFunc func, tQxPriority prio, uint32_t stacksz, void* userdata)
+{
+    return posix_create_thread(name, func, prio, NULL, stacksz, userdata);
+}
+
+tQxThread* QxOS_Posix_CreateThreadOnStack(const char *name, tQxThreadFunc func, tQxPriority prio, void *stack,
+                                          uint32_t stacksz, void *userdata)
+{
+    return posix_create_thread(name, func, prio, stack, stacksz, userdata);
+}
+
+tQxStatus QxOS_Posix_JoinThread(tQxThread *thread)
+{
+    if (thread == NULL) {
+        return QxErr;
+    }
+    tPosixThread *t = (tPosixThread *)thread;
+    if (pthread_join(t->tid, NULL) != 0) {
+        return QxErr;
+    }
+    free(t);
+    return QxOK;
+}
+
+tQxStatus QxOS_StartKernel(void)
+{
+    /* threads run as soon as they are created */
+    posix_init();
+    return QxOK;
+}
+
+/*
+    Mutexes
+ */
+static long posix_futex(std::atomic<int> *addr, int op, int val, const struct timespec *timeout)
+{
+    return syscall(SYS_futex, (int *)addr, op | FUTEX_PRIVATE_FLAG, val, timeout, NULL, 0);
+}
+
+/*
+    Priority inheriting like the RTX mutexes of the device, which matters
+    with the SCHED_FIFO threads of QXOS_POSIX_RT=1: an uncontended lock and
+    unlock is a compare and swap of the owner tid, else the kernel queues
+    the waiters by priority and boosts the owner (FUTEX_LOCK_PI). Its
+    timeout is CLOCK_REALTIME, the remaining monotonic time is converted.
+
+    The owner updates the maxima, relaxed atomics are enough.
+ */
+static pthread_mutex_t posix_mutex_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static tPosixMutex *posix_mutexes;
+static __thread int posix_tid;
+
+static int posix_gettid(void)
+{
+    if (posix_tid == 0) {
+        posix_tid = (int)syscall(SYS_gettid);
+    }
+    return posix_tid;
+}
+
+static void posix_max(std::atomic<uint32_t> &max, uint64_t value)
+{
+    uint32_t v = (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
+    if (v > max.load(std::memory_order_relaxed)) {
+        max.store(v, std::memory_order_relaxed);
+    }
+}
+
+static tQxStatus posix_lock(tPosixMutex *m, const struct timespec *deadline)
+{
+    int tid = posix_gettid();
+    int unlocked = 0;
+    if (!m->state.compare_exchange_strong(unlocked, tid, std::memory_order_acquire)) {
+        uint64_t start = QxOS_GetTimeUs();
+        for (;;) {
+            struct timespec left, until;
+            if (deadline != NULL) {
+                if (!posix_remaining(deadline, &left)) {
+                    m->timeouts.fetch_add(1, std::memory_order_relaxed);
+                    return QxBusy;
+                }
+                clock_gettime(CLOCK_REALTIME, &until);
+                until.tv_sec += left.tv_sec;
+                until.tv_nsec += left.tv_nsec;
+                if (until.tv_nsec >= 1000000000L) {
+                    until.tv_sec++;
+                    until.tv_nsec -= 1000000000L;
+                }
+            }
+            if (posix_futex(&m->state, FUTEX_LOCK_PI, 0, deadline ? &until : NULL) == 0) {
+                break;
+            }
+            if (errno == EDEADLK) {
+                return QxErr;
+            }
+            unlocked = 0;
+            if (m->state.compare_exchange_strong(unlocked, tid, std::memory_order_acquire)) {
+                break;
+            }
+        }
+        /* the kernel made us the owner, pair with the release of QxOS_UnLockMutex() */
+        m->state.load(std::memory_order_acquire);
+        m->contended.fetch_add(1, std::memory_order_relaxed);
+        posix_max(m->max_wait_us, QxOS_GetTimeUs() - start);
+    }
+    m->locks.fetch_add(1, std::memory_order_relaxed);
+    m->locked_us = QxOS_GetTimeUs();
+    m->mutex.isLocked = TRUE;
+    return QxOK;
+}
+
+tQxMutex* QxOS_CreateMutex(const char* name)
+{
+    tPosixMutex *m = (tPosixMutex *)calloc(1, sizeof(tPosixMutex));
+    if (m == NULL) {
+        return NULL;
+    }
+    new (&m->state) std::atomic<int>(0);
+    new (&m->locks) std::atomic<uint32_t>(0);
+    new (&m->contended) std::atomic<uint32_t>(0);
+    new (&m->timeouts) std::atomic<uint32_t>(0);
+    new (&m->max_wait_us) std::atomic<uint32_t>(0);
+    new (&m->max_hold_us) std::atomic<uint32_t>(0);
+    m->mutex.name = (char *)name;
+    m->mutex.isLocked = FALSE;
+
+    pthread_mutex_lock(&posix_mutex_list_lock);
+    m->next = posix_mutexes;
+    posix_mutexes = m;
+    pthread_mutex_unlock(&posix_mutex_list_lock);
+    return &m->mutex;
+}
+
+tQxStatus QxOS_LockMutex(tQxMutex* mutex)
+{
+    if (mutex == NULL) {
+        return QxErr;
+    }
+    return posix_lock((tPosixMutex *)mutex, NULL);
+}
+
+tQxStatus QxOS_LockMutex_Wait(tQxMutex* mutex, uint32_t millisec)
+{
+    if (mutex == NULL) {
+        return QxErr;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    posix_timespec_add_ms(&deadline, millisec);
+    return posix_lock((tPosixMutex *)mutex, &deadline);
+}
+
+tQxStatus QxOS_UnLockMutex(tQxMutex* mutex)
+{
+    if (mutex == NULL) {
+        return QxErr;
+    }
+    tPosixMutex *m = (tPosixMutex *)mutex;
+    int tid = posix_gettid();
+    if ((m->state.load(std::memory_order_relaxed) & FUTEX_TID_MASK) != tid) {
+        return QxErr;
+    }
+
+    posix_max(m->max_hold_us, QxOS_GetTimeUs() - m->locked_us);
+    m->mutex.isLocked = FALSE;
+    int owner = tid;
+    if (!m->state.compare_exchange_strong(owner, 0, std::memory_order_release)) {
+        /* waiters, the kernel hands the mutex to the highest priority one */
+        m->state.fetch_or(0, std::memory_order_release);
+        posix_futex(&m->state, FUTEX_UNLOCK_PI, 0, NULL);
+    }
+    return QxOK;
+}
+
+static void posix_mutex_stats(tPosixMutex *m, tQxMutexStats *stats)
+{
+    stats->name = m->mutex.name;
+    stats->locks = m->locks.load(std::memory_order_relaxed);
+    stats->contended = m->contended.load(std::memory_order_relaxed);
+    stats->timeouts = m->timeouts.load(std::memory_order_relaxed);
+    stats->max_wait_us = m->max_wait_us.load(std::memory_order_relaxed);
+    stats->max_hold_us = m->max_hold_us.load(std::memory_order_relaxed);
+}
+
+tQxStatus QxOS_GetMutexStats(tQxMutex* mutex, tQxMutexStats* stats)
+{
+    if (mutex == NULL || stats == NULL) {
+        return QxErr;
+    }
+    posix_mutex_stats((tPosixMutex *)mutex, stats);
+    return QxOK;
+}
+
+int QxOS_ListMutexStats(tQxMutexStats* stats, int max)
+{
+    int n = 0;
+    pthread_mutex_lock(&posix_mutex_list_lock);
+    for (tPosixMutex *m = posix_mutexes; m != NULL && n < max; m = m->next) {
+        posix_mutex_stats(m, &stats[n++]);
+    }
+    pthread_mutex_unlock(&posix_mutex_list_lock);
+    return n;
+}
+
+/*
+    Semaphores
+ */
+tQxSemaphore* QxOS_CreateSemaphore(const char* name, uint32_t max_count, uint32_t initial_count)
+{
+    if (max_count == 0 || max_count > INT_MAX || initial_count > max_count) {
+        return NULL;
+    }
+    tPosixSemaphore *s = (tPosixSemaphore *)calloc(1, sizeof(tPosixSemaphore));
+    if (s == NULL) {
+        return NULL;
+    }
+    new (&s->count) std::atomic<int>((int)initial_count);
+    new (&s->waiters) std::atomic<int>(0);
+    s->max = (int)max_count;
+    s->sem.name = (char *)name;
+    return &s->sem;
+}
+
+tQxStatus QxOS_WaitSemaphore(tQxSemaphore* sem, uint32_t millisec)
+{
+    if (sem == NULL) {
+        return QxErr;
+    }
+    tPosixSemaphore *s = (tPosixSemaphore *)sem;
+    struct timespec deadline;
+    if (millisec != QX_WAIT_FOREVER) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        posix_timespec_add_ms(&deadline, millisec);
+    }
+
+    for (;;) {
+        int c = s->count.load();
+        while (c > 0) {
+            if (s->count.compare_exchange_weak(c, c - 1, std::memory_order_acquire)) {
+                return QxOK;
+            }
+        }
+        struct timespec left;
+        if (millisec != QX_WAIT_FOREVER && !posix_remaining(&deadline, &left)) {
+            return QxBusy;
+        }
+        /* a release between the load and the wait changes count, the wait then returns at once */
+        s->waiters.fetch_add(1);
+        posix_futex(&s->count, FUTEX_WAIT, 0, (millisec != QX_WAIT_FOREVER) ? &left : NULL);
+        s->waiters.fetch_sub(1);
+    }
+}
+
+tQxStatus QxOS_ReleaseSemaphore(tQxSemaphore* sem)
+{
+    if (sem == NULL) {
+        return QxErr;
+    }
+    tPosixSemaphore *s = (tPosixSemaphore *)sem;
+    int c = s->count.load();
+    do {
+        if (c >= s->max) {
+            return QxBusy;
+        }
+    } while (!s->count.compare_exchange_weak(c, c + 1));
+    if (s->waiters.load() > 0) {
+        posix_futex(&s->count, FUTEX_WAKE, 1, NULL);
+    }
+    return QxOK;
+}
+
+/*
+    Time
+ */
+tQxStatus QxOS_Delay(uint32_t msec)
+{
+    struct timespec ts;
+    ts.tv_sec = msec / 1000;
+    ts.tv_nsec = (long)(msec % 1000) * 1000000L;
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {
+    }
+    return QxOK;
+}
+
+uint32_t QxOS_GetTick()
+{
+    /* wraps after 49 days like the device tick */
+    return (uint32_t)(QxOS_GetTimeUs() / 1000);
+}
+
+uint64_t QxOS_GetTimeUs(void)
+{
+    posix_init();
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - posix_tick_base.tv_sec) * 1000000 +
+           (now.tv_nsec - posix_tick_base.tv_nsec) / 1000;
+}
+
+/* a host cycle is a nanosecond of CLOCK_MONOTONIC, the counter wraps after 4.3 s */
+uint32_t QxOS_GetCycles(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec);
+}
+
+uint32_t QxOS_GetCycleHz(void)
+{
+    return 1000000000u;
+}
+
+/*
+    CPU statistics
+ */
+#define POSIX_CPU_NAMES 32
+
+/* thread names by tid, kept so the names of a report stay valid */
+static pthread_mutex_t posix_cpu_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    long tid;
+    char name[16];
+} posix_cpu_names[POSIX_CPU_NAMES];
+static int posix_cpu_name_count;
+
+static const char *posix_cpu_name(long tid)
+{
+    for (int i = 0; i < posix_cpu_name_count; i++) {
+        if (posix_cpu_names[i].tid == tid) {
+            return posix_cpu_names[i].name;
+        }
+    }
+    if (posix_cpu_name_count == POSIX_CPU_NAMES) {
+        return "?";
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%ld/comm", tid);
+    FILE *f = fopen(path, "r");
+    char *name = posix_cpu_names[posix_cpu_name_count].name;
+    if (f == NULL || fgets(name, sizeof(posix_cpu_names[0].name), f) == NULL) {
+        snprintf(name, sizeof(posix_cpu_names[0].name), "%d", (int)tid);
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+    name[strcspn(name, "\n")] = '\0';
+    posix_cpu_names[posix_cpu_name_count].tid = tid;
+    return posix_cpu_names[posix_cpu_name_count++].name;
+}
+
+/*
+    schedstat of every thread: nanoseconds on the CPU and the number of times
+    it was switched in. The idle entry is the time no thread of the process
+    ran, as if it had one CPU; threads that exited no longer count.
+ */
+int QxOS_GetThreadCpu(tQxThreadCpu *threads, int max)
+{
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == NULL || max < 2) {
+        if (dir != NULL) {
+            closedir(dir);
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock(&posix_cpu_lock);
+    int n = 0;
+    uint64_t busy_us = 0;
+    struct dirent *entry;
+    while (n < max - 1 && (entry = readdir(dir)) != NULL) {
+        long tid = atol(entry->d_name);
+        if (tid <= 0) {
+            continue;
+        }
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/task/%ld/schedstat", tid);
+        FILE *f = fopen(path, "r");
+        if (f == NULL) {
+            continue;
+        }
+        unsigned long long run_ns = 0, wait_ns = 0, slices = 0;
+        int fields = fscanf(f, "%llu %llu %llu", &run_ns, &wait_ns, &slices);
+        fclose(f);
+        if (fields != 3) {
+            continue;
+        }
+
+        threads[n].name = posix_cpu_name(tid);
+        threads[n].id = (uintptr_t)tid;
+        threads[n].runtime_us = run_ns / 1000;
+        threads[n].switches = (uint32_t)slices;
+        threads[n].idle = FALSE;
+        busy_us += threads[n].runtime_us;
+        n++;
+    }
+    closedir(dir);
+    pthread_mutex_unlock(&posix_cpu_lock);
+
+    uint64_t now = QxOS_GetTimeUs();
+    threads[n].name = "idle";
+    threads[n].id = 0;
+    threads[n].runtime_us = (now > busy_us) ? now - busy_us : 0;
+    threads[n].switches = 0;
+    threads[n].idle = TRUE;
+    return n + 1;
+}
+
+#endif /* QXOS_VIRTUAL_TIME */
+
+/*
+    Streams
+ */
+#ifdef QXOS_VIRTUAL_TIME
+
+/*
+    A reader thread is not scheduled: it only blocks in read() and queues
+    what it got. Callbacks call QxOS_GetTick() and QxOS_ExecutorPost(), so
+    they run on the thread holding the token, never on the reader.
+ */
+static void posix_stream_in(tQxStreamDevice device, const uint8_t *data, uint16_t len)
+{
+    tPosixStreamIn *in = (tPosixStreamIn *)malloc(sizeof(tPosixStreamIn));
+    if (in == NULL) {
+        return;
+    }
+    in->next = NULL;
+    in->device = device;
+    in->len = len;
+    memcpy(in->data, data, len);
+
+    pthread_mutex_lock(&posix_in_lock);
+    *posix_in_tail = in;
+    posix_in_tail = &in->next;
+    pthread_mutex_unlock(&posix_in_lock);
+}
+
+static tPosixStreamIn *posix_stream_in_take(void)
+{
+    pthread_mutex_lock(&posix_in_lock);
+    tPosixStreamIn *in = posix_in_head;
+    if (in != NULL) {
+        posix_in_head = in->next;
+        posix_in_tail = (posix_in_head == NULL) ? &posix_in_head : posix_in_tail;
+    }
+    pthread_mutex_unlock(&posix_in_lock);
+    return in;
+}
+
+void QxOS_Posix_DrainStreams(void)
+{
+    /* a callback that sleeps drains again from inside, keep the order */
+    static bool draining;
+    if (draining) {
+        return;
+    }
+    draining = true;
+    tPosixStreamIn *in;
+    while ((in = posix_stream_in_take()) != NULL) {
+        QxOS_NotifyStreamDataIn(in->device, in->data, in->len);
+        free(in);
+    }
+    draining = false;
+}
+
+#else
+
+static void posix_stream_in(tQxStreamDevice device, const uint8_t *data, uint16_t len)
+{
+    QxOS_NotifyStreamDataIn(device, data, len);
+}
+
+#endif /* QXOS_VIRTUAL_TIME */
+
+static void *posix_stream_reader(void *arg)
+{
+    tQxStreamDevice device = (tQxStreamDevice)(intptr_t)arg;
+    uint8_t buf[POSIX_READ_CHUNK];
+
+    for (;;) {
+        ssize_t n = read(posix_streams[device].fd_in, buf, sizeof(buf));
+        if (n > 0) {
+            posix_stream_in(device, buf, (uint16_t)n);
+        } else if (n == 0 || errno != EINTR) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int posix_connect_tcp(const char *host_port)
+{
+    char host[256];
+    const char *colon = strrchr(host_port, ':');
+    if (colon == NULL || (size_t)(colon - host_port) >= sizeof(host)) {
+        return -1;
+    }
+    memcpy(host, host_port, colon - host_port);
+    host[colon - host_port] = '\0';
+
+    struct addrinfo hints, *res, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, colon + 1, &hints, &res) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (ai = res; ai != NULL && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static int posix_connect_unix(const char *path)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static void posix_unbind(tPosixStream *s)
+{
+    if (s->fd_in >= 0 && s->has_reader) {
+        shutdown(s->fd_in, SHUT_RD);
+        pthread_cancel(s->reader);
+        pthread_join(s->reader, NULL);
+    }
+    if (s->owned) {
+        if (s->fd_in >= 0 && s->fd_in != s->fd_out) {
+            close(s->fd_in);
+        }
+        if (s->fd_out >= 0) {
+            close(s->fd_out);
+        }
+    }
+    s->fd_out = s->fd_in = -1;
+    s->owned = s->has_reader = false;
+}
+
+tQxStatus QxOS_Posix_BindStream(tQxStreamDevice device_type, const char *spec)
+{
+    posix_init();
+    if (device_type <= QxStreamDeviceNone || device_type >= QxStreamDeviceMax || spec == NULL) {
+        return QxErr;
+    }
+
+    tPosixStream *s = &posix_streams[device_type];
+    pthread_mutex_lock(&s->write_lock);
+    posix_unbind(s);
+
+    int fd_out = -1, fd_in = -1;
+    bool owned = true;
+    if (strncmp(spec, "file:", 5) == 0) {
+        fd_out = open(spec + 5, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    } else if (strncmp(spec, "fd:", 3) == 0) {
+        fd_out = atoi(spec + 3);
+        const char *comma = strchr(spec, ',');
+        fd_in = comma ? atoi(comma + 1) : -1;
+        owned = false;
+    } else if (strncmp(spec, "tcp:", 4) == 0) {
+        fd_out = fd_in = posix_connect_tcp(spec + 4);
+    } else if (strncmp(spec, "unix:", 5) == 0) {
+        fd_out = fd_in = posix_connect_unix(spec + 5);
+    }
+
+    if (fd_out < 0) {
+        pthread_mutex_unlock(&s->write_lock);
+        QxOS_DebugPrint("QxOS_Posix: cannot open stream %s\n", spec);
+        return QxDeviceErr;
+    }
+
+    s->fd_out = fd_out;
+    s->fd_in = fd_in;
+    s->owned = owned;
+    if (fd_in >= 0) {
+        s->has_reader = pthread_create(&s->reader, NULL, posix_stream_reader,
+                                       (void *)(intptr_t)device_type) == 0;
+    }
+    pthread_mutex_unlock(&s->write_lock);
+    return QxOK;
+}
+
+tQxStatus QxOS_Posix_CloseStreams(void)
+{
+    posix_init();
+    for (int i = 0; i < QxStreamDeviceMax; i++) {
+        pthread_mutex_lock(&posix_streams[i].write_lock);
+        posix_unbind(&posix_streams[i]);
+        pthread_mutex_unlock(&posix_streams[i].write_lock);
+    }
+#ifdef QXOS_VIRTUAL_TIME
+    /* the readers are gone, drop what nobody drained */
+    tPosixStreamIn *in;
+    while ((in = posix_stream_in_take()) != NULL) {
+        free(in);
+    }
+#endif
+    return QxOK;
+}
+
+int QxOS_StreamDataOut(tQxStreamDevice device_type, void* data, uint16_t data_len, uint32_t timeout)
+{
+    if (device_type <= QxStreamDeviceNone || device_type >= QxStreamDeviceMax) {
+        return 0;
+    }
+    posix_init();
+
+    tPosixStream *s = &posix_streams[device_type];
+    const uint8_t *p = (const uint8_t *)data;
+    int sent = 0;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    posix_timespec_add_ms(&deadline, timeout);
+
+    pthread_mutex_lock(&s->write_lock);
+    while (s->fd_out >= 0 && sent < data_len) {
+        struct timespec left;
+        if (!posix_remaining(&deadline, &left)) {
+            break;
+        }
+        struct pollfd pfd = {s->fd_out, POLLOUT, 0};
+        int ms = (int)(left.tv_sec * 1000 + left.tv_nsec / 1000000);
+        if (poll(&pfd, 1, ms) <= 0) {
+            break;
+        }
+        ssize_t n = write(s->fd_out, p + sent, data_len - sent);
+        if (n < 0 && errno != EINTR && errno != EAGAIN) {
+            break;
+        }
+        sent += (n > 0) ? (int)n : 0;
+    }
+    pthread_mutex_unlock(&s->write_lock);
+    return sent;
+}
+
+int QxOS_FlushDataOut(tQxStreamDevice device_type, uint32_t timeout)
+{
+    (void)timeout;
+    /* writes go straight to the descriptor, nothing is buffered here */
+    if (device_type <= QxStreamDeviceNone || device_type >= QxStreamDeviceMax) {
+        return 0;
+    }
+    return 0;
+}
+
+tQxStatus QxOS_RegisterStreamDataInCallback(tQxStreamDataInCallback callback, void *userdata)
+{
+    tQxStatus status = QxErr;
+
+    pthread_mutex_lock(&posix_callback_lock);
+    if (posix_callback_count < POSIX_MAX_CALLBACKS) {
+        posix_callbacks[posix_callback_count].func = callback;
+        posix_callbacks[posix_callback_count].userdata = userdata;
+        posix_callback_count++;
+        status = QxOK;
+    }
+    pthread_mutex_unlock(&posix_callback_lock);
+    return status;
+}
+
+tQxStatus QxOS_NotifyStreamDataIn(tQxStreamDevice device_type, const uint8_t* data, uint16_t length)
+{
+    pthread_mutex_lock(&posix_callback_lock);
+    int count = posix_callback_count;
+    pthread_mutex_unlock(&posix_callback_lock);
+
+    /* callbacks are only ever appended, the first count entries are stable */
+    for (int i = 0; i < count; i++) {
+        posix_callbacks[i].func(device_type, data, length, posix_callbacks[i].userdata);
+    }
+    return QxOK;
+}
+
+/*
+    Printing
+ */
+void QxOS_DebugPrint(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    /* the device ends every debug line, most callers leave the newline out */
+    size_t len = strlen(format);
+    if (len == 0 || format[len - 1] != '\n') {
+        fputc('\n', stderr);
+    }
+}
+
+void QxOS_ClassifyPrint(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stdout, format, args);
+    va_end(args);
+    fflush(stdout);
+}
+
+void QxOS_ClassifyBTPrint(const char *format, ...)
+{
+    char text[POSIX_PRINT_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    len = (len < 0) ? 0 : ((len >= (int)sizeof(text)) ? (int)sizeof(text) - 1 : len);
+    if (posix_streams[QxStreamDeviceBT].fd_out >= 0) {
+        QxOS_StreamDataOut(QxStreamDeviceBT, text, (uint16_t)len, 100);
+    }
+}
+
+/*
+    Static threads and memory
+ */
+static pthread_mutex_t posix_static_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    tQxStaticThread *thread;
+    bool painted;
+} posix_static_threads[POSIX_STATIC_THREADS];
+static int posix_static_count;
+
+tQxThread* QxOS_CreateStaticThread(tQxStaticThread *t, tQxThreadFunc func, tQxPriority prio, void *userdata)
+{
+    t->func = func;
+    t->userdata = userdata;
+    QxOS_PaintStack(t->stack, t->stack_size);
+
+    /*
+        A stack below the libc minimum, or one the libc refuses (sanitizers
+        need more), still runs, on a libc stack that is not measured.
+     */
+    tQxThread *thread = NULL;
+    if (t->stack_size >= PTHREAD_STACK_MIN) {
+        thread = QxOS_Posix_CreateThreadOnStack(t->thread.name, func, prio, t->stack, t->stack_size, userdata);
+    }
+    bool painted = thread != NULL;
+    if (thread == NULL) {
+        thread = QxOS_Posix_CreateThreadOnStack(t->thread.name, func, prio, NULL, t->stack_size, userdata);
+    }
+    if (thread == NULL) {
+        return NULL;
+    }
+    t->handle = thread;
+
+    pthread_mutex_lock(&posix_static_lock);
+    if (posix_static_count < POSIX_STATIC_THREADS) {
+        posix_static_threads[posix_static_count].thread = t;
+        posix_static_threads[posix_static_count].painted = painted;
+        posix_static_count++;
+    }
+    pthread_mutex_unlock(&posix_static_lock);
+    return thread;
+}
+
+/* the stack of the main thread grows on demand, it is not painted */
+void QxOS_PaintCurrentStack(void)
+{
+}
+
+int QxOS_GetStackStats(tQxStackStats *stats, int max)
+{
+    pthread_mutex_lock(&posix_static_lock);
+    int n = (posix_static_count < max) ? posix_static_count : max;
+    for (int i = 0; i < n; i++) {
+        tQxStaticThread *t = posix_static_threads[i].thread;
+        stats[i].name = t->thread.name;
+        stats[i].size = t->stack_size;
+        stats[i].painted = posix_static_threads[i].painted;
+        stats[i].used = stats[i].painted ? QxOS_StackUsed(t->stack, t->stack_size) : 0;
+    }
+    pthread_mutex_unlock(&posix_static_lock);
+    return n;
+}
+
+tQxStatus QxOS_GetHeapStats(tQxHeapStats *stats)
+{
+    struct mallinfo2 info = mallinfo2();
+    stats->arena = (uint32_t)info.arena;
+    stats->in_use = (uint32_t)info.uordblks;
+    stats->free = (uint32_t)info.fordblks;
+    return QxOK;
+}
+
+/*
+    Board and sensors
+ */
+tQxStatus QxOS_InitializeBSP(void)
+{
+    static const char *env_names[QxStreamDeviceMax] = {
+        NULL, "QXOS_STREAM_USB", "QXOS_STREAM_BT", "QXOS_STREAM_SD", "QXOS_STREAM_WIFI", NULL,
+    };
+
+    posix_init();
+    for (int i = 0; i < QxStreamDeviceMax; i++) {
+        const char *spec = env_names[i] ? getenv(env_names[i]) : NULL;
+        if (spec != NULL && QxOS_Posix_BindStream((tQxStreamDevice)i, spec) != QxOK) {
+            return QxDeviceErr;
+        }
+    }
+    return QxOK;
+}
+
+tQxStatus QxOS_Posix_SetSensorHandler(tQxPosixSensorFunc read, tQxPosixSensorFunc write, void *userdata)
+{
+    posix_sensor_read = read;
+    posix_sensor_write = write;
+    posix_sensor_userdata = userdata;
+    return QxOK;
+}
+
+tQxStatus QxOS_SensorWriteReg(uint8_t slave_addr, uint8_t reg, uint8_t *data,  uint16_t len)
+{
+    if (posix_sensor_write == NULL) {
+        return QxDeviceErr;
+    }
+    return posix_sensor_write(slave_addr, reg, data, len, posix_sensor_userdata);
+}
+
+tQxStatus QxOS_SensorWriteRegSingle(uint8_t slave_addr, uint8_t reg, uint8_t data)
+{
+    return QxOS_SensorWriteReg(slave_addr, reg, &data, 1);
+}
+
+tQxStatus QxOS_SensorReadReg(uint8_t slave_addr, uint8_t reg, uint8_t *data,  uint16_t len)
+{
+    if (posix_sensor_read == NULL) {
+        return QxDeviceErr;
+    }
+    return posix_sensor_read(slave_addr, reg, data, len, posix_sensor_userdata);
+}
+
+void QxOS_Assert(BOOL cond)
+{
+    if (!cond) {
+        QxOS_DebugPrint("QxOS_Assert failed\n");
+        abort();
+    }
+}
@@ -0,0 +1,134 @@
+/**
+  ******************************************************************************
+  * @file    QxOS_Posix.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the POSIX (Linux) backend of the QxOS abstraction layer.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef HOST_POSIX_QXOS_POSIX_H_
+#define HOST_POSIX_QXOS_POSIX_H_
+
+#include "QxOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * QxOS_Posix.cpp implements every function of QxOS.h on Linux, so code
+ * written against QxOS (and a host build of the engine library) runs
+ * natively under perf, sanitizers and the Linux scheduler:
+ *
+ *  - threads are pthreads, tQxPriority maps to SCHED_FIFO when
+ *    QXOS_POSIX_RT=1 is set and the process may use it;
+ *  - mutexes and semaphores are futex based and honour their timeouts;
+ *  - QxOS_GetTick(), QxOS_GetTimeUs() and QxOS_Delay() use CLOCK_MONOTONIC,
+ *    a QxOS_GetCycles() cycle is one nanosecond;
+ *  - stream devices are bound to files, file descriptors or sockets, with
+ *    QxOS_Posix_BindStream() or the QXOS_STREAM_USB, QXOS_STREAM_BT,
+ *    QXOS_STREAM_SD and QXOS_STREAM_WIFI environment variables read by
+ *    QxOS_InitializeBSP(). Data read from a bound device is passed to
+ *    QxOS_NotifyStreamDataIn() by a reader thread;
+ *  - the sensor register calls go to handlers set with
+ *    QxOS_Posix_SetSensorHandler(), e.g. a sensor simulator;
+ *  - QxOS_CreateStaticThread() runs threads on their painted static stacks
+ *    when these have at least PTHREAD_STACK_MIN bytes. Host frames are
+ *    larger than on the M4, so the watermarks only compare host builds.
+ *
+ * Built with QXOS_VIRTUAL_TIME defined, QxOS_VirtualTime.cpp replaces the
+ * threads, mutexes, semaphores and time functions with a cooperative
+ * scheduler on a virtual clock: sleeps cost no wall time and runs are
+ * reproducible. The reader threads then only queue the data, and the thread
+ * holding the token passes it to the callbacks when it sleeps or waits.
+*/
+
+/**
+ * Sensor register read or write handler.
+ *
+ * @param[in] slave_addr Slave address or unique id of the sensor.
+ * @param[in] reg The register address.
+ * @param[in,out] *data The register data.
+ * @param[in] len The length of data.
+ * @param[in] *userdata The pointer given to QxOS_Posix_SetSensorHandler().
+ */
+typedef tQxStatus (*tQxPosixSensorFunc) (uint8_t slave_addr, uint8_t reg, uint8_t *data, uint16_t len, void *userdata);
+
+/**
+ * @brief Bind a stream device to a file, file descriptor or socket.
+ * @param[in] device_type The stream device.
+ * @param[in] *spec One of:
+ *                  "file:PATH"      write to PATH, truncated,
+ *                  "fd:OUT[,IN]"    write to descriptor OUT, read from IN,
+ *                  "tcp:HOST:PORT"  connect to a TCP server,
+ *                  "unix:PATH"      connect to a unix stream socket.
+ * @return tQxStatus : QxOK on success, QxDeviceErr when the spec cannot be opened.
+ * @note A device that is already bound is closed first.
+ */
+tQxStatus QxOS_Posix_BindStream(tQxStreamDevice device_type, const char *spec);
+
+/**
+ * @brief Close every bound stream device and join its reader thread.
+ * @return tQxStatus : QxOK.
+ */
+tQxStatus QxOS_Posix_CloseStreams(void);
+
+/**
+ * @brief Set the handlers of the sensor register calls.
+ * @param[in] read Handler of QxOS_SensorReadReg(), NULL to fail reads.
+ * @param[in] write Handler of QxOS_SensorWriteReg(), NULL to fail writes.
+ * @param[in] *userdata The pointer passed to both handlers.
+ * @return tQxStatus : QxOK.
+ */
+tQxStatus QxOS_Posix_SetSensorHandler(tQxPosixSensorFunc read, tQxPosixSensorFunc write, void *userdata);
+
+/**
+ * @brief Create a thread on a stack provided by the caller, used by QxOS_CreateStaticThread().
+ * @param[in] *name the name of a created thread.
+ * @param[in] func the main function of thread.
+ * @param[in] prio the priority of this thread.
+ * @param[in] *stack Lowest address of the stack, at least PTHREAD_STACK_MIN bytes; NULL for a libc stack.
+ * @param[in] stacksz the stack size of this thread.
+ * @param[in] userdata the memory pointer passed into func.
+ * @return tQxThread : Memory pointer of a created thread.
+ */
+tQxThread* QxOS_Posix_CreateThreadOnStack(const char *name, tQxThreadFunc func, tQxPriority prio, void *stack,
+                                          uint32_t stacksz, void *userdata);
+
+/**
+ * @brief Wait until a thread created by QxOS_CreateThread() returns, then release it.
+ * @param[in] *thread The thread, invalid after QxOK.
+ * @return tQxStatus : QxOK on success, QxErr otherwise.
+ */
+tQxStatus QxOS_Posix_JoinThread(tQxThread *thread);
+
+#ifdef QXOS_VIRTUAL_TIME
+/**
+ * @brief Pass the data queued by the reader threads to the QxOS_RegisterStreamDataInCallback() callbacks.
+ * @note Called by QxOS_VirtualTime.cpp on the thread holding the token, without its lock.
+ */
+void QxOS_Posix_DrainStreams(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HOST_POSIX_QXOS_POSIX_H_
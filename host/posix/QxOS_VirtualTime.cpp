@@ -0,0 +1,682 @@
+/**
+  ******************************************************************************
+  * @file    QxOS_VirtualTime.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Deterministic virtual time scheduler for the POSIX QxOS backend.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+/*
+    Built together with QxOS_Posix.cpp when QXOS_VIRTUAL_TIME is defined, and
+    then replaces its threads, mutexes, semaphores, QxOS_Delay() and the
+    time stamps.
+
+    QxOS threads are still pthreads, but only the thread holding the token
+    runs, like a single core RTOS without preemption. The token moves only
+    when the running thread sleeps, blocks on a mutex or a semaphore, or
+    returns. The next thread is the one with the highest priority among those
+    whose wake time has come, then the earliest wake time, then the earliest
+    created; the owner of a mutex inherits the priority of its waiters. When
+    no thread is ready the clock jumps to the next wake time, so a 10 ms
+    sleep costs no wall time and every run gives the same interleaving and
+    ticks.
+
+    QXOS_VT_CHARGE=<factor> adds the real time a thread ran, multiplied by
+    factor, to the clock when it gives up the token, e.g. the ratio of device
+    to host speed, so measured latencies are not zero. Runs are then no longer
+    bit for bit reproducible.
+
+    Stream reader threads of QxOS_Posix.cpp are not scheduled and never
+    hold the token; they queue what they read, and QxOS_Delay() and
+    QxOS_WaitSemaphore() hand it to the stream callbacks once the calling
+    thread holds the token again, with vt_lock released.
+ */
+
+#ifdef QXOS_VIRTUAL_TIME
+
+#include "QxOS_Posix.h"
+#include "QxCpuStats.h"
+
+#include <pthread.h>
+#include <time.h>
+#include <vector>
+
+typedef enum {
+    VT_READY,
+    VT_SLEEPING,
+    VT_BLOCKED,
+    VT_DONE,
+} tVtState;
+
+struct tVtMutex;
+struct tVtSemaphore;
+
+/* tQxThread is handed out, the rest stays private */
+typedef struct tVtThread {
+    tQxThread thread;
+    pthread_t tid;
+    tQxThreadFunc func;
+    void *userdata;
+    uint32_t id;
+    int prio;                   /* base_prio, or that of a waiter it inherited */
+    int base_prio;
+    tVtState state;
+    uint64_t wake_us;           /* ready time, or mutex timeout when has_deadline */
+    bool has_deadline;
+    bool timed_out;
+    struct tVtMutex *waiting;   /* mutex a VT_BLOCKED thread waits for */
+    struct tVtSemaphore *waiting_sem; /* or semaphore */
+    uint64_t waiting_seq;       /* FIFO order among the waiters of a mutex or semaphore */
+    uint64_t run_us;            /* virtual time charged while it held the token */
+    uint32_t switches;          /* times it got the token */
+    struct tVtThread *joining;  /* thread a VT_BLOCKED thread joins */
+    pthread_cond_t cond;
+} tVtThread;
+
+typedef struct tVtMutex {
+    tQxMutex mutex;
+    tVtThread *owner;
+    uint64_t locked_us;
+    tQxMutexStats stats;
+    struct tVtMutex *next;
+} tVtMutex;
+
+typedef struct tVtSemaphore {
+    tQxSemaphore sem;
+    uint32_t count;
+    uint32_t max;
+} tVtSemaphore;
+
+static pthread_mutex_t vt_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<tVtThread *> vt_threads;
+static tVtMutex *vt_mutexes;
+static tVtThread *vt_current;
+static uint64_t vt_now_us;
+static uint64_t vt_wait_seq;
+static uint64_t vt_idle_us;
+static double vt_charge = -1.0;
+static struct timespec vt_resumed;
+static __thread tVtThread *vt_me;
+
+static tVtThread *vt_new_thread(const char *name, tQxPriority prio)
+{
+    tVtThread *t = (tVtThread *)calloc(1, sizeof(tVtThread));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->thread.name = (char *)name;
+    t->id = (uint32_t)vt_threads.size();
+    t->prio = (prio == QxPriorityError) ? QxPriorityNormal : prio;
+    t->base_prio = t->prio;
+    t->state = VT_READY;
+    t->wake_us = vt_now_us;
+    pthread_cond_init(&t->cond, NULL);
+    vt_threads.push_back(t);
+    return t;
+}
+
+/* Called with vt_lock held. The first caller owns the token. */
+static tVtThread *vt_self(void)
+{
+    if (vt_me == NULL) {
+        const char *charge = getenv("QXOS_VT_CHARGE");
+        vt_charge = (vt_charge < 0.0) ? (charge ? atof(charge) : 0.0) : vt_charge;
+
+        vt_me = vt_new_thread("main", QxPriorityNormal);
+        vt_me->tid = pthread_self();
+        if (vt_current == NULL) {
+            vt_current = vt_me;
+            vt_me->switches++;
+            clock_gettime(CLOCK_MONOTONIC, &vt_resumed);
+        }
+        while (vt_current != vt_me) {
+            pthread_cond_wait(&vt_me->cond, &vt_lock);
+        }
+    }
+    return vt_me;
+}
+
+static void vt_charge_time(void)
+{
+    if (vt_charge <= 0.0) {
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double ran_us = (double)(now.tv_sec - vt_resumed.tv_sec) * 1e6 + (now.tv_nsec - vt_resumed.tv_nsec) / 1e3;
+    uint64_t charged = (uint64_t)(ran_us * vt_charge);
+    vt_now_us += charged;
+    if (vt_current != NULL) {
+        vt_current->run_us += charged;
+    }
+}
+
+static bool vt_ready(const tVtThread *t)
+{
+    return t->state == VT_READY ||
+           (t->state == VT_SLEEPING && t->wake_us <= vt_now_us) ||
+           (t->state == VT_BLOCKED && t->has_deadline && t->wake_us <= vt_now_us);
+}
+
+static bool vt_before(const tVtThread *a, const tVtThread *b)
+{
+    if (a->prio != b->prio) {
+        return a->prio > b->prio;
+    }
+    if (a->wake_us != b->wake_us) {
+        return a->wake_us < b->wake_us;
+    }
+    return a->id < b->id;
+}
+
+/*
+    Priority inheritance like the RTX mutexes of the device: the owner of a
+    mutex runs at the priority of its highest waiter. Called with vt_lock
+    held after the waiters or the mutexes of t changed; follows the chain
+    when t itself waits for a mutex.
+ */
+static void vt_inherit(tVtThread *t)
+{
+    while (t != NULL) {
+        int prio = t->base_prio;
+        for (tVtMutex *m = vt_mutexes; m != NULL; m = m->next) {
+            if (m->owner != t) {
+                continue;
+            }
+            for (tVtThread *w : vt_threads) {
+                if (w->state == VT_BLOCKED && w->waiting == m && w->prio > prio) {
+                    prio = w->prio;
+                }
+            }
+        }
+        if (prio == t->prio) {
+            return;
+        }
+        t->prio = prio;
+        t = (t->state == VT_BLOCKED && t->waiting != NULL) ? t->waiting->owner : NULL;
+    }
+}
+
+/* Next thread to run, advancing the clock when nothing is ready */
+static tVtThread *vt_pick(void)
+{
+    for (;;) {
+        tVtThread *best = NULL;
+        uint64_t next_us = UINT64_MAX;
+
+        for (tVtThread *t : vt_threads) {
+            if (vt_ready(t)) {
+                best = (best == NULL || vt_before(t, best)) ? t : best;
+            } else if (t->state == VT_SLEEPING || (t->state == VT_BLOCKED && t->has_deadline)) {
+                next_us = (t->wake_us < next_us) ? t->wake_us : next_us;
+            }
+        }
+
+        if (best != NULL) {
+            tVtMutex *gave_up = NULL;
+            if (best->state == VT_BLOCKED) {
+                gave_up = best->waiting;
+                best->timed_out = true;
+                best->waiting = NULL;
+                best->waiting_sem = NULL;
+            }
+            best->state = VT_READY;
+            best->has_deadline = false;
+            if (gave_up != NULL) {
+                gave_up->stats.timeouts++;
+                vt_inherit(gave_up->owner);
+            }
+            return best;
+        }
+        if (next_us == UINT64_MAX) {
+            return NULL;
+        }
+        vt_idle_us += next_us - vt_now_us;
+        vt_now_us = next_us;
+    }
+}
+
+/* Called with vt_lock held by the token owner; returns when self has the token again */
+static void vt_switch(tVtThread *self)
+{
+    vt_charge_time();
+
+    tVtThread *next = vt_pick();
+    if (next == NULL) {
+        if (self->state == VT_DONE) {
+            vt_current = NULL;
+            return;
+        }
+        QxOS_DebugPrint("QxOS_VirtualTime: every thread is blocked at %llu us\n",
+                        (unsigned long long)vt_now_us);
+        abort();
+    }
+
+    vt_current = next;
+    if (next != self) {
+        next->switches++;
+        pthread_cond_signal(&next->cond);
+        if (self->state == VT_DONE) {
+            return;
+        }
+        while (vt_current != self) {
+            pthread_cond_wait(&self->cond, &vt_lock);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &vt_resumed);
+}
+
+/*
+    Threads
+ */
+static void *vt_thread_main(void *arg)
+{
+    tVtThread *t = (tVtThread *)arg;
+
+    pthread_mutex_lock(&vt_lock);
+    vt_me = t;
+    while (vt_current != t) {
+        pthread_cond_wait(&t->cond, &vt_lock);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &vt_resumed);
+    pthread_mutex_unlock(&vt_lock);
+
+    t->func(t->userdata);
+
+    pthread_mutex_lock(&vt_lock);
+    t->state = VT_DONE;
+    for (tVtThread *j : vt_threads) {
+        if (j->state == VT_BLOCKED && j->joining == t) {
+            j->joining = NULL;
+            j->state = VT_READY;
+            j->wake_us = vt_now_us;
+        }
+    }
+    vt_switch(t);
+    pthread_mutex_unlock(&vt_lock);
+    return NULL;
+}
+
+static tQxThread *vt_create_thread(const char *name, tQxThreadFunc func, tQxPriority prio, void *stack,
+                                   uint32_t stacksz, void *userdata)
+{
+    pthread_mutex_lock(&vt_lock);
+    vt_self();
+
+    tVtThread *t = vt_new_thread(name, prio);
+    if (t == NULL) {
+        pthread_mutex_unlock(&vt_lock);
+        return NULL;
+    }
+    t->thread.pData = userdata;
+    t->func = func;
+    t->userdata = userdata;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (stack != NULL) {
+        pthread_attr_setstack(&attr, stack, stacksz);
+    } else if (stacksz > 0) {
+        pthread_attr_setstacksize(&attr, (stacksz < PTHREAD_STACK_MIN) ? PTHREAD_STACK_MIN : stacksz);
+    }
+    int err = pthread_create(&t->tid, &attr, vt_thread_main, t);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        /* never scheduled, keep it as a finished thread */
+        t->state = VT_DONE;
+        pthread_mutex_unlock(&vt_lock);
+        return NULL;
+    }
+
+    /* no preemption: the new thread runs when the creator sleeps or blocks */
+    pthread_mutex_unlock(&vt_lock);
+    return &t->thread;
+}
+
+tQxThread* QxOS_CreateThread(const char* name, tQxThreadFunc func, tQxPriority prio, uint32_t stacksz, void* userdata)
+{
+    return vt_create_thread(name, func, prio, NULL, stacksz, userdata);
+}
+
+tQxThread* QxOS_Posix_CreateThreadOnStack(const char *name, tQxThreadFunc func, tQxPriority prio, void *stack,
+                                          uint32_t stacksz, void *userdata)
+{
+    return vt_create_thread(name, func, prio, stack, stacksz, userdata);
+}
+
+tQxStatus QxOS_Posix_JoinThread(tQxThread *thread)
+{
+    if (thread == NULL) {
+        return QxErr;
+    }
+    tVtThread *t = (tVtThread *)thread;
+
+    pthread_mutex_lock(&vt_lock);
+    tVtThread *self = vt_self();
+    if (t->state != VT_DONE) {
+        self->joining = t;
+        self->state = VT_BLOCKED;
+        vt_switch(self);
+    }
+    pthread_mutex_unlock(&vt_lock);
+
+    return (pthread_join(t->tid, NULL) == 0) ? QxOK : QxErr;
+}
+
+tQxStatus QxOS_StartKernel(void)
+{
+    pthread_mutex_lock(&vt_lock);
+    vt_self();
+    pthread_mutex_unlock(&vt_lock);
+    return QxOK;
+}
+
+/*
+    Mutexes
+ */
+static tQxStatus vt_lock_mutex(tQxMutex *mutex, bool has_deadline, uint32_t millisec)
+{
+    if (mutex == NULL) {
+        return QxErr;
+    }
+    tVtMutex *m = (tVtMutex *)mutex;
+    tQxStatus status = QxOK;
+
+    pthread_mutex_lock(&vt_lock);
+    tVtThread *self = vt_self();
+    if (m->owner == NULL) {
+        m->owner = self;
+    } else if (has_deadline && millisec == 0) {
+        m->stats.timeouts++;
+        status = QxBusy;
+    } else {
+        uint64_t start = vt_now_us;
+        self->waiting = m;
+        self->waiting_seq = vt_wait_seq++;
+        self->timed_out = false;
+        self->has_deadline = has_deadline;
+        self->wake_us = vt_now_us + (uint64_t)millisec * 1000;
+        self->state = VT_BLOCKED;
+        vt_inherit(m->owner);
+        vt_switch(self);
+        /* ownership is handed over by QxOS_UnLockMutex(), vt_pick() counts timeouts */
+        status = self->timed_out ? QxBusy : QxOK;
+        if (status == QxOK) {
+            uint64_t waited = vt_now_us - start;
+            m->stats.contended++;
+            m->stats.max_wait_us = (waited > m->stats.max_wait_us) ? (uint32_t)waited : m->stats.max_wait_us;
+        }
+    }
+    if (status == QxOK) {
+        m->stats.locks++;
+        m->locked_us = vt_now_us;
+    }
+    m->mutex.isLocked = (m->owner != NULL) ? TRUE : FALSE;
+    pthread_mutex_unlock(&vt_lock);
+    return status;
+}
+
+tQxMutex* QxOS_CreateMutex(const char* name)
+{
+    tVtMutex *m = (tVtMutex *)calloc(1, sizeof(tVtMutex));
+    if (m == NULL) {
+        return NULL;
+    }
+    m->mutex.name = (char *)name;
+    m->mutex.isLocked = FALSE;
+    m->stats.name = name;
+
+    pthread_mutex_lock(&vt_lock);
+    m->next = vt_mutexes;
+    vt_mutexes = m;
+    pthread_mutex_unlock(&vt_lock);
+    return &m->mutex;
+}
+
+tQxStatus QxOS_LockMutex(tQxMutex* mutex)
+{
+    return vt_lock_mutex(mutex, false, 0);
+}
+
+tQxStatus QxOS_LockMutex_Wait(tQxMutex* mutex, uint32_t millisec)
+{
+    return vt_lock_mutex(mutex, true, millisec);
+}
+
+tQxStatus QxOS_UnLockMutex(tQxMutex* mutex)
+{
+    if (mutex == NULL) {
+        return QxErr;
+    }
+    tVtMutex *m = (tVtMutex *)mutex;
+
+    pthread_mutex_lock(&vt_lock);
+    tVtThread *self = vt_self();
+    if (m->owner != self) {
+        pthread_mutex_unlock(&vt_lock);
+        return QxErr;
+    }
+
+    uint64_t held = vt_now_us - m->locked_us;
+    m->stats.max_hold_us = (held > m->stats.max_hold_us) ? (uint32_t)held : m->stats.max_hold_us;
+
+    /* hand over to the highest priority waiter, first come first served among equals */
+    tVtThread *next = NULL;
+    for (tVtThread *t : vt_threads) {
+        if (t->state == VT_BLOCKED && t->waiting == m &&
+            (next == NULL || t->prio > next->prio ||
+             (t->prio == next->prio && t->waiting_seq < next->waiting_seq))) {
+            next = t;
+        }
+    }
+    m->owner = next;
+    if (next != NULL) {
+        next->waiting = NULL;
+        next->has_deadline = false;
+        next->state = VT_READY;
+        next->wake_us = vt_now_us;
+        vt_inherit(next);
+    }
+    vt_inherit(self);
+    m->mutex.isLocked = (next != NULL) ? TRUE : FALSE;
+    pthread_mutex_unlock(&vt_lock);
+    return QxOK;
+}
+
+tQxStatus QxOS_GetMutexStats(tQxMutex* mutex, tQxMutexStats* stats)
+{
+    if (mutex == NULL || stats == NULL) {
+        return QxErr;
+    }
+    pthread_mutex_lock(&vt_lock);
+    *stats = ((tVtMutex *)mutex)->stats;
+    pthread_mutex_unlock(&vt_lock);
+    return QxOK;
+}
+
+int QxOS_ListMutexStats(tQxMutexStats* stats, int max)
+{
+    int n = 0;
+    pthread_mutex_lock(&vt_lock);
+    for (tVtMutex *m = vt_mutexes; m != NULL && n < max; m = m->next) {
+        stats[n++] = m->stats;
+    }
+    pthread_mutex_unlock(&vt_lock);
+    return n;
+}
+
+/*
+    Semaphores
+ */
+tQxSemaphore* QxOS_CreateSemaphore(const char* name, uint32_t max_count, uint32_t initial_count)
+{
+    if (max_count == 0 || initial_count > max_count) {
+        return NULL;
+    }
+    tVtSemaphore *s = (tVtSemaphore *)calloc(1, sizeof(tVtSemaphore));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->sem.name = (char *)name;
+    s->count = initial_count;
+    s->max = max_count;
+    return &s->sem;
+}
+
+tQxStatus QxOS_WaitSemaphore(tQxSemaphore* sem, uint32_t millisec)
+{
+    if (sem == NULL) {
+        return QxErr;
+    }
+    tVtSemaphore *s = (tVtSemaphore *)sem;
+    tQxStatus status = QxOK;
+
+    pthread_mutex_lock(&vt_lock);
+    tVtThread *self = vt_self();
+    if (s->count > 0) {
+        s->count--;
+    } else if (millisec == 0) {
+        status = QxBusy;
+    } else {
+        self->waiting_sem = s;
+        self->waiting_seq = vt_wait_seq++;
+        self->timed_out = false;
+        self->has_deadline = millisec != QX_WAIT_FOREVER;
+        self->wake_us = vt_now_us + (uint64_t)millisec * 1000;
+        self->state = VT_BLOCKED;
+        vt_switch(self);
+        /* the count is handed over by QxOS_ReleaseSemaphore() */
+        status = self->timed_out ? QxBusy : QxOK;
+    }
+    pthread_mutex_unlock(&vt_lock);
+    QxOS_Posix_DrainStreams();
+    return status;
+}
+
+tQxStatus QxOS_ReleaseSemaphore(tQxSemaphore* sem)
+{
+    if (sem == NULL) {
+        return QxErr;
+    }
+    tVtSemaphore *s = (tVtSemaphore *)sem;
+    tQxStatus status = QxOK;
+
+    pthread_mutex_lock(&vt_lock);
+    vt_self();
+    tVtThread *next = NULL;
+    for (tVtThread *t : vt_threads) {
+        if (t->state == VT_BLOCKED && t->waiting_sem == s &&
+            (next == NULL || t->prio > next->prio ||
+             (t->prio == next->prio && t->waiting_seq < next->waiting_seq))) {
+            next = t;
+        }
+    }
+    if (next != NULL) {
+        next->waiting_sem = NULL;
+        next->has_deadline = false;
+        next->state = VT_READY;
+        next->wake_us = vt_now_us;
+    } else if (s->count < s->max) {
+        s->count++;
+    } else {
+        status = QxBusy;
+    }
+    pthread_mutex_unlock(&vt_lock);
+    return status;
+}
+
+/*
+    Time
+ */
+tQxStatus QxOS_Delay(uint32_t msec)
+{
+    pthread_mutex_lock(&vt_lock);
+    tVtThread *self = vt_self();
+    self->state = VT_SLEEPING;
+    self->wake_us = vt_now_us + (uint64_t)msec * 1000;
+    vt_switch(self);
+    pthread_mutex_unlock(&vt_lock);
+    QxOS_Posix_DrainStreams();
+    return QxOK;
+}
+
+uint32_t QxOS_GetTick()
+{
+    return (uint32_t)(QxOS_GetTimeUs() / 1000);
+}
+
+uint64_t QxOS_GetTimeUs(void)
+{
+    pthread_mutex_lock(&vt_lock);
+    vt_self();
+    vt_charge_time();
+    clock_gettime(CLOCK_MONOTONIC, &vt_resumed);
+    uint64_t now = vt_now_us;
+    pthread_mutex_unlock(&vt_lock);
+    return now;
+}
+
+/* cycles are virtual nanoseconds, so cycle latencies replay like tick latencies */
+uint32_t QxOS_GetCycles(void)
+{
+    return (uint32_t)(QxOS_GetTimeUs() * 1000);
+}
+
+uint32_t QxOS_GetCycleHz(void)
+{
+    return 1000000000u;
+}
+
+/*
+    CPU statistics
+ */
+/* exact: threads run only while charged (QXOS_VT_CHARGE), idle is the time the clock jumped */
+int QxOS_GetThreadCpu(tQxThreadCpu *threads, int max)
+{
+    pthread_mutex_lock(&vt_lock);
+    vt_self();
+    vt_charge_time();
+    clock_gettime(CLOCK_MONOTONIC, &vt_resumed);
+
+    int n = 0;
+    for (tVtThread *t : vt_threads) {
+        if (n == max - 1) {
+            break;
+        }
+        threads[n].name = t->thread.name;
+        threads[n].id = (uintptr_t)t;
+        threads[n].runtime_us = t->run_us;
+        threads[n].switches = t->switches;
+        threads[n].idle = FALSE;
+        n++;
+    }
+    if (n < max) {
+        threads[n].name = "idle";
+        threads[n].id = 0;
+        threads[n].runtime_us = vt_idle_us;
+        threads[n].switches = 0;
+        threads[n].idle = TRUE;
+        n++;
+    }
+    pthread_mutex_unlock(&vt_lock);
+    return n;
+}
+
+#endif /* QXOS_VIRTUAL_TIME */
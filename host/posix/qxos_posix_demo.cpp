@@ -0,0 +1,355 @@
+/**
+  ******************************************************************************
+  * @file    qxos_posix_demo.cpp
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Sensor and classify loops of the sketch on the POSIX QxOS backend.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+/*
+    Built and run by "./automl-build.sh --posix". The two loops have the
+    shape of QxAutoMLInf::FillDataLoop() and the sketch loop(): a sensor
+    thread reads a simulated accelerometer every 10 ms through
+    QxOS_SensorReadReg() into a frame guarded by a QxOS mutex, and the main
+    thread classifies the frame every 100 ms. Results go to stdout and,
+    through QxOS_StreamDataOutAsync(), to the USB stream device
+    (QXOS_STREAM_USB); bytes arriving on any bound device are counted. Good for perf, -fsanitize=thread and scheduler experiments.
+
+    Input is also parsed as commands (inc/QxCommand.h): APK_CMD_STOP pauses
+    the classification and APK_CMD_START_INFERENCE resumes it, e.g.
+
+        (sleep 1; printf '\x05\x00'; sleep 1; printf '\x04\x00') | QXOS_STREAM_USB=fd:1,0 ./automl-build.sh -p 3
+
+    With QX_EXECUTOR=1 both loops are timers of a QxOS executor
+    (inc/QxExecutor.h) that runs on the main thread.
+
+    With QX_LOG_DEFERRED=1 the per-round debug line is a deferred log record
+    sent to the USB stream, to try tools/debuglog.py --elf on the host:
+
+        QX_LOG_DEFERRED=1 QXOS_STREAM_USB=file:usb.bin ./automl-build.sh -p
+        python3 tools/debuglog.py --elf output/host/qxos_posix_demo --file usb.bin
+
+    With QX_USB_FRAMED=1 the USB stream is framed (inc/QxFrame.h): the
+    predictions go out as text and result frames, the samples as data
+    collection packets and the CPU report as a statistics frame, next to
+    the log records of QX_LOG_DEFERRED=1:
+
+        QX_USB_FRAMED=1 QX_LOG_DEFERRED=1 QXOS_STREAM_USB=file:usb.bin ./automl-build.sh -p
+        python3 tools/qxcapture.py --raw usb.bin --elf output/host/qxos_posix_demo
+ */
+
+#include <math.h>
+#include <atomic>
+
+#include "QxOS_Posix.h"
+#include "QxBTHal.h"
+#include "QxCommand.h"
+#include "QxCpuStats.h"
+#include "QxDataCollect.h"
+#include "QxExecutor.h"
+#include "QxFrame.h"
+#include "QxLog.h"
+#include "QxStack.h"
+#include "QxStreamAsync.h"
+
+#define DEMO_SENSOR_ADDR    0x6B
+#define DEMO_FRAME_SAMPLES  100
+#define DEMO_FILL_INTERVAL  10  //ms
+#define DEMO_CLASSIFY_INTERVAL 100 //ms
+
+static tQxMutex *frame_mutex;
+static int16_t frame[DEMO_FRAME_SAMPLES];
+static uint32_t frame_count;
+static std::atomic<bool> running(true);
+static std::atomic<uint32_t> bytes_in(0);
+static std::atomic<bool> classifying(true);
+
+#ifdef QX_USB_FRAMED
+/* Samples of the sensor thread as data collection packets, the axis as ax and the rest zero */
+#define DEMO_DC_SAMPLES 20
+static uint8_t dc_packet[QX_DC_HEADER + DEMO_DC_SAMPLES * QX_DC_SAMPLE_SIZE];
+static uint8_t dc_count;
+static uint16_t dc_seq;
+
+static void demo_frame_sample(const uint8_t *raw)
+{
+    if (dc_count == 0) {
+        memset(dc_packet, 0, sizeof(dc_packet));
+        dc_packet[0] = DEV_RPL_DC_INST;
+        dc_packet[2] = (uint8_t)dc_seq;
+        dc_packet[3] = (uint8_t)(dc_seq >> 8);
+    }
+    memcpy(&dc_packet[QX_DC_HEADER + dc_count * QX_DC_SAMPLE_SIZE], raw, 2);
+    if (++dc_count == DEMO_DC_SAMPLES) {
+        dc_packet[1] = dc_count;
+        QxFrame_Send(QxFrameSensor, dc_packet, sizeof(dc_packet));
+        dc_count = 0;
+        dc_seq++;
+    }
+}
+#endif
+
+/* An accelerometer axis swinging at 2 Hz, read as little endian int16 */
+static tQxStatus demo_sensor_read(uint8_t slave_addr, uint8_t reg, uint8_t *data, uint16_t len, void *userdata)
+{
+    (void)reg;
+    (void)userdata;
+    if (slave_addr != DEMO_SENSOR_ADDR || len != 2) {
+        return QxDeviceErr;
+    }
+    int16_t v = (int16_t)(4096.0f * sinf(2.0f * 3.14159265f * 2.0f * QxOS_GetTick() / 1000.0f));
+    memcpy(data, &v, sizeof(v));
+    return QxOK;
+}
+
+static void demo_stream_in(tQxStreamDevice device_type, const uint8_t* data, uint16_t length, void *userdata)
+{
+    (void)device_type;
+    (void)data;
+    (void)userdata;
+    bytes_in += length;
+}
+
+static void demo_command(const tQxCommandFrame *cmd, void *userdata)
+{
+    (void)userdata;
+    classifying = (cmd->cmd == APK_CMD_START_INFERENCE);
+    QxOS_DebugPrint("command 0x%x from device %u, classification %s", cmd->cmd, cmd->device,
+                    classifying ? "on" : "paused");
+}
+
+/*
+    A truncated frame must not hold up the frames after it: over BT the end
+    of a write gives it up, on a byte stream a pause of QX_CMD_TIMEOUT. Runs
+    before QxCommand_Init(), so QxCommand_Run() may run the handlers here.
+ */
+static bool demo_command_selftest(void)
+{
+    static const uint8_t truncated[12] = { APK_CMD_STOP, QX_CMD_PAYLOAD_MAX, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    static const uint8_t start[2] = { APK_CMD_START_INFERENCE, 0 };
+    tQxCommandStats before, after;
+
+    QxCommand_GetStats(&before);
+    QxCommand_Input(QxStreamDeviceBT, truncated, sizeof(truncated), NULL);
+    QxCommand_Input(QxStreamDeviceBT, start, sizeof(start), NULL);
+    QxCommand_Input(QxStreamDeviceUSB, truncated, sizeof(truncated), NULL);
+    QxOS_Delay(QX_CMD_TIMEOUT + 1);
+    QxCommand_Input(QxStreamDeviceUSB, start, sizeof(start), NULL);
+    QxCommand_Run();
+    QxCommand_GetStats(&after);
+
+    bool ok = (after.handled - before.handled == 2) && (after.errors - before.errors == 2 * sizeof(truncated)) &&
+              classifying;
+    QxOS_DebugPrint("command self-test: %s, %u handled, %u bytes of truncated frames skipped", ok ? "ok" : "FAILED",
+                    (unsigned)(after.handled - before.handled), (unsigned)(after.errors - before.errors));
+    return ok;
+}
+
+static void demo_fill_frame(void *arg)
+{
+    (void)arg;
+    uint8_t raw[2];
+
+    if (QxOS_SensorReadReg(DEMO_SENSOR_ADDR, 0x28, raw, sizeof(raw)) == QxOK) {
+        QxOS_LockMutex(frame_mutex);
+        memmove(frame, frame + 1, sizeof(frame) - sizeof(frame[0]));
+        memcpy(&frame[DEMO_FRAME_SAMPLES - 1], raw, sizeof(raw));
+        frame_count++;
+        QxOS_UnLockMutex(frame_mutex);
+#ifdef QX_USB_FRAMED
+        demo_frame_sample(raw);
+#endif
+    }
+}
+
+#ifndef QX_EXECUTOR
+static void demo_fill_loop(const void *userdata)
+{
+    (void)userdata;
+    while (running) {
+        uint32_t tick = QxOS_GetTick();
+
+        demo_fill_frame(NULL);
+
+        uint32_t diff = QxOS_GetTick() - tick;
+        if (diff < DEMO_FILL_INTERVAL) {
+            QxOS_Delay(DEMO_FILL_INTERVAL - diff);
+        }
+    }
+}
+
+/* host frames are larger than on the M4, the stack has room for printf and the libc */
+QX_STATIC_THREAD(fill_thread, "sensor_read", 65536);
+#endif
+
+static uint32_t rounds, worst, last_loop;
+
+static void demo_classify(void *arg)
+{
+    (void)arg;
+#ifdef QXOS_VIRTUAL_TIME
+    /* stream reader threads are not scheduled on the virtual clock, the queue is polled here */
+    QxCommand_Run();
+#endif
+    if (!classifying) {
+        return;
+    }
+    uint64_t loop_start = QxOS_GetTimeUs();
+
+    QxOS_LockMutex(frame_mutex);
+    float energy = 0.0f;
+    for (int i = 0; i < DEMO_FRAME_SAMPLES; i++) {
+        energy += (float)frame[i] * frame[i];
+    }
+    uint32_t samples = frame_count;
+    QxOS_UnLockMutex(frame_mutex);
+
+    int cls = sqrtf(energy / DEMO_FRAME_SAMPLES) > 2048.0f;
+    char text[64];
+    int len = snprintf(text, sizeof(text), "PRED: %d, samples %u\n", cls, (unsigned)samples);
+    QxOS_ClassifyPrint("%s", text);
+#ifdef QX_USB_FRAMED
+    tQxBTResult result;
+    float p = sqrtf(energy / DEMO_FRAME_SAMPLES) / 4096.0f;
+    result.seq = (uint16_t)rounds;
+    result.time_ms = QxOS_GetTick();
+    result.cls = (uint8_t)cls;
+    result.count = 2;
+    result.probs[1] = (uint8_t)((p > 1.0f ? 1.0f : p) * 255.0f + 0.5f);
+    result.probs[0] = (uint8_t)(255 - result.probs[1]);
+    QxFrame_Send(QxFrameResult, &result, QX_BT_RESULT_HEADER + result.count);
+    QxFrame_Send(QxFrameText, text, (uint16_t)len);
+#else
+    QxOS_StreamDataOutAsync(QxStreamDeviceUSB, text, (uint16_t)len);
+#endif
+    rounds++;
+
+    last_loop = (uint32_t)(QxOS_GetTimeUs() - loop_start);
+    worst = (last_loop > worst) ? last_loop : worst;
+    QX_DEBUG_PRINT("round %u: rms %.1f, loop %lu us\n", (unsigned)rounds, sqrtf(energy / DEMO_FRAME_SAMPLES),
+                   (unsigned long)last_loop);
+#ifdef QX_LOG_DEFERRED
+    QxLog_Flush();
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = (argc > 1) ? (uint32_t)atoi(argv[1]) : 2;
+
+    if (QxOS_InitializeBSP() != QxOK) {
+        return 1;
+    }
+    QxOS_Posix_SetSensorHandler(demo_sensor_read, NULL, NULL);
+    QxOS_RegisterStreamDataInCallback(demo_stream_in, NULL);
+    frame_mutex = QxOS_CreateMutex("frame");
+
+    QxOS_StartKernel();
+    QxOS_StreamAsyncStart(QxStreamDeviceUSB, 4096, 512, 20, QxPriorityBelowNormal);
+#ifdef QX_USB_FRAMED
+    QxFrame_Init(QxStreamDeviceUSB);
+#endif
+#ifdef QX_LOG_DEFERRED
+    QxLog_Init(QxStreamDeviceUSB, 0);
+#endif
+
+    QxOS_CpuStatsSample();
+
+    QxCommand_Register(APK_CMD_START_INFERENCE, demo_command, NULL);
+    QxCommand_Register(APK_CMD_STOP, demo_command, NULL);
+    if (!demo_command_selftest()) {
+        return 1;
+    }
+#ifdef QXOS_VIRTUAL_TIME
+    QxCommand_Init(NULL, QxPriorityNormal);
+#else
+    /* command handlers run on a low priority thread of their own */
+    tQxExecutor *commands = QxOS_CreateExecutor("command");
+    QxCommand_Init(commands, QxPriorityNormal);
+    tQxThread *command_thread = QxOS_ExecutorStart(commands, QxPriorityLow, 1024);
+#endif
+
+#ifdef QX_EXECUTOR
+    /* both loops as timers of one executor on the main thread, no sensor thread */
+    static tQxTimer fill_timer = QX_TIMER_INIT(demo_fill_frame, NULL, QxPriorityHigh);
+    static tQxTimer classify_timer = QX_TIMER_INIT(demo_classify, NULL, QxPriorityNormal);
+    /* static like the timers, so it stays reachable for the leak checker after the run */
+    static tQxExecutor *executor = QxOS_CreateExecutor("demo");
+    QxOS_ExecutorTimerStart(executor, &fill_timer, 0, DEMO_FILL_INTERVAL);
+    QxOS_ExecutorTimerStart(executor, &classify_timer, 0, DEMO_CLASSIFY_INTERVAL);
+    QxOS_ExecutorRun(executor, seconds * 1000);
+    QxOS_CpuReport(QxStreamDeviceNone);
+
+    tQxExecutorStats exec;
+    QxOS_ExecutorGetStats(executor, &exec);
+    QxOS_DebugPrint("executor: %u runs, %u coalesced, %u overruns, latency %u us, longest run %u us (%s)",
+                    (unsigned)exec.runs, (unsigned)exec.coalesced, (unsigned)exec.overruns,
+                    (unsigned)exec.max_latency_us, (unsigned)exec.max_run_us,
+                    (exec.max_run_func == demo_classify) ? "classify" : "fill");
+#else
+    tQxThread *fill = QxOS_CreateStaticThread(&fill_thread, demo_fill_loop, QxPriorityHigh, NULL);
+    uint32_t start = QxOS_GetTick();
+    while (QxOS_GetTick() - start < seconds * 1000) {
+        demo_classify(NULL);
+        if (last_loop < QxOS_MsToUs(DEMO_CLASSIFY_INTERVAL)) {
+            QxOS_Delay(QxOS_UsToMs(QxOS_MsToUs(DEMO_CLASSIFY_INTERVAL) - last_loop));
+        }
+    }
+
+    /* while the sensor thread still counts */
+    QxOS_CpuReport(QxStreamDeviceNone);
+    running = false;
+    QxOS_Posix_JoinThread(fill);
+#endif
+#ifndef QXOS_VIRTUAL_TIME
+    QxOS_ExecutorStop(commands);
+    QxOS_Posix_JoinThread(command_thread);
+#endif
+#ifdef QX_USB_FRAMED
+    /* the CPU report once more, as a statistics frame */
+    QxOS_CpuReport(QxStreamDeviceUSB);
+#ifdef QX_LOG_DEFERRED
+    QxLog_Flush();
+#endif
+#endif
+    tQxStreamAsyncStats usb;
+    QxOS_FlushDataOutAsync(QxStreamDeviceUSB, 1000);
+    QxOS_StreamAsyncGetStats(QxStreamDeviceUSB, &usb);
+    QxOS_Posix_CloseStreams();
+    QxOS_DebugPrint("%u classifications, %u samples, worst loop %u us, %u bytes in\n",
+                    (unsigned)rounds, (unsigned)frame_count, (unsigned)worst, (unsigned)bytes_in.load());
+    tQxCommandStats cmds;
+    QxCommand_GetStats(&cmds);
+    QxOS_DebugPrint("commands: %u frames, %u handled, %u unhandled, %u dropped, %u bytes skipped",
+                    (unsigned)cmds.frames, (unsigned)cmds.handled, (unsigned)cmds.unhandled,
+                    (unsigned)cmds.dropped, (unsigned)cmds.errors);
+    QxOS_DebugPrint("usb: %u bytes queued in %u writes, %u dropped, %u lost\n",
+                    (unsigned)usb.queued, (unsigned)usb.writes, (unsigned)usb.dropped, (unsigned)usb.lost);
+#ifdef QX_USB_FRAMED
+    tQxFrameStats frames;
+    QxFrame_GetStats(&frames);
+    QxOS_DebugPrint("frames: %u log, %u text, %u result, %u sensor, %u stats, %u bytes, %u dropped",
+                    (unsigned)frames.frames[QxFrameLog], (unsigned)frames.frames[QxFrameText],
+                    (unsigned)frames.frames[QxFrameResult], (unsigned)frames.frames[QxFrameSensor],
+                    (unsigned)frames.frames[QxFrameStats], (unsigned)frames.bytes, (unsigned)frames.dropped);
+#endif
+    QxOS_MemoryReport();
+    return 0;
+}
@@ -28,7 +28,7 @@
 #ifndef MIDDLEWARES_QEEXO_INCLUDE_QXBTHAL_H_
 #define MIDDLEWARES_QEEXO_INCLUDE_QXBTHAL_H_
 
-#include "QxTypeDefs.h"
+#include "QxOS.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -63,6 +63,164 @@ typedef enum {
     DEV_RPL_DISCONNECTED = 0x1E,
     DEV_RPL_ERR = 0x1F,
 } e_apk_cmd_bits_tx;
+
+/* Probabilities in a result, 8 header bytes + 12 fit the 20 bytes of a notification at the minimal ATT MTU of 23 */
+#ifndef QX_BT_RESULT_CLASSES
+#define QX_BT_RESULT_CLASSES 12
+#endif
+
+/*
+    Value of the result characteristic, little endian and without padding:
+
+        offset  size   field
+        0       2      seq      counts the results, wraps at 65536
+        2       4      time_ms  QxOS_GetTick() of the classification
+        6       1      cls      class id QXO_MLEngine_Work() returned
+        7       1      count    number of probabilities that follow
+        8       count  probs    probability of class i as round(p * 255)
+
+    A notification carries only the 8 + count bytes in use. tools/qxresult.py
+    decodes it; a gap in seq means notifications were lost.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t    seq;                            /*!< Sequence number of the result */
+    uint32_t    time_ms;                        /*!< Time of the classification in ms */
+    uint8_t     cls;                            /*!< Class id of the result */
+    uint8_t     count;                          /*!< Valid entries of probs */
+    uint8_t     probs[QX_BT_RESULT_CLASSES];    /*!< Probabilities quantized to 0..255 */
+} tQxBTResult;
+
+#define QX_BT_RESULT_HEADER 8
+
+/* Default connection profile: the largest MTU and LL payload of Bluetooth 4.2, one notification of 244 bytes per LL packet */
+#ifndef QX_BT_MAX_MTU
+#define QX_BT_MAX_MTU 247
+#endif
+#ifndef QX_BT_DATA_LENGTH
+#define QX_BT_DATA_LENGTH 251
+#endif
+
+/* What the device negotiates on every connection, both limited by the controller */
+typedef struct {
+    uint16_t    max_mtu;        /*!< Largest ATT MTU, the device exchanges it on connect when above 23 */
+    uint16_t    data_length;    /*!< LL payload in octets asked for on connect when above 27, at most 251 */
+} tQxBTConnProfile;
+
+/* The link of the current connection, counters since it was established */
+typedef struct {
+    uint16_t    mtu;            /*!< ATT MTU after the exchange, 23 without */
+    uint16_t    tx_octets;      /*!< LL payload to the central */
+    uint16_t    tx_time_us;     /*!< Air time of the longest LL packet to the central */
+    uint16_t    rx_octets;      /*!< LL payload from the central */
+    uint16_t    rx_time_us;     /*!< Air time of the longest LL packet from the central */
+    uint16_t    interval;       /*!< Connection interval in 1.25 ms */
+    uint16_t    latency;        /*!< Connection events the device may skip */
+    uint16_t    timeout;        /*!< Supervision timeout in 10 ms */
+    uint8_t     tx_phy;         /*!< PHY to the central, 1: 1M, 2: 2M, 3: Coded */
+    uint8_t     rx_phy;         /*!< PHY from the central */
+    uint32_t    connected_ms;   /*!< Time since the connection */
+    uint32_t    notifications;  /*!< Notifications handed to the controller */
+    uint32_t    notified_bytes; /*!< Their payload bytes */
+} tQxBTLinkStats;
+
+/* Notifications QxBTHal_Write() and QxBTHal_WriteResult() queue for the BLE thread, a power of two */
+#ifndef QX_BT_TX_QUEUE
+#define QX_BT_TX_QUEUE 8
+#endif
+
+/* LE_PSM of the L2CAP credit based channel the central may open, 0x0080 to 0x00FF */
+#ifndef QX_BT_COC_PSM
+#define QX_BT_COC_PSM 0x0080
+#endif
+
+/* What a full notification queue gives up, see QxBTHal_SetTxPolicy() */
+typedef enum {
+    QxBTDropNewest = 0,         /*!< The new notification is refused */
+    QxBTDropOldest,             /*!< The oldest queued notification makes room for the new one */
+} tQxBTDropPolicy;
+
+/* Counters of the notification queue since start up */
+typedef struct {
+    uint32_t    queued;         /*!< Notifications accepted */
+    uint32_t    sent;           /*!< Handed to the controller */
+    uint32_t    dropped;        /*!< Refused, or removed for a newer one, because the queue was full */
+    uint32_t    discarded;      /*!< Taken from the queue without a subscribed central */
+    uint16_t    depth;          /*!< Notifications queued now */
+    uint16_t    max_depth;      /*!< Most notifications queued at once */
+} tQxBTTxStats;
+
+/* PHY masks of tQxBTLinkParams */
+#define QX_BT_PHY_1M    0x01
+#define QX_BT_PHY_2M    0x02
+
+/* Connection parameters the device asks the central for, see QxBTHal_SetLinkParams() */
+typedef struct {
+    uint16_t    min_interval;   /*!< Shortest connection interval in 1.25 ms, 6 to 3200 */
+    uint16_t    max_interval;   /*!< Longest connection interval in 1.25 ms */
+    uint16_t    latency;        /*!< Connection events the device may skip without data to send */
+    uint16_t    timeout;        /*!< Supervision timeout in 10 ms, above (1 + latency) * max_interval * 2 */
+    uint8_t     phys;           /*!< PHYs the device prefers, QX_BT_PHY_1M and QX_BT_PHY_2M */
+} tQxBTLinkParams;
+
+/* Company identifier of the broadcast result, 0xFFFF is reserved for tests; use the one assigned to a product */
+#ifndef QX_BT_COMPANY_ID
+#define QX_BT_COMPANY_ID 0xFFFF
+#endif
+
+/* Change of the confidence, out of 255, that refreshes the broadcast result without a new class */
+#ifndef QX_BT_BROADCAST_STEP
+#define QX_BT_BROADCAST_STEP 13
+#endif
+
+/*
+    Manufacturer specific data of the advertising packets with the broadcast
+    on, see QxBTHal_SetBroadcast(). It follows the flags and the service UUID,
+    29 of the 31 bytes. seq counts the updates of the advertising data, not
+    the results: a scanner sees each update many times and keeps one per seq.
+    tools/qxresult.py --broadcast decodes it.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t    company;        /*!< QX_BT_COMPANY_ID */
+    uint16_t    seq;            /*!< Counts the updates, wraps at 65536 */
+    uint8_t     cls;            /*!< Class id of the latest result, 0xFF before the first */
+    uint8_t     confidence;     /*!< Probability of that class as round(p * 255) */
+} tQxBTBroadcast;
+
+/* Interval of the periodic advertising of tQxBTBroadcastExt in 1.25 ms, 0 without; 800 is one second */
+#ifndef QX_BT_PERIODIC_INTERVAL
+#define QX_BT_PERIODIC_INTERVAL 0
+#endif
+
+/*
+    Manufacturer specific data of the extended advertising set, and of its
+    periodic advertising, when the controller supports BLE 5 advertising and
+    QxBTHal_SetBroadcast() came before QxBTHal_Initialize(). Next to the
+    update of tQxBTBroadcast it carries the latest result with all its
+    probabilities and a few health counters, 8 + count bytes of result sent.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t    company;        /*!< QX_BT_COMPANY_ID */
+    uint16_t    seq;            /*!< The seq of tQxBTBroadcast */
+    uint32_t    uptime_s;       /*!< Time since start up in s */
+    uint32_t    dropped;        /*!< Notifications the full queue dropped, see tQxBTTxStats */
+    uint8_t     connected;      /*!< 1 while a central is connected */
+    tQxBTResult result;         /*!< The latest result, cls 0xFF and count 0 before the first */
+} tQxBTBroadcastExt;
+
+/* Named links, see QxBTHal_SetLinkProfile() */
+typedef enum {
+    QxBTLinkStreaming = 0,      /*!< 7.5 to 15 ms on 2M, for data collection */
+    QxBTLinkInteractive,        /*!< 15 to 30 ms on 1M, quick answers to commands */
+    QxBTLinkLowPower,           /*!< 200 to 250 ms on 1M skipping 4 events, for results now and then */
+    QxBTLinkProfileNum,
+} tQxBTLinkProfile;
+
+/**
+ * @brief Set the connection profile QxBTHal_Initialize() applies, QX_BT_MAX_MTU and QX_BT_DATA_LENGTH without a call.
+ * @param[in] *profile The profile, a max_mtu of 23 and data_length of 27 keep the Bluetooth 4.0 link.
+ * @note Call it before QxBTHal_Initialize().
+ */
+void QxBTHal_SetConnProfile(const tQxBTConnProfile *profile);
 /**    
  * @brief Initialize BT device
  * @return tQxStatus : Status of initializing BT device.
@@ -74,9 +232,111 @@ tQxStatus QxBTHal_Initialize();
  * @param[in] *buf the data pointer to transfer.
  * @param[in] length The data size to transfer.
  * @return int : Return how many bytes has been transferred.
+ * @note The text up to its terminating zero, at most 125 bytes, is queued and notified by the BLE thread; it never blocks.
  */
 void QxBTHal_Write(char *buf, int length);
 
+/**
+ * @brief Notify a classification result on the binary result characteristic, see tQxBTResult.
+ * @param[in] cls The class id of the result.
+ * @param[in] *probs The probabilities of the classes, NULL sends none.
+ * @param[in] num_classes The number of probabilities, only the first QX_BT_RESULT_CLASSES are sent.
+ * @return tQxStatus : QxOK when queued, QxErr when no central is connected, QxBusy when the full queue dropped it.
+ * @note Never blocks, the BLE thread notifies it as soon as the controller has a buffer. With the broadcast on,
+ *       the result also reaches the advertising data, connected or not. A framed USB stream (inc/QxFrame.h)
+ *       gets it on the result channel.
+ */
+tQxStatus QxBTHal_WriteResult(uint8_t cls, const float *probs, int num_classes);
+
+/**
+ * @brief Choose what a full notification queue drops, QxBTDropNewest until called.
+ * @param[in] policy The drop policy.
+ */
+void QxBTHal_SetTxPolicy(tQxBTDropPolicy policy);
+
+/**
+ * @brief Get the counters and depth of the notification queue.
+ * @param[out] *stats The counters.
+ */
+void QxBTHal_GetTxStats(tQxBTTxStats *stats);
+
+/**
+ * @brief Start the thread that polls BLE, writes of the central to the RX characteristic then reach the stream data input callbacks as QxStreamDeviceBT.
+ * @param[in] prio The priority of the thread, below the sensor reads.
+ * @return tQxStatus : Status of creating the thread.
+ * @note Call it after QxBTHal_Initialize() and the last BLE.poll() of the sketch.
+ */
+tQxStatus QxBTHal_StartReceive(tQxPriority prio);
+
+/**
+ * @brief Get the ATT MTU of the connection, a notification carries MTU - 3 bytes.
+ * @return uint16_t : The MTU, 23 without connection.
+ */
+uint16_t QxBTHal_GetMtu();
+
+/**
+ * @brief Tell whether the central opened the L2CAP channel on QX_BT_COC_PSM.
+ * @return bool : true while the channel is open.
+ */
+bool QxBTHal_ChannelOpen();
+
+/**
+ * @brief Send one SDU on the L2CAP channel without waiting for the radio, the BLE thread segments it as credits allow.
+ * @param[in] *data The SDU.
+ * @param[in] length The SDU size, at most the MTU the central gave for the channel.
+ * @return int : length when taken, 0 when the previous SDU is still being sent or no channel is open.
+ */
+int QxBTHal_ChannelWrite(const void *data, uint16_t length);
+
+/**
+ * @brief Get the most bytes one data collection packet may take: the SDU size of an open channel, else MTU - 3.
+ * @return uint16_t : The payload size in bytes.
+ */
+uint16_t QxBTHal_GetStreamPayload();
+
+/**
+ * @brief Ask the central for connection parameters and a PHY, as the peripheral it decides.
+ * @param[in] *params The parameters, a phys of 0 keeps the PHY.
+ * @return tQxStatus : QxOK when the requests were sent, QxErr when no central is connected or the controller refused.
+ * @note The central answers later, QxBTHal_GetLinkStats() shows what it chose.
+ */
+tQxStatus QxBTHal_SetLinkParams(const tQxBTLinkParams *params);
+
+/**
+ * @brief Switch the link to one of the named profiles with QxBTHal_SetLinkParams(), once per change.
+ * @param[in] profile The profile.
+ * @return tQxStatus : QxOK when requested or already in use, QxErr otherwise.
+ */
+tQxStatus QxBTHal_SetLinkProfile(tQxBTLinkProfile profile);
+
+/**
+ * @brief Get the negotiated link and the notification counters of the connection.
+ * @param[out] *stats The link of the connection.
+ * @return tQxStatus : QxOK, QxErr when no central is connected.
+ */
+tQxStatus QxBTHal_GetLinkStats(tQxBTLinkStats *stats);
+
+/**
+ * @brief Print the negotiated link and the notification throughput since the previous report with QxOS_DebugPrint().
+ */
+void QxBTHal_LinkReport();
+
+/**
+ * @brief Broadcast the latest result in the advertising data, for scanners that do not connect.
+ * @param[in] enable true to add tQxBTBroadcast to the advertising data, false to remove it.
+ * @return tQxStatus : QxOK, QxErr when the controller refused the advertising data.
+ * @note QxBTHal_WriteResult() updates it when the class changes or the confidence moves by QX_BT_BROADCAST_STEP.
+ *       Called before QxBTHal_Initialize(), a BLE 5 controller also advertises tQxBTBroadcastExt in an extended
+ *       set, which keeps running while a central is connected. Otherwise the legacy advertising goes on
+ *       non-connectable while a central is connected, and connectable again after it disconnected.
+ */
+tQxStatus QxBTHal_SetBroadcast(bool enable);
+
+/**
+ * @brief Disconnect the central.
+ */
+void QxBTHal_Disconnect();
+
 bool QxBTHal_Connected();
 
 #ifdef __cplusplus
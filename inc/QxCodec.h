@@ -0,0 +1,161 @@
+/**
+  ******************************************************************************
+  * @file    QxCodec.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the sample codecs for streamed IMU and PCM data.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXCODEC_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXCODEC_H_
+
+#include "QxTypeDefs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Lossless and lossy codecs for sample streams, without allocation and
+ * without tables beyond the 89 ADPCM step sizes.
+ *
+ * IMU samples are interleaved int16 channels (ax, ay, az, gx, gy, gz).
+ * Consecutive samples of a channel differ little, so every codec sends the
+ * difference to the previous sample of the channel, modulo 2^16 so that it
+ * always fits 16 bits, zigzag mapped (0, -1, 1, -2, ... to 0, 1, 2, 3, ...)
+ * so small negative differences become small numbers:
+ *
+ * - delta varint: every difference as a LEB128 varint, 1 byte below 64,
+ *   2 below 8192, at most 3. Samples can be encoded one at a time, so a
+ *   packet is filled until the worst case no longer fits.
+ * - delta pack: a block of samples; per channel the first sample (int16) and
+ *   the bit width of its largest difference (uint8), then the differences
+ *   of all channels, channel after channel, in a bit stream filled from the
+ *   least significant bit. Smaller than varint for quiet signals.
+ *
+ * PCM uses IMA ADPCM, 4 bits per sample: a block starts with the predictor
+ * (int16) and step index (uint8) of the encoder, then two samples per byte,
+ * the first in the low nibble. Every block decodes on its own, so a lost
+ * packet costs only its samples.
+ *
+ * All multi-byte fields are little endian. tools/qxcodec.py decodes every
+ * format; ratio and cycles per sample are reported by
+ * host/bench/codec_bench.cpp, see "./automl-build.sh --bench".
+*/
+
+#define QX_CODEC_CHANNELS_MAX   8
+
+/* Largest encodings, for output buffers */
+#define QX_CODEC_VARINT_MAX(samples, channels)  ((samples) * (channels) * 3)
+#define QX_CODEC_PACK_MAX(samples, channels)    ((channels) * 3 + ((samples) * (channels) * 16 + 7) / 8)
+#define QX_CODEC_ADPCM_MAX(samples)             (3 + ((samples) + 1) / 2)
+
+/**
+ * Previous sample of every channel of a delta varint stream.
+*/
+typedef struct {
+	int16_t prev[QX_CODEC_CHANNELS_MAX];    /*!< last sample of each channel */
+} tQxDeltaState;
+
+/**
+ * State of an IMA ADPCM encoder.
+*/
+typedef struct {
+	int16_t predictor;      /*!< last reconstructed sample */
+	uint8_t index;          /*!< step size index, 0 .. 88 */
+} tQxAdpcmState;
+
+/**
+ * @brief Start a delta varint stream, the first sample is sent against zero.
+ * @param[out] *state The state to clear.
+ */
+void QxCodec_DeltaReset(tQxDeltaState *state);
+
+/**
+ * @brief Encode samples as delta varints.
+ * @param[in,out] *state The previous samples, updated.
+ * @param[in] *samples count * channels interleaved samples.
+ * @param[in] count The number of samples.
+ * @param[in] channels Channels per sample, at most QX_CODEC_CHANNELS_MAX.
+ * @param[out] *out At least QX_CODEC_VARINT_MAX(count, channels) bytes.
+ * @return uint32_t : Bytes written.
+ */
+uint32_t QxCodec_DeltaVarintEncode(tQxDeltaState *state, const int16_t *samples, uint32_t count,
+                                   uint8_t channels, uint8_t *out);
+
+/**
+ * @brief Decode delta varints.
+ * @param[in,out] *state The previous samples, updated.
+ * @param[in] *in The encoded bytes.
+ * @param[in] len The number of encoded bytes.
+ * @param[out] *samples count * channels interleaved samples.
+ * @param[in] count The number of samples to decode.
+ * @param[in] channels Channels per sample, at most QX_CODEC_CHANNELS_MAX.
+ * @return uint32_t : Bytes read, 0 when in ends early.
+ */
+uint32_t QxCodec_DeltaVarintDecode(tQxDeltaState *state, const uint8_t *in, uint32_t len,
+                                   int16_t *samples, uint32_t count, uint8_t channels);
+
+/**
+ * @brief Encode a block of samples as bit packed deltas.
+ * @param[in] *samples count * channels interleaved samples.
+ * @param[in] count The number of samples, at least 1.
+ * @param[in] channels Channels per sample, at most QX_CODEC_CHANNELS_MAX.
+ * @param[out] *out At least QX_CODEC_PACK_MAX(count, channels) bytes.
+ * @return uint32_t : Bytes written.
+ */
+uint32_t QxCodec_DeltaPackEncode(const int16_t *samples, uint32_t count, uint8_t channels, uint8_t *out);
+
+/**
+ * @brief Decode a block of bit packed deltas.
+ * @param[in] *in The encoded block.
+ * @param[in] len The number of encoded bytes.
+ * @param[out] *samples count * channels interleaved samples.
+ * @param[in] count The number of samples in the block.
+ * @param[in] channels Channels per sample, at most QX_CODEC_CHANNELS_MAX.
+ * @return uint32_t : Bytes read, 0 when in ends early.
+ */
+uint32_t QxCodec_DeltaPackDecode(const uint8_t *in, uint32_t len, int16_t *samples, uint32_t count, uint8_t channels);
+
+/**
+ * @brief Encode a block of PCM samples as IMA ADPCM.
+ * @param[in,out] *state The encoder state, zeroed for the first block, carried over to the next.
+ * @param[in] *pcm The samples.
+ * @param[in] count The number of samples.
+ * @param[out] *out At least QX_CODEC_ADPCM_MAX(count) bytes.
+ * @return uint32_t : Bytes written.
+ */
+uint32_t QxCodec_AdpcmEncode(tQxAdpcmState *state, const int16_t *pcm, uint32_t count, uint8_t *out);
+
+/**
+ * @brief Decode a block of IMA ADPCM.
+ * @param[in] *in The encoded block.
+ * @param[in] len The number of encoded bytes.
+ * @param[out] *pcm The samples.
+ * @param[in] count The number of samples in the block.
+ * @return uint32_t : Bytes read, 0 when in ends early.
+ */
+uint32_t QxCodec_AdpcmDecode(const uint8_t *in, uint32_t len, int16_t *pcm, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXCODEC_H_
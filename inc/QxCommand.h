@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file    QxCommand.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the framed command parser for stream input.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXCOMMAND_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXCOMMAND_H_
+
+#include "QxExecutor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Commands arrive on any stream device as frames
+ *
+ *     cmd, length, payload[length]
+ *
+ * with cmd one of e_apk_cmd_bits_rx (QxBTHal.h) and length at most
+ * QX_CMD_PAYLOAD_MAX. On a byte stream like USB a write may hold several
+ * frames or a part of one; over BT every write to the RX characteristic,
+ * and every SDU of the L2CAP channel, holds whole frames.
+ *
+ * The parser runs in the stream data input callback and copies each
+ * payload once, from the transport buffer straight into a slot of a
+ * lock-free queue of its device, without allocation. On a byte stream the
+ * slot is claimed at the length byte and filled as the payload arrives; a
+ * BT write is parsed frame by frame, and a slot is only claimed for a
+ * frame the write holds completely. Handlers run in order of arrival per
+ * device on the executor given to QxCommand_Init(), usually a low priority
+ * thread of its own, so they neither delay the transport nor the sensor
+ * reads; a handler only has to set the state that the sensor and
+ * classification code reads at its next run.
+ *
+ * A byte that is no command, or a length above QX_CMD_PAYLOAD_MAX, is
+ * skipped and counted as an error, so the parser finds the next frame of
+ * a stream that lost bytes. A frame cut off at the end of a BT write, or
+ * still incomplete when a byte stream paused for QX_CMD_TIMEOUT ms, is
+ * given up and its bytes counted as errors too; a slot claimed for it is
+ * published as skipped and dropped by QxCommand_Run(), so it never blocks
+ * the frames after it. Frames completed while QX_CMD_QUEUE frames of their
+ * device wait are dropped.
+*/
+
+#define QX_CMD_MAX          16  /*!< command codes 0 .. QX_CMD_MAX - 1 */
+#define QX_CMD_PAYLOAD_MAX  40  /*!< longest payload, fits s_qx_bt_ctrl */
+#define QX_CMD_QUEUE        4   /*!< frames of one device waiting for their handler, a power of two */
+#define QX_CMD_TIMEOUT      100 /*!< ms without input that end a frame in progress on a byte stream */
+
+/* Stack of the thread running the handlers in the sketch */
+#ifndef QX_COMMAND_STACK
+#define QX_COMMAND_STACK 1024
+#endif
+
+/**
+ * A received command, valid during the handler.
+*/
+typedef struct {
+	uint8_t cmd;                            /*!< command code */
+	uint8_t device;                         /*!< tQxStreamDevice it came from */
+	uint8_t length;                         /*!< payload length */
+	uint8_t payload[QX_CMD_PAYLOAD_MAX];    /*!< payload */
+} tQxCommandFrame;
+
+/**
+ * Handler of a command.
+ *
+ * @param *frame The received command.
+ * @param *userdata The pointer given to QxCommand_Register().
+ */
+typedef void (*tQxCommandFunc)(const tQxCommandFrame *frame, void *userdata);
+
+/**
+ * Counters of the parser.
+*/
+typedef struct {
+	uint32_t frames;        /*!< complete frames queued */
+	uint32_t handled;       /*!< frames given to a handler */
+	uint32_t unhandled;     /*!< frames of a command without handler */
+	uint32_t dropped;       /*!< frames lost because the queue was full */
+	uint32_t errors;        /*!< bytes skipped to find the next frame */
+} tQxCommandStats;
+
+/**
+ * @brief Set the handler of a command, before QxCommand_Init().
+ * @param[in] cmd The command code.
+ * @param[in] func The handler, NULL to remove it.
+ * @param[in] *userdata The pointer passed into func.
+ * @return tQxStatus : QxOK, QxErr for a code of QX_CMD_MAX or more.
+ */
+tQxStatus QxCommand_Register(uint8_t cmd, tQxCommandFunc func, void *userdata);
+
+/**
+ * @brief Parse the stream input of every device from now on.
+ * @param[in] *executor The executor running the handlers, NULL to run them with QxCommand_Run().
+ * @param[in] prio The priority of the handlers among the items of the executor.
+ * @return tQxStatus : Status of QxOS_RegisterStreamDataInCallback().
+ */
+tQxStatus QxCommand_Init(tQxExecutor *executor, tQxPriority prio);
+
+/**
+ * @brief Parse stream input, the tQxStreamDataInCallback that QxCommand_Init() registers.
+ * @param[in] device_type The device the data came from.
+ * @param[in] *data The data, read in place.
+ * @param[in] length The data length.
+ * @param[in] *userdata Unused.
+ * @note One thread per device.
+ */
+void QxCommand_Input(tQxStreamDevice device_type, const uint8_t *data, uint16_t length, void *userdata);
+
+/**
+ * @brief Run the handlers of the queued frames on the calling thread.
+ * @return uint32_t : Number of frames taken from the queue.
+ * @note Only for QxCommand_Init(NULL, ...), the executor calls it otherwise.
+ */
+uint32_t QxCommand_Run(void);
+
+/**
+ * @brief Get the counters of the parser.
+ * @param[out] *stats Counters since boot.
+ */
+void QxCommand_GetStats(tQxCommandStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXCOMMAND_H_
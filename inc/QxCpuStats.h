@@ -0,0 +1,141 @@
+/**
+  ******************************************************************************
+  * @file    QxCpuStats.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the per-thread CPU time and context switch statistics.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXCPUSTATS_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXCPUSTATS_H_
+
+#include "QxOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The backend counts, for every thread, the time it ran and how often it
+ * was switched in. The idle time is the part of the window no other
+ * thread ran, whatever the backend counts for the idle thread itself.
+ * QxOS_CpuStatsSample() keeps the last QX_CPU_WINDOW snapshots of these
+ * counters, and QxOS_GetCpuStats() reports the difference between now and
+ * the oldest one: CPU share, runtime and switches of every thread over a
+ * sliding window of QX_CPU_WINDOW sample periods. Sample and read from the
+ * same thread, QxOS_CpuReport() does both.
+ *
+ * On the device the counters are exact. The RTX context switch happens
+ * only on return from the SVC, PendSV and SysTick handlers, which are
+ * wrapped at link time (QX_CPU_STATS=<ms> of automl-build.sh). Every entry
+ * into one of them adds the DWT cycles since the previous entry to the
+ * running thread. On the host they come from /proc/self/task, and from
+ * the scheduler itself with QXOS_VIRTUAL_TIME.
+*/
+
+#define QX_CPU_THREADS_MAX  16  /*!< threads tracked, the idle time included */
+#define QX_CPU_WINDOW       8   /*!< snapshots in the sliding window */
+
+/* Device of the periodic report of the sketch, e.g. -DQX_CPU_REPORT_DEVICE=QxStreamDeviceBT */
+#ifndef QX_CPU_REPORT_DEVICE
+#define QX_CPU_REPORT_DEVICE QxStreamDeviceNone
+#endif
+
+/**
+ * Counters of a thread since boot, filled by the backend.
+*/
+typedef struct {
+	const char *name;       /*!< thread name */
+	uintptr_t id;           /*!< backend thread id, stable while the thread lives */
+	uint64_t runtime_us;    /*!< time the thread ran */
+	uint32_t switches;      /*!< times the thread was switched in */
+	BOOL idle;              /*!< the idle thread, or the time no thread ran */
+} tQxThreadCpu;
+
+/**
+ * Use of a thread over the window.
+*/
+typedef struct {
+	const char *name;       /*!< thread name */
+	uint32_t runtime_us;    /*!< time the thread ran */
+	uint16_t permille;      /*!< share of the window in 1/1000 */
+	uint32_t switches;      /*!< times the thread was switched in */
+} tQxThreadLoad;
+
+/**
+ * CPU use over the window.
+*/
+typedef struct {
+	uint32_t window_us;     /*!< length of the window */
+	uint16_t load_permille; /*!< share of the window not idle, in 1/1000 */
+	uint32_t idle_us;       /*!< window_us minus the runtime of all threads but idle */
+	uint32_t switches;      /*!< context switches */
+	int count;              /*!< entries of threads, busiest first */
+	tQxThreadLoad threads[QX_CPU_THREADS_MAX];
+} tQxCpuStats;
+
+/**
+ * @brief Get the counters of every thread, backend specific.
+ * @param[out] *threads Array for the threads.
+ * @param[in] max Length of threads.
+ * @return int : Number of entries filled, 0 when the backend does not count.
+ */
+int QxOS_GetThreadCpu(tQxThreadCpu *threads, int max);
+
+/**
+ * @brief Take a snapshot for the sliding window, call it every sample period.
+ * @return tQxStatus : QxOK, QxNotReady when the backend does not count.
+ */
+tQxStatus QxOS_CpuStatsSample(void);
+
+/**
+ * @brief Get the CPU use from the oldest snapshot of the window until now.
+ * @param[out] *stats CPU use.
+ * @return tQxStatus : QxOK, QxNotReady before the first snapshot.
+ */
+tQxStatus QxOS_GetCpuStats(tQxCpuStats *stats);
+
+/**
+ * @brief Format CPU use as one line, e.g. "cpu 37.5% sw 812 | loop 30.1% 100 | ble 6.0% 610".
+ * @param[in] *stats CPU use from QxOS_GetCpuStats().
+ * @param[out] *text Buffer for the line, terminated.
+ * @param[in] size Size of text, the line is cut at a thread boundary to fit.
+ * @return int : Length of the line.
+ */
+int QxOS_CpuStatsFormat(const tQxCpuStats *stats, char *text, int size);
+
+/**
+ * @brief Take a snapshot, then print the CPU use over the window.
+ * @param[in] device QxStreamDeviceNone for QxOS_DebugPrint(), one line per thread,
+ *                   else the QxOS_CpuStatsFormat() line is sent with QxOS_StreamDataOut(), e.g. over BT.
+ */
+void QxOS_CpuReport(tQxStreamDevice device);
+
+/**
+ * @brief Print the contention statistics of every mutex with QxOS_DebugPrint(), one line per mutex.
+ * @note QxOS_CpuReport(QxStreamDeviceNone) prints them after the threads.
+ */
+void QxOS_MutexReport(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXCPUSTATS_H_
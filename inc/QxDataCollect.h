@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file    QxDataCollect.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the data collection stream of raw IMU samples.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXDATACOLLECT_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXDATACOLLECT_H_
+
+#include "QxBTHal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Data collection streams the raw accelerometer and gyroscope samples of
+ * the sensor thread to the app, which labels and uploads them, in packets
+ *
+ *     DEV_RPL_DC_INST, count, seq (uint16), count * {ax, ay, az, gx, gy, gz} (int16)
+ *
+ * all little endian. A packet holds as many samples as one notification at
+ * the MTU given to QxDataCollect_Start() carries: 1 at the minimal MTU of
+ * 23, 20 at an MTU of 247. 952 Hz of 6 axes are 11.4 KB/s, so the full rate
+ * needs a large MTU and several notifications per connection event; the
+ * BT sender hands every queued packet to the controller as long as it has
+ * buffers for them.
+ *
+ * The sensor thread packs the samples in place into a slot of a lock-free
+ * queue, so it never waits for the radio. When the radio falls behind and
+ * QX_DC_QUEUE packets wait, the samples of the next packet are discarded
+ * and counted in tQxDcStats.dropped; they still use a sequence number, so
+ * a gap in seq tells the app how many packets it missed, on the device or
+ * on the air.
+ *
+ * Built with QX_DC_CODEC, the samples are delta varints (inc/QxCodec.h),
+ * each packet starting against zero so it decodes on its own, and count
+ * has QX_DC_DELTA_VARINT set. Moving samples take about half the bytes, so
+ * the same link carries twice the rate; a packet holds as many samples as
+ * fit in the worst case of 18 bytes each.
+*/
+
+#define QX_DC_PACKET_MAX    244 /*!< largest packet, a notification at an MTU of 247 */
+#define QX_DC_HEADER        4   /*!< cmd, count, seq */
+#define QX_DC_SAMPLE_SIZE   12  /*!< 6 axes of int16 */
+#define QX_DC_QUEUE         16  /*!< packets waiting for the radio, a power of two */
+#define QX_DC_DELTA_VARINT  0x80 /*!< flag in count, samples are delta varints */
+
+/**
+ * A packet of samples, as notified.
+*/
+typedef struct {
+	uint16_t length;                    /*!< bytes in data */
+	uint8_t data[QX_DC_PACKET_MAX];     /*!< header and samples */
+} tQxDcPacket;
+
+/**
+ * Counters since boot.
+*/
+typedef struct {
+	uint32_t samples;       /*!< samples packed */
+	uint32_t packets;       /*!< packets queued */
+	uint32_t sent;          /*!< packets handed to the transport */
+	uint32_t dropped;       /*!< packets lost because the queue was full */
+} tQxDcStats;
+
+/**
+ * @brief Start a collection, the sensor thread takes it up at its next read.
+ * @param[in] *ctrl The settings of APK_CMD_START_DC: samples are sent from dc_delay_ms on for dc_duration ms, 0 for until QxDataCollect_Stop().
+ * @param[in] payload_max The largest notification, the MTU - 3.
+ * @return tQxStatus : QxOK, QxErr when payload_max holds no sample.
+ */
+tQxStatus QxDataCollect_Start(const s_qx_bt_ctrl *ctrl, uint16_t payload_max);
+
+/**
+ * @brief Stop the collection, the packet in progress is still sent.
+ */
+void QxDataCollect_Stop(void);
+
+/**
+ * @brief Whether a collection is started and not yet over.
+ * @return bool : true from QxDataCollect_Start() until the duration passed or QxDataCollect_Stop().
+ */
+bool QxDataCollect_Active(void);
+
+/**
+ * @brief Pack samples read from the sensor FIFO, from the sensor thread only.
+ * @param[in] *accel x, y, z of every sample.
+ * @param[in] *gyro x, y, z of every sample.
+ * @param[in] samples The number of samples.
+ */
+void QxDataCollect_Push(const int16_t *accel, const int16_t *gyro, uint16_t samples);
+
+/**
+ * @brief The oldest queued packet in place, from the single sender.
+ * @return const tQxDcPacket* : The packet, valid until QxDataCollect_Sent(); NULL when none is queued.
+ */
+const tQxDcPacket *QxDataCollect_Peek(void);
+
+/**
+ * @brief Release the packet returned by QxDataCollect_Peek().
+ * @param[in] sent false when it was discarded, e.g. without connection.
+ */
+void QxDataCollect_Sent(bool sent);
+
+/**
+ * @brief Get the counters.
+ * @param[out] *stats Counters since boot.
+ */
+void QxDataCollect_GetStats(tQxDcStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXDATACOLLECT_H_
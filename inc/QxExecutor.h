@@ -0,0 +1,185 @@
+/**
+  ******************************************************************************
+  * @file    QxExecutor.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the prioritized executor for timers and posted work.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXEXECUTOR_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXEXECUTOR_H_
+
+#include "QxOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An executor runs work items and timers one after the other on a single
+ * thread, instead of a thread per job that sleeps and polls on its own.
+ * Every item has a tQxPriority; the executor always runs the oldest ready
+ * item of the highest priority next, and an item runs to completion. The
+ * latency of an item is therefore bounded by the longest item of any
+ * priority plus the items of higher priority, which QxOS_ExecutorGetStats()
+ * measures.
+ *
+ * Work items and timers are owned by the caller, usually static, so posting
+ * never allocates. QxOS_ExecutorPost() is lock-free and may be called from
+ * interrupt handlers, e.g. for I/O completions. A work item posted again
+ * before it ran runs once. Periodic timers keep their phase: when the
+ * executor is late by whole periods, those periods are skipped and counted.
+ *
+ * The executor runs on the thread that calls QxOS_ExecutorRun(), e.g. the
+ * sketch loop(), or on its own thread with QxOS_ExecutorStart().
+*/
+
+/**
+ * Function of a work item.
+ *
+ * @param *arg The argument of the work item.
+ */
+typedef void (*tQxWorkFunc)(void *arg);
+
+/**
+ * Work item, initialize with QX_WORK_INIT() or QxOS_WorkInit().
+*/
+typedef struct tQxWork {
+	tQxWorkFunc func;       /*!< function to run */
+	void *arg;              /*!< argument of func */
+	tQxPriority prio;       /*!< priority among the items of the executor */
+	struct tQxWork *next;   /*!< private: queue link */
+	uint32_t pending;       /*!< private: posted and not run yet */
+	uint32_t posted_us;     /*!< private: time of the post, for the latency */
+} tQxWork;
+
+#define QX_WORK_INIT(func, arg, prio) { (func), (arg), (prio), NULL, 0, 0 }
+
+/**
+ * Timer, its work item is posted when it expires.
+*/
+typedef struct tQxTimer {
+	tQxWork work;           /*!< work item run on expiry */
+	uint32_t period_ms;     /*!< private: 0 for a one shot timer */
+	uint64_t due_us;        /*!< private: next expiry */
+	struct tQxTimer *next;  /*!< private: timer list link */
+	uint8_t active;         /*!< private: in the timer list */
+} tQxTimer;
+
+#define QX_TIMER_INIT(func, arg, prio) { QX_WORK_INIT(func, arg, prio), 0, 0, NULL, 0 }
+
+/**
+ * Executor, created by QxOS_CreateExecutor().
+*/
+typedef struct tQxExecutor tQxExecutor;
+
+/**
+ * Counters of an executor.
+*/
+typedef struct {
+	uint32_t runs;            /*!< work items run, timers included */
+	uint32_t coalesced;       /*!< posts of an item that was still pending */
+	uint32_t overruns;        /*!< timer periods skipped because the executor was late */
+	uint32_t max_latency_us;  /*!< longest time from post or timer expiry to the start of an item */
+	uint32_t max_run_us;      /*!< longest run of an item */
+	tQxWorkFunc max_run_func; /*!< function of that item */
+} tQxExecutorStats;
+
+/**
+ * @brief Initialize a work item.
+ * @param[in] *work The work item.
+ * @param[in] func The function to run.
+ * @param[in] arg The argument of func.
+ * @param[in] prio The priority of the item.
+ */
+void QxOS_WorkInit(tQxWork *work, tQxWorkFunc func, void *arg, tQxPriority prio);
+
+/**
+ * @brief Create an executor.
+ * @param[in] *name The name of the executor.
+ * @return tQxExecutor : The executor, NULL when out of memory.
+ */
+tQxExecutor* QxOS_CreateExecutor(const char *name);
+
+/**
+ * @brief Queue a work item, it runs once even when posted again before it ran.
+ * @param[in] *ex The executor.
+ * @param[in] *work The work item, it must stay valid until it ran.
+ * @return tQxStatus : QxOK.
+ * @note It never blocks and may be called from interrupt handlers.
+ */
+tQxStatus QxOS_ExecutorPost(tQxExecutor *ex, tQxWork *work);
+
+/**
+ * @brief Start or restart a timer.
+ * @param[in] *ex The executor.
+ * @param[in] *timer The timer, initialized with QX_TIMER_INIT() or QxOS_WorkInit() of its work.
+ * @param[in] delay_ms Milliseconds until the first expiry.
+ * @param[in] period_ms Milliseconds between expiries, 0 for a one shot timer.
+ * @return tQxStatus : QxOK.
+ * @note Not from interrupt handlers.
+ */
+tQxStatus QxOS_ExecutorTimerStart(tQxExecutor *ex, tQxTimer *timer, uint32_t delay_ms, uint32_t period_ms);
+
+/**
+ * @brief Stop a timer. A run already posted still happens.
+ * @param[in] *ex The executor.
+ * @param[in] *timer The timer.
+ * @return tQxStatus : QxOK, QxNotReady when it was not running.
+ */
+tQxStatus QxOS_ExecutorTimerStop(tQxExecutor *ex, tQxTimer *timer);
+
+/**
+ * @brief Run the executor on the calling thread.
+ * @param[in] *ex The executor.
+ * @param[in] millisec How long to run, QX_WAIT_FOREVER until QxOS_ExecutorStop().
+ * @return tQxStatus : QxOK.
+ */
+tQxStatus QxOS_ExecutorRun(tQxExecutor *ex, uint32_t millisec);
+
+/**
+ * @brief Run the executor on a new thread until QxOS_ExecutorStop().
+ * @param[in] *ex The executor.
+ * @param[in] prio The priority of the thread.
+ * @param[in] stacksz The stack size of the thread.
+ * @return tQxThread : The thread, NULL on failure.
+ */
+tQxThread* QxOS_ExecutorStart(tQxExecutor *ex, tQxPriority prio, uint32_t stacksz);
+
+/**
+ * @brief Make QxOS_ExecutorRun() return after the item it is running.
+ * @param[in] *ex The executor.
+ * @return tQxStatus : QxOK.
+ */
+tQxStatus QxOS_ExecutorStop(tQxExecutor *ex);
+
+/**
+ * @brief Get the counters of an executor.
+ * @param[in] *ex The executor.
+ * @param[out] *stats Counters since QxOS_CreateExecutor().
+ * @return tQxStatus : QxOK.
+ */
+tQxStatus QxOS_ExecutorGetStats(tQxExecutor *ex, tQxExecutorStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXEXECUTOR_H_
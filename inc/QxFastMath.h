@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * @file    QxFastMath.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of array-at-a-time fast math Api used by feature and probability code.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXFASTMATH_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXFASTMATH_H_
+
+#include "QxTypeDefs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The batch functions below are branch free and unrolled by four, so the
+ * Cortex-M4 FPU can overlap independent multiply-adds and host compilers can
+ * vectorize the loops. Input and output arrays must not overlap unless they
+ * are the same array.
+ *
+ * Accuracy against libm is reported by host/bench/fastmath_bench.cpp, see
+ * "./automl-build.sh --bench".
+*/
+
+/**
+ * Scalar fast 2^x, provided by fastmath.o of the classify engine library.
+ */
+float fm_exp2f(float x);
+
+/**
+ * Scalar fast log2(x), provided by fastmath.o of the classify engine library.
+ */
+float fm_log2f(float x);
+
+/**
+ * @brief Compute 2^x for every element of an array.
+ * @param[in] *in Input array.
+ * @param[out] *out Output array, may be the same as in.
+ * @param[in] n The number of elements.
+ * @note Inputs are clamped to [-126, 127]; results are never denormal or infinite.
+ */
+void fm_exp2f_batch(const float *in, float *out, uint32_t n);
+
+/**
+ * @brief Compute log2(x) for every element of an array.
+ * @param[in] *in Input array.
+ * @param[out] *out Output array, may be the same as in.
+ * @param[in] n The number of elements.
+ * @note Inputs smaller than FLT_MIN (including zero and negative values) return -126.
+ */
+void fm_log2f_batch(const float *in, float *out, uint32_t n);
+
+/**
+ * @brief Compute softmax of an array in place or into a second array.
+ * @param[in] *in Input scores.
+ * @param[out] *out Output probabilities, may be the same as in.
+ * @param[in] n The number of elements.
+ */
+void fm_softmax_batch(const float *in, float *out, uint32_t n);
+
+/**
+ * @brief Compute log2 power spectrum from an interleaved complex spectrum.
+ * @param[in] *cplx Complex spectrum (re, im pairs), as produced by arm_rfft_fast_f32().
+ * @param[out] *out Output array of log2(re^2 + im^2 + pwr_floor).
+ * @param[in] nbins The number of complex bins.
+ * @param[in] pwr_floor Small positive value added to each power to avoid log of zero.
+ */
+void fm_log2_power_batch(const float *cplx, float *out, uint32_t nbins, float pwr_floor);
+
+/**
+ * @brief Compute Shannon entropy in bits of a distribution.
+ * @param[in] *p Probability or normalized power array; zero entries contribute nothing.
+ * @param[in] n The number of elements.
+ * @return float : -sum(p * log2(p)).
+ */
+float fm_entropy_batch(const float *p, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXFASTMATH_H_
@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file    QxFlatTree.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the flattened tree ensemble predictor.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXFLATTREE_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXFLATTREE_H_
+
+#include "QxTypeDefs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Slot value marking a leaf node.
+*/
+#define QX_FLAT_LEAF 0xFF
+
+/**
+ * Node of a flattened tree, 4 bytes, stored const in flash.
+ *
+ * Every tree is laid out breadth first and the two children of a node are
+ * adjacent, so a single offset addresses both of them. Thresholds are
+ * replaced by bins: the predictor first maps each used feature to the number
+ * of model thresholds not greater than it, then compares small integers.
+*/
+typedef struct {
+	uint8_t slot;  /*!< Feature slot of an internal node, QX_FLAT_LEAF for a leaf */
+	uint8_t bin;   /*!< Go to the right child when the feature bin >= bin */
+	int16_t value; /*!< Internal node: offset to the left child. Leaf: quantized margin */
+} tQxFlatNode;
+
+/**
+ * Flattened tree ensemble, generated by tools/qxmodel.py --emit-flat.
+*/
+typedef struct {
+	uint16_t num_trees;             /*!< Number of trees with at least one split */
+	uint16_t num_nodes;             /*!< Number of nodes of all trees */
+	uint8_t num_classes;            /*!< Number of output classes */
+	uint8_t num_slots;              /*!< Number of distinct features used by the trees */
+	const uint16_t *slot_feature;   /*!< Feature index of every slot */
+	const uint16_t *edge_start;     /*!< num_slots + 1 offsets of each slot's thresholds in edges */
+	const float *edges;             /*!< Sorted unique thresholds of every slot */
+	const uint16_t *tree_root;      /*!< Node index of every tree root */
+	const uint16_t *class_tree_end; /*!< Trees are grouped by class, end index of each group */
+	const tQxFlatNode *nodes;       /*!< All nodes of all trees */
+	const float *base_score;        /*!< Initial margin of each class, including constant trees */
+	float leaf_scale;               /*!< Margin = quantized leaf value * leaf_scale */
+} tQxFlatForest;
+
+/**
+ * @brief Predict class probabilities with a flattened tree ensemble.
+ * @param[in] *forest The flattened model.
+ * @param[in] *features Feature vector, as produced by the engine's featurize step.
+ * @param[out] *probs Output probabilities, num_classes entries.
+ */
+void QxFlatTree_Predict(const tQxFlatForest *forest, const float *features, float *probs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXFLATTREE_H_
@@ -0,0 +1,138 @@
+/**
+  ******************************************************************************
+  * @file    QxFrame.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    19-Oct-2020
+  * @brief   Header of the framed binary stream: COBS frames of several channels.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXFRAME_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXFRAME_H_
+
+#include "QxOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Framed stream. Several channels share one stream device, e.g. USB, as
+ * binary frames a host splits without parsing any text:
+ *
+ *     0x00, COBS(channel, seq, payload[length], crc16), 0x00
+ *
+ * COBS (consistent overhead byte stuffing) removes every zero from the
+ * frame for one byte per 254, so a zero only ever delimits frames and a
+ * reader that starts mid stream, or lost bytes, is in sync again at the
+ * next one. crc16 is CRC-16/CCITT-FALSE (polynomial 0x1021, init 0xFFFF)
+ * of channel, seq and payload, little endian. seq counts the frames of a
+ * channel, wrapping at 256; a frame the stream refused still uses one, so
+ * a gap in seq tells the host how many frames were lost and where.
+ *
+ * Payload of the channels:
+ *
+ *     QxFrameLog      a deferred log record of inc/QxLog.h, without 0xA5 framing
+ *     QxFrameText     text, e.g. the prints of the app
+ *     QxFrameResult   a classification result, tQxBTResult of inc/QxBTHal.h
+ *     QxFrameSensor   a data collection packet of inc/QxDataCollect.h
+ *     QxFrameStats    a report line, e.g. of QxOS_CpuReport()
+ *
+ * Prints of the closed engine library do not go through here and stay
+ * plain text between the frames; they hold no zero byte, so the host
+ * passes them through. tools/qxcapture.py records and decodes the stream.
+ *
+ * Frames go out through QxOS_StreamDataOutAsync() when the device was
+ * started with QxOS_StreamAsyncStart(), which any thread may call without
+ * blocking and which keeps every frame in one piece, else through
+ * QxOS_StreamDataOut().
+*/
+
+/**
+ * Channels of a framed stream.
+*/
+typedef enum {
+	QxFrameLog = 0,        /*!< deferred log records */
+	QxFrameText,           /*!< text */
+	QxFrameResult,         /*!< classification results */
+	QxFrameSensor,         /*!< raw sensor samples */
+	QxFrameStats,          /*!< statistics reports */
+	QxFrameChannelNum,
+} tQxFrameChannel;
+
+#define QX_FRAME_DELIMITER      0x00
+#define QX_FRAME_PAYLOAD_MAX    256 /*!< largest payload of a frame */
+#define QX_FRAME_OVERHEAD       4   /*!< channel, seq and crc16 */
+
+/* Bytes on the wire of a frame of n payload bytes: COBS adds one byte per 254 and one more, plus the two delimiters */
+#define QX_FRAME_ENCODED_MAX(n) ((n) + QX_FRAME_OVERHEAD + ((n) + QX_FRAME_OVERHEAD) / 254 + 1 + 2)
+
+/**
+ * Counters since QxFrame_Init().
+*/
+typedef struct {
+	uint32_t frames[QxFrameChannelNum];  /*!< frames the stream took, per channel */
+	uint32_t bytes;                      /*!< encoded bytes the stream took */
+	uint32_t dropped;                    /*!< frames the stream refused or that were too long */
+} tQxFrameStats;
+
+/**
+ * @brief Start framing a stream device; QxLog, QxDataCollect, QxOS_CpuReport() and QxBTHal_WriteResult() then send frames to it.
+ * @param[in] device The stream device, e.g. QxStreamDeviceUSB. Call QxOS_StreamAsyncStart() for it first to never block.
+ * @return tQxStatus : QxOK, QxErr for QxStreamDeviceNone.
+ */
+tQxStatus QxFrame_Init(tQxStreamDevice device);
+
+/**
+ * @brief Whether a stream device is framed.
+ * @param[in] device The stream device.
+ * @return bool : true after QxFrame_Init() of the device.
+ */
+bool QxFrame_Active(tQxStreamDevice device);
+
+/**
+ * @brief Encode one frame, taking the next sequence number of the channel.
+ * @param[out] *out The frame, QX_FRAME_ENCODED_MAX(length) bytes.
+ * @param[in] channel The channel of the frame.
+ * @param[in] *data The payload.
+ * @param[in] length The payload length, at most QX_FRAME_PAYLOAD_MAX.
+ * @return uint32_t : Bytes of the frame, 0 for a bad channel or length.
+ */
+uint32_t QxFrame_Pack(uint8_t *out, tQxFrameChannel channel, const void *data, uint16_t length);
+
+/**
+ * @brief Send one frame to the framed stream device.
+ * @param[in] channel The channel of the frame.
+ * @param[in] *data The payload.
+ * @param[in] length The payload length, at most QX_FRAME_PAYLOAD_MAX.
+ * @return int : length when the stream took the frame, 0 when it was dropped or no device is framed.
+ */
+int QxFrame_Send(tQxFrameChannel channel, const void *data, uint16_t length);
+
+/**
+ * @brief Get the counters of the framed stream.
+ * @param[out] *stats Counters since QxFrame_Init().
+ */
+void QxFrame_GetStats(tQxFrameStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXFRAME_H_
@@ -0,0 +1,287 @@
+/**
+  ******************************************************************************
+  * @file    QxLog.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of deferred binary logging, formatted on the host by tools/debuglog.py.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXLOG_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXLOG_H_
+
+#include "QxOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Deferred logging. QX_LOG() does no formatting: it queues the address of
+ * the format string and the raw arguments, tagged with their type, as one
+ * record in a lock-free ring. QxLog_Flush() later sends the records over a
+ * stream device, and "python3 tools/debuglog.py --elf <ELF>" looks the
+ * format strings up in the ELF file of the build and formats them there.
+ *
+ * Frame on the wire, all integers as LEB128 varints, signed ones zigzag coded:
+ *
+ *     0xA5, length, payload[length], ~sum(payload)
+ *     payload = level, id, time, args...
+ *
+ * id is the distance of the format string from QxLog_Base, time the low
+ * 32 bits of QxOS_GetTimeUs(). Every argument is a tag byte followed by its
+ * value: 'i' signed, 'u' unsigned, 'f' float, 'd' double (4 and 8 byte
+ * little endian), 's' length byte and characters. A level of
+ * QxLogDropped carries the count of records lost to a full ring instead.
+ *
+ * Text printed through QxOS_DebugPrint() or Serial may share the stream;
+ * the decoder passes bytes outside of frames through as text.
+*/
+
+/**
+ * Levels of a log record.
+*/
+typedef enum {
+	QxLogDebug = 0,        /*!< QX_DEBUG_PRINT(), replaces QxOS_DebugPrint() */
+	QxLogClassify = 1,     /*!< QX_CLASSIFY_PRINT(), replaces QxOS_ClassifyPrint() */
+	QxLogDropped = 0x7F,   /*!< records lost because the ring was full */
+} tQxLogLevel;
+
+#define QX_LOG_SYNC         0xA5
+#define QX_LOG_RECORD_MAX   48  /*!< payload bytes of a record, longer records are cut at an argument */
+#ifndef QX_LOG_RECORDS
+#define QX_LOG_RECORDS      32  /*!< records of the ring, a power of two */
+#endif
+#define QX_LOG_STRING_MAX   16  /*!< characters kept of a string argument */
+
+/**
+ * Anchor of format string ids, its address is looked up in the ELF symbols.
+*/
+extern const char QxLog_Base[];
+
+/**
+ * @brief Set the stream device of the log and optionally start a thread draining it.
+ * @param[in] device The stream device records are sent to, e.g. QxStreamDeviceUSB.
+ * @param[in] period Drain period in milliseconds of a low priority thread, 0 to call QxLog_Flush() yourself.
+ * @return tQxStatus : Status of creating the thread.
+ */
+tQxStatus QxLog_Init(tQxStreamDevice device, uint32_t period);
+
+/**
+ * @brief Send all queued records to the stream device.
+ * @return int : Number of bytes sent.
+ * @note Only one thread may flush at a time, usually the one of QxLog_Init().
+ */
+int QxLog_Flush(void);
+
+/**
+ * @brief Queue one encoded record.
+ * @param[in] *payload Level, id, time and arguments.
+ * @param[in] length Payload length, at most QX_LOG_RECORD_MAX.
+ * @return BOOL : FALSE when the ring was full and the record was dropped.
+ */
+BOOL QxLog_Commit(const uint8_t *payload, uint8_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <type_traits>
+
+namespace qxlog {
+
+/* record under construction, arguments that do not fit are left out */
+class Writer
+{
+public:
+    Writer(uint8_t level, const char *fmt) : mLen(0), mFull(false)
+    {
+        mBuf[mLen++] = level;
+        Varint(ZigZag((int32_t)((intptr_t)fmt - (intptr_t)QxLog_Base)));
+        Varint((uint32_t)QxOS_GetTimeUs());
+    }
+
+    void Unsigned(uint64_t v) { Tagged('u', v); }
+    void Signed(int64_t v) { Tagged('i', ZigZag(v)); }
+
+    void Float(float v)
+    {
+        uint8_t bytes[1 + sizeof(v)] = { 'f' };
+        memcpy(&bytes[1], &v, sizeof(v));
+        Put(bytes, sizeof(bytes));
+    }
+
+    void Double(double v)
+    {
+        uint8_t bytes[1 + sizeof(v)] = { 'd' };
+        memcpy(&bytes[1], &v, sizeof(v));
+        Put(bytes, sizeof(bytes));
+    }
+
+    void String(const char *s)
+    {
+        uint8_t bytes[2 + QX_LOG_STRING_MAX] = { 's' };
+        size_t n = (s == NULL) ? 0 : strnlen(s, QX_LOG_STRING_MAX);
+        bytes[1] = (uint8_t)n;
+        memcpy(&bytes[2], s, n);
+        Put(bytes, 2 + n);
+    }
+
+    void Commit() { QxLog_Commit(mBuf, mLen); }
+
+private:
+    static uint64_t ZigZag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+
+    void Varint(uint64_t v)
+    {
+        uint8_t bytes[10];
+        size_t n = 0;
+        do {
+            bytes[n++] = (uint8_t)((v & 0x7F) | (v > 0x7F ? 0x80 : 0));
+            v >>= 7;
+        } while (v);
+        Put(bytes, n);
+    }
+
+    void Tagged(uint8_t tag, uint64_t v)
+    {
+        if (!mFull && mLen < QX_LOG_RECORD_MAX) {
+            uint8_t len = mLen;
+            mBuf[mLen++] = tag;
+            Varint(v);
+            /* keep either the whole argument or nothing */
+            mLen = mFull ? len : mLen;
+        }
+    }
+
+    void Put(const uint8_t *bytes, size_t n)
+    {
+        if (mFull || mLen + n > QX_LOG_RECORD_MAX) {
+            mFull = true;
+            return;
+        }
+        memcpy(&mBuf[mLen], bytes, n);
+        mLen += (uint8_t)n;
+    }
+
+    uint8_t mBuf[QX_LOG_RECORD_MAX];
+    uint8_t mLen;
+    bool mFull;
+};
+
+/* one overload per argument type, picked at compile time */
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+Put(Writer &w, T v) { w.Signed((int64_t)v); }
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+Put(Writer &w, T v) { w.Unsigned((uint64_t)v); }
+
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value>::type
+Put(Writer &w, T v) { w.Signed((int64_t)v); }
+
+template <typename T>
+inline void Put(Writer &w, T *v) { w.Unsigned((uintptr_t)v); }
+
+inline void Put(Writer &w, float v) { w.Float(v); }
+inline void Put(Writer &w, double v) { w.Double(v); }
+inline void Put(Writer &w, const char *v) { w.String(v); }
+inline void Put(Writer &w, char *v) { w.String(v); }
+
+template <typename... Args>
+inline void Write(uint8_t level, const char *fmt, Args... args)
+{
+    Writer w(level, fmt);
+    int expand[] = { 0, (Put(w, args), 0)... };
+    (void)expand;
+    w.Commit();
+}
+
+constexpr bool IsConversion(char c)
+{
+    return c == 'd' || c == 'i' || c == 'u' || c == 'o' || c == 'x' || c == 'X' || c == 'c' ||
+           c == 's' || c == 'p' || c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' ||
+           c == 'G' || c == 'a' || c == 'A';
+}
+
+/* number of arguments a printf format consumes, for the check in QX_LOG() */
+constexpr int CountArgs(const char *f)
+{
+    int n = 0;
+    while (*f) {
+        if (*f++ != '%') {
+            continue;
+        }
+        if (*f == '%') {
+            f++;
+            continue;
+        }
+        while (*f && !IsConversion(*f)) {
+            n += (*f == '*');
+            f++;
+        }
+        if (*f) {
+            n++;
+            f++;
+        }
+    }
+    return n;
+}
+
+template <typename... Args>
+struct Count {
+    static const int value = sizeof...(Args);
+};
+
+template <typename... Args>
+Count<Args...> Types(const Args &...);
+
+} // namespace qxlog
+
+/**
+ * Queue a printf style log record without formatting it. The format must
+ * be a string literal; its conversions are checked against the number of
+ * arguments at compile time. Formatting happens on the host, see above.
+ */
+#define QX_LOG(level, fmt, ...)                                                                   \
+    do {                                                                                          \
+        static_assert(qxlog::CountArgs(fmt) == decltype(qxlog::Types(__VA_ARGS__))::value,        \
+                      "QX_LOG: the format does not match the number of arguments");              \
+        qxlog::Write((uint8_t)(level), fmt, ##__VA_ARGS__);                                      \
+    } while (0)
+
+/**
+ * Prints of the sketch and QxAutoMLInf, deferred when built with
+ * QX_LOG_DEFERRED=1 and formatted on the device otherwise.
+ */
+#ifdef QX_LOG_DEFERRED
+#define QX_DEBUG_PRINT(fmt, ...)    QX_LOG(QxLogDebug, fmt, ##__VA_ARGS__)
+#define QX_CLASSIFY_PRINT(fmt, ...) QX_LOG(QxLogClassify, fmt, ##__VA_ARGS__)
+#else
+#define QX_DEBUG_PRINT(fmt, ...)    QxOS_DebugPrint(fmt, ##__VA_ARGS__)
+#define QX_CLASSIFY_PRINT(fmt, ...) QxOS_ClassifyPrint(fmt, ##__VA_ARGS__)
+#endif
+
+#endif //__cplusplus
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXLOG_H_
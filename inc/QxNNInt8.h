@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file    QxNNInt8.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the int8 quantized neural network predictor.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXNNINT8_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXNNINT8_H_
+
+#include "QxTypeDefs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Quantization follows the usual int8 scheme: activations are asymmetric per
+ * tensor, real = scale * (q - zero_point), weights are symmetric per output
+ * channel. The input zero point is folded into the int32 bias when the model
+ * is generated, so every output is a plain int8 dot product plus bias,
+ * requantized by a Q31 multiplier and a power of two shift.
+ *
+ * Activations are stored channels last, [position][channel]. A dense layer
+ * is a conv1d layer with one input position and a kernel of one.
+*/
+
+/**
+ * Layer types.
+*/
+typedef enum {
+	QX_NN_DENSE,
+	QX_NN_CONV1D,
+} tQxNNLayerType;
+
+/**
+ * One quantized layer, generated by tools/qxnn.py.
+*/
+typedef struct {
+	uint8_t type;                /*!< tQxNNLayerType */
+	uint8_t relu;                /*!< Clamp outputs at the real value 0 */
+	int8_t out_zero_point;       /*!< Zero point of the output activations */
+	uint16_t in_channels;        /*!< Input channels, or inputs of a dense layer */
+	uint16_t out_channels;       /*!< Output channels, or outputs of a dense layer */
+	uint16_t in_length;          /*!< Input positions, 1 for a dense layer */
+	uint16_t out_length;         /*!< Output positions, 1 for a dense layer */
+	uint16_t kernel;             /*!< Kernel positions, 1 for a dense layer */
+	uint16_t stride;             /*!< Input positions between two outputs */
+	const int8_t *weights;       /*!< [out_channels][kernel][in_channels] */
+	const int32_t *bias;         /*!< Per output channel, input zero point folded in */
+	const int32_t *multiplier;   /*!< Per output channel Q31 requantization multiplier */
+	const int8_t *shift;         /*!< Per output channel shift, positive is a left shift */
+} tQxNNLayer;
+
+/**
+ * Quantized network, generated by tools/qxnn.py.
+*/
+typedef struct {
+	uint16_t num_inputs;         /*!< Number of float features */
+	uint16_t num_outputs;        /*!< Number of outputs of the last layer */
+	uint8_t num_layers;          /*!< Number of layers */
+	uint8_t softmax;             /*!< Apply softmax to the outputs */
+	int8_t in_zero_point;        /*!< Zero point of the quantized features */
+	int8_t out_zero_point;       /*!< Zero point of the last layer */
+	float in_scale;              /*!< Scale of the quantized features */
+	float out_scale;             /*!< Scale of the last layer */
+	const tQxNNLayer *layers;    /*!< The layers, in order */
+	int8_t *scratch;             /*!< Two activation buffers of scratch_half bytes each */
+	uint32_t scratch_half;       /*!< Size of the largest activation */
+} tQxNNModel;
+
+/**
+ * @brief Run one layer.
+ * @param[in] *layer The layer.
+ * @param[in] *in Input activations, in_length * in_channels.
+ * @param[out] *out Output activations, out_length * out_channels.
+ */
+void QxNNInt8_Layer(const tQxNNLayer *layer, const int8_t *in, int8_t *out);
+
+/**
+ * @brief Predict outputs of a quantized network.
+ * @param[in] *model The quantized model.
+ * @param[in] *features Float feature vector, as produced by the engine's featurize step.
+ * @param[out] *probs Output probabilities (or dequantized outputs without softmax), num_outputs entries.
+ */
+void QxNNInt8_Predict(const tQxNNModel *model, const float *features, float *probs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXNNINT8_H_
@@ -50,6 +50,30 @@ typedef struct {
 	BOOL isLocked; /*!< The variable indicates if the mutex is locked. */
 } tQxMutex;
 
+/**
+ * Contention statistics of a mutex, see QxOS_GetMutexStats().
+*/
+typedef struct {
+	const char *name;       /*!< The name of mutex */
+	uint32_t locks;         /*!< Acquisitions, the nested ones of a recursive mutex not counted */
+	uint32_t contended;     /*!< Acquisitions that had to wait for another owner */
+	uint32_t timeouts;      /*!< QxOS_LockMutex_Wait() calls that gave up */
+	uint32_t max_wait_us;   /*!< Longest wait of a contended acquisition */
+	uint32_t max_hold_us;   /*!< Longest time from lock to unlock */
+} tQxMutexStats;
+
+/**
+ * Counting semaphore structure for Qeexo AutoML framework.
+*/
+typedef struct {
+	char *name; /*!< The name of semaphore */
+} tQxSemaphore;
+
+/**
+ * Timeout of QxOS_WaitSemaphore() that never expires.
+*/
+#define QX_WAIT_FOREVER 0xFFFFFFFFu
+
 /**
  * Thread priority defintions. 
  * @note it is compatible with osPriority of CMSIS FreeRTOS.
@@ -135,8 +159,8 @@ tQxStatus QxOS_LockMutex(tQxMutex* mutex);
  * @brief Lock the critical section with the mutex.
  * @param[in] *mutex The memory pointer of mutex.
  * @param[in] millisec Timeout value.
- * @return tQxStatus : Status of mutex lock.
- * @note In side of the sample codes, there is some code how to write with osMutexWait() of CMSIS.
+ * @return tQxStatus : QxOK, QxBusy when the mutex was not free within millisec.
+ * @note The owner inherits the priority of the highest waiter until it unlocks, see QxOS_Mutex_Nano33BLE.cpp.
  */
 tQxStatus QxOS_LockMutex_Wait(tQxMutex* mutex, uint32_t millisec);
 
@@ -148,6 +172,49 @@ tQxStatus QxOS_LockMutex_Wait(tQxMutex* mutex, uint32_t millisec);
  */
 tQxStatus QxOS_UnLockMutex(tQxMutex* mutex);
 
+/**
+ * @brief Get the contention statistics of a mutex since it was created.
+ * @param[in] *mutex The memory pointer of mutex.
+ * @param[out] *stats Statistics.
+ * @return tQxStatus : QxOK, QxErr for a NULL mutex.
+ */
+tQxStatus QxOS_GetMutexStats(tQxMutex* mutex, tQxMutexStats* stats);
+
+/**
+ * @brief Get the contention statistics of every mutex.
+ * @param[out] *stats Array for the statistics.
+ * @param[in] max Length of stats.
+ * @return int : Number of entries filled, the most recently created mutex first.
+ */
+int QxOS_ListMutexStats(tQxMutexStats* stats, int max);
+
+/**
+ * @brief Create a counting semaphore.
+ * @param[in] *name The name of semaphore.
+ * @param[in] max_count The largest count, further releases are refused.
+ * @param[in] initial_count The count it starts with.
+ * @return tQxSemaphore : The memory pointer of the created semaphore, NULL on failure.
+ * @note This function is matched with osSemaphoreNew() of CMSIS.
+ */
+tQxSemaphore* QxOS_CreateSemaphore(const char* name, uint32_t max_count, uint32_t initial_count);
+
+/**
+ * @brief Take one count of the semaphore, waiting until it is released.
+ * @param[in] *sem The memory pointer of semaphore.
+ * @param[in] millisec Timeout value, 0 to poll, QX_WAIT_FOREVER to wait without limit.
+ * @return tQxStatus : QxOK when a count was taken, QxBusy on timeout.
+ * @note This function is matched with osSemaphoreAcquire() of CMSIS.
+ */
+tQxStatus QxOS_WaitSemaphore(tQxSemaphore* sem, uint32_t millisec);
+
+/**
+ * @brief Add one count to the semaphore and wake a waiting thread.
+ * @param[in] *sem The memory pointer of semaphore.
+ * @return tQxStatus : QxOK, or QxBusy when the count is at its maximum.
+ * @note It may be called from interrupt handlers, like osSemaphoreRelease() of CMSIS.
+ */
+tQxStatus QxOS_ReleaseSemaphore(tQxSemaphore* sem);
+
 /**    
  * @brief Start OS Kernel for QxSensor framework.    
  * @return tQxStatus : Status of starting OS kernel.
@@ -170,6 +237,77 @@ tQxStatus QxOS_Delay(uint32_t msec);
  */
 uint32_t QxOS_GetTick();
 
+/**
+ * @brief Get time since boot in microsecond unit.
+ * @return uint64_t : Microsecond time stamp, it does not wrap.
+ * @note Use it for latencies below a tick; QxOS_GetTick() stays the time base of delays.
+ */
+uint64_t QxOS_GetTimeUs(void);
+
+/**
+ * @brief Get the free running cycle counter.
+ * @return uint32_t : Cycle counter. It wraps, the unsigned difference of two reads is correct across one wrap.
+ * @note On the device it is the core clock (64 MHz, wraps after 67 s), see QxOS_GetCycleHz().
+ */
+uint32_t QxOS_GetCycles(void);
+
+/**
+ * @brief Get the frequency of QxOS_GetCycles().
+ * @return uint32_t : Cycles per second.
+ */
+uint32_t QxOS_GetCycleHz(void);
+
+/**
+ * @brief Convert a QxOS_GetCycles() difference to microseconds.
+ * @param[in] cycles Cycle count.
+ * @return uint32_t : Microseconds, rounded down.
+ */
+static inline uint32_t QxOS_CyclesToUs(uint32_t cycles)
+{
+    return (uint32_t)((uint64_t)cycles * 1000000u / QxOS_GetCycleHz());
+}
+
+/**
+ * @brief Convert a QxOS_GetCycles() difference to nanoseconds.
+ * @param[in] cycles Cycle count.
+ * @return uint64_t : Nanoseconds, rounded down.
+ */
+static inline uint64_t QxOS_CyclesToNs(uint32_t cycles)
+{
+    return (uint64_t)cycles * 1000000000u / QxOS_GetCycleHz();
+}
+
+/**
+ * @brief Convert microseconds to cycles of QxOS_GetCycles().
+ * @param[in] usec Microseconds.
+ * @return uint32_t : Cycle count, saturated at UINT32_MAX.
+ */
+static inline uint32_t QxOS_UsToCycles(uint32_t usec)
+{
+    uint64_t cycles = (uint64_t)usec * QxOS_GetCycleHz() / 1000000u;
+    return (cycles > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)cycles;
+}
+
+/**
+ * @brief Convert a microsecond duration to milliseconds for QxOS_Delay().
+ * @param[in] usec Microseconds.
+ * @return uint32_t : Milliseconds, rounded up so a delay is never too short.
+ */
+static inline uint32_t QxOS_UsToMs(uint64_t usec)
+{
+    return (uint32_t)((usec + 999u) / 1000u);
+}
+
+/**
+ * @brief Convert milliseconds to microseconds.
+ * @param[in] msec Milliseconds.
+ * @return uint64_t : Microseconds.
+ */
+static inline uint64_t QxOS_MsToUs(uint32_t msec)
+{
+    return (uint64_t)msec * 1000u;
+}
+
 /**    
  * @brief Print log out for the debug purpose of AutoML package.    
  * @param[in] *format The format of log message.    
@@ -198,6 +336,7 @@ void QxOS_ClassifyBTPrint(const char *format, ...);
  * @param[in] data_len The data length to transfer.
  * @param[in] timeout The millisecond unit of timeout.
  * @return int : Return how many bytes has been transferred.
+ * @note It blocks until the transport took the data; QxOS_StreamDataOutAsync() of QxStreamAsync.h queues it instead.
  */
 int QxOS_StreamDataOut(tQxStreamDevice device_type, void* data, uint16_t data_len, uint32_t timeout);
 
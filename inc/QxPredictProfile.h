@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    QxPredictProfile.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of the predict() cycle profiler.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXPREDICTPROFILE_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXPREDICTPROFILE_H_
+
+#include "QxTypeDefs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The profiler is built when QX_PROFILE_PREDICT is defined. automl-build.sh
+ * then links with -Wl,--wrap=predict, so every predict() call made by
+ * QXO_MLEngine_Work() goes through a wrapper that counts QxOS_GetCycles(). This
+ * works the same for the engine's predict.o and for a generated layout
+ * (QX_MODEL_LAYOUT=flat or compiled).
+ *
+ * QX_GOLDEN_DUMP builds link the same wrapper, which also keeps the first
+ * QX_GOLDEN_FEATURES features of the last call for the golden records.
+*/
+
+/**
+ * Cycle statistics of predict() since the last reset.
+*/
+typedef struct {
+	uint32_t count; /*!< Number of predict() calls */
+	uint32_t last;  /*!< Cycles of the last call */
+	uint32_t min;   /*!< Fewest cycles of a call */
+	uint32_t max;   /*!< Most cycles of a call */
+	uint64_t total; /*!< Sum of cycles of all calls */
+} tQxPredictProfile;
+
+/**
+ * @brief Get the predict() cycle statistics.
+ * @param[out] *profile Statistics since the last reset.
+ * @return tQxStatus : QxOK on success, QxNotReady when built without QX_PROFILE_PREDICT.
+ */
+tQxStatus QxPredictProfile_Get(tQxPredictProfile *profile);
+
+/**
+ * @brief Clear the predict() cycle statistics.
+ * @return tQxStatus : QxOK on success, QxNotReady when built without QX_PROFILE_PREDICT.
+ */
+tQxStatus QxPredictProfile_Reset(void);
+
+/**
+ * @brief Get the feature vector of the last predict() call, from the thread that runs QXO_MLEngine_Work().
+ * @param[out] **features The QX_GOLDEN_FEATURES features.
+ * @param[out] *count Number of features, 0 before the first call.
+ * @return tQxStatus : QxOK on success, QxNotReady before the first call or when built without QX_GOLDEN_DUMP.
+ */
+tQxStatus QxPredictProfile_GetFeatures(const float **features, uint32_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXPREDICTPROFILE_H_
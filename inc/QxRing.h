@@ -0,0 +1,335 @@
+/**
+  ******************************************************************************
+  * @file    QxRing.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Lock-free bounded queues, many producers and one consumer.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXRING_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXRING_H_
+
+#include "QxTypeDefs.h"
+
+#ifdef __cplusplus
+
+#include <atomic>
+
+/**
+ * Bounded queue of N records of type T (D. Vyukov's bounded MPMC queue,
+ * used with a single consumer). Every slot carries a sequence number that
+ * tells producers and the consumer whose turn it is, so producers only
+ * compete on one compare-and-swap of the write position and never wait for
+ * each other. Push() fails instead of blocking when the queue is full, so
+ * it can be called from any thread or interrupt handler.
+ *
+ * A producer that is preempted between claiming a slot and filling it
+ * holds back the consumer, not the other producers; the records behind it
+ * are delivered once it resumes.
+ *
+ * N must be a power of two. T is copied with its assignment operator and
+ * should be plain data. A QxRing needs static storage: its all-zero state is
+ * the empty queue, so it has no constructor to run and is usable before
+ * static constructors, and the linker drops it when nothing pushes to it.
+*/
+template <typename T, uint32_t N>
+class QxRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "QxRing size must be a power of two");
+
+public:
+    /**
+     * @brief Append a record, from any producer.
+     * @param[in] &record The record to copy into the queue.
+     * @return bool : false when the queue is full.
+     */
+    bool Push(const T &record)
+    {
+        uint32_t pos;
+        T *slot = Claim(pos);
+        if (slot == NULL) {
+            return false;
+        }
+        *slot = record;
+        Publish(pos);
+        return true;
+    }
+
+    /**
+     * @brief Claim the next slot to fill it in place, from any producer.
+     * @param[out] &pos The position of the slot, for Publish().
+     * @return T* : The slot, NULL when the queue is full.
+     * @note Every claimed slot must be published, the consumer stops at it until then.
+     */
+    T *Claim(uint32_t &pos)
+    {
+        pos = mHead.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Slot *slot = &mSlots[pos & (N - 1)];
+            int32_t diff = (int32_t)(Seq(slot, pos) - pos);
+            if (diff == 0) {
+                if (mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return &slot->data;
+                }
+            } else if (diff < 0) {
+                return NULL;
+            } else {
+                pos = mHead.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Hand a slot filled after Claim() to the consumer.
+     * @param[in] pos The position Claim() returned.
+     */
+    void Publish(uint32_t pos)
+    {
+        SetSeq(&mSlots[pos & (N - 1)], pos, pos + 1);
+    }
+
+    /**
+     * @brief Remove the oldest record, from the single consumer.
+     * @param[out] &record The removed record.
+     * @return bool : false when no complete record is queued.
+     */
+    bool Pop(T &record)
+    {
+        const T *slot = Peek();
+        if (slot == NULL) {
+            return false;
+        }
+        record = *slot;
+        Drop();
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest record, from any thread.
+     * @param[out] &record The removed record.
+     * @return bool : false when no complete record is queued.
+     * @note For queues whose producers also remove records, e.g. to drop the oldest one when full.
+     *       All removals must then use PopAny(), not Pop() or Peek() and Drop().
+     */
+    bool PopAny(T &record)
+    {
+        uint32_t pos = mTail.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Slot *slot = &mSlots[pos & (N - 1)];
+            int32_t diff = (int32_t)(Seq(slot, pos) - (pos + 1));
+            if (diff == 0) {
+                if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    record = slot->data;
+                    SetSeq(slot, pos, pos + N);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief The oldest record in place, from the single consumer.
+     * @return const T* : The record, valid until Drop(); NULL when no complete record is queued.
+     */
+    const T *Peek()
+    {
+        uint32_t pos = mTail.load(std::memory_order_relaxed);
+        Slot *slot = &mSlots[pos & (N - 1)];
+
+        if (Seq(slot, pos) != pos + 1) {
+            return NULL;
+        }
+        return &slot->data;
+    }
+
+    /**
+     * @brief Remove the record returned by Peek(), from the single consumer.
+     */
+    void Drop()
+    {
+        uint32_t pos = mTail.load(std::memory_order_relaxed);
+        SetSeq(&mSlots[pos & (N - 1)], pos, pos + N);
+        mTail.store(pos + 1, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq; /*!< sequence minus slot index, so zero is free for the first lap */
+        T data;
+    };
+
+    static uint32_t Seq(Slot *slot, uint32_t pos)
+    {
+        return slot->seq.load(std::memory_order_acquire) + (pos & (N - 1));
+    }
+
+    static void SetSeq(Slot *slot, uint32_t pos, uint32_t seq)
+    {
+        slot->seq.store(seq - (pos & (N - 1)), std::memory_order_release);
+    }
+
+    Slot mSlots[N];
+    std::atomic<uint32_t> mHead; /*!< next slot producers claim */
+    std::atomic<uint32_t> mTail; /*!< next slot the consumer reads */
+};
+
+/**
+ * Byte queue for writes of any length on a caller provided buffer, with the
+ * same progress guarantees as QxRing. A write is stored as one chunk: a
+ * 32 bit header word, the data, padding to 4 bytes. Producers reserve a
+ * chunk with one compare-and-swap of the write position, copy the data and
+ * then publish the header with a release store, so a chunk is either
+ * complete for the consumer or not there. The consumer zeroes what it has
+ * read before handing the space back, so an all-zero word always means "not
+ * published yet".
+ *
+ * Positions are free running byte counts; Head() - Tail() is the space in use.
+*/
+class QxByteRing
+{
+public:
+    /**
+     * @brief Set the buffer of the queue.
+     * @param[in] *words Zeroed buffer.
+     * @param[in] size Buffer size in bytes, a power of two of at least 8.
+     */
+    void Init(uint32_t *words, uint32_t size)
+    {
+        mWords = words;
+        mMask = size - 1;
+        mHead.store(0, std::memory_order_relaxed);
+        mTail.store(0, std::memory_order_relaxed);
+        mOffset = 0;
+    }
+
+    /**
+     * @brief Append data as one chunk, from any producer.
+     * @param[in] *data The data to copy into the queue.
+     * @param[in] len The data length.
+     * @return bool : false when there is not enough free space; nothing is written then.
+     */
+    bool Write(const void *data, uint32_t len)
+    {
+        uint32_t need = ChunkSize(len);
+        if (len == 0 || len >= COMMIT || need > mMask + 1) {
+            return false;
+        }
+
+        uint32_t head = mHead.load(std::memory_order_relaxed);
+        do {
+            uint32_t tail = mTail.load(std::memory_order_acquire);
+            if (head - tail + need > mMask + 1) {
+                return false;
+            }
+        } while (!mHead.compare_exchange_weak(head, head + need, std::memory_order_relaxed));
+
+        CopyIn(head + 4, (const uint8_t *)data, len);
+        __atomic_store_n(Header(head), len | COMMIT, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /**
+     * @brief Take up to max bytes of published chunks, from the single consumer.
+     * @param[out] *out Buffer for the data.
+     * @param[in] max Size of out. A chunk longer than max is returned in parts.
+     * @return uint32_t : Number of bytes copied, 0 when nothing is published.
+     */
+    uint32_t Read(uint8_t *out, uint32_t max)
+    {
+        uint32_t n = 0;
+
+        while (n < max) {
+            uint32_t tail = mTail.load(std::memory_order_relaxed);
+            uint32_t header = __atomic_load_n(Header(tail), __ATOMIC_ACQUIRE);
+            if (!(header & COMMIT)) {
+                break;
+            }
+
+            uint32_t len = header & ~COMMIT;
+            uint32_t take = (len - mOffset < max - n) ? len - mOffset : max - n;
+            CopyOut(out + n, tail + 4 + mOffset, take);
+            n += take;
+            mOffset += take;
+
+            if (mOffset == len) {
+                uint32_t need = ChunkSize(len);
+                for (uint32_t pos = tail + 4; pos != tail + need; pos += 4) {
+                    mWords[(pos & mMask) >> 2] = 0;
+                }
+                __atomic_store_n(Header(tail), 0, __ATOMIC_RELAXED);
+                mOffset = 0;
+                mTail.store(tail + need, std::memory_order_release);
+            }
+        }
+        return n;
+    }
+
+    /**
+     * @brief Position after the last reserved chunk.
+     */
+    uint32_t Head() const { return mHead.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Position of the oldest chunk not completely read.
+     */
+    uint32_t Tail() const { return mTail.load(std::memory_order_acquire); }
+
+private:
+    static const uint32_t COMMIT = 0x80000000u;
+
+    static uint32_t ChunkSize(uint32_t len) { return 4 + ((len + 3) & ~3u); }
+
+    uint32_t *Header(uint32_t pos) { return &mWords[(pos & mMask) >> 2]; }
+
+    /* copies to and from the ring at pos, split at the end of the ring */
+    void CopyIn(uint32_t pos, const uint8_t *src, uint32_t len)
+    {
+        uint8_t *ring = (uint8_t *)mWords;
+        uint32_t at = pos & mMask;
+        uint32_t first = (len < mMask + 1 - at) ? len : mMask + 1 - at;
+        memcpy(ring + at, src, first);
+        memcpy(ring, src + first, len - first);
+    }
+
+    void CopyOut(uint8_t *dst, uint32_t pos, uint32_t len) const
+    {
+        const uint8_t *ring = (const uint8_t *)mWords;
+        uint32_t at = pos & mMask;
+        uint32_t first = (len < mMask + 1 - at) ? len : mMask + 1 - at;
+        memcpy(dst, ring + at, first);
+        memcpy(dst + first, ring, len - first);
+    }
+
+    uint32_t *mWords;
+    uint32_t mMask;
+    std::atomic<uint32_t> mHead; /*!< end of the reserved chunks */
+    std::atomic<uint32_t> mTail; /*!< start of the oldest chunk not released by the consumer */
+    uint32_t mOffset;            /*!< bytes of the oldest chunk already read */
+};
+
+#endif //__cplusplus
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXRING_H_
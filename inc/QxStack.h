@@ -0,0 +1,144 @@
+/**
+  ******************************************************************************
+  * @file    QxStack.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of statically allocated threads, stack watermarks and heap statistics.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXSTACK_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXSTACK_H_
+
+#include "QxOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * QxOS_CreateThread() allocates stack and thread memory on the heap, so its
+ * RAM use is not in the link map and nobody knows how much of a stack is
+ * really needed. A thread declared with QX_STATIC_THREAD() has its stack and
+ * control block in .bss, sized at compile time. The stack is painted with
+ * QX_STACK_PAINT before the thread starts; the deepest word that no longer
+ * holds the pattern is the high watermark of the stack.
+ *
+ * QxOS_MemoryReport() prints the watermark of every painted stack and the
+ * heap in use. Run the worst case (BLE connected, streaming, classifying)
+ * for a while, then trim the stack sizes to the watermarks plus a margin.
+*/
+
+#define QX_STACK_PAINT  0xCCCCCCCCu  /*!< the RTX watermark pattern, so both kinds of painting agree */
+
+/**
+ * Statically allocated thread, declare with QX_STATIC_THREAD().
+*/
+typedef struct {
+	tQxThread thread;       /*!< name and user data */
+	uint64_t *stack;        /*!< stack memory, 8 byte aligned */
+	uint32_t stack_size;    /*!< stack size in bytes */
+	tQxThreadFunc func;     /*!< main function of the thread */
+	void *userdata;         /*!< argument of func */
+	void *handle;           /*!< backend thread id */
+	uint64_t cb[10];        /*!< control block memory of the RTOS */
+} tQxStaticThread;
+
+/**
+ * Declare a static thread var with a stack of stack_bytes (rounded up to 8).
+ */
+#define QX_STATIC_THREAD(var, name, stack_bytes) \
+	static uint64_t var##_stack[((stack_bytes) + 7) / 8]; \
+	static tQxStaticThread var = { { (char *)(name), NULL }, var##_stack, sizeof(var##_stack), NULL, NULL, NULL, { 0 } }
+
+/**
+ * Stack use of a thread.
+*/
+typedef struct {
+	const char *name;  /*!< thread name */
+	uint32_t size;     /*!< stack size in bytes */
+	uint32_t used;     /*!< high watermark in bytes, valid when painted */
+	BOOL painted;      /*!< the stack was painted before the thread ran */
+} tQxStackStats;
+
+/**
+ * Heap use.
+*/
+typedef struct {
+	uint32_t arena;    /*!< bytes the heap has grown to, its high watermark */
+	uint32_t in_use;   /*!< bytes in allocated blocks */
+	uint32_t free;     /*!< bytes in free blocks inside the arena */
+} tQxHeapStats;
+
+/**
+ * @brief Paint a stack and start a static thread on it.
+ * @param[in] *t The thread declared with QX_STATIC_THREAD().
+ * @param[in] func The main function of thread.
+ * @param[in] prio The priority of this thread.
+ * @param[in] userdata The memory pointer passed into func.
+ * @return tQxThread : The thread, NULL on failure.
+ */
+tQxThread* QxOS_CreateStaticThread(tQxStaticThread *t, tQxThreadFunc func, tQxPriority prio, void *userdata);
+
+/**
+ * @brief Fill a stack that is not in use yet with QX_STACK_PAINT.
+ * @param[in] *stack Lowest address of the stack.
+ * @param[in] size Stack size in bytes.
+ */
+void QxOS_PaintStack(void *stack, uint32_t size);
+
+/**
+ * @brief Paint the unused part of the stack of the calling thread, e.g. first thing in setup().
+ */
+void QxOS_PaintCurrentStack(void);
+
+/**
+ * @brief Get the high watermark of a painted stack.
+ * @param[in] *stack Lowest address of the stack.
+ * @param[in] size Stack size in bytes.
+ * @return uint32_t : Bytes from the top of the stack down to the deepest word written.
+ */
+uint32_t QxOS_StackUsed(const void *stack, uint32_t size);
+
+/**
+ * @brief Get the stack use of the threads.
+ * @param[out] *stats Array for the threads.
+ * @param[in] max Length of stats.
+ * @return int : Number of entries filled.
+ * @note On the device these are all RTOS threads, on the host the threads of QxOS_CreateStaticThread().
+ */
+int QxOS_GetStackStats(tQxStackStats *stats, int max);
+
+/**
+ * @brief Get the heap use.
+ * @param[out] *stats Heap statistics.
+ * @return tQxStatus : QxOK on success.
+ */
+tQxStatus QxOS_GetHeapStats(tQxHeapStats *stats);
+
+/**
+ * @brief Print the stack use of every thread and the heap use with QxOS_DebugPrint().
+ */
+void QxOS_MemoryReport(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXSTACK_H_
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file    QxStreamAsync.h
+  * @author  Qeexo Kernel Development team
+  * @version V1.0.0
+  * @date    30-Sep-2020
+  * @brief   Header of asynchronous stream output on top of QxOS_StreamDataOut().
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2020 Qeexo Co.
+  * All rights reserved.
+  *
+  *
+  * ALL INFORMATION CONTAINED HEREIN IS AND REMAINS THE PROPERTY OF QEEXO, CO.
+  * THE INTELLECTUAL AND TECHNICAL CONCEPTS CONTAINED HEREIN ARE PROPRIETARY TO
+  * QEEXO, CO. AND MAY BE COVERED BY U.S. AND FOREIGN PATENTS, PATENTS IN PROCESS,
+  * AND ARE PROTECTED BY TRADE SECRET OR COPYRIGHT LAW. DISSEMINATION OF
+  * THIS INFORMATION OR REPRODUCTION OF THIS MATERIAL IS STRICTLY FORBIDDEN UNLESS
+  * PRIOR WRITTEN PERMISSION IS OBTAINED OR IS MADE PURSUANT TO A LICENSE AGREEMENT
+  * WITH QEEXO, CO. ALLOWING SUCH DISSEMINATION OR REPRODUCTION.
+  *
+  ******************************************************************************
+ */
+
+#ifndef MIDDLEWARES_QEEXO_INCLUDE_QXSTREAMASYNC_H_
+#define MIDDLEWARES_QEEXO_INCLUDE_QXSTREAMASYNC_H_
+
+#include "QxOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * QxOS_StreamDataOut() blocks its caller until the transport took the data
+ * or the timeout passed. QxOS_StreamDataOutAsync() instead copies the data
+ * into a lock-free byte queue of the device (QxByteRing of inc/QxRing.h) and
+ * returns; it never blocks and may be called by any number of threads at
+ * once. A drain thread per started device takes everything queued, up to
+ * chunk_size bytes, and passes it to QxOS_StreamDataOut() in one call, so
+ * small writes of many threads reach the transport as full-sized writes.
+ *
+ * Each write is kept in one piece: it is queued completely or, when the
+ * queue is full, not at all and counted as dropped.
+*/
+
+/**
+ * Counters of an asynchronous stream device.
+*/
+typedef struct {
+	uint32_t queued;   /*!< bytes accepted by QxOS_StreamDataOutAsync() */
+	uint32_t dropped;  /*!< bytes refused because the queue was full */
+	uint32_t written;  /*!< bytes taken by QxOS_StreamDataOut() */
+	uint32_t lost;     /*!< bytes QxOS_StreamDataOut() failed to take */
+	uint32_t writes;   /*!< QxOS_StreamDataOut() calls of the drain thread */
+} tQxStreamAsyncStats;
+
+/**
+ * @brief Create the queue and drain thread of a stream device.
+ * @param[in] device_type The device type transferring data.
+ * @param[in] buffer_size Queue size in bytes, a power of two. Every write takes 4 to 7 bytes more.
+ * @param[in] chunk_size Most bytes passed to one QxOS_StreamDataOut() call, e.g. the USB or BLE packet size.
+ * @param[in] period Milliseconds the drain thread sleeps when the queue is empty.
+ * @param[in] prio The priority of the drain thread.
+ * @return tQxStatus : QxOK, QxBusy when already started, QxErr when out of memory.
+ */
+tQxStatus QxOS_StreamAsyncStart(tQxStreamDevice device_type, uint32_t buffer_size, uint32_t chunk_size,
+                                uint32_t period, tQxPriority prio);
+
+/**
+ * @brief Queue data for a started stream device without blocking.
+ * @param[in] device_type The device type transferring data.
+ * @param[in] *data The data pointer of memory to transfer.
+ * @param[in] data_len The data length to transfer.
+ * @return int : data_len when queued, 0 when the queue is full or the device is not started.
+ */
+int QxOS_StreamDataOutAsync(tQxStreamDevice device_type, const void *data, uint16_t data_len);
+
+/**
+ * @brief Wait until the data queued before the call has been written, then flush the device.
+ * @param[in] device_type The device type transferring data.
+ * @param[in] timeout The millisecond unit of timeout.
+ * @return tQxStatus : QxOK, QxBusy on timeout, QxNotReady when the device is not started.
+ */
+tQxStatus QxOS_FlushDataOutAsync(tQxStreamDevice device_type, uint32_t timeout);
+
+/**
+ * @brief Get the counters of a stream device.
+ * @param[in] device_type The device type transferring data.
+ * @param[out] *stats Counters since QxOS_StreamAsyncStart().
+ * @return tQxStatus : QxOK, QxNotReady when the device is not started.
+ */
+tQxStatus QxOS_StreamAsyncGetStats(tQxStreamDevice device_type, tQxStreamAsyncStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MIDDLEWARES_QEEXO_INCLUDE_QXSTREAMASYNC_H_
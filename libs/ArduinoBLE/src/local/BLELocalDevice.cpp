@@ -21,6 +21,7 @@
 #include "utility/HCI.h"
 #include "utility/GAP.h"
 #include "utility/GATT.h"
+#include "utility/L2CAPCoC.h"
 #include "utility/L2CAPSignaling.h"
 
 #include "BLELocalDevice.h"
@@ -31,7 +32,9 @@
 #endif
 #endif
 
-BLELocalDevice::BLELocalDevice()
+BLELocalDevice::BLELocalDevice() :
+  _maxMtu(0),
+  _dataLength(0)
 {
 }
 
@@ -116,6 +119,15 @@ int BLELocalDevice::begin()
     return 0;
   }
 
+  // readLeBufferSize() set the MTU the controller buffers allow
+  if (_maxMtu != 0 && _maxMtu < ATT.maxMtu()) {
+    ATT.setMaxMtu(_maxMtu);
+  }
+  ATT.setConnectionSetup(_maxMtu > 23, _dataLength);
+
+  // the default LE events, LE Data Length Change and LE PHY Update Complete, optional for older controllers
+  HCI.leSetEventMask(0x000000000000085F);
+
   GATT.begin();
 
   return 1;
@@ -142,11 +154,17 @@ void BLELocalDevice::end()
 void BLELocalDevice::poll()
 {
   HCI.poll();
+  ATT.setupConnections();
+  GAP.poll();
+  L2CAPCoC.poll();
 }
 
 void BLELocalDevice::poll(unsigned long timeout)
 {
   HCI.poll(timeout);
+  ATT.setupConnections();
+  GAP.poll();
+  L2CAPCoC.poll();
 }
 
 bool BLELocalDevice::connected() const
@@ -208,6 +226,36 @@ void BLELocalDevice::setLocalName(const char *localName)
   GAP.setLocalName(localName);
 }
 
+void BLELocalDevice::setExtendedAdvertisingData(const uint8_t data[], int length)
+{
+  GAP.setExtendedAdvertisingData(data, length);
+}
+
+void BLELocalDevice::setPeriodicAdvertisingData(const uint8_t data[], int length)
+{
+  GAP.setPeriodicAdvertisingData(data, length);
+}
+
+void BLELocalDevice::setPeriodicAdvertisingInterval(uint16_t interval)
+{
+  GAP.setPeriodicAdvertisingInterval(interval);
+}
+
+void BLELocalDevice::setAdvertiseWhileConnected(bool enable)
+{
+  GAP.setAdvertiseWhileConnected(enable);
+}
+
+bool BLELocalDevice::extendedAdvertising()
+{
+  return GAP.extendedAdvertising();
+}
+
+bool BLELocalDevice::periodicAdvertising()
+{
+  return GAP.periodicAdvertising();
+}
+
 void BLELocalDevice::setDeviceName(const char* deviceName)
 {
   GATT.setDeviceName(deviceName);
@@ -228,6 +276,11 @@ int BLELocalDevice::advertise()
   return GAP.advertise();
 }
 
+int BLELocalDevice::updateAdvertisingData()
+{
+  return GAP.updateAdvertisingData();
+}
+
 void BLELocalDevice::stopAdvertise()
 {
   GAP.stopAdvertise();
@@ -301,6 +354,17 @@ void BLELocalDevice::setTimeout(unsigned long timeout)
   ATT.setTimeout(timeout);
 }
 
+void BLELocalDevice::setMaxMtu(uint16_t maxMtu)
+{
+  _maxMtu = maxMtu;
+}
+
+void BLELocalDevice::setDataLength(uint16_t txOctets)
+{
+  // 27 to 251 octets, Bluetooth 4.2 Vol 6 Part B 4.5.10
+  _dataLength = min(txOctets, (uint16_t)251);
+}
+
 void BLELocalDevice::debug(Stream& stream)
 {
   HCI.debug(stream);
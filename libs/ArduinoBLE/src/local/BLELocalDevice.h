@@ -47,12 +47,21 @@ public:
   void setManufacturerData(const uint16_t companyId, const uint8_t manufacturerData[], int manufacturerDataLength);
   void setLocalName(const char *localName);
 
+  // BLE 5 extended and periodic advertising, see GAPClass
+  void setExtendedAdvertisingData(const uint8_t data[], int length);
+  void setPeriodicAdvertisingData(const uint8_t data[], int length);
+  void setPeriodicAdvertisingInterval(uint16_t interval);
+  bool extendedAdvertising();
+  bool periodicAdvertising();
+  void setAdvertiseWhileConnected(bool enable);
+
   void setDeviceName(const char* deviceName);
   void setAppearance(uint16_t appearance);
 
   void addService(BLEService& service);
 
   int advertise();
+  int updateAdvertisingData();
   void stopAdvertise();
 
   int scan(bool withDuplicates = false);
@@ -72,10 +81,17 @@ public:
 
   void setTimeout(unsigned long timeout);
 
+  // before begin(): the largest ATT MTU, exchanged on connect when above 23,
+  // and the LL payload asked for on connect when above 27 (Data Length Extension)
+  void setMaxMtu(uint16_t maxMtu);
+  void setDataLength(uint16_t txOctets);
+
   void debug(Stream& stream);
   void noDebug();
 
 private:
+  uint16_t _maxMtu;
+  uint16_t _dataLength;
 };
 
 extern BLELocalDevice BLE;
@@ -84,6 +84,8 @@
 ATTClass::ATTClass() :
   _maxMtu(23),
   _timeout(5000),
+  _exchangeMtuOnConnect(false),
+  _dataLengthOnConnect(0),
   _longWriteHandle(0x0000),
   _longWriteValue(NULL),
   _longWriteValueLength(0)
@@ -94,6 +96,7 @@ ATTClass::ATTClass() :
     _peers[i].addressType = 0x00;
     memset(_peers[i].address, 0x00, sizeof(_peers[i].address));
     _peers[i].mtu = 23;
+    _peers[i].setupPending = false;
     _peers[i].device = NULL;
   }
 
@@ -223,6 +226,56 @@ void ATTClass::setMaxMtu(uint16_t maxMtu)
   _maxMtu = maxMtu;
 }
 
+uint16_t ATTClass::maxMtu() const
+{
+  return _maxMtu;
+}
+
+uint16_t ATTClass::linkMtu() const
+{
+  // HCI.sendAclPkt() does not fragment, a PDU and its L2CAP header must fit one ACL packet
+  uint16_t aclMtu = HCI.aclPktLen() - 4;
+
+  return (_maxMtu < aclMtu) ? _maxMtu : aclMtu;
+}
+
+// what setupConnections() does for every new connection
+void ATTClass::setConnectionSetup(bool exchangeMtu, uint16_t dataLength)
+{
+  _exchangeMtuOnConnect = exchangeMtu;
+  _dataLengthOnConnect = dataLength;
+}
+
+// Called after HCI.poll(), outside of event handling: commands wait for their completion event
+void ATTClass::setupConnections()
+{
+  for (int i = 0; i < ATT_MAX_PEERS; i++) {
+    if (_peers[i].connectionHandle == 0xffff || !_peers[i].setupPending) {
+      continue;
+    }
+
+    uint16_t handle = _peers[i].connectionHandle;
+    _peers[i].setupPending = false;
+
+    if (_dataLengthOnConnect > 27) {
+      // the longest PDU time on the 1M PHY: preamble, access address, header, MIC and CRC are 14 bytes
+      HCI.leSetDataLength(handle, _dataLengthOnConnect, (_dataLengthOnConnect + 14) * 8);
+    }
+
+    uint16_t mtu = linkMtu();
+
+    if (_exchangeMtuOnConnect && mtu > 23) {
+      // not waited for, mtuResp() takes the answer
+      struct __attribute__ ((packed)) {
+        uint8_t op;
+        uint16_t mtu;
+      } mtuReq = { ATT_OP_MTU_REQ, mtu };
+
+      HCI.sendAclPkt(handle, ATT_CID, sizeof(mtuReq), &mtuReq);
+    }
+  }
+}
+
 void ATTClass::setTimeout(unsigned long timeout)
 {
   _timeout = timeout;
@@ -250,6 +303,7 @@ void ATTClass::addConnection(uint16_t handle, uint8_t role, uint8_t peerBdaddrTy
   _peers[peerIndex].connectionHandle = handle;
   _peers[peerIndex].role = role;
   _peers[peerIndex].mtu = 23;
+  _peers[peerIndex].setupPending = true;
   _peers[peerIndex].addressType = peerBdaddrType;
   memcpy(_peers[peerIndex].address, peerBdaddr, sizeof(_peers[peerIndex].address));
 
@@ -467,6 +521,30 @@ uint16_t ATTClass::mtu(uint16_t handle) const
   return 23;
 }
 
+// MTU of the connected central, 23 when there is none
+uint16_t ATTClass::centralMtu() const
+{
+  for (int i = 0; i < ATT_MAX_PEERS; i++) {
+    if (_peers[i].connectionHandle != 0xffff && _peers[i].role == 0x01) {
+      return _peers[i].mtu;
+    }
+  }
+
+  return 23;
+}
+
+// 0xffff without a central
+uint16_t ATTClass::centralHandle() const
+{
+  for (int i = 0; i < ATT_MAX_PEERS; i++) {
+    if (_peers[i].connectionHandle != 0xffff && _peers[i].role == 0x01) {
+      return _peers[i].connectionHandle;
+    }
+  }
+
+  return 0xffff;
+}
+
 bool ATTClass::disconnect()
 {
   int numDisconnects = 0;
@@ -609,8 +687,8 @@ void ATTClass::mtuReq(uint16_t connectionHandle, uint8_t dlen, uint8_t data[])
     return;
   }
 
-  if (mtu > _maxMtu) {
-    mtu = _maxMtu;
+  if (mtu > linkMtu()) {
+    mtu = linkMtu();
   }
 
   for (int i = 0; i < ATT_MAX_PEERS; i++) {
@@ -646,6 +724,11 @@ void ATTClass::mtuResp(uint16_t connectionHandle, uint8_t dlen, uint8_t data[])
     return;
   }
 
+  // the MTU of the connection is the smaller of both
+  if (mtu > linkMtu()) {
+    mtu = linkMtu();
+  }
+
   for (int i = 0; i < ATT_MAX_PEERS; i++) {
     if (_peers[i].connectionHandle == connectionHandle) {
       _peers[i].mtu = mtu;
@@ -1423,7 +1506,7 @@ bool ATTClass::exchangeMtu(uint16_t connectionHandle)
 {
   uint8_t responseBuffer[_maxMtu];
 
-  if (!mtuReq(connectionHandle, _maxMtu, responseBuffer)) {
+  if (!mtuReq(connectionHandle, linkMtu(), responseBuffer)) {
     return false;
   }
 
@@ -42,6 +42,9 @@ public:
   virtual ~ATTClass();
 
   void setMaxMtu(uint16_t maxMtu);
+  uint16_t maxMtu() const;
+  void setConnectionSetup(bool exchangeMtu, uint16_t dataLength);
+  void setupConnections();
   void setTimeout(unsigned long timeout);
 
   bool connect(uint8_t peerBdaddrType, uint8_t peerBdaddr[6]);
@@ -63,6 +66,8 @@ public:
   bool connected(uint8_t addressType, const uint8_t address[6]) const;
   bool connected(uint16_t handle) const;
   uint16_t mtu(uint16_t handle) const;
+  uint16_t centralMtu() const;
+  uint16_t centralHandle() const;
 
   bool disconnect();
 
@@ -109,15 +114,20 @@ private:
 
   int sendReq(uint16_t connectionHandle, void* requestBuffer, int requestLength, uint8_t responseBuffer[]);
 
+  uint16_t linkMtu() const;
+
 private:
   uint16_t _maxMtu;
   unsigned long _timeout;
+  bool _exchangeMtuOnConnect;
+  uint16_t _dataLengthOnConnect;
   struct {
     uint16_t connectionHandle;
     uint8_t role;
     uint8_t addressType;
     uint8_t address[6];
     uint16_t mtu;
+    bool setupPending;
     BLERemoteDevice* device;
   } _peers[ATT_MAX_PEERS];
 
@@ -24,6 +24,13 @@
 
 #define GAP_MAX_DISCOVERED_QUEUE_SIZE 5
 
+// advertising sets in extended mode: the legacy advertising, then the extended data
+#define GAP_LEGACY_SET   0x00
+#define GAP_EXTENDED_SET 0x01
+
+#define LE_FEATURE_EXTENDED_ADVERTISING (1ULL << 12)
+#define LE_FEATURE_PERIODIC_ADVERTISING (1ULL << 13)
+
 GAPClass::GAPClass() :
   _advertising(false),
   _scanning(false),
@@ -33,6 +40,19 @@ GAPClass::GAPClass() :
   _localName(NULL),
   _advertisingInterval(160),
   _connectable(true),
+  _extendedData(NULL),
+  _extendedDataLength(0),
+  _periodicData(NULL),
+  _periodicDataLength(0),
+  _periodicInterval(0),
+  _legacyCommands(false),
+  _extendedCommands(false),
+  _advertisingSets(0),
+  _periodic(false),
+  _advertiseWhileConnected(false),
+  _nonConnectablePending(false),
+  _connectablePending(false),
+  _nonConnectable(false),
   _serviceData(NULL),
   _serviceDataLength(0),
   _discoverEventHandler(NULL)
@@ -68,6 +88,33 @@ void GAPClass::setLocalName(const char *localName)
   _localName = localName;
 }
 
+void GAPClass::setExtendedAdvertisingData(const uint8_t data[], int length)
+{
+  _extendedData = data;
+  _extendedDataLength = length;
+}
+
+void GAPClass::setPeriodicAdvertisingData(const uint8_t data[], int length)
+{
+  _periodicData = data;
+  _periodicDataLength = length;
+}
+
+void GAPClass::setPeriodicAdvertisingInterval(uint16_t interval)
+{
+  _periodicInterval = interval;
+}
+
+bool GAPClass::extendedAdvertising()
+{
+  return _extendedCommands;
+}
+
+bool GAPClass::periodicAdvertising()
+{
+  return _periodic;
+}
+
 bool GAPClass::advertising()
 {
   return _advertising;
@@ -77,15 +124,162 @@ int GAPClass::advertise()
 {
   uint8_t directBdaddr[6] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
+  // the controller refuses extended advertising commands after legacy ones, and the other way round
+  if (!_legacyCommands && !_extendedCommands && (_extendedData || _periodicData)) {
+    uint64_t features = 0;
+
+    if (HCI.leReadLocalSupportedFeatures(features) == 0 && (features & LE_FEATURE_EXTENDED_ADVERTISING)) {
+      _extendedCommands = true;
+      _periodic = (features & LE_FEATURE_PERIODIC_ADVERTISING) && _periodicData && _periodicInterval;
+    }
+  }
+
+  if (_extendedCommands) {
+    return advertiseExtended();
+  }
+
+  _legacyCommands = true;
+
   uint8_t type = (_connectable) ? 0x00 : (_localName ? 0x02 : 0x03);
 
   _advertising = false;
+  _nonConnectablePending = _connectablePending = _nonConnectable = false;
 
   if (HCI.leSetAdvertisingParameters(_advertisingInterval, _advertisingInterval, type, 0x00, 0x00, directBdaddr, 0x07, 0) != 0) {
     return 0;
   }
 
+  if (updateAdvertisingData() == 0) {
+    return 0;
+  }
+
+  uint8_t scanResponseData[31];
+  uint8_t scanResponseDataLen = buildScanResponseData(scanResponseData);
+
+  if (HCI.leSetScanResponseData(scanResponseDataLen, scanResponseData) != 0) {
+    return 0;
+  }
+
+  if (HCI.leSetAdvertiseEnable(0x01) != 0) {
+    return 0;
+  }
+
+  _advertising = true;
+
+  return 1;
+}
+
+// the legacy advertising as a set with legacy PDUs, which every scanner sees, and an extended set for the rest
+int GAPClass::advertiseExtended()
+{
+  uint8_t handles[2] = { GAP_LEGACY_SET, GAP_EXTENDED_SET };
+
+  // legacy PDUs: ADV_IND, ADV_SCAN_IND or ADV_NONCONN_IND
+  uint16_t properties = (_connectable) ? 0x0013 : (_localName ? 0x0012 : 0x0010);
+
+  _advertising = false;
+
+  // parameters only change while the sets are disabled
+  if (_periodic) {
+    HCI.leSetPeriodicAdvertiseEnable(0x00, GAP_EXTENDED_SET);
+  }
+  HCI.leSetExtendedAdvertiseEnable(0x00, 0, NULL);
+
+  if (HCI.leSetExtendedAdvertisingParameters(GAP_LEGACY_SET, properties, _advertisingInterval, _advertisingInterval,
+                                             0x07, 0x00, 0x00, 0x01, 0x01, 0) != 0) {
+    return 0;
+  }
+  _advertisingSets = 1;
+
+  if (_extendedData || _periodic) {
+    // non-connectable and non-scannable, the data follows on the secondary channels
+    if (HCI.leSetExtendedAdvertisingParameters(GAP_EXTENDED_SET, 0x0000, _advertisingInterval, _advertisingInterval,
+                                               0x07, 0x00, 0x00, 0x01, 0x01, 1) != 0) {
+      return 0;
+    }
+    _advertisingSets = 2;
+
+    if (_periodic && HCI.leSetPeriodicAdvertisingParameters(GAP_EXTENDED_SET, _periodicInterval, _periodicInterval) != 0) {
+      return 0;
+    }
+  }
+
+  if (updateAdvertisingData() == 0) {
+    return 0;
+  }
+
+  uint8_t scanResponseData[31];
+  uint8_t scanResponseDataLen = buildScanResponseData(scanResponseData);
+
+  if (HCI.leSetExtendedScanResponseData(GAP_LEGACY_SET, scanResponseDataLen, scanResponseData) != 0) {
+    return 0;
+  }
+
+  if (_periodic && HCI.leSetPeriodicAdvertiseEnable(0x01, GAP_EXTENDED_SET) != 0) {
+    return 0;
+  }
+
+  if (HCI.leSetExtendedAdvertiseEnable(0x01, _advertisingSets, handles) != 0) {
+    return 0;
+  }
+
+  _advertising = true;
+
+  return 1;
+}
+
+int GAPClass::updateAdvertisingData()
+{
   uint8_t advertisingData[31];
+  uint8_t advertisingDataLen = buildAdvertisingData(advertisingData);
+
+  if (!_extendedCommands) {
+    // legacy advertising takes new data while it is enabled
+    return (HCI.leSetAdvertisingData(advertisingDataLen, advertisingData) == 0) ? 1 : 0;
+  }
+
+  // so do the sets, as long as the data of each fits one command
+  if (HCI.leSetExtendedAdvertisingData(GAP_LEGACY_SET, advertisingDataLen, advertisingData) != 0) {
+    return 0;
+  }
+
+  if (_advertisingSets > 1 && HCI.leSetExtendedAdvertisingData(GAP_EXTENDED_SET, _extendedData ? _extendedDataLength : 0, _extendedData) != 0) {
+    return 0;
+  }
+
+  if (_periodic && HCI.leSetPeriodicAdvertisingData(GAP_EXTENDED_SET, _periodicData ? _periodicDataLength : 0, _periodicData) != 0) {
+    return 0;
+  }
+
+  return 1;
+}
+
+uint8_t GAPClass::buildScanResponseData(uint8_t scanResponseData[31])
+{
+  uint8_t scanResponseDataLen = 0;
+
+  if (_localName) {
+    int localNameLen = strlen(_localName);
+
+    if (localNameLen > 29) {
+      localNameLen = 29;
+      scanResponseData[1] = 0x08;
+    } else {
+      scanResponseData[1] = 0x09;
+    }
+
+    scanResponseData[0] = 1 + localNameLen;
+
+    memcpy(&scanResponseData[2], _localName, localNameLen);
+
+    scanResponseDataLen += (2 + localNameLen);
+  }
+
+  return scanResponseDataLen;
+}
+
+uint8_t GAPClass::buildAdvertisingData(uint8_t advertisingData[31])
+{
   uint8_t advertisingDataLen = 0;
 
   advertisingData[0] = 0x02;
@@ -102,7 +296,10 @@ int GAPClass::advertise()
     memcpy(&advertisingData[advertisingDataLen], uuid.data(), uuidLen);
 
     advertisingDataLen += uuidLen;
-  } else if (_manufacturerData && _manufacturerDataLength) {
+  }
+
+  // next to the service UUID when both fit
+  if (_manufacturerData && _manufacturerDataLength && advertisingDataLen + 2 + _manufacturerDataLength <= 31) {
     advertisingData[advertisingDataLen++] = 1 + _manufacturerDataLength;
     advertisingData[advertisingDataLen++] = 0xff;
     memcpy(&advertisingData[advertisingDataLen], _manufacturerData, _manufacturerDataLength);
@@ -110,7 +307,7 @@ int GAPClass::advertise()
     advertisingDataLen += _manufacturerDataLength;
   }
 
-  if (_serviceData && _serviceDataLength > 0 && advertisingDataLen >= (_serviceDataLength + 4)) {
+  if (_serviceData && _serviceDataLength > 0 && advertisingDataLen + 4 + _serviceDataLength <= 31) {
     advertisingData[advertisingDataLen++] = _serviceDataLength + 3;
     advertisingData[advertisingDataLen++] = 0x16;
 
@@ -121,48 +318,80 @@ int GAPClass::advertise()
     advertisingDataLen += _serviceDataLength;
   }
 
-  if (HCI.leSetAdvertisingData(advertisingDataLen, advertisingData) != 0) {
-    return 0;
-  }
-
-  uint8_t scanResponseData[31];
-  uint8_t scanResponseDataLen = 0;
+  return advertisingDataLen;
+}
 
-  if (_localName) {
-    int localNameLen = strlen(_localName);
+void GAPClass::stopAdvertise()
+{
+  _advertising = false;
+  _nonConnectablePending = _connectablePending = _nonConnectable = false;
 
-    if (localNameLen > 29) {
-      localNameLen = 29;
-      scanResponseData[1] = 0x08;
-    } else {
-      scanResponseData[1] = 0x09;
+  if (_extendedCommands) {
+    if (_periodic) {
+      HCI.leSetPeriodicAdvertiseEnable(0x00, GAP_EXTENDED_SET);
     }
+    HCI.leSetExtendedAdvertiseEnable(0x00, 0, NULL);
+    return;
+  }
 
-    scanResponseData[0] = 1 + localNameLen;
+  HCI.leSetAdvertiseEnable(0x00);
+}
 
-    memcpy(&scanResponseData[2], _localName, localNameLen);
+void GAPClass::resumeAdvertising()
+{
+  uint8_t handles[2] = { GAP_LEGACY_SET, GAP_EXTENDED_SET };
 
-    scanResponseDataLen += (2 + localNameLen);
+  // stopAdvertise() ended all of them, they stay off until the next advertise()
+  if (!_advertising) {
+    return;
   }
 
-  if (HCI.leSetScanResponseData(scanResponseDataLen, scanResponseData) != 0) {
-    return 0;
+  if (!_extendedCommands) {
+    _nonConnectablePending = false;
+    if (_nonConnectable) {
+      // the parameters change only while it is off, poll() does that
+      _connectablePending = true;
+      return;
+    }
+    HCI.leSetAdvertiseEnable(0x01);
+    return;
   }
 
-  if (HCI.leSetAdvertiseEnable(0x01) != 0) {
-    return 0;
+  // the connection only ended the legacy set
+  if (_periodic) {
+    HCI.leSetPeriodicAdvertiseEnable(0x01, GAP_EXTENDED_SET);
   }
+  HCI.leSetExtendedAdvertiseEnable(0x01, _advertisingSets, handles);
+}
 
-  _advertising = false;
-
-  return 1;
+void GAPClass::handleConnection()
+{
+  if (_advertising && _advertiseWhileConnected && !_extendedCommands && _connectable) {
+    _nonConnectablePending = true;
+  }
 }
 
-void GAPClass::stopAdvertise()
+void GAPClass::poll()
 {
-  _advertising = false;
+  uint8_t directBdaddr[6] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
-  HCI.leSetAdvertiseEnable(0x00);
+  if (_nonConnectablePending) {
+    _nonConnectablePending = false;
+
+    // the connection ended the advertising, the data stays
+    if (HCI.leSetAdvertisingParameters(_advertisingInterval, _advertisingInterval, _localName ? 0x02 : 0x03,
+                                       0x00, 0x00, directBdaddr, 0x07, 0) == 0) {
+      _nonConnectable = true;
+      HCI.leSetAdvertiseEnable(0x01);
+    }
+  } else if (_connectablePending) {
+    _connectablePending = false;
+    _nonConnectable = false;
+
+    HCI.leSetAdvertiseEnable(0x00);
+    HCI.leSetAdvertisingParameters(_advertisingInterval, _advertisingInterval, 0x00, 0x00, 0x00, directBdaddr, 0x07, 0);
+    HCI.leSetAdvertiseEnable(0x01);
+  }
 }
 
 int GAPClass::scan(bool withDuplicates)
@@ -252,6 +481,11 @@ void GAPClass::setAdvertisingInterval(uint16_t advertisingInterval)
   _advertisingInterval = advertisingInterval;
 }
 
+void GAPClass::setAdvertiseWhileConnected(bool enable)
+{
+  _advertiseWhileConnected = enable;
+}
+
 void GAPClass::setConnectable(bool connectable)
 {
   _connectable = connectable;
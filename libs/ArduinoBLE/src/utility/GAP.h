@@ -34,8 +34,27 @@ public:
   void setManufacturerData(const uint16_t companyId, const uint8_t manufacturerData[], int manufacturerDataLength);
   void setLocalName(const char *localName);
 
+  // BLE 5 advertising sets, for controllers that support them: AD structures of up to 251 bytes in
+  // a second, non-connectable set next to the legacy one, and periodic advertising of that set with
+  // an interval in 1.25 ms (0 turns it off). Set before the first advertise(), after that the
+  // controller only takes the kind of advertising commands it got first.
+  void setExtendedAdvertisingData(const uint8_t data[], int length);
+  void setPeriodicAdvertisingData(const uint8_t data[], int length);
+  void setPeriodicAdvertisingInterval(uint16_t interval);
+  bool extendedAdvertising();
+  bool periodicAdvertising();
+
+  // legacy advertising goes on non-connectable while a central is connected, e.g. for data in the
+  // advertising packets; the extended set of BLE 5 keeps running anyway
+  void setAdvertiseWhileConnected(bool enable);
+  // called after HCI.poll(), outside of event handling: switches the legacy advertising after a
+  // connection started or ended
+  void poll();
+
   bool advertising();
   int advertise();
+  // sends the advertising data again, e.g. after the manufacturer data changed in place
+  int updateAdvertisingData();
   void stopAdvertise();
 
   int scan(bool withDuplicates);
@@ -60,9 +79,16 @@ protected:
 
   void handleLeAdvertisingReport(uint8_t type, uint8_t addressType, uint8_t address[6],
                                   uint8_t eirLength, uint8_t eirData[], int8_t rssi);
+  // a connection ended the connectable advertising, restart it unless stopAdvertise() was called
+  void resumeAdvertising();
+  // a central connected to the connectable advertising
+  void handleConnection();
 
 private:
   bool matchesScanFilter(const BLEDevice& device);
+  uint8_t buildAdvertisingData(uint8_t advertisingData[31]);
+  uint8_t buildScanResponseData(uint8_t scanResponseData[31]);
+  int advertiseExtended();
 
 private:
   bool _advertising;
@@ -75,6 +101,22 @@ private:
   uint16_t _advertisingInterval;
   bool _connectable;
 
+  const uint8_t* _extendedData;
+  int _extendedDataLength;
+  const uint8_t* _periodicData;
+  int _periodicDataLength;
+  uint16_t _periodicInterval;
+  bool _legacyCommands;
+  bool _extendedCommands;
+  uint8_t _advertisingSets;
+  bool _periodic;
+
+  bool _advertiseWhileConnected;
+  // legacy advertising to switch by poll(), and whether it runs non-connectable now
+  bool _nonConnectablePending;
+  bool _connectablePending;
+  bool _nonConnectable;
+
   uint16_t _serviceDataUuid;
   const uint8_t* _serviceData;
   int _serviceDataLength;
@@ -20,6 +20,7 @@
 #include "ATT.h"
 #include "GAP.h"
 #include "HCITransport.h"
+#include "L2CAPCoC.h"
 #include "L2CAPSignaling.h"
 
 #include "HCI.h"
@@ -36,6 +37,9 @@
 
 #define EVT_LE_CONN_COMPLETE      0x01
 #define EVT_LE_ADVERTISING_REPORT 0x02
+#define EVT_LE_CONN_UPDATE_COMPLETE 0x03
+#define EVT_LE_DATA_LENGTH_CHANGE 0x07
+#define EVT_LE_PHY_UPDATE_COMPLETE 0x0c
 
 #define OGF_LINK_CTL           0x01
 #define OGF_HOST_CTL           0x03
@@ -58,7 +62,9 @@
 #define OCF_READ_RSSI          0x0005
 
 // OGF_LE_CTL
+#define OCF_LE_SET_EVENT_MASK             0x0001
 #define OCF_LE_READ_BUFFER_SIZE           0x0002
+#define OCF_LE_READ_LOCAL_FEATURES        0x0003
 #define OCF_LE_SET_RANDOM_ADDRESS         0x0005
 #define OCF_LE_SET_ADVERTISING_PARAMETERS 0x0006
 #define OCF_LE_SET_ADVERTISING_DATA       0x0008
@@ -69,13 +75,40 @@
 #define OCF_LE_CREATE_CONN                0x000d
 #define OCF_LE_CANCEL_CONN                0x000e
 #define OCF_LE_CONN_UPDATE                0x0013
+#define OCF_LE_SET_DATA_LENGTH            0x0022
+#define OCF_LE_SET_PHY                    0x0032
+#define OCF_LE_SET_EXT_ADV_PARAMETERS     0x0036
+#define OCF_LE_SET_EXT_ADV_DATA           0x0037
+#define OCF_LE_SET_EXT_SCAN_RESPONSE_DATA 0x0038
+#define OCF_LE_SET_EXT_ADV_ENABLE         0x0039
+#define OCF_LE_SET_PERIODIC_ADV_PARAMS    0x003e
+#define OCF_LE_SET_PERIODIC_ADV_DATA      0x003f
+#define OCF_LE_SET_PERIODIC_ADV_ENABLE    0x0040
+
+// Operation of the extended and periodic data commands: all of it in one command
+#define LE_ADV_DATA_COMPLETE              0x03
+#define LE_ADV_DATA_MAX                   251
+
+// LL PDU defaults of the 1M PHY, before Data Length Extension
+#define LE_DEFAULT_OCTETS 27
+#define LE_DEFAULT_TIME   328
 
 #define HCI_OE_USER_ENDED_CONNECTION 0x13
 
 HCIClass::HCIClass() :
   _debug(NULL),
   _recvIndex(0),
-  _pendingPkt(0)
+  _pendingPkt(0),
+  _aclPktLen(27),
+  _txOctets(LE_DEFAULT_OCTETS),
+  _txTime(LE_DEFAULT_TIME),
+  _rxOctets(LE_DEFAULT_OCTETS),
+  _rxTime(LE_DEFAULT_TIME),
+  _connInterval(0),
+  _connLatency(0),
+  _connTimeout(0),
+  _txPhy(0),
+  _rxPhy(0)
 {
 }
 
@@ -237,7 +270,7 @@ int HCIClass::readLeBufferSize(uint16_t& pktLen, uint8_t& maxPkt)
       uint8_t maxPkt;
     } *leBufferSize = (HCILeBufferSize*)_cmdResponse;
 
-    pktLen = leBufferSize->pktLen;
+    _aclPktLen = pktLen = leBufferSize->pktLen;
     _maxPkt = maxPkt = leBufferSize->maxPkt;
 
 #ifndef __AVR__
@@ -413,7 +446,7 @@ int HCIClass::leConnUpdate(uint16_t handle, uint16_t minInterval, uint16_t maxIn
   return sendCommand(OGF_LE_CTL << 10 | OCF_LE_CONN_UPDATE, sizeof(leConnUpdateData), &leConnUpdateData);
 }
 
-int HCIClass::sendAclPkt(uint16_t handle, uint8_t cid, uint8_t plen, void* data)
+int HCIClass::sendAclPkt(uint16_t handle, uint16_t cid, uint8_t plen, void* data)
 {
   while (_pendingPkt >= _maxPkt) {
     poll();
@@ -441,6 +474,244 @@ int HCIClass::sendAclPkt(uint16_t handle, uint8_t cid, uint8_t plen, void* data)
   return 0;
 }
 
+int HCIClass::leSetEventMask(uint64_t leEventMask)
+{
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_EVENT_MASK, sizeof(leEventMask), &leEventMask);
+}
+
+int HCIClass::leSetDataLength(uint16_t handle, uint16_t txOctets, uint16_t txTime)
+{
+  struct __attribute__ ((packed)) HCILeSetDataLength {
+    uint16_t handle;
+    uint16_t txOctets;
+    uint16_t txTime;
+  } leSetDataLengthData = { handle, txOctets, txTime };
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_DATA_LENGTH, sizeof(leSetDataLengthData), &leSetDataLengthData);
+}
+
+void HCIClass::leDataLength(uint16_t& txOctets, uint16_t& txTime, uint16_t& rxOctets, uint16_t& rxTime) const
+{
+  txOctets = _txOctets;
+  txTime = _txTime;
+  rxOctets = _rxOctets;
+  rxTime = _rxTime;
+}
+
+// txPhys and rxPhys are masks of the PHYs the host prefers: 0x01 1M, 0x02 2M, 0x04 Coded
+int HCIClass::leSetPhy(uint16_t handle, uint8_t txPhys, uint8_t rxPhys)
+{
+  struct __attribute__ ((packed)) HCILeSetPhy {
+    uint16_t handle;
+    uint8_t allPhys;
+    uint8_t txPhys;
+    uint8_t rxPhys;
+    uint16_t phyOptions;
+  } leSetPhyData = { handle, 0x00, txPhys, rxPhys, 0x0000 };
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_PHY, sizeof(leSetPhyData), &leSetPhyData);
+}
+
+// 0x01 1M, 0x02 2M, 0x03 Coded, 0 without connection
+void HCIClass::lePhy(uint8_t& txPhy, uint8_t& rxPhy) const
+{
+  txPhy = _txPhy;
+  rxPhy = _rxPhy;
+}
+
+// interval in 1.25 ms, supervision timeout in 10 ms units, 0 without connection
+void HCIClass::leConnParams(uint16_t& interval, uint16_t& latency, uint16_t& supervisionTimeout) const
+{
+  interval = _connInterval;
+  latency = _connLatency;
+  supervisionTimeout = _connTimeout;
+}
+
+// bit 12 LE Extended Advertising, bit 13 LE Periodic Advertising
+int HCIClass::leReadLocalSupportedFeatures(uint64_t& features)
+{
+  int result = sendCommand(OGF_LE_CTL << 10 | OCF_LE_READ_LOCAL_FEATURES);
+
+  if (result == 0) {
+    memcpy(&features, _cmdResponse, sizeof(features));
+  }
+
+  return result;
+}
+
+// intervals in 0.625 ms like the legacy ones, but 24 bits wide; PHYs 0x01 1M, 0x02 2M, 0x03 Coded
+int HCIClass::leSetExtendedAdvertisingParameters(uint8_t handle, uint16_t properties,
+                                                 uint32_t minInterval, uint32_t maxInterval,
+                                                 uint8_t chanMap, uint8_t ownBdaddrType, uint8_t filter,
+                                                 uint8_t primaryPhy, uint8_t secondaryPhy, uint8_t sid)
+{
+  struct __attribute__ ((packed)) HCILeSetExtAdvParameters {
+    uint8_t handle;
+    uint16_t properties;
+    uint8_t minInterval[3];
+    uint8_t maxInterval[3];
+    uint8_t chanMap;
+    uint8_t ownBdaddrType;
+    uint8_t peerBdaddrType;
+    uint8_t peerBdaddr[6];
+    uint8_t filter;
+    int8_t txPower;
+    uint8_t primaryPhy;
+    uint8_t secondaryMaxSkip;
+    uint8_t secondaryPhy;
+    uint8_t sid;
+    uint8_t scanRequestNotify;
+  } leExtAdvParameters;
+
+  memset(&leExtAdvParameters, 0, sizeof(leExtAdvParameters));
+  leExtAdvParameters.handle = handle;
+  leExtAdvParameters.properties = properties;
+  for (int i = 0; i < 3; i++) {
+    leExtAdvParameters.minInterval[i] = (minInterval >> (8 * i)) & 0xff;
+    leExtAdvParameters.maxInterval[i] = (maxInterval >> (8 * i)) & 0xff;
+  }
+  leExtAdvParameters.chanMap = chanMap;
+  leExtAdvParameters.ownBdaddrType = ownBdaddrType;
+  leExtAdvParameters.filter = filter;
+  leExtAdvParameters.txPower = 0x7f; // no preference
+  leExtAdvParameters.primaryPhy = primaryPhy;
+  leExtAdvParameters.secondaryPhy = secondaryPhy;
+  leExtAdvParameters.sid = sid;
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_EXT_ADV_PARAMETERS, sizeof(leExtAdvParameters), &leExtAdvParameters);
+}
+
+// up to 251 bytes in one command, which the controller may also change while the set is enabled
+int HCIClass::leSetExtendedAdvertisingData(uint8_t handle, uint8_t length, const uint8_t data[])
+{
+  struct __attribute__ ((packed)) HCILeSetExtAdvData {
+    uint8_t handle;
+    uint8_t operation;
+    uint8_t fragmentPreference;
+    uint8_t length;
+    uint8_t data[LE_ADV_DATA_MAX];
+  } leExtAdvData;
+
+  if (length > LE_ADV_DATA_MAX) {
+    return -1;
+  }
+
+  leExtAdvData.handle = handle;
+  leExtAdvData.operation = LE_ADV_DATA_COMPLETE;
+  leExtAdvData.fragmentPreference = 0x01; // as few fragments as possible
+  leExtAdvData.length = length;
+  memcpy(leExtAdvData.data, data, length);
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_EXT_ADV_DATA, 4 + length, &leExtAdvData);
+}
+
+int HCIClass::leSetExtendedScanResponseData(uint8_t handle, uint8_t length, const uint8_t data[])
+{
+  struct __attribute__ ((packed)) HCILeSetExtScanResponseData {
+    uint8_t handle;
+    uint8_t operation;
+    uint8_t fragmentPreference;
+    uint8_t length;
+    uint8_t data[LE_ADV_DATA_MAX];
+  } leExtScanResponseData;
+
+  if (length > LE_ADV_DATA_MAX) {
+    return -1;
+  }
+
+  leExtScanResponseData.handle = handle;
+  leExtScanResponseData.operation = LE_ADV_DATA_COMPLETE;
+  leExtScanResponseData.fragmentPreference = 0x01;
+  leExtScanResponseData.length = length;
+  memcpy(leExtScanResponseData.data, data, length);
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_EXT_SCAN_RESPONSE_DATA, 4 + length, &leExtScanResponseData);
+}
+
+// enables or disables the sets without duration or event limit, disabling with no sets disables all of them
+int HCIClass::leSetExtendedAdvertiseEnable(uint8_t enable, uint8_t numSets, const uint8_t handles[])
+{
+  struct __attribute__ ((packed)) HCILeSetExtAdvEnable {
+    uint8_t enable;
+    uint8_t numSets;
+    struct __attribute__ ((packed)) {
+      uint8_t handle;
+      uint16_t duration;
+      uint8_t maxEvents;
+    } sets[4];
+  } leExtAdvEnable;
+
+  if (numSets > 4) {
+    return -1;
+  }
+
+  leExtAdvEnable.enable = enable;
+  leExtAdvEnable.numSets = numSets;
+  for (int i = 0; i < numSets; i++) {
+    leExtAdvEnable.sets[i].handle = handles[i];
+    leExtAdvEnable.sets[i].duration = 0;
+    leExtAdvEnable.sets[i].maxEvents = 0;
+  }
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_EXT_ADV_ENABLE, 2 + 4 * numSets, &leExtAdvEnable);
+}
+
+// intervals in 1.25 ms, the set must be non-connectable and non-scannable
+int HCIClass::leSetPeriodicAdvertisingParameters(uint8_t handle, uint16_t minInterval, uint16_t maxInterval)
+{
+  struct __attribute__ ((packed)) HCILeSetPeriodicAdvParameters {
+    uint8_t handle;
+    uint16_t minInterval;
+    uint16_t maxInterval;
+    uint16_t properties;
+  } lePeriodicAdvParameters = { handle, minInterval, maxInterval, 0x0000 };
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_PERIODIC_ADV_PARAMS, sizeof(lePeriodicAdvParameters), &lePeriodicAdvParameters);
+}
+
+int HCIClass::leSetPeriodicAdvertisingData(uint8_t handle, uint8_t length, const uint8_t data[])
+{
+  struct __attribute__ ((packed)) HCILeSetPeriodicAdvData {
+    uint8_t handle;
+    uint8_t operation;
+    uint8_t length;
+    uint8_t data[LE_ADV_DATA_MAX];
+  } lePeriodicAdvData;
+
+  if (length > LE_ADV_DATA_MAX) {
+    return -1;
+  }
+
+  lePeriodicAdvData.handle = handle;
+  lePeriodicAdvData.operation = LE_ADV_DATA_COMPLETE;
+  lePeriodicAdvData.length = length;
+  memcpy(lePeriodicAdvData.data, data, length);
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_PERIODIC_ADV_DATA, 3 + length, &lePeriodicAdvData);
+}
+
+int HCIClass::leSetPeriodicAdvertiseEnable(uint8_t enable, uint8_t handle)
+{
+  struct __attribute__ ((packed)) HCILeSetPeriodicAdvEnable {
+    uint8_t enable;
+    uint8_t handle;
+  } lePeriodicAdvEnable = { enable, handle };
+
+  return sendCommand(OGF_LE_CTL << 10 | OCF_LE_SET_PERIODIC_ADV_ENABLE, sizeof(lePeriodicAdvEnable), &lePeriodicAdvEnable);
+}
+
+// the longest ACL packet the controller takes, L2CAP header included
+uint16_t HCIClass::aclPktLen() const
+{
+  return _aclPktLen;
+}
+
+// ACL packets the controller takes before sendAclPkt() has to wait for one to complete
+int HCIClass::availableAclPkts() const
+{
+  return (_pendingPkt < _maxPkt) ? (_maxPkt - _pendingPkt) : 0;
+}
+
 int HCIClass::disconnect(uint16_t handle)
 {
     struct __attribute__ ((packed)) HCIDisconnectData {
@@ -531,6 +802,9 @@ void HCIClass::handleAclDataPkt(uint8_t /*plen*/, uint8_t pdata[])
     }
   } else if (aclHdr->cid == SIGNALING_CID) {
     L2CAPSignaling.handleData(aclHdr->handle & 0x0fff, aclHdr->len, &_recvBuffer[1 + sizeof(HCIACLHdr)]);
+  } else if (L2CAPCoC.handleData(aclHdr->handle & 0x0fff, aclHdr->cid, aclHdr->len,
+                                 (aclFlags == 0x01) ? &_aclPktBuffer[sizeof(HCIACLHdr)] : &_recvBuffer[1 + sizeof(HCIACLHdr)])) {
+    // K-frame of the credit based channel
   } else {
     struct __attribute__ ((packed)) {
       uint8_t op;
@@ -570,8 +844,14 @@ void HCIClass::handleEventPkt(uint8_t /*plen*/, uint8_t pdata[])
 
     ATT.removeConnection(disconnComplete->handle, disconnComplete->reason);
     L2CAPSignaling.removeConnection(disconnComplete->handle, disconnComplete->reason);
+    L2CAPCoC.removeConnection(disconnComplete->handle, disconnComplete->reason);
+
+    _txOctets = _rxOctets = LE_DEFAULT_OCTETS;
+    _txTime = _rxTime = LE_DEFAULT_TIME;
+    _connInterval = _connLatency = _connTimeout = 0;
+    _txPhy = _rxPhy = 0;
 
-    HCI.leSetAdvertiseEnable(0x01);
+    GAP.resumeAdvertising();
   } else if (eventHdr->evt == EVT_CMD_COMPLETE) {
     struct __attribute__ ((packed)) CmdComplete {
       uint8_t ncmd;
@@ -622,6 +902,11 @@ void HCIClass::handleEventPkt(uint8_t /*plen*/, uint8_t pdata[])
       } *leConnectionComplete = (EvtLeConnectionComplete*)&pdata[sizeof(HCIEventHdr) + sizeof(LeMetaEventHeader)];
     
       if (leConnectionComplete->status == 0x00) {
+        _connInterval = leConnectionComplete->interval;
+        _connLatency = leConnectionComplete->latency;
+        _connTimeout = leConnectionComplete->supervisionTimeout;
+        _txPhy = _rxPhy = 0x01;
+
         ATT.addConnection(leConnectionComplete->handle,
                           leConnectionComplete->role,
                           leConnectionComplete->peerBdaddrType,
@@ -639,6 +924,11 @@ void HCIClass::handleEventPkt(uint8_t /*plen*/, uint8_t pdata[])
                               leConnectionComplete->latency,
                               leConnectionComplete->supervisionTimeout,
                               leConnectionComplete->masterClockAccuracy);
+
+        // slave role, a central connected to our advertising
+        if (leConnectionComplete->role == 0x01) {
+          GAP.handleConnection();
+        }
       }
     } else if (leMetaHeader->subevent == EVT_LE_ADVERTISING_REPORT) {
       struct __attribute__ ((packed)) EvtLeAdvertisingReport {
@@ -662,6 +952,45 @@ void HCIClass::handleEventPkt(uint8_t /*plen*/, uint8_t pdata[])
                                       rssi);
 
       }
+    } else if (leMetaHeader->subevent == EVT_LE_DATA_LENGTH_CHANGE) {
+      struct __attribute__ ((packed)) EvtLeDataLengthChange {
+        uint16_t handle;
+        uint16_t maxTxOctets;
+        uint16_t maxTxTime;
+        uint16_t maxRxOctets;
+        uint16_t maxRxTime;
+      } *leDataLengthChange = (EvtLeDataLengthChange*)&pdata[sizeof(HCIEventHdr) + sizeof(LeMetaEventHeader)];
+
+      _txOctets = leDataLengthChange->maxTxOctets;
+      _txTime = leDataLengthChange->maxTxTime;
+      _rxOctets = leDataLengthChange->maxRxOctets;
+      _rxTime = leDataLengthChange->maxRxTime;
+    } else if (leMetaHeader->subevent == EVT_LE_CONN_UPDATE_COMPLETE) {
+      struct __attribute__ ((packed)) EvtLeConnUpdateComplete {
+        uint8_t status;
+        uint16_t handle;
+        uint16_t interval;
+        uint16_t latency;
+        uint16_t supervisionTimeout;
+      } *leConnUpdateComplete = (EvtLeConnUpdateComplete*)&pdata[sizeof(HCIEventHdr) + sizeof(LeMetaEventHeader)];
+
+      if (leConnUpdateComplete->status == 0x00) {
+        _connInterval = leConnUpdateComplete->interval;
+        _connLatency = leConnUpdateComplete->latency;
+        _connTimeout = leConnUpdateComplete->supervisionTimeout;
+      }
+    } else if (leMetaHeader->subevent == EVT_LE_PHY_UPDATE_COMPLETE) {
+      struct __attribute__ ((packed)) EvtLePhyUpdateComplete {
+        uint8_t status;
+        uint16_t handle;
+        uint8_t txPhy;
+        uint8_t rxPhy;
+      } *lePhyUpdateComplete = (EvtLePhyUpdateComplete*)&pdata[sizeof(HCIEventHdr) + sizeof(LeMetaEventHeader)];
+
+      if (lePhyUpdateComplete->status == 0x00) {
+        _txPhy = lePhyUpdateComplete->txPhy;
+        _rxPhy = lePhyUpdateComplete->rxPhy;
+      }
     }
   }
 }
@@ -62,9 +62,28 @@ public:
   int leConnUpdate(uint16_t handle, uint16_t minInterval, uint16_t maxInterval, 
                   uint16_t latency, uint16_t supervisionTimeout);
   int leCancelConn();
-
-
-  int sendAclPkt(uint16_t handle, uint8_t cid, uint8_t plen, void* data);
+  int leSetEventMask(uint64_t leEventMask);
+  int leSetDataLength(uint16_t handle, uint16_t txOctets, uint16_t txTime);
+  void leDataLength(uint16_t& txOctets, uint16_t& txTime, uint16_t& rxOctets, uint16_t& rxTime) const;
+  int leSetPhy(uint16_t handle, uint8_t txPhys, uint8_t rxPhys);
+  void lePhy(uint8_t& txPhy, uint8_t& rxPhy) const;
+  void leConnParams(uint16_t& interval, uint16_t& latency, uint16_t& supervisionTimeout) const;
+  int leReadLocalSupportedFeatures(uint64_t& features);
+  int leSetExtendedAdvertisingParameters(uint8_t handle, uint16_t properties,
+                                         uint32_t minInterval, uint32_t maxInterval,
+                                         uint8_t chanMap, uint8_t ownBdaddrType, uint8_t filter,
+                                         uint8_t primaryPhy, uint8_t secondaryPhy, uint8_t sid);
+  int leSetExtendedAdvertisingData(uint8_t handle, uint8_t length, const uint8_t data[]);
+  int leSetExtendedScanResponseData(uint8_t handle, uint8_t length, const uint8_t data[]);
+  int leSetExtendedAdvertiseEnable(uint8_t enable, uint8_t numSets, const uint8_t handles[]);
+  int leSetPeriodicAdvertisingParameters(uint8_t handle, uint16_t minInterval, uint16_t maxInterval);
+  int leSetPeriodicAdvertisingData(uint8_t handle, uint8_t length, const uint8_t data[]);
+  int leSetPeriodicAdvertiseEnable(uint8_t enable, uint8_t handle);
+
+
+  int sendAclPkt(uint16_t handle, uint16_t cid, uint8_t plen, void* data);
+  int availableAclPkts() const;
+  uint16_t aclPktLen() const;
 
   int disconnect(uint16_t handle);
 
@@ -92,6 +111,20 @@ private:
 
   uint8_t _maxPkt;
   uint8_t _pendingPkt;
+  uint16_t _aclPktLen;
+
+  // last LE Data Length Change event, the defaults until then
+  uint16_t _txOctets;
+  uint16_t _txTime;
+  uint16_t _rxOctets;
+  uint16_t _rxTime;
+
+  // parameters of the connection, from its connection, update and PHY update events
+  uint16_t _connInterval;
+  uint16_t _connLatency;
+  uint16_t _connTimeout;
+  uint8_t _txPhy;
+  uint8_t _rxPhy;
 
   uint8_t _aclPktBuffer[255];
 };
@@ -165,7 +165,14 @@ static void bleLoop()
 }
 
 static rtos::EventFlags bleEventFlags; 
-static rtos::Thread bleLoopThread;
+
+#ifndef BLE_LOOP_STACK_SIZE
+#define BLE_LOOP_STACK_SIZE OS_STACK_SIZE
+#endif
+
+// static and painted with the RTX watermark pattern, so the stack use can be measured
+MBED_ALIGN(8) static unsigned char bleLoopStack[BLE_LOOP_STACK_SIZE];
+static rtos::Thread bleLoopThread(osPriorityNormal, sizeof(bleLoopStack), bleLoopStack, "bleLoopThread");
 
 
 HCICordioTransportClass::HCICordioTransportClass() :
@@ -189,6 +196,7 @@ int HCICordioTransportClass::begin()
   CordioHCIHook::getDriver().initialize();
   CordioHCIHook::getDriver().start_reset_sequence();
 
+  memset(bleLoopStack, 0xCC, sizeof(bleLoopStack));
   bleLoopThread.start(bleLoop);
 
   CordioHCIHook::setDataReceivedHandler(HCICordioTransportClass::onDataReceived);
@@ -217,6 +225,11 @@ void HCICordioTransportClass::wait(unsigned long timeout)
   bleEventFlags.wait_all(0x01, timeout, true);
 }
 
+void HCICordioTransportClass::wakeup()
+{
+  bleEventFlags.set(0x01);
+}
+
 int HCICordioTransportClass::available()
 {
   return _rxBuf.available();
@@ -35,6 +35,7 @@ public:
   virtual void end();
 
   virtual void wait(unsigned long timeout);
+  virtual void wakeup();
 
   virtual int available();
   virtual int peek();
@@ -28,6 +28,8 @@ public:
   virtual void end() = 0;
 
   virtual void wait(unsigned long timeout) = 0;
+  // ends a wait() of another thread early, for work that is not HCI data
+  virtual void wakeup() {}
 
   virtual int available() = 0;
   virtual int peek() = 0;
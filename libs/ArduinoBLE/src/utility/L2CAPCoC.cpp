@@ -0,0 +1,342 @@
+/*
+  This file is part of the ArduinoBLE library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "HCI.h"
+#include "L2CAPSignaling.h"
+
+#include "L2CAPCoC.h"
+
+#define DISCONNECTION_REQUEST                 0x06
+#define DISCONNECTION_RESPONSE                0x07
+#define LE_CREDIT_BASED_CONNECTION_RESPONSE   0x15
+#define LE_FLOW_CONTROL_CREDIT                0x16
+
+#define LE_RESULT_SUCCESS                     0x0000
+#define LE_RESULT_PSM_NOT_SUPPORTED           0x0002
+#define LE_RESULT_NO_RESOURCES                0x0004
+#define LE_RESULT_INVALID_SOURCE_CID          0x0009
+#define LE_RESULT_UNACCEPTABLE_PARAMETERS     0x000B
+
+// the one channel we accept, first of the dynamic range
+#define L2CAP_COC_LOCAL_CID 0x0040
+
+L2CAPCoCClass::L2CAPCoCClass() :
+  _psm(0),
+  _receiveHandler(NULL),
+  _identifier(0x80)
+{
+  reset();
+}
+
+L2CAPCoCClass::~L2CAPCoCClass()
+{
+}
+
+void L2CAPCoCClass::listen(uint16_t psm)
+{
+  _psm = psm;
+}
+
+void L2CAPCoCClass::setReceiveHandler(void (*handler)(const uint8_t* data, uint16_t length))
+{
+  _receiveHandler = handler;
+}
+
+bool L2CAPCoCClass::connected() const
+{
+  return (_handle != 0xffff);
+}
+
+uint16_t L2CAPCoCClass::peerMtu() const
+{
+  return connected() ? _remoteMtu : 0;
+}
+
+bool L2CAPCoCClass::writable() const
+{
+  return connected() && _txLength == 0;
+}
+
+int L2CAPCoCClass::write(const uint8_t* data, uint16_t length)
+{
+  if (!writable() || length == 0 || length > _remoteMtu || length > sizeof(_txBuffer)) {
+    return 0;
+  }
+
+  memcpy(_txBuffer, data, length);
+  _txLength = length;
+  _txOffset = 0;
+
+  return length;
+}
+
+void L2CAPCoCClass::disconnect()
+{
+  if (!connected()) {
+    return;
+  }
+
+  struct __attribute__ ((packed)) L2CAPDisconnectionRequest {
+    uint8_t code;
+    uint8_t identifier;
+    uint16_t length;
+    uint16_t dcid;
+    uint16_t scid;
+  } request = { DISCONNECTION_REQUEST, nextIdentifier(), 4, _remoteCid, L2CAP_COC_LOCAL_CID };
+
+  HCI.sendAclPkt(_handle, SIGNALING_CID, sizeof(request), &request);
+
+  // the response only confirms it, the channel is gone for us
+  reset();
+}
+
+void L2CAPCoCClass::poll()
+{
+  if (!connected()) {
+    return;
+  }
+
+  // hand out credits again once the central used half of them
+  if (_rxCredits <= L2CAP_COC_CREDITS / 2 && HCI.availableAclPkts() > 0) {
+    struct __attribute__ ((packed)) L2CAPFlowControlCredit {
+      uint8_t code;
+      uint8_t identifier;
+      uint16_t length;
+      uint16_t cid;
+      uint16_t credits;
+    } credit = { LE_FLOW_CONTROL_CREDIT, nextIdentifier(), 4, L2CAP_COC_LOCAL_CID, (uint16_t)(L2CAP_COC_CREDITS - _rxCredits) };
+
+    HCI.sendAclPkt(_handle, SIGNALING_CID, sizeof(credit), &credit);
+    _rxCredits = L2CAP_COC_CREDITS;
+  }
+
+  // one K-frame per credit of the central and free ACL buffer, the first one starts with the SDU length
+  uint16_t mps = min(min(_remoteMps, (uint16_t)L2CAP_COC_MPS), (uint16_t)(HCI.aclPktLen() - 4));
+
+  while (_txOffset < _txLength && _txCredits > 0 && HCI.availableAclPkts() > 0) {
+    uint8_t frame[L2CAP_COC_MPS];
+    uint16_t header = 0;
+
+    if (_txOffset == 0) {
+      frame[0] = _txLength & 0xff;
+      frame[1] = _txLength >> 8;
+      header = 2;
+    }
+
+    uint16_t length = min((uint16_t)(mps - header), (uint16_t)(_txLength - _txOffset));
+    memcpy(&frame[header], &_txBuffer[_txOffset], length);
+
+    HCI.sendAclPkt(_handle, _remoteCid, header + length, frame);
+    _txOffset += length;
+    _txCredits--;
+
+    if (_txOffset == _txLength) {
+      _txLength = _txOffset = 0;
+      _sduSent++;
+    }
+  }
+}
+
+void L2CAPCoCClass::connectionRequest(uint16_t handle, uint8_t identifier, uint8_t dlen, uint8_t data[])
+{
+  struct __attribute__ ((packed)) L2CAPLeCreditBasedConnectionRequest {
+    uint16_t psm;
+    uint16_t scid;
+    uint16_t mtu;
+    uint16_t mps;
+    uint16_t initialCredits;
+  } *request = (L2CAPLeCreditBasedConnectionRequest*)data;
+
+  if (dlen < sizeof(L2CAPLeCreditBasedConnectionRequest)) {
+    // too short, ignore
+    return;
+  }
+
+  uint16_t result = LE_RESULT_SUCCESS;
+
+  if (_psm == 0 || request->psm != _psm) {
+    result = LE_RESULT_PSM_NOT_SUPPORTED;
+  } else if (request->scid < 0x0040 || request->scid > 0x007f) {
+    // LE dynamic range
+    result = LE_RESULT_INVALID_SOURCE_CID;
+  } else if (request->mtu < 23 || request->mps < 23) {
+    result = LE_RESULT_UNACCEPTABLE_PARAMETERS;
+  } else if (connected()) {
+    result = LE_RESULT_NO_RESOURCES;
+  }
+
+  bool accepted = (result == LE_RESULT_SUCCESS);
+
+  struct __attribute__ ((packed)) L2CAPLeCreditBasedConnectionResponse {
+    uint8_t code;
+    uint8_t identifier;
+    uint16_t length;
+    uint16_t dcid;
+    uint16_t mtu;
+    uint16_t mps;
+    uint16_t initialCredits;
+    uint16_t result;
+  } response = { LE_CREDIT_BASED_CONNECTION_RESPONSE, identifier, 10,
+                 // a refusal carries zeros, only the result counts
+                 (uint16_t)(accepted ? L2CAP_COC_LOCAL_CID : 0),
+                 (uint16_t)(accepted ? L2CAP_COC_MTU : 0),
+                 (uint16_t)(accepted ? L2CAP_COC_MPS : 0),
+                 (uint16_t)(accepted ? L2CAP_COC_CREDITS : 0), result };
+
+  if (accepted) {
+    reset();
+    _handle = handle;
+    _remoteCid = request->scid;
+    _remoteMtu = request->mtu;
+    _remoteMps = request->mps;
+    _txCredits = request->initialCredits;
+    _rxCredits = L2CAP_COC_CREDITS;
+  }
+
+  HCI.sendAclPkt(handle, SIGNALING_CID, sizeof(response), &response);
+}
+
+void L2CAPCoCClass::flowControlCredit(uint16_t handle, uint8_t dlen, uint8_t data[])
+{
+  struct __attribute__ ((packed)) L2CAPFlowControlCredit {
+    uint16_t cid;
+    uint16_t credits;
+  } *credit = (L2CAPFlowControlCredit*)data;
+
+  if (dlen < sizeof(L2CAPFlowControlCredit) || handle != _handle || credit->cid != _remoteCid) {
+    return;
+  }
+
+  // at most 65535 credits may be outstanding
+  _txCredits = min((uint32_t)_txCredits + credit->credits, (uint32_t)0xffff);
+}
+
+void L2CAPCoCClass::disconnectionRequest(uint16_t handle, uint8_t identifier, uint8_t dlen, uint8_t data[])
+{
+  struct __attribute__ ((packed)) L2CAPDisconnectionRequest {
+    uint16_t dcid;
+    uint16_t scid;
+  } *request = (L2CAPDisconnectionRequest*)data;
+
+  if (dlen < sizeof(L2CAPDisconnectionRequest) || handle != _handle ||
+      request->dcid != L2CAP_COC_LOCAL_CID || request->scid != _remoteCid) {
+    return;
+  }
+
+  struct __attribute__ ((packed)) L2CAPDisconnectionResponse {
+    uint8_t code;
+    uint8_t identifier;
+    uint16_t length;
+    uint16_t dcid;
+    uint16_t scid;
+  } response = { DISCONNECTION_RESPONSE, identifier, 4, request->dcid, request->scid };
+
+  reset();
+  HCI.sendAclPkt(handle, SIGNALING_CID, sizeof(response), &response);
+}
+
+void L2CAPCoCClass::disconnectionResponse(uint16_t /*handle*/, uint8_t /*dlen*/, uint8_t /*data*/[])
+{
+  // disconnect() already released the channel
+}
+
+bool L2CAPCoCClass::handleData(uint16_t handle, uint16_t cid, uint16_t dlen, uint8_t data[])
+{
+  if (cid != L2CAP_COC_LOCAL_CID || handle != _handle) {
+    return false;
+  }
+
+  if (_rxCredits > 0) {
+    _rxCredits--;
+  }
+
+  if (_rxLength == 0) {
+    // first K-frame of an SDU
+    if (dlen < 2) {
+      return true;
+    }
+
+    _rxLength = data[0] | (data[1] << 8);
+    _rxOffset = 0;
+    _rxDropping = (_rxLength > sizeof(_rxBuffer));
+    data += 2;
+    dlen -= 2;
+
+    if (_rxLength == 0) {
+      return true;
+    }
+  }
+
+  // an SDU above our MTU is skipped, the central broke the channel parameters
+  if (!_rxDropping) {
+    memcpy(&_rxBuffer[_rxOffset], data, min(dlen, (uint16_t)(_rxLength - _rxOffset)));
+  }
+  _rxOffset += dlen;
+
+  if (_rxOffset >= _rxLength) {
+    if (!_rxDropping && _receiveHandler) {
+      _receiveHandler(_rxBuffer, _rxLength);
+    }
+    _sduReceived++;
+    _rxLength = 0;
+  }
+
+  return true;
+}
+
+void L2CAPCoCClass::removeConnection(uint16_t handle, uint16_t /*reason*/)
+{
+  if (handle == _handle) {
+    reset();
+  }
+}
+
+void L2CAPCoCClass::counters(uint32_t& sduSent, uint32_t& sduReceived, uint16_t& txCredits) const
+{
+  sduSent = _sduSent;
+  sduReceived = _sduReceived;
+  txCredits = _txCredits;
+}
+
+void L2CAPCoCClass::reset()
+{
+  _handle = 0xffff;
+  _remoteCid = 0;
+  _remoteMtu = 0;
+  _remoteMps = 0;
+  _txCredits = 0;
+  _rxCredits = 0;
+  _txLength = 0;
+  _txOffset = 0;
+  _rxLength = 0;
+  _rxOffset = 0;
+  _rxDropping = false;
+  _sduSent = 0;
+  _sduReceived = 0;
+}
+
+// identifiers of our requests, 0x80 to 0xff so they differ from those of L2CAPSignaling
+uint8_t L2CAPCoCClass::nextIdentifier()
+{
+  _identifier = (_identifier == 0xff) ? 0x80 : _identifier + 1;
+
+  return _identifier;
+}
+
+L2CAPCoCClass L2CAPCoC;
@@ -0,0 +1,97 @@
+/*
+  This file is part of the ArduinoBLE library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _L2CAP_COC_H_
+#define _L2CAP_COC_H_
+
+#include <Arduino.h>
+
+// largest SDU in either direction, both buffers are this size
+#ifndef L2CAP_COC_MTU
+#define L2CAP_COC_MTU 512
+#endif
+
+// largest K-frame we receive, a reassembled ACL packet of HCI holds 255 bytes with its 8 byte header
+#define L2CAP_COC_MPS 247
+
+// K-frames the central may send before we hand out more
+#define L2CAP_COC_CREDITS 8
+
+class L2CAPCoCClass {
+public:
+  L2CAPCoCClass();
+  virtual ~L2CAPCoCClass();
+
+  // accepts one LE credit based channel the central opens on psm, 0 refuses all
+  void listen(uint16_t psm);
+  void setReceiveHandler(void (*handler)(const uint8_t* data, uint16_t length));
+
+  bool connected() const;
+  // the SDU size of the peer, 0 without channel
+  uint16_t peerMtu() const;
+  // true when write() takes an SDU
+  bool writable() const;
+  // copies an SDU of up to peerMtu() bytes, poll() sends it as credits and ACL buffers allow
+  int write(const uint8_t* data, uint16_t length);
+  void disconnect();
+
+  // called after HCI.poll(), outside of event handling
+  void poll();
+
+  void connectionRequest(uint16_t handle, uint8_t identifier, uint8_t dlen, uint8_t data[]);
+  void flowControlCredit(uint16_t handle, uint8_t dlen, uint8_t data[]);
+  void disconnectionRequest(uint16_t handle, uint8_t identifier, uint8_t dlen, uint8_t data[]);
+  void disconnectionResponse(uint16_t handle, uint8_t dlen, uint8_t data[]);
+  bool handleData(uint16_t handle, uint16_t cid, uint16_t dlen, uint8_t data[]);
+  void removeConnection(uint16_t handle, uint16_t reason);
+
+  void counters(uint32_t& sduSent, uint32_t& sduReceived, uint16_t& txCredits) const;
+
+private:
+  void reset();
+  uint8_t nextIdentifier();
+
+private:
+  uint16_t _psm;
+  void (*_receiveHandler)(const uint8_t* data, uint16_t length);
+
+  uint16_t _handle;
+  uint16_t _remoteCid;
+  uint16_t _remoteMtu;
+  uint16_t _remoteMps;
+  uint16_t _txCredits;
+  uint16_t _rxCredits;
+  uint8_t _identifier;
+
+  uint8_t _txBuffer[L2CAP_COC_MTU];
+  uint16_t _txLength;
+  uint16_t _txOffset;
+
+  uint8_t _rxBuffer[L2CAP_COC_MTU];
+  uint16_t _rxLength;
+  uint16_t _rxOffset;
+  bool _rxDropping;
+
+  uint32_t _sduSent;
+  uint32_t _sduReceived;
+};
+
+extern L2CAPCoCClass L2CAPCoC;
+
+#endif
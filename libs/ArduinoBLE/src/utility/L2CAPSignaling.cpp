@@ -18,15 +18,21 @@
 */
 
 #include "HCI.h"
+#include "L2CAPCoC.h"
 
 #include "L2CAPSignaling.h"
 
 #define CONNECTION_PARAMETER_UPDATE_REQUEST  0x12
 #define CONNECTION_PARAMETER_UPDATE_RESPONSE 0x13
+#define DISCONNECTION_REQUEST                0x06
+#define DISCONNECTION_RESPONSE               0x07
+#define LE_CREDIT_BASED_CONNECTION_REQUEST   0x14
+#define LE_FLOW_CONTROL_CREDIT               0x16
 
 L2CAPSignalingClass::L2CAPSignalingClass() :
   _minInterval(0),
-  _maxInterval(0)
+  _maxInterval(0),
+  _identifier(0x01)
 {
 }
 
@@ -95,6 +101,14 @@ void L2CAPSignalingClass::handleData(uint16_t connectionHandle, uint8_t dlen, ui
     connectionParameterUpdateRequest(connectionHandle, identifier, length, data);
   } else if (code == CONNECTION_PARAMETER_UPDATE_RESPONSE) {
     connectionParameterUpdateResponse(connectionHandle, identifier, length, data);
+  } else if (code == LE_CREDIT_BASED_CONNECTION_REQUEST) {
+    L2CAPCoC.connectionRequest(connectionHandle, identifier, length, data);
+  } else if (code == LE_FLOW_CONTROL_CREDIT) {
+    L2CAPCoC.flowControlCredit(connectionHandle, length, data);
+  } else if (code == DISCONNECTION_REQUEST) {
+    L2CAPCoC.disconnectionRequest(connectionHandle, identifier, length, data);
+  } else if (code == DISCONNECTION_RESPONSE) {
+    L2CAPCoC.disconnectionResponse(connectionHandle, length, data);
   }
 }
 
@@ -108,6 +122,28 @@ void L2CAPSignalingClass::setConnectionInterval(uint16_t minInterval, uint16_t m
   _maxInterval = maxInterval;
 }
 
+int L2CAPSignalingClass::requestConnectionParameters(uint16_t handle, uint16_t minInterval, uint16_t maxInterval,
+                                                     uint16_t latency, uint16_t supervisionTimeout)
+{
+  // identifiers of requests are non-zero and differ from the one before
+  if (++_identifier == 0) {
+    _identifier = 0x01;
+  }
+
+  struct __attribute__ ((packed)) L2CAPConnectionParameterUpdateRequest {
+    uint8_t code;
+    uint8_t identifier;
+    uint16_t length;
+    uint16_t minInterval;
+    uint16_t maxInterval;
+    uint16_t latency;
+    uint16_t supervisionTimeout;
+  } request = { CONNECTION_PARAMETER_UPDATE_REQUEST, _identifier, 8,
+                minInterval, maxInterval, latency, supervisionTimeout };
+
+  return HCI.sendAclPkt(handle, SIGNALING_CID, sizeof(request), &request);
+}
+
 void L2CAPSignalingClass::connectionParameterUpdateRequest(uint16_t handle, uint8_t identifier, uint8_t dlen, uint8_t data[])
 {
   struct __attribute__ ((packed)) L2CAPConnectionParameterUpdateRequest {
@@ -40,6 +40,10 @@ public:
 
   void setConnectionInterval(uint16_t minInterval, uint16_t maxInterval);
 
+  // asks the central for new parameters of a connection we are the peripheral of
+  int requestConnectionParameters(uint16_t handle, uint16_t minInterval, uint16_t maxInterval,
+                                  uint16_t latency, uint16_t supervisionTimeout);
+
 private:
   void connectionParameterUpdateRequest(uint16_t handle, uint8_t identifier, uint8_t dlen, uint8_t data[]);
   void connectionParameterUpdateResponse(uint16_t handle, uint8_t identifier, uint8_t dlen, uint8_t data[]);
@@ -47,6 +51,7 @@ private:
 private:
   uint16_t _minInterval;
   uint16_t _maxInterval;
+  uint8_t _identifier;
 };
 
 extern L2CAPSignalingClass L2CAPSignaling;
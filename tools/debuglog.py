@@ -1,14 +1,239 @@
-import serial
+"""
+Print the debug log of the device.
+
+With --elf, frames of the deferred log (QX_LOG_DEFERRED=1, see inc/QxLog.h)
+are decoded: the format strings are read from the ELF file of the same
+build and formatted here. Text outside of frames is printed as it is.
+"""
+
+import re
+import struct
+import sys
+
 import argparse
 
+LOG_SYNC = 0xA5
+LOG_DROPPED = 0x7F
+LOG_LEVELS = {0: 'D', 1: 'C'}
+
+CONVERSION = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L|q)?([diuoxXcspfFeEgGaA%])')
+
+
+class Elf(object):
+    """Sections and symbols of a little endian ELF32 or ELF64 file."""
+
+    def __init__(self, path):
+        self.data = open(path, 'rb').read()
+        if self.data[:4] != b'\x7fELF' or self.data[5] != 1:
+            raise ValueError('%s is not a little endian ELF file' % path)
+        self.is64 = self.data[4] == 2
+        if self.is64:
+            shoff, = struct.unpack_from('<Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from('<HH', self.data, 0x3A)
+        else:
+            shoff, = struct.unpack_from('<I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2E)
+
+        self.sections = []
+        for i in range(shnum):
+            at = shoff + i * shentsize
+            if self.is64:
+                _, stype, _, addr, offset, size, link = struct.unpack_from('<IIQQQQI', self.data, at)
+            else:
+                _, stype, _, addr, offset, size, link = struct.unpack_from('<IIIIIII', self.data, at)
+            self.sections.append((stype, addr, offset, size, link))
+
+    def symbol(self, name):
+        want = name.encode()
+        for stype, _, offset, size, link in self.sections:
+            if stype != 2:  # SHT_SYMTAB
+                continue
+            strtab = self.sections[link][2]
+            entsize = 24 if self.is64 else 16
+            for at in range(offset, offset + size, entsize):
+                if self.is64:
+                    st_name, _, _, _, value, _ = struct.unpack_from('<IBBHQQ', self.data, at)
+                else:
+                    st_name, value, _, _, _, _ = struct.unpack_from('<IIIBBH', self.data, at)
+                end = self.data.index(b'\0', strtab + st_name)
+                if self.data[strtab + st_name:end] == want:
+                    return value
+        raise KeyError('%s not found, is the ELF file stripped or built without QxLog.cpp?' % name)
+
+    def string(self, addr):
+        for stype, base, offset, size, _ in self.sections:
+            # allocated sections with file contents only, not .bss
+            if stype != 8 and base and base <= addr < base + size:
+                at = offset + addr - base
+                return self.data[at:self.data.index(b'\0', at)].decode(errors='replace')
+        return None
+
+
+def read_varint(data, at):
+    value, shift = 0, 0
+    while True:
+        b = data[at]
+        at += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, at
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def decode_args(data, at):
+    args = []
+    while at < len(data):
+        tag = chr(data[at])
+        at += 1
+        if tag == 'u':
+            v, at = read_varint(data, at)
+        elif tag == 'i':
+            v, at = read_varint(data, at)
+            v = unzigzag(v)
+        elif tag == 'f':
+            v, = struct.unpack_from('<f', data, at)
+            at += 4
+        elif tag == 'd':
+            v, = struct.unpack_from('<d', data, at)
+            at += 8
+        elif tag == 's':
+            n = data[at]
+            v = data[at + 1:at + 1 + n].decode(errors='replace')
+            at += 1 + n
+        else:
+            raise ValueError('unknown argument tag %r' % tag)
+        args.append(v)
+    return args
+
+
+def c_format(fmt, args):
+    """printf() on the host; missing arguments, cut off by the device, print as '?'."""
+    args = list(args)
+
+    def take():
+        return args.pop(0) if args else None
+
+    def convert(m):
+        flags, width, prec, _, conv = m.groups()
+        if conv == '%':
+            return '%'
+        if width == '*':
+            width = str(take() or 0)
+        if prec == '*':
+            prec = str(take() or 0)
+        v = take()
+        if v is None:
+            return '?'
+        spec = '%' + flags + (width or '') + ('.' + prec if prec is not None else '')
+        if conv in 'diu':
+            return (spec + 'd') % int(v)
+        if conv == 'p':
+            return '0x%x' % int(v)
+        if conv == 'c':
+            return (spec + 's') % chr(int(v) & 0xFF)
+        if conv in 'aA':
+            return float(v).hex()
+        if conv == 's':
+            return (spec + 's') % v
+        return (spec + conv) % v
+
+    return CONVERSION.sub(convert, fmt)
+
+
+class Decoder(object):
+    def __init__(self, elf):
+        self.elf = elf
+        self.base = elf.symbol('QxLog_Base')
+        self.buf = bytearray()
+        self.text = bytearray()
+        self.time_us = None
+
+    def record(self, payload):
+        level = payload[0]
+        if level == LOG_DROPPED:
+            count, _ = read_varint(payload, 1)
+            return '!! %d log records dropped, the ring was full' % count
+
+        ident, at = read_varint(payload, 1)
+        stamp, at = read_varint(payload, at)
+        # the device sends 32 bits of microseconds, unwrap them
+        if self.time_us is None:
+            self.time_us = stamp
+        else:
+            self.time_us += (stamp - self.time_us) & 0xFFFFFFFF
+        fmt = self.elf.string(self.base + unzigzag(ident))
+        args = decode_args(payload, at)
+        if fmt is None:
+            text = '<unknown format id %d> %r' % (unzigzag(ident), args)
+        else:
+            text = c_format(fmt, args).rstrip('\r\n')
+        return '[%12.6f] %s %s' % (self.time_us / 1e6, LOG_LEVELS.get(level, '?'), text)
+
+    def feed(self, data, final=False):
+        """Split data into frames and text; yields printable lines."""
+        self.buf += data
+        i = 0
+        while i < len(self.buf):
+            b = self.buf[i]
+            if b == LOG_SYNC:
+                if i + 2 > len(self.buf) or i + 3 + self.buf[i + 1] > len(self.buf):
+                    if not final:
+                        break
+                else:
+                    n = self.buf[i + 1]
+                    payload = bytes(self.buf[i + 2:i + 2 + n])
+                    if n and (sum(payload) + self.buf[i + 2 + n]) & 0xFF == 0xFF:
+                        if self.text:
+                            yield self.text.decode(errors='replace')
+                            self.text = bytearray()
+                        yield self.record(payload)
+                        i += 3 + n
+                        continue
+            if b == 0x0A:
+                yield self.text.decode(errors='replace').rstrip('\r')
+                self.text = bytearray()
+            else:
+                self.text.append(b)
+            i += 1
+        del self.buf[:i]
+        if final and self.text:
+            yield self.text.decode(errors='replace')
+            self.text = bytearray()
+
+
 def main():
     parser = argparse.ArgumentParser(description=__doc__)
     parser.add_argument('-p', '--port',
                         default=None,
                         type=str,
                         help='Port name open to get debug message.')
+    parser.add_argument('--elf',
+                        default=None,
+                        help='ELF file of the running build, decodes the deferred log.')
+    parser.add_argument('--file',
+                        default=None,
+                        help='Decode a captured log file instead of reading the port.')
     args = parser.parse_args()
 
+    if args.elf:
+        decoder = Decoder(Elf(args.elf))
+        if args.file:
+            for line in decoder.feed(open(args.file, 'rb').read(), final=True):
+                print(line)
+            return
+        import serial
+        ser = serial.Serial(args.port, 9600, timeout=0.2)
+        while True:
+            for line in decoder.feed(ser.read(4096)):
+                print(line)
+            sys.stdout.flush()
+
+    import serial
+
     # linux
     # ser = serial.Serial('/dev/ttyS0', 9600, timeout=0.2)
     # windows
@@ -24,4 +249,3 @@ def main():
 
 if __name__ == '__main__':
     main()
-
@@ -0,0 +1,293 @@
+"""
+Record and decode the framed USB stream of a QX_USB_FRAMED=1 build.
+
+Frames (inc/QxFrame.h) are 0x00, COBS(channel, seq, payload, crc16), 0x00
+on the wire, crc16 being CRC-16/CCITT-FALSE of channel, seq and payload.
+The channels carry deferred log records, text, results (tQxBTResult),
+data collection packets and report lines; prints of the engine library
+arrive as plain text between the frames.
+
+The port is read in large blocks and every block is appended, as read and
+with the host time, to a timestamped capture file before anything is
+decoded, so a slow terminal or a decoder error never loses data:
+
+    python3 tools/qxcapture.py -p /dev/ttyACM0
+
+writes qxcapture-YYYYmmdd-HHMMSS.qxcap and prints, once a second, the
+frames and bytes per second of every channel, the frames lost (gaps in
+seq) and the frames with a bad CRC. --decode also prints the frames:
+log records need --elf of the build, as tools/debuglog.py. Recorded
+files are decoded again with --replay, plain stream files, e.g. the
+QXOS_STREAM_USB=file:usb.bin of "./automl-build.sh -p", with --raw:
+
+    python3 tools/qxcapture.py --replay qxcapture-20201019-120000.qxcap --decode
+    python3 tools/qxcapture.py --raw usb.bin --elf output/host/qxos_posix_demo
+
+A capture file is the 8 bytes "QXCAP\\0\\1\\0" followed by blocks of
+host time in ns (uint64), length (uint32) and the bytes read, little endian.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import debuglog  # noqa: E402
+import qxcodec  # noqa: E402
+import qxresult  # noqa: E402
+
+CAPTURE_MAGIC = b'QXCAP\x00\x01\x00'
+BLOCK = struct.Struct('<QI')
+
+CHANNELS = ['log', 'text', 'result', 'sensor', 'stats']
+CH_LOG, CH_TEXT, CH_RESULT, CH_SENSOR, CH_STATS = range(len(CHANNELS))
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError('bad COBS block')
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def printable(data):
+    return all(32 <= b < 127 or b in (9, 10, 13) for b in data)
+
+
+class Channel(object):
+    def __init__(self):
+        self.seq = None
+        self.frames = 0
+        self.bytes = 0
+        self.lost = 0
+
+    def feed(self, seq, size):
+        if self.seq is not None:
+            self.lost += (seq - self.seq - 1) & 0xFF
+        self.seq = seq
+        self.frames += 1
+        self.bytes += size
+
+
+class Splitter(object):
+    """Splits the stream at the zero bytes into frames and text."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.channels = [Channel() for _ in CHANNELS]
+        self.crc_errors = 0
+        self.text_bytes = 0
+        self.total = 0
+
+    def feed(self, data, final=False):
+        """Yields (channel, seq, payload), or (None, None, text) for bytes outside of frames."""
+        self.buf += data
+        self.total += len(data)
+        segments = self.buf.split(b'\x00')
+        self.buf = bytearray() if final else segments.pop()
+        for seg in segments:
+            if not seg:
+                continue
+            frame = self.frame(bytes(seg))
+            if frame is not None:
+                yield frame
+            elif printable(seg):
+                self.text_bytes += len(seg)
+                yield None, None, bytes(seg)
+            else:
+                self.crc_errors += 1
+
+    def frame(self, seg):
+        try:
+            raw = cobs_decode(seg)
+        except ValueError:
+            return None
+        if len(raw) < 4 or raw[0] >= len(CHANNELS):
+            return None
+        if crc16(raw[:-2]) != struct.unpack_from('<H', raw, len(raw) - 2)[0]:
+            return None
+        channel, seq, payload = raw[0], raw[1], raw[2:-2]
+        self.channels[channel].feed(seq, len(seg) + 1)
+        return channel, seq, payload
+
+
+class Printer(object):
+    """Turns frames into lines."""
+
+    def __init__(self, elf):
+        self.log = debuglog.Decoder(debuglog.Elf(elf)) if elf else None
+        self.text = bytearray()
+
+    def lines(self, channel, seq, payload):
+        if channel is None or channel == CH_TEXT:
+            self.text += payload
+            while b'\n' in self.text:
+                line, _, rest = bytes(self.text).partition(b'\n')
+                self.text = bytearray(rest)
+                yield line.decode(errors='replace').rstrip('\r')
+        elif channel == CH_LOG:
+            if self.log:
+                yield self.log.record(payload)
+            else:
+                yield 'log    #%-3d %d bytes, pass --elf to decode' % (seq, len(payload))
+        elif channel == CH_RESULT:
+            try:
+                r = qxresult.decode(payload)
+                yield 'result #%-5d %10d ms  cls %d  %s' % (r['seq'], r['time_ms'], r['cls'],
+                                                            ' '.join('%.3f' % p for p in r['probs']))
+            except ValueError as e:
+                yield 'result ?? %s' % e
+        elif channel == CH_SENSOR:
+            try:
+                dc_seq, samples = qxcodec.decode_dc(payload)
+                yield 'sensor #%-5d %d samples, first %s' % (dc_seq, len(samples),
+                                                            ' '.join(str(v) for v in samples[0]) if samples else '-')
+            except ValueError as e:
+                yield 'sensor ?? %s' % e
+        else:
+            yield 'stats  %s' % payload.decode(errors='replace').rstrip('\r\n')
+
+
+class Meter(object):
+    """Throughput and loss since the last report."""
+
+    def __init__(self, splitter, now):
+        self.splitter = splitter
+        self.start = self.last = now
+        self.prev = self.snapshot()
+
+    def snapshot(self):
+        s = self.splitter
+        return (s.total, [(c.frames, c.bytes) for c in s.channels])
+
+    def report(self, now):
+        if now - self.last < 1.0:
+            return None
+        span = max(now - self.last, 1e-9)
+        total, channels = self.snapshot()
+        parts = ['%8.1f s %8.1f kB/s' % (now - self.start, (total - self.prev[0]) / span / 1000.0)]
+        for name, (frames, size), (pframes, psize) in zip(CHANNELS, channels, self.prev[1]):
+            if frames != pframes:
+                parts.append('%s %.0f/s %.1f kB/s' % (name, (frames - pframes) / span, (size - psize) / span / 1000.0))
+        s = self.splitter
+        parts.append('lost %d  crc %d' % (sum(c.lost for c in s.channels), s.crc_errors))
+        self.last, self.prev = now, (total, channels)
+        return '  '.join(parts)
+
+    def summary(self, now):
+        s = self.splitter
+        span = now - self.start
+        rate = ' in %.1f s, %.1f kB/s' % (span, s.total / span / 1000.0) if span > 0 else ''
+        lines = ['%d bytes%s, %d bytes of text, %d frames with a bad CRC' % (
+            s.total, rate, s.text_bytes, s.crc_errors)]
+        for name, c in zip(CHANNELS, s.channels):
+            if c.frames:
+                lines.append('  %-6s %8d frames %10d bytes %6d lost' % (name, c.frames, c.bytes, c.lost))
+        return '\n'.join(lines)
+
+
+def blocks_of_capture(path):
+    with open(path, 'rb') as f:
+        if f.read(len(CAPTURE_MAGIC)) != CAPTURE_MAGIC:
+            raise ValueError('%s is not a capture file' % path)
+        while True:
+            head = f.read(BLOCK.size)
+            if len(head) < BLOCK.size:
+                return
+            ns, n = BLOCK.unpack(head)
+            yield ns / 1e9, f.read(n)
+
+
+def run(blocks, args, record=None):
+    splitter = Splitter()
+    printer = Printer(args.elf)
+    meter = None
+    now = 0.0
+    for now, data in blocks:
+        if record:
+            record.write(BLOCK.pack(int(now * 1e9), len(data)))
+            record.write(data)
+        if meter is None:
+            meter = Meter(splitter, now)
+        for frame in splitter.feed(data):
+            if args.decode:
+                for line in printer.lines(*frame):
+                    print(line)
+        line = meter.report(now)
+        if line and not args.quiet:
+            sys.stderr.write(line + '\n')
+            sys.stderr.flush()
+    for frame in splitter.feed(b'', final=True):
+        if args.decode:
+            for line in printer.lines(*frame):
+                print(line)
+    if meter is None:
+        meter = Meter(splitter, now)
+    sys.stdout.flush()
+    sys.stderr.write(meter.summary(now) + '\n')
+    return 1 if splitter.crc_errors or any(c.lost for c in splitter.channels) else 0
+
+
+def serial_blocks(ser):
+    try:
+        while True:
+            # what the driver holds, at least one byte, so the blocks stay large at high rates
+            data = ser.read(max(1, min(ser.in_waiting, 1 << 20)))
+            if data:
+                yield time.time(), data
+    except KeyboardInterrupt:
+        return
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('-p', '--port', help='Serial port of the device, recorded to a capture file.')
+    source.add_argument('--replay', help='Decode a capture file.')
+    source.add_argument('--raw', help='Decode a file of the plain stream.')
+    parser.add_argument('--baud', type=int, default=2000000, help='Baud rate, ignored by USB CDC ports.')
+    parser.add_argument('--out', default=None, help='Capture file, default qxcapture-<date>-<time>.qxcap.')
+    parser.add_argument('--decode', action='store_true', help='Print the frames and the text.')
+    parser.add_argument('--elf', default=None, help='ELF file of the running build, decodes the log records.')
+    parser.add_argument('-q', '--quiet', action='store_true', help='No throughput line every second.')
+    args = parser.parse_args()
+    if args.elf:
+        args.decode = True
+
+    if args.replay:
+        sys.exit(run(blocks_of_capture(args.replay), args))
+    if args.raw:
+        data = open(args.raw, 'rb').read()
+        sys.exit(run([(0.0, data)], args))
+
+    import serial
+    ser = serial.Serial(args.port, args.baud, timeout=0.05)
+    out = args.out or time.strftime('qxcapture-%Y%m%d-%H%M%S.qxcap')
+    with open(out, 'wb') as record:
+        record.write(CAPTURE_MAGIC)
+        sys.stderr.write('recording %s to %s, Ctrl-C stops\n' % (args.port, out))
+        status = run(serial_blocks(ser), args, record)
+    sys.exit(status)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,171 @@
+"""
+Decoders of the sample codecs in inc/QxCodec.h.
+
+    varint  delta varint IMU samples: per channel the zigzag mapped
+            difference to the previous sample, modulo 2^16, as a LEB128
+            varint; the first sample is against zero
+    pack    a bit packed block: per channel first sample (int16) and bit
+            width (uint8), then the zigzag differences of every channel,
+            channel after channel, least significant bit first
+    adpcm   an IMA ADPCM block: predictor (int16), step index (uint8), then
+            two 4 bit codes per byte, low nibble first
+    dc      a data collection notification (inc/QxDataCollect.h): cmd,
+            count, seq (uint16), raw or, with count & 0x80, varint samples
+
+Input is hex, one block per argument or per line of stdin. Samples are
+printed one per line, e.g.
+
+    python tools/qxcodec.py varint --count 2 --channels 3 0a0b0c020406
+    python tools/qxcodec.py dc 13810700020406080a0c
+"""
+
+import argparse
+import struct
+import sys
+
+ADPCM_STEPS = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767]
+ADPCM_INDEX_SHIFT = [-1, -1, -1, -1, 2, 4, 6, 8]
+
+DEV_RPL_DC_INST = 0x13
+DC_DELTA_VARINT = 0x80
+DC_CHANNELS = 6
+
+
+def int16(v):
+    v &= 0xFFFF
+    return v - 0x10000 if v & 0x8000 else v
+
+
+def unzigzag(z, prev):
+    """Sample from its zigzag difference to prev, modulo 2^16."""
+    return int16(prev + ((z >> 1) ^ -(z & 1)))
+
+
+def decode_varint(data, count, channels, prev=None):
+    """count samples of channels values; returns (samples, bytes read)."""
+    prev = list(prev or [0] * channels)
+    samples, at = [], 0
+    for _ in range(count):
+        sample = []
+        for c in range(channels):
+            z, shift = 0, 0
+            while True:
+                if at >= len(data) or shift > 14:
+                    raise ValueError('varint stream ends early')
+                b = data[at]
+                at += 1
+                z |= (b & 0x7F) << shift
+                shift += 7
+                if not b & 0x80:
+                    break
+            prev[c] = unzigzag(z, prev[c])
+            sample.append(prev[c])
+        samples.append(sample)
+    return samples, at
+
+
+def decode_pack(data, count, channels):
+    """A block of count samples; returns (samples, bytes read)."""
+    if len(data) < 3 * channels:
+        raise ValueError('block ends in the channel headers')
+    first = [struct.unpack_from('<h', data, 3 * c)[0] for c in range(channels)]
+    width = [data[3 * c + 2] for c in range(channels)]
+    need = 3 * channels + (sum(width) * (count - 1) + 7) // 8
+    if len(data) < need or max(width) > 16:
+        raise ValueError('block needs %d bytes, has %d' % (need, len(data)))
+
+    stream = int.from_bytes(bytes(data[3 * channels:need]), 'little')
+    columns = []
+    for c in range(channels):
+        x, column = first[c], [first[c]]
+        for _ in range(count - 1):
+            x = unzigzag(stream & ((1 << width[c]) - 1), x)
+            stream >>= width[c]
+            column.append(x)
+        columns.append(column)
+    return [list(s) for s in zip(*columns)], need
+
+
+def decode_adpcm(data, count):
+    """A block of count PCM samples; returns (samples, bytes read)."""
+    need = 3 + (count + 1) // 2
+    if len(data) < need or data[2] > 88:
+        raise ValueError('block needs %d bytes, has %d' % (need, len(data)))
+    predictor, index = struct.unpack_from('<h', data, 0)[0], data[2]
+    pcm = []
+    for i in range(count):
+        code = (data[3 + i // 2] >> (4 * (i & 1))) & 0x0F
+        step = ADPCM_STEPS[index]
+        vpdiff = step >> 3
+        if code & 4:
+            vpdiff += step
+        if code & 2:
+            vpdiff += step >> 1
+        if code & 1:
+            vpdiff += step >> 2
+        predictor += -vpdiff if code & 8 else vpdiff
+        predictor = max(-32768, min(32767, predictor))
+        index = max(0, min(88, index + ADPCM_INDEX_SHIFT[code & 7]))
+        pcm.append(predictor)
+    return pcm, need
+
+
+def decode_dc(data):
+    """A data collection notification; returns (seq, samples of ax, ay, az, gx, gy, gz)."""
+    if len(data) < 4 or data[0] != DEV_RPL_DC_INST:
+        raise ValueError('not a data collection packet')
+    count, seq = data[1] & 0x7F, struct.unpack_from('<H', data, 2)[0]
+    if data[1] & DC_DELTA_VARINT:
+        samples, _ = decode_varint(data[4:], count, DC_CHANNELS)
+    else:
+        if len(data) < 4 + 12 * count:
+            raise ValueError('%d samples announced, %d bytes sent' % (count, len(data)))
+        samples = [list(struct.unpack_from('<6h', data, 4 + 12 * i)) for i in range(count)]
+    return seq, samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('format', choices=['varint', 'pack', 'adpcm', 'dc'])
+    parser.add_argument('blocks', nargs='*', help='Blocks in hex, read from stdin when none.')
+    parser.add_argument('--count', type=int, default=1, help='Samples per block, not for dc.')
+    parser.add_argument('--channels', type=int, default=DC_CHANNELS, help='Channels of varint and pack.')
+    args = parser.parse_intermixed_args()
+
+    last_seq, lost = None, 0
+    for text in (args.blocks or sys.stdin):
+        text = text.strip().replace(' ', '').replace(':', '')
+        if not text:
+            continue
+        data = bytearray.fromhex(text)
+        try:
+            if args.format == 'varint':
+                samples, _ = decode_varint(data, args.count, args.channels)
+            elif args.format == 'pack':
+                samples, _ = decode_pack(data, args.count, args.channels)
+            elif args.format == 'adpcm':
+                samples, _ = decode_adpcm(data, args.count)
+            else:
+                seq, samples = decode_dc(data)
+                if last_seq is not None:
+                    lost += (seq - last_seq - 1) & 0xFFFF
+                last_seq = seq
+        except ValueError as e:
+            print('?? %s' % e)
+            continue
+        for s in samples:
+            print(' '.join(str(v) for v in s) if isinstance(s, list) else s)
+    if lost:
+        print('%d packets lost' % lost)
+
+
+if __name__ == '__main__':
+    main()
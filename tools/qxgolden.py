@@ -0,0 +1,183 @@
+"""
+Golden vectors for host/harness/qxgolden.cpp, and gates on its results.
+
+A golden file has one JSON record per line:
+
+    {"accel": [int16, ...], "gyro": [int16, ...], "cls": 1,
+     "features": [float, ...], "probs": [float, ...]}
+
+"accel"/"gyro" are the raw sensor windows QXO_MLEngine_Work() reads and
+"cls" its result; they drive the harness in engine mode. "features" and
+"probs" are the predict() input and output; "features" alone drives the
+harness in predict mode. Every key is optional, but a run in which no record
+could be compared fails.
+
+Commands:
+
+    synth LIB OUT       feature/probs records computed from the model of LIB
+                        by tools/qxmodel.py: they check a generated layout
+                        against the extracted model, not against the original
+                        predict(), so "./automl-build.sh -g" does not use them
+    capture SOURCE OUT  "GOLDEN {...}" lines of a device built with
+                        QX_GOLDEN_DUMP=1, from a log file or serial port
+    gate RESULT         fail when a record of a harness run failed, or when a
+                        stage got slower than in --baseline RESULT
+"""
+
+import argparse
+import json
+import math
+import os
+import random
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import qxmodel  # noqa: E402
+
+
+def walk(tree, x):
+    while tree[0] == 'node':
+        # NaN fails "<" and goes right, like predict.o
+        tree = tree[3] if x[tree[1]] < tree[2] else tree[4]
+    return tree[1]
+
+
+def model_predict(m, x):
+    nc = m['num_classes']
+    margin = [m['base_score']] * nc
+    for t, tree in enumerate(m['trees']):
+        margin[t % nc] += walk(tree, x)
+    top = max(margin)
+    e = [math.exp(v - top) for v in margin]
+    return [v / sum(e) for v in e]
+
+
+def synth(args):
+    try:
+        m = qxmodel.load_model(args.lib, args.num_classes, args.base_score)
+    except ValueError as e:
+        sys.exit('qxgolden: %s' % e)
+    lo, hi = {}, {}
+    for f, t in zip(m['ifeat'], m['thresh']):
+        lo[f] = min(lo.get(f, t), t)
+        hi[f] = max(hi.get(f, t), t)
+
+    rng = random.Random(args.seed)
+    with open(args.out, 'w') as out:
+        for _ in range(args.count):
+            x = []
+            for f in range(m['num_features']):
+                if f not in lo:
+                    x.append(0.0)
+                    continue
+                span = hi[f] - lo[f]
+                pad = 0.25 * span + 1e-3 * (abs(lo[f]) + 1.0)
+                x.append(rng.uniform(lo[f] - pad, hi[f] + pad))
+            out.write(json.dumps({'features': x, 'probs': model_predict(m, x)}) + '\n')
+    sys.stderr.write('%s: %d records of %d features\n' % (args.out, args.count, m['num_features']))
+
+
+def capture(args):
+    if os.path.exists(args.source):
+        lines = open(args.source, 'rb')
+    else:
+        import serial
+        lines = serial.Serial(args.source, 9600, timeout=1.0)
+
+    count = 0
+    with open(args.out, 'w') as out:
+        while count < args.count:
+            raw = lines.readline()
+            if not raw:
+                if os.path.exists(args.source):
+                    break
+                continue
+            text = raw.decode(errors='replace').strip()
+            if not text.startswith('GOLDEN '):
+                continue
+            try:
+                record = json.loads(text[len('GOLDEN '):])
+            except ValueError:
+                sys.stderr.write('skipped a truncated record\n')
+                continue
+            out.write(json.dumps(record) + '\n')
+            count += 1
+    sys.stderr.write('%s: %d records\n' % (args.out, count))
+
+
+def summary_of(path):
+    failed, summary = [], None
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith('{'):
+                continue
+            r = json.loads(line)
+            if r.get('summary'):
+                summary = r
+            elif r.get('ok') is False:
+                failed.append(r['record'])
+    if summary is None:
+        raise ValueError('%s has no summary line, did the harness finish?' % path)
+    return summary, failed
+
+
+def gate(args):
+    summary, failed = summary_of(args.result)
+    status = 0
+    compared = summary.get('compared', summary['records'])
+    if failed or compared == 0:
+        print('FAIL correctness: %d of %d records, %d compared, %d skipped, first %s' %
+              (len(failed), summary['records'], compared, summary.get('skipped', 0), failed[:10]))
+        status = 1
+    else:
+        print('ok   correctness: %d records, %d skipped' % (compared, summary.get('skipped', 0)))
+
+    if args.baseline:
+        base, _ = summary_of(args.baseline)
+        for stage in ('featurize_ns', 'predict_ns', 'work_ns'):
+            old, new = base.get(stage, 0), summary.get(stage, 0)
+            if not old or not new:
+                continue
+            change = 100.0 * (new - old) / old
+            bad = change > args.max_regress
+            print('%s %-12s %10.0f -> %10.0f ns  %+6.1f%%' %
+                  ('FAIL' if bad else 'ok  ', stage[:-3], old, new, change))
+            status |= bad
+    return status
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    p = sub.add_parser('synth', help='Golden predict records from the model of a static library.')
+    p.add_argument('lib')
+    p.add_argument('out')
+    p.add_argument('--count', type=int, default=64)
+    p.add_argument('--seed', type=int, default=1)
+    p.add_argument('--num-classes', type=int, help='When predict() of the library does not show it.')
+    p.add_argument('--base-score', type=float, help='When predict() of the library does not show it.')
+    p.set_defaults(func=synth)
+
+    p = sub.add_parser('capture', help='Golden engine records from a QX_GOLDEN_DUMP device log.')
+    p.add_argument('source', help='Log file, or serial port of the device.')
+    p.add_argument('out')
+    p.add_argument('--count', type=int, default=64)
+    p.set_defaults(func=capture)
+
+    p = sub.add_parser('gate', help='Check a harness result, optionally against a baseline result.')
+    p.add_argument('result')
+    p.add_argument('--baseline')
+    p.add_argument('--max-regress', type=float, default=10.0,
+                   help='Largest allowed slowdown of a stage in percent.')
+    p.set_defaults(func=gate)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args) or 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,457 @@
+"""
+Convert the tree ensemble inside a Qeexo AutoML static library into other
+layouts.
+
+The predict.o member of libQxClassifyEngine.a keeps the ensemble in six
+arrays that predict() interprets:
+
+    ifeat[n]      uint16  feature index of each internal node
+    thresh[n]     float   go left when feature < thresh
+    ileft[n]      int8    > 0: child node relative to the tree root,
+    iright[n]     int8    <= 0: -value is the leaf index inside the tree
+    leaves[m]     float   leaf margins
+    tree_lens[t]  uint8   internal node count of each tree
+
+A tree whose root has ileft == iright == 0 is a single leaf. Trees vote for
+class (tree index % num_classes) and the margins, starting at base_score, go
+through a softmax.
+
+num_classes and base_score are not stored as data; they are read from the
+Thumb-2 code of predict(), see predict_constants(). When the code does not
+match, pass --num-classes and --base-score.
+"""
+
+import argparse
+import struct
+import sys
+
+
+def read_archive_member(path, member):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'!<arch>\n':
+        raise ValueError('%s is not an ar archive' % path)
+    pos = 8
+    long_names = b''
+    while pos + 60 <= len(data):
+        header = data[pos:pos + 60]
+        name = header[:16].decode().strip()
+        size = int(header[48:58].decode().strip())
+        body = data[pos + 60:pos + 60 + size]
+        if name == '//':
+            long_names = body
+        elif name.startswith('/') and name[1:].isdigit():
+            start = int(name[1:])
+            name = long_names[start:long_names.index(b'/', start)].decode()
+        name = name.rstrip('/')
+        if name == member:
+            return body
+        pos += 60 + size + (size & 1)
+    raise ValueError('%s not found in %s' % (member, path))
+
+
+def read_elf_symbols(obj, kind=1):
+    """Return {name: bytes} for every sized symbol of an ELF32 LE object, data (1) or functions (2)."""
+    if obj[:4] != b'\x7fELF' or obj[4] != 1 or obj[5] != 1:
+        raise ValueError('expected a little endian ELF32 object')
+    shoff, = struct.unpack_from('<I', obj, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', obj, 0x2e)
+    sections = []
+    for i in range(shnum):
+        sections.append(struct.unpack_from('<IIIIIIIIII', obj, shoff + i * shentsize))
+
+    symbols = {}
+    for sh in sections:
+        if sh[1] != 2:  # SHT_SYMTAB
+            continue
+        strtab = sections[sh[6]]
+        for off in range(sh[4], sh[4] + sh[5], 16):
+            st_name, st_value, st_size, st_info, st_other, st_shndx = \
+                struct.unpack_from('<IIIBBH', obj, off)
+            if st_size == 0 or (st_info & 0xf) != kind or st_shndx >= len(sections):
+                continue
+            name_off = strtab[4] + st_name
+            name = obj[name_off:obj.index(b'\0', name_off)].decode()
+            target = sections[st_shndx]
+            start = target[4] + (st_value & ~1)  # bit 0 marks Thumb code
+            symbols[name] = obj[start:start + st_size]
+    return symbols
+
+
+def thumb_expand_imm(imm12):
+    if imm12 >> 10 == 0:
+        b = imm12 & 0xff
+        return [b, b * 0x00010001, b * 0x01000100, b * 0x01010101][(imm12 >> 8) & 3]
+    rot = imm12 >> 7
+    v = 0x80 | (imm12 & 0x7f)
+    return ((v >> rot) | (v << (32 - rot))) & 0xffffffff
+
+
+def vfp_expand_imm(imm8):
+    b = (imm8 >> 6) & 1
+    bits = ((imm8 >> 7) << 31) | ((b ^ 1) << 30) | ((0x1f if b else 0) << 25) | ((imm8 & 0x3f) << 19)
+    return struct.unpack('<f', struct.pack('<I', bits))[0]
+
+
+def predict_constants(code, num_trees):
+    """
+    Read (num_classes, base_score) from the Thumb-2 code of predict(), None when not found.
+
+    The tree loop compares its counter with the tree count (CMP.W Rn, #num_trees)
+    and picks the class with AND.W Rd, Rn, #(num_classes - 1). base_score is the
+    VMOV.F32 immediate that initializes the margins on the stack (VSTR Sd, [SP]).
+    """
+    insns = []
+    pos = 0
+    while pos + 2 <= len(code):
+        hw1, = struct.unpack_from('<H', code, pos)
+        if hw1 >> 11 in (0x1d, 0x1e, 0x1f) and pos + 4 <= len(code):
+            insns.append((hw1, struct.unpack_from('<H', code, pos + 2)[0]))
+            pos += 4
+        else:
+            pos += 2
+
+    counters = set()
+    masks = []
+    moves = []
+    stored = set()
+    for hw1, hw2 in insns:
+        imm12 = ((hw1 >> 10) & 1) << 11 | ((hw2 >> 12) & 7) << 8 | (hw2 & 0xff)
+        sreg = ((hw2 >> 12) & 0xf) << 1 | ((hw1 >> 6) & 1)
+        if hw1 & 0xfbf0 == 0xf1b0 and hw2 & 0x8f00 == 0x0f00 and thumb_expand_imm(imm12) == num_trees:
+            counters.add(hw1 & 0xf)                         # CMP.W Rn, #imm
+        elif hw1 & 0xfbf0 == 0xf000 and hw2 & 0x8f00 != 0x0f00 and not hw2 & 0x8000:
+            masks.append((hw1 & 0xf, thumb_expand_imm(imm12)))  # AND.W Rd, Rn, #imm
+        elif hw1 & 0xffb0 == 0xeeb0 and hw2 & 0x0ff0 == 0x0a00:
+            moves.append((sreg, vfp_expand_imm((hw1 & 0xf) << 4 | (hw2 & 0xf))))  # VMOV.F32 Sd, #imm
+        elif hw1 & 0xff3f == 0xed0d and hw2 & 0x0f00 == 0x0a00:
+            stored.add(sreg)                                # VSTR Sd, [SP, #imm]
+
+    classes = set(m + 1 for rn, m in masks if rn in counters and m & (m + 1) == 0)
+    scores = set(v for reg, v in moves if reg in stored)
+    return (classes.pop() if len(classes) == 1 else None,
+            scores.pop() if len(scores) == 1 else None)
+
+
+def load_model(lib, num_classes=None, base_score=None):
+    obj = read_archive_member(lib, 'predict.o')
+    sym = read_elf_symbols(obj)
+
+    def arr(name, fmt):
+        raw = sym[name]
+        return list(struct.unpack('<%d%s' % (len(raw) // struct.calcsize(fmt), fmt), raw))
+
+    model = {
+        'ifeat': arr('ifeat', 'H'),
+        'thresh': arr('thresh', 'f'),
+        'ileft': arr('ileft', 'b'),
+        'iright': arr('iright', 'b'),
+        'leaves': arr('leaves', 'f'),
+        'tree_lens': arr('tree_lens', 'B'),
+    }
+    code = read_elf_symbols(obj, 2).get('predict', b'')
+    found = predict_constants(code, len(model['tree_lens']))
+    for key, given, value in zip(('num_classes', 'base_score'), (num_classes, base_score), found):
+        flag = '--' + key.replace('_', '-')
+        if given is None and value is None:
+            raise ValueError('%s: %s not found in predict(), pass %s' % (lib, key, flag))
+        if given is not None and value is not None and given != value:
+            raise ValueError('%s: %s %s disagrees with %s of predict()' % (lib, flag, given, value))
+        model[key] = value if given is None else given
+    model['trees'] = decode_trees(model)
+    model['num_features'] = max(model['ifeat']) + 1
+    return model
+
+
+def decode_trees(m):
+    """Rebuild every tree as nested tuples ('node', feat, thresh, left, right) / ('leaf', value)."""
+    trees = []
+    node_base = 0
+    leaf_base = 0
+    for length in m['tree_lens']:
+        if m['ileft'][node_base] == 0 and m['iright'][node_base] == 0:
+            trees.append(('leaf', m['leaves'][leaf_base]))
+            node_base += 1
+            leaf_base += 1
+            continue
+
+        def build(ref, nb=node_base, lb=leaf_base):
+            if ref <= 0:
+                return ('leaf', m['leaves'][lb - ref])
+            i = nb + ref
+            return ('node', m['ifeat'][i], m['thresh'][i],
+                    build(m['ileft'][i]), build(m['iright'][i]))
+
+        root = node_base
+        trees.append(('node', m['ifeat'][root], m['thresh'][root],
+                      build(m['ileft'][root]), build(m['iright'][root])))
+        node_base += length
+        leaf_base += length + 1
+
+    if node_base != len(m['ifeat']) or leaf_base != len(m['leaves']):
+        raise ValueError('tree_lens does not cover the node/leaf arrays, unknown predict.o layout')
+    return trees
+
+
+def c_float(v):
+    text = '%.9g' % v
+    if '.' not in text and 'e' not in text:
+        text += '.0'
+    return text + 'f'
+
+
+def c_array(ctype, name, values, fmt=str, per_line=12):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append('    ' + ', '.join(fmt(v) for v in values[i:i + per_line]) + ',')
+    return 'static const %s %s[%d] = {\n%s\n};\n' % (ctype, name, len(values), '\n'.join(lines))
+
+
+def emit_reference(m, out):
+    """Original arrays, used by host benchmarks as the interpreted baseline."""
+    out.write('/* Generated by tools/qxmodel.py, do not edit. */\n\n')
+    out.write('#define QX_REF_NUM_FEATURES %d\n' % m['num_features'])
+    out.write('#define QX_REF_NUM_CLASSES %d\n' % m['num_classes'])
+    out.write('#define QX_REF_NUM_TREES %d\n' % len(m['tree_lens']))
+    out.write('#define QX_REF_BASE_SCORE %s\n\n' % c_float(m['base_score']))
+    out.write(c_array('uint16_t', 'ref_ifeat', m['ifeat']))
+    out.write(c_array('float', 'ref_thresh', m['thresh'], c_float, 6))
+    out.write(c_array('int8_t', 'ref_ileft', m['ileft']))
+    out.write(c_array('int8_t', 'ref_iright', m['iright']))
+    out.write(c_array('float', 'ref_leaves', m['leaves'], c_float, 6))
+    out.write(c_array('uint8_t', 'ref_tree_lens', m['tree_lens']))
+
+
+PREDICT_SHIM = '''
+/*
+    Replacement of predict.o: QXO_MLEngine_Work() calls predict(features, probs).
+    init_predict()/free_predict() keep the allocation contract of the original.
+ */
+extern "C" void *init_predict(void)
+{
+    return malloc(8);
+}
+
+extern "C" void free_predict(void *p)
+{
+    free(p);
+}
+
+extern "C" void predict(const float *features, float *probs)
+{
+    %s(features, probs);
+}
+
+/* Number of probabilities predict() writes, read by host/harness/qxgolden.cpp */
+extern "C" const int qx_predict_num_classes = %d;
+'''
+
+
+def emit_flat(m, out, replace_predict):
+    nc = m['num_classes']
+    base = [m['base_score']] * nc
+    walked = [[] for _ in range(nc)]
+    for t, tree in enumerate(m['trees']):
+        if tree[0] == 'leaf':
+            # constant trees fold into the class base score
+            base[t % nc] += tree[1]
+        else:
+            walked[t % nc].append(tree)
+
+    edges = {}
+
+    def collect(node):
+        if node[0] == 'node':
+            edges.setdefault(node[1], set()).add(node[2])
+            collect(node[3])
+            collect(node[4])
+
+    for trees in walked:
+        for tree in trees:
+            collect(tree)
+
+    slot_feature = sorted(edges)
+    if len(slot_feature) > 255:
+        raise ValueError('%d features used, the flat layout supports 255' % len(slot_feature))
+    slot_of = {f: i for i, f in enumerate(slot_feature)}
+    slot_edges = [sorted(edges[f]) for f in slot_feature]
+    for f, e in zip(slot_feature, slot_edges):
+        if len(e) > 255:
+            raise ValueError('feature %d has %d thresholds, the flat layout supports 255' % (f, len(e)))
+    edge_start = [0]
+    for e in slot_edges:
+        edge_start.append(edge_start[-1] + len(e))
+
+    leaf_values = []
+
+    def leaves_of(node):
+        if node[0] == 'leaf':
+            leaf_values.append(node[1])
+        else:
+            leaves_of(node[3])
+            leaves_of(node[4])
+
+    for trees in walked:
+        for tree in trees:
+            leaves_of(tree)
+    leaf_scale = max(abs(v) for v in leaf_values) / 32767.0 if leaf_values else 1.0
+
+    nodes = []
+    tree_root = []
+    class_tree_end = []
+    for trees in walked:
+        for tree in trees:
+            tree_root.append(len(nodes))
+            # breadth first, the two children of a node are adjacent
+            queue = [tree]
+            order = []
+            while queue:
+                node = queue.pop(0)
+                order.append(node)
+                if node[0] == 'node':
+                    queue.append(node[3])
+                    queue.append(node[4])
+            base_index = len(nodes)
+            child_of = {}
+            next_slot = 1
+            for i, node in enumerate(order):
+                if node[0] == 'node':
+                    child_of[i] = next_slot
+                    next_slot += 2
+            for i, node in enumerate(order):
+                if node[0] == 'leaf':
+                    q = int(round(node[1] / leaf_scale))
+                    nodes.append((255, 0, max(-32767, min(32767, q))))
+                else:
+                    bin_ = slot_edges[slot_of[node[1]]].index(node[2]) + 1
+                    nodes.append((slot_of[node[1]], bin_, child_of[i] - i))
+            if len(nodes) - base_index > 32767:
+                raise ValueError('tree too large for 16 bit child offsets')
+        class_tree_end.append(len(tree_root))
+
+    err_bound = [leaf_scale / 2 * len(trees) for trees in walked]
+    sys.stderr.write('flat: %d trees (%d constant trees folded), %d nodes, %d slots, %d edges, '
+                     'leaf scale %.3g, max margin error %.3g\n' %
+                     (len(tree_root), len(m['trees']) - len(tree_root), len(nodes),
+                      len(slot_feature), edge_start[-1], leaf_scale, max(err_bound)))
+
+    out.write('/* Generated by tools/qxmodel.py, do not edit. */\n\n')
+    out.write('#include "QxFlatTree.h"\n\n')
+    out.write(c_array('uint16_t', 'flat_slot_feature', slot_feature))
+    out.write(c_array('uint16_t', 'flat_edge_start', edge_start))
+    out.write(c_array('float', 'flat_edges', [e for es in slot_edges for e in es], c_float, 6))
+    out.write(c_array('uint16_t', 'flat_tree_root', tree_root))
+    out.write(c_array('uint16_t', 'flat_class_tree_end', class_tree_end))
+    out.write(c_array('float', 'flat_base_score', base, c_float, 6))
+    out.write('static const tQxFlatNode flat_nodes[%d] = {\n' % len(nodes))
+    for i in range(0, len(nodes), 6):
+        out.write('    ' + ' '.join('{%d, %d, %d},' % n for n in nodes[i:i + 6]) + '\n')
+    out.write('};\n\n')
+    out.write('extern "C" const tQxFlatForest qx_flat_model = {\n')
+    out.write('    %d, /* num_trees */\n' % len(tree_root))
+    out.write('    %d, /* num_nodes */\n' % len(nodes))
+    out.write('    %d, /* num_classes */\n' % nc)
+    out.write('    %d, /* num_slots */\n' % len(slot_feature))
+    out.write('    flat_slot_feature,\n    flat_edge_start,\n    flat_edges,\n')
+    out.write('    flat_tree_root,\n    flat_class_tree_end,\n    flat_nodes,\n')
+    out.write('    flat_base_score,\n    %s, /* leaf_scale */\n' % c_float(leaf_scale))
+    out.write('};\n')
+
+    if replace_predict:
+        out.write('\nstatic void flat_predict(const float *features, float *probs)\n{\n')
+        out.write('    QxFlatTree_Predict(&qx_flat_model, features, probs);\n}\n')
+        out.write(PREDICT_SHIM % ('flat_predict', nc))
+
+
+def emit_compiled(m, out, replace_predict):
+    """Every tree as nested if/else with the thresholds and feature indices as immediates."""
+    nc = m['num_classes']
+
+    def emit_node(node, depth):
+        pad = '    ' * depth
+        if node[0] == 'leaf':
+            return '%sreturn %s;\n' % (pad, c_float(node[1]))
+        # NaN features fail "<" and take the right branch, as in predict.o
+        return ('%sif (f[%d] < %s) {\n' % (pad, node[1], c_float(node[2])) +
+                emit_node(node[3], depth + 1) +
+                '%s} else {\n' % pad +
+                emit_node(node[4], depth + 1) +
+                '%s}\n' % pad)
+
+    out.write('/* Generated by tools/qxmodel.py, do not edit. */\n\n')
+    out.write('#include "QxFastMath.h"\n\n')
+
+    walked = 0
+    for t, tree in enumerate(m['trees']):
+        if tree[0] == 'leaf':
+            continue
+        out.write('static inline float compiled_tree_%d(const float *f)\n{\n' % t)
+        out.write(emit_node(tree, 1))
+        out.write('}\n\n')
+        walked += 1
+
+    out.write('extern "C" void qx_compiled_predict(const float *f, float *probs)\n{\n')
+    for c in range(nc):
+        out.write('    float m%d = %s;\n' % (c, c_float(m['base_score'])))
+    out.write('\n')
+    # same summation order as predict.o, so the margins match bit for bit
+    for t, tree in enumerate(m['trees']):
+        if tree[0] == 'leaf':
+            out.write('    m%d += %s;\n' % (t % nc, c_float(tree[1])))
+        else:
+            out.write('    m%d += compiled_tree_%d(f);\n' % (t % nc, t))
+    out.write('\n')
+    for c in range(nc):
+        out.write('    probs[%d] = m%d;\n' % (c, c))
+    out.write('    fm_softmax_batch(probs, probs, %d);\n}\n' % nc)
+
+    sys.stderr.write('compiled: %d trees as code, %d constant trees inlined\n' %
+                     (walked, len(m['trees']) - walked))
+
+    if replace_predict:
+        out.write(PREDICT_SHIM % ('qx_compiled_predict', nc))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('lib', help='Qeexo AutoML static library, e.g. libs/libQxClassifyEngine.a')
+    parser.add_argument('--num-classes', type=int,
+                        help='Number of classes the trees alternate over, required when predict() does not show it.')
+    parser.add_argument('--base-score', type=float,
+                        help='Initial margin of every class, required when predict() does not show it.')
+    parser.add_argument('--emit-reference', metavar='FILE',
+                        help='Write the original arrays as a C header.')
+    parser.add_argument('--emit-flat', metavar='FILE',
+                        help='Write the model in the QxFlatTree layout as C++ source.')
+    parser.add_argument('--emit-compiled', metavar='FILE',
+                        help='Write the model as straight-line if/else C++ source.')
+    parser.add_argument('--replace-predict', action='store_true',
+                        help='Also define predict()/init_predict()/free_predict() in the emitted source.')
+    parser.add_argument('--print-num-features', action='store_true',
+                        help='Print the number of features predict() reads, for QX_GOLDEN_DUMP builds.')
+    args = parser.parse_args()
+
+    try:
+        model = load_model(args.lib, args.num_classes, args.base_score)
+    except ValueError as e:
+        sys.exit('qxmodel: %s' % e)
+    sys.stderr.write('%s: %d trees, %d nodes, %d leaves, %d features, %d classes, base score %g\n' %
+                     (args.lib, len(model['trees']), len(model['ifeat']),
+                      len(model['leaves']), model['num_features'], model['num_classes'], model['base_score']))
+    if args.print_num_features:
+        print(model['num_features'])
+
+    if args.emit_reference:
+        with open(args.emit_reference, 'w') as out:
+            emit_reference(model, out)
+    if args.emit_flat:
+        with open(args.emit_flat, 'w') as out:
+            emit_flat(model, out, args.replace_predict)
+    if args.emit_compiled:
+        with open(args.emit_compiled, 'w') as out:
+            emit_compiled(model, out, args.replace_predict)
+
+
+if __name__ == '__main__':
+    main()
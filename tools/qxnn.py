@@ -0,0 +1,292 @@
+"""
+Quantize a small dense/conv1d network to int8 and emit it for QxNNInt8.
+
+The network is described in JSON with float weights, as exported from the
+training framework:
+
+    {
+      "input": {"size": 881, "min": -10.0, "max": 60.0},
+      "softmax": true,
+      "layers": [
+        {"type": "conv1d", "in_channels": 1, "out_channels": 8, "kernel": 8,
+         "stride": 4, "activation": "relu",
+         "weights": [out_channels][kernel][in_channels], "bias": [out_channels]},
+        {"type": "dense", "units": 2, "activation": "none",
+         "weights": [units][inputs], "bias": [units]}
+      ],
+      "calibration": [[feature, ...], ...]
+    }
+
+Activations are channels last, so a dense layer after a conv1d layer sees
+the inputs in [position][channel] order. Each layer may give its float
+output range as "output_range": [min, max]; otherwise the range is measured
+by running the float network on the "calibration" feature vectors, or on
+random vectors inside the input range when there are none.
+
+Weights are quantized symmetric per output channel, activations asymmetric
+per tensor, and the input zero point is folded into the int32 bias.
+"""
+
+import argparse
+import json
+import math
+import random
+import sys
+
+from qxmodel import PREDICT_SHIM, c_array, c_float
+
+
+def normalize(net):
+    """Give every layer the geometry fields of tQxNNLayer and flat float weights."""
+    size = net['input']['size']
+    prev = None
+    layers = []
+    for i, src in enumerate(net['layers']):
+        layer = {'relu': src.get('activation', 'none') == 'relu'}
+        if src.get('activation', 'none') not in ('relu', 'none'):
+            raise ValueError('layer %d: activation %s is not supported' % (i, src['activation']))
+        if src['type'] == 'conv1d':
+            if prev is not None and prev['type'] == 'dense':
+                raise ValueError('layer %d: conv1d after dense is not supported' % i)
+            ic = src['in_channels']
+            in_length = size // ic if prev is None else prev['out_length']
+            if prev is not None and prev['out_channels'] != ic:
+                raise ValueError('layer %d: expected %d input channels' % (i, prev['out_channels']))
+            if prev is None and in_length * ic != size:
+                raise ValueError('layer %d: input size %d is not a multiple of %d channels' % (i, size, ic))
+            k, s = src['kernel'], src.get('stride', 1)
+            layer.update(type='conv1d', in_channels=ic, in_length=in_length, kernel=k, stride=s,
+                         out_channels=src['out_channels'], out_length=(in_length - k) // s + 1)
+            layer['w'] = [[v for pos in ch for v in pos] for ch in src['weights']]
+        elif src['type'] == 'dense':
+            inputs = size if prev is None else prev['out_length'] * prev['out_channels']
+            layer.update(type='dense', in_channels=inputs, in_length=1, kernel=1, stride=1,
+                         out_channels=src['units'], out_length=1)
+            layer['w'] = [list(row) for row in src['weights']]
+        else:
+            raise ValueError('layer %d: type %s is not supported' % (i, src['type']))
+
+        window = layer['kernel'] * layer['in_channels']
+        if len(layer['w']) != layer['out_channels'] or any(len(w) != window for w in layer['w']):
+            raise ValueError('layer %d: weights must be %d x %d' % (i, layer['out_channels'], window))
+        layer['b'] = list(src.get('bias', [0.0] * layer['out_channels']))
+        layer['range'] = src.get('output_range')
+        layers.append(layer)
+        prev = layer
+    return layers
+
+
+def forward_layer(layer, x):
+    ic, oc = layer['in_channels'], layer['out_channels']
+    window = layer['kernel'] * ic
+    out = []
+    for p in range(layer['out_length']):
+        base = p * layer['stride'] * ic
+        win = x[base:base + window]
+        for c in range(oc):
+            acc = layer['b'][c] + sum(a * b for a, b in zip(win, layer['w'][c]))
+            out.append(max(acc, 0.0) if layer['relu'] else acc)
+    return out
+
+
+def calibrate(net, layers):
+    if all(layer['range'] for layer in layers):
+        return
+    samples = net.get('calibration')
+    if not samples:
+        lo, hi = net['input']['min'], net['input']['max']
+        rng = random.Random(1)
+        samples = [[rng.uniform(lo, hi) for _ in range(net['input']['size'])] for _ in range(64)]
+        sys.stderr.write('no calibration data, using %d random inputs in [%g, %g]\n' % (len(samples), lo, hi))
+    ranges = [[math.inf, -math.inf] for _ in layers]
+    for x in samples:
+        for layer, r in zip(layers, ranges):
+            x = forward_layer(layer, x)
+            r[0] = min(r[0], min(x))
+            r[1] = max(r[1], max(x))
+    for layer, r in zip(layers, ranges):
+        if not layer['range']:
+            layer['range'] = r
+
+
+def act_quant(lo, hi):
+    """Scale and zero point of an asymmetric int8 tensor covering [lo, hi] and 0."""
+    lo, hi = min(lo, 0.0), max(hi, 0.0)
+    if hi - lo < 1e-12:
+        hi = lo + 1.0
+    scale = (hi - lo) / 255.0
+    zp = int(round(-128 - lo / scale))
+    return scale, max(-128, min(127, zp))
+
+
+def quantize_multiplier(m):
+    """m = multiplier * 2^shift / 2^31, as used by nn_requantize()."""
+    if m <= 0.0:
+        return 0, 0
+    q, shift = math.frexp(m)
+    q_fixed = int(round(q * (1 << 31)))
+    if q_fixed == 1 << 31:
+        q_fixed //= 2
+        shift += 1
+    if shift > 30:
+        raise ValueError('requantization scale %g is too large' % m)
+    if shift < -31:
+        return 0, 0
+    return q_fixed, shift
+
+
+def quantize(net, layers):
+    in_scale, in_zp = act_quant(net['input']['min'], net['input']['max'])
+    s_in, z_in = in_scale, in_zp
+    for i, layer in enumerate(layers):
+        s_out, z_out = act_quant(*layer['range'])
+        layer['wq'], layer['bq'], layer['mult'], layer['shift'] = [], [], [], []
+        for c in range(layer['out_channels']):
+            w = layer['w'][c]
+            s_w = max(abs(v) for v in w) / 127.0 or 1.0
+            wq = [max(-127, min(127, int(round(v / s_w)))) for v in w]
+            bq = int(round(layer['b'][c] / (s_in * s_w))) - z_in * sum(wq)
+            if not -(1 << 31) <= bq < (1 << 31):
+                raise ValueError('layer %d channel %d: bias does not fit int32' % (i, c))
+            mult, shift = quantize_multiplier(s_in * s_w / s_out)
+            layer['wq'].extend(wq)
+            layer['bq'].append(bq)
+            layer['mult'].append(mult)
+            layer['shift'].append(shift)
+        layer['out_scale'], layer['out_zp'] = s_out, z_out
+        s_in, z_in = s_out, z_out
+    return in_scale, in_zp
+
+
+def emit_model(net, layers, in_scale, in_zp, out, replace_predict):
+    half = max([net['input']['size']] + [l['out_length'] * l['out_channels'] for l in layers])
+    out.write('/* Generated by tools/qxnn.py, do not edit. */\n\n')
+    out.write('#include "QxNNInt8.h"\n\n')
+    for i, l in enumerate(layers):
+        out.write(c_array('int8_t', 'nn_weights_%d' % i, l['wq']))
+        out.write(c_array('int32_t', 'nn_bias_%d' % i, l['bq'], per_line=8))
+        out.write(c_array('int32_t', 'nn_multiplier_%d' % i, l['mult'], per_line=8))
+        out.write(c_array('int8_t', 'nn_shift_%d' % i, l['shift']))
+        out.write('\n')
+
+    out.write('static const tQxNNLayer nn_layers[%d] = {\n' % len(layers))
+    for i, l in enumerate(layers):
+        out.write('    {%s, %d, %d, %d, %d, %d, %d, %d, %d,\n' %
+                  ('QX_NN_CONV1D' if l['type'] == 'conv1d' else 'QX_NN_DENSE', l['relu'], l['out_zp'],
+                   l['in_channels'], l['out_channels'], l['in_length'], l['out_length'],
+                   l['kernel'], l['stride']))
+        out.write('     nn_weights_%d, nn_bias_%d, nn_multiplier_%d, nn_shift_%d},\n' % (i, i, i, i))
+    out.write('};\n\n')
+
+    out.write('static int8_t nn_scratch[%d] __attribute__((aligned(4)));\n\n' % (2 * half))
+    last = layers[-1]
+    out.write('extern "C" const tQxNNModel qx_nn_model = {\n')
+    out.write('    %d, /* num_inputs */\n' % net['input']['size'])
+    out.write('    %d, /* num_outputs */\n' % (last['out_length'] * last['out_channels']))
+    out.write('    %d, /* num_layers */\n' % len(layers))
+    out.write('    %d, /* softmax */\n' % bool(net.get('softmax', True)))
+    out.write('    %d, /* in_zero_point */\n' % in_zp)
+    out.write('    %d, /* out_zero_point */\n' % last['out_zp'])
+    out.write('    %s, /* in_scale */\n' % c_float(in_scale))
+    out.write('    %s, /* out_scale */\n' % c_float(last['out_scale']))
+    out.write('    nn_layers,\n    nn_scratch,\n    %d, /* scratch_half */\n};\n' % half)
+
+    if replace_predict:
+        out.write('\nstatic void nn_predict(const float *features, float *probs)\n{\n')
+        out.write('    QxNNInt8_Predict(&qx_nn_model, features, probs);\n}\n')
+        out.write(PREDICT_SHIM % ('nn_predict', last['out_length'] * last['out_channels']))
+
+
+def emit_reference(net, layers, out):
+    """Float weights and geometry, used by host/bench/nn_bench.cpp as the baseline."""
+    last = layers[-1]
+    out.write('/* Generated by tools/qxnn.py, do not edit. */\n\n')
+    out.write('#define NN_REF_NUM_INPUTS %d\n' % net['input']['size'])
+    out.write('#define NN_REF_NUM_OUTPUTS %d\n' % (last['out_length'] * last['out_channels']))
+    out.write('#define NN_REF_NUM_LAYERS %d\n' % len(layers))
+    out.write('#define NN_REF_SOFTMAX %d\n' % bool(net.get('softmax', True)))
+    out.write('#define NN_REF_INPUT_MIN %s\n' % c_float(net['input']['min']))
+    out.write('#define NN_REF_INPUT_MAX %s\n\n' % c_float(net['input']['max']))
+    for i, l in enumerate(layers):
+        out.write(c_array('float', 'ref_weights_%d' % i, [v for w in l['w'] for v in w], c_float, 6))
+        out.write(c_array('float', 'ref_bias_%d' % i, l['b'], c_float, 6))
+    out.write('\nstruct ref_layer {\n')
+    out.write('    int relu, in_channels, out_channels, out_length, kernel, stride;\n')
+    out.write('    const float *weights, *bias;\n};\n\n')
+    out.write('static const struct ref_layer ref_layers[%d] = {\n' % len(layers))
+    for i, l in enumerate(layers):
+        out.write('    {%d, %d, %d, %d, %d, %d, ref_weights_%d, ref_bias_%d},\n' %
+                  (l['relu'], l['in_channels'], l['out_channels'], l['out_length'],
+                   l['kernel'], l['stride'], i, i))
+    out.write('};\n')
+
+
+def write_example(path, inputs, outputs):
+    """A random conv1d + dense network for benchmarks, with He initialized weights."""
+    rng = random.Random(2020)
+
+    def he(fan_in, shape):
+        std = math.sqrt(2.0 / fan_in)
+        if len(shape) == 1:
+            return [rng.gauss(0.0, std) for _ in range(shape[0])]
+        return [he(fan_in, shape[1:]) for _ in range(shape[0])]
+
+    conv_out = (inputs - 8) // 4 + 1
+    net = {
+        'input': {'size': inputs, 'min': -10.0, 'max': 60.0},
+        'softmax': True,
+        'layers': [
+            {'type': 'conv1d', 'in_channels': 1, 'out_channels': 8, 'kernel': 8, 'stride': 4,
+             'activation': 'relu', 'weights': he(8, [8, 8, 1]), 'bias': [0.0] * 8},
+            {'type': 'dense', 'units': 16, 'activation': 'relu',
+             'weights': he(conv_out * 8, [16, conv_out * 8]), 'bias': [0.0] * 16},
+            {'type': 'dense', 'units': outputs, 'activation': 'none',
+             'weights': he(16, [outputs, 16]), 'bias': [0.0] * outputs},
+        ],
+    }
+    with open(path, 'w') as f:
+        json.dump(net, f)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('model', help='Network description in JSON, see above.')
+    parser.add_argument('--emit', metavar='FILE',
+                        help='Write the quantized model for QxNNInt8 as C++ source.')
+    parser.add_argument('--emit-reference', metavar='FILE',
+                        help='Write the float weights as a C header for host benchmarks.')
+    parser.add_argument('--replace-predict', action='store_true',
+                        help='Also define predict()/init_predict()/free_predict() in the emitted source.')
+    parser.add_argument('--example', metavar='INPUTS:OUTPUTS',
+                        help='First write a random example network with this shape to MODEL.')
+    args = parser.parse_args()
+
+    if args.example:
+        inputs, outputs = (int(v) for v in args.example.split(':'))
+        write_example(args.model, inputs, outputs)
+
+    with open(args.model) as f:
+        net = json.load(f)
+    layers = normalize(net)
+    calibrate(net, layers)
+    in_scale, in_zp = quantize(net, layers)
+
+    params = sum(len(l['wq']) for l in layers)
+    sys.stderr.write('%s: %d layers, %d weights, %d bytes int8 (%d bytes float)\n' %
+                     (args.model, len(layers), params,
+                      params + sum(9 * l['out_channels'] for l in layers),
+                      4 * (params + sum(l['out_channels'] for l in layers))))
+    if layers[-1]['out_length'] * layers[-1]['out_channels'] > 50:
+        sys.stderr.write('warning: more than 50 outputs do not fit PredictionFrame.mProbs\n')
+
+    if args.emit:
+        with open(args.emit, 'w') as out:
+            emit_model(net, layers, in_scale, in_zp, out, args.replace_predict)
+    if args.emit_reference:
+        with open(args.emit_reference, 'w') as out:
+            emit_reference(net, layers, out)
+
+
+if __name__ == '__main__':
+    main()
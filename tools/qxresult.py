@@ -0,0 +1,149 @@
+"""
+Decode notifications of the binary result characteristic.
+
+The characteristic 30618b72-a321-389d-8849-cd74f9f0f4eb of the AutoML
+service sends one notification per classification (tQxBTResult in
+inc/QxBTHal.h), little endian:
+
+    offset  size   field
+    0       2      seq      counts the results, wraps at 65536
+    2       4      time_ms  device time of the classification in ms
+    6       1      cls      class id
+    7       1      count    number of probabilities that follow
+    8       count  probs    probability of class i as round(p * 255)
+
+Pass notifications as hex, one per argument or per line of stdin, e.g.
+
+    python tools/qxresult.py 0700a0860100010203fc
+
+With --broadcast the values are the manufacturer specific data of the
+advertising packets instead (tQxBTBroadcast, QX_BT_BROADCAST=1):
+
+    offset  size   field
+    0       2      company     company identifier, QX_BT_COMPANY_ID
+    2       2      seq         counts the updates of the advertising data
+    4       1      cls         class id of the latest result, 0xFF before the first
+    5       1      confidence  probability of that class as round(p * 255)
+
+The extended advertising set of a BLE 5 controller, and its periodic
+advertising, carry longer manufacturer data (tQxBTBroadcastExt):
+
+    offset  size   field
+    0       2      company     company identifier, QX_BT_COMPANY_ID
+    2       2      seq         the seq of the legacy data
+    4       4      uptime_s    device time in s
+    8       4      dropped     notifications the full queue dropped
+    12      1      connected   1 while a central is connected
+    13      8+n    result      the latest result, as a notification above
+
+A scanner reports every advertising packet, repeated seq are printed once.
+"""
+
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct('<HIBB')
+BROADCAST = struct.Struct('<HHBB')
+BROADCAST_EXT = struct.Struct('<HHIIB')
+
+
+def decode(value):
+    """One notification to a dict; raises ValueError when it is cut short."""
+    value = bytes(value)
+    if len(value) < HEADER.size:
+        raise ValueError('%d bytes, a result has at least %d' % (len(value), HEADER.size))
+    seq, time_ms, cls, count = HEADER.unpack_from(value)
+    if len(value) < HEADER.size + count:
+        raise ValueError('%d probabilities announced, %d sent' % (count, len(value) - HEADER.size))
+    probs = [b / 255.0 for b in value[HEADER.size:HEADER.size + count]]
+    return {'seq': seq, 'time_ms': time_ms, 'cls': cls, 'probs': probs}
+
+
+def decode_broadcast(value):
+    """Manufacturer data of one advertising packet to a dict."""
+    value = bytes(value)
+    if len(value) < BROADCAST.size:
+        raise ValueError('%d bytes, a broadcast has %d' % (len(value), BROADCAST.size))
+    if len(value) > BROADCAST.size:
+        return decode_broadcast_ext(value)
+    company, seq, cls, confidence = BROADCAST.unpack_from(value)
+    return {'company': company, 'seq': seq, 'cls': cls, 'confidence': confidence / 255.0}
+
+
+def decode_broadcast_ext(value):
+    """Manufacturer data of the extended set, the result included."""
+    if len(value) < BROADCAST_EXT.size + HEADER.size:
+        raise ValueError('%d bytes, an extended broadcast has at least %d' %
+                         (len(value), BROADCAST_EXT.size + HEADER.size))
+    company, seq, uptime_s, dropped, connected = BROADCAST_EXT.unpack_from(value)
+    result = decode(value[BROADCAST_EXT.size:])
+    return {'company': company, 'seq': seq, 'uptime_s': uptime_s, 'dropped': dropped,
+            'connected': bool(connected), 'result': result}
+
+
+class Tracker(object):
+    """Counts the results lost between notifications from the gaps in seq."""
+
+    def __init__(self):
+        self.seq = None
+        self.lost = 0
+
+    def feed(self, result):
+        if self.seq is not None:
+            self.lost += (result['seq'] - self.seq - 1) & 0xFFFF
+        self.seq = result['seq']
+        return result
+
+    def repeated(self, result):
+        """True for an advertising packet with the seq of the one before."""
+        return result['seq'] == self.seq
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('values', nargs='*', help='Notifications in hex, read from stdin when none.')
+    parser.add_argument('--broadcast', action='store_true',
+                        help='The values are manufacturer data of advertising packets.')
+    args = parser.parse_args()
+
+    tracker = Tracker()
+    ext_tracker = Tracker()
+    for text in (args.values or sys.stdin):
+        text = text.strip().replace(' ', '').replace(':', '')
+        if not text:
+            continue
+        try:
+            if args.broadcast:
+                r = decode_broadcast(bytearray.fromhex(text))
+            else:
+                r = decode(bytearray.fromhex(text))
+        except ValueError as e:
+            print('?? %s: %s' % (text, e))
+            continue
+        if args.broadcast and 'result' in r:
+            if ext_tracker.repeated(r):
+                continue
+            ext_tracker.feed(r)
+            res = r['result']
+            print('#%-5d company 0x%04x  up %d s  dropped %d%s  result #%d cls %s  %s' % (
+                r['seq'], r['company'], r['uptime_s'], r['dropped'], '  connected' if r['connected'] else '',
+                res['seq'], '-' if res['cls'] == 0xFF else res['cls'], ' '.join('%.3f' % p for p in res['probs'])))
+            continue
+        if args.broadcast:
+            if tracker.repeated(r):
+                continue
+            tracker.feed(r)
+            print('#%-5d company 0x%04x  cls %s  %.3f' % (r['seq'], r['company'],
+                                                         '-' if r['cls'] == 0xFF else r['cls'], r['confidence']))
+            continue
+        r = tracker.feed(r)
+        print('#%-5d %10.3f s  cls %d  %s' % (r['seq'], r['time_ms'] / 1e3, r['cls'],
+                                            ' '.join('%.3f' % p for p in r['probs'])))
+    if tracker.lost:
+        print('%d %s lost' % (tracker.lost, 'updates' if args.broadcast else 'results'))
+
+
+if __name__ == '__main__':
+    main()